@@ -0,0 +1,88 @@
+struct GpuObject
+{
+    float4 sphere;
+    uint2 constants;
+    uint indexCount;
+    uint startIndex;
+};
+
+struct IndirectCommand
+{
+    uint2 constants;
+    uint indexCountPerInstance;
+    uint instanceCount;
+    uint startIndexLocation;
+    int baseVertexLocation;
+    uint startInstanceLocation;
+};
+
+struct CullConstants
+{
+    float4 planes[6];
+    uint objectCount;
+};
+
+ConstantBuffer<CullConstants> cull : register(b0);
+StructuredBuffer<GpuObject> objects : register(t0);
+RWStructuredBuffer<IndirectCommand> commands : register(u0);
+RWByteAddressBuffer commandCount : register(u1);
+
+#define GROUP_SIZE 64
+
+groupshared uint prefix[GROUP_SIZE];
+
+bool IsVisible(float4 sphere)
+{
+    [unroll]
+    for (uint i = 0; i < 6; i++)
+    {
+        precise float distance = cull.planes[i].x * sphere.x + cull.planes[i].y * sphere.y + cull.planes[i].z * sphere.z + cull.planes[i].w;
+
+        if (distance < -sphere.w)
+            return false;
+    }
+
+    return true;
+}
+
+//a single group walks the objects in order so the compacted commands match the cpu reference exactly
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint thread : SV_GroupIndex)
+{
+    uint base = 0;
+
+    for (uint first = 0; first < cull.objectCount; first += GROUP_SIZE)
+    {
+        uint index = first + thread;
+        bool visible = index < cull.objectCount && IsVisible(objects[index].sphere);
+
+        prefix[thread] = visible ? 1 : 0;
+        GroupMemoryBarrierWithGroupSync();
+
+        for (uint stride = 1; stride < GROUP_SIZE; stride <<= 1)
+        {
+            uint value = thread >= stride ? prefix[thread - stride] : 0;
+            GroupMemoryBarrierWithGroupSync();
+            prefix[thread] += value;
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        if (visible)
+        {
+            IndirectCommand command;
+            command.constants = objects[index].constants;
+            command.indexCountPerInstance = objects[index].indexCount;
+            command.instanceCount = 1;
+            command.startIndexLocation = objects[index].startIndex;
+            command.baseVertexLocation = 0;
+            command.startInstanceLocation = 0;
+            commands[base + prefix[thread] - 1] = command;
+        }
+
+        base += prefix[GROUP_SIZE - 1];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (thread == 0)
+        commandCount.Store(0, base);
+}
@@ -19,6 +19,8 @@
 #include <windows.h>
 #undef _CRT_SECURE_NO_WARNINGS
 #include <shellscalingapi.h>
+#include <shellapi.h>
+#include <psapi.h>
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
@@ -36,12 +38,18 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
 #include <assert.h>
 #include <stdbool.h>
 #include <stdalign.h>
+#include <intrin.h>
 
 #pragma comment(linker, "/DEFAULTLIB:D3d12.lib")
 #pragma comment(linker, "/DEFAULTLIB:Shcore.lib")
+#pragma comment(linker, "/DEFAULTLIB:Shell32.lib")
 #pragma comment(linker, "/DEFAULTLIB:DXGI.lib")
 #pragma comment(linker, "/DEFAULTLIB:dxguid.lib")
 
@@ -110,16 +118,105 @@ inline void MEMCPY_VERIFY_IMPL(errno_t error, int line)
 
 #define MEMCPY_VERIFY(x) MEMCPY_VERIFY_IMPL(x, __LINE__)
 
+//comment out to compile the zone macros away entirely
+#define CPU_ZONES
+
+#define CPU_ZONE_RING_SIZE 65536
+#define CPU_ZONE_MAX_THREADS 16
+#define CPU_ZONE_BENCH_ITERATIONS 100000
+
+//a NULL name marks the end of the innermost open zone
+struct CpuZoneEvent
+{
+	UINT64 Timestamp;
+	const char* Name;
+};
+
+//written only by its owning thread, Head is published with release semantics for the exporter
+struct CpuZoneRing
+{
+	struct CpuZoneEvent Events[CPU_ZONE_RING_SIZE];
+	volatile LONG64 Head;
+	DWORD ThreadId;
+};
+
+struct CpuZoneRing* CpuZoneRings[CPU_ZONE_MAX_THREADS];
+volatile LONG CpuZoneRingCount;
+__declspec(thread) struct CpuZoneRing* CpuZoneThreadRing;
+__declspec(thread) bool bCpuZoneThreadUnregistered;
+
+UINT64 CpuZoneTscBase;
+LONGLONG CpuZoneQpcBase;
+
+struct CpuZoneRing* CpuZoneRegisterThread(void);
+
+inline void CpuZoneRecord(const char* Name)
+{
+	struct CpuZoneRing* Ring = CpuZoneThreadRing;
+
+	if (Ring == NULL)
+	{
+		//threads past CPU_ZONE_MAX_THREADS only try once
+		if (bCpuZoneThreadUnregistered)
+			return;
+
+		Ring = CpuZoneRegisterThread();
+
+		if (Ring == NULL)
+			return;
+	}
+
+	LONG64 Head = Ring->Head;
+	struct CpuZoneEvent* Event = &Ring->Events[Head & (CPU_ZONE_RING_SIZE - 1)];
+	Event->Timestamp = __rdtsc();
+	Event->Name = Name;
+	WriteRelease64(&Ring->Head, Head + 1);
+}
+
+#ifdef CPU_ZONES
+#define CPU_ZONE_BEGIN(Name) CpuZoneRecord(Name)
+#define CPU_ZONE_END() CpuZoneRecord(NULL)
+#else
+#define CPU_ZONE_BEGIN(Name)
+#define CPU_ZONE_END()
+#endif
+
+//xorshift64, the state must start nonzero
+inline UINT64 RandomNext(UINT64* restrict State)
+{
+	*State ^= *State << 13;
+	*State ^= *State >> 7;
+	*State ^= *State << 17;
+	return *State;
+}
+
+//uniform in [0, 1)
+inline float RandomFloat(UINT64* restrict State)
+{
+	return (float)(RandomNext(State) >> 40) / (float)(1 << 24);
+}
+
 LRESULT CALLBACK PreInitProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
-LRESULT CALLBACK IdleProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-static const bool bWarp = false;
 static const LPCTSTR WindowClassName = L"MinimalDx12";
 
 #define BUFFER_COUNT 3
 #define WM_INIT (WM_USER + 1)
 
+#define RETIRE_QUEUE_CAPACITY 64
+#define DEPTH_POOL_CAPACITY 4
+#define DEPTH_BUCKET_GRANULARITY 256
+#define RETIRE_SIM_FRAMES 1000
+
+#define MEMORY_MAX_ALLOCATIONS 128
+#define MEMORY_BENCH_ITERATIONS 65536
+
+#define RESIDENCY_MAX_OBJECTS 32
+#define RESIDENCY_BATCH_QUEUE 4
+#define RESIDENCY_SIM_OBJECTS 16
+#define RESIDENCY_SIM_FRAMES 600
+
 struct Vertex {
 	vec3 pos;
 	vec2 texCoord;
@@ -181,1230 +278,12061 @@ static const UINT TEXTURE_HEIGHT = 64;
 static const UINT BYTES_PER_TEXEL = 2;
 static const DXGI_FORMAT TEXTURE_FORMAT = DXGI_FORMAT_B5G6R5_UNORM;
 
+#define TEXTURE_MAX_SUBRESOURCES 256
+#define TEXTURE_BENCH_DIMENSION 1024
+#define TEXTURE_BENCH_LAYERS 2
+#define TEXTURE_BENCH_ITERATIONS 4096
+#define TEXTURE_COPY_ITERATIONS 16
+
+#define DDS_FOURCC(a, b, c, d) ((UINT32)(a) | (UINT32)(b) << 8 | (UINT32)(c) << 16 | (UINT32)(d) << 24)
+#define DDS_PF_FOURCC 0x4
+#define DDS_PF_RGB 0x40
+#define DDS_PF_LUMINANCE 0x20000
+#define DDS_CAPS2_CUBEMAP 0x200
+#define DDS_CAPS2_CUBEMAP_ALLFACES 0xFC00
+#define DDS_CAPS2_VOLUME 0x200000
+#define DDS_MISC_TEXTURECUBE 0x4
+
+struct DdsPixelFormat
+{
+	UINT32 Size;
+	UINT32 Flags;
+	UINT32 FourCC;
+	UINT32 RgbBitCount;
+	UINT32 RBitMask;
+	UINT32 GBitMask;
+	UINT32 BBitMask;
+	UINT32 ABitMask;
+};
+
+struct DdsHeader
+{
+	UINT32 Size;
+	UINT32 Flags;
+	UINT32 Height;
+	UINT32 Width;
+	UINT32 PitchOrLinearSize;
+	UINT32 Depth;
+	UINT32 MipMapCount;
+	UINT32 Reserved1[11];
+	struct DdsPixelFormat PixelFormat;
+	UINT32 Caps;
+	UINT32 Caps2;
+	UINT32 Caps3;
+	UINT32 Caps4;
+	UINT32 Reserved2;
+};
+
+struct DdsHeaderDx10
+{
+	UINT32 DxgiFormat;
+	UINT32 ResourceDimension;
+	UINT32 MiscFlag;
+	UINT32 ArraySize;
+	UINT32 MiscFlags2;
+};
+
+struct Ktx2Header
+{
+	UINT8 Identifier[12];
+	UINT32 VkFormat;
+	UINT32 TypeSize;
+	UINT32 PixelWidth;
+	UINT32 PixelHeight;
+	UINT32 PixelDepth;
+	UINT32 LayerCount;
+	UINT32 FaceCount;
+	UINT32 LevelCount;
+	UINT32 SupercompressionScheme;
+	UINT32 DfdByteOffset;
+	UINT32 DfdByteLength;
+	UINT32 KvdByteOffset;
+	UINT32 KvdByteLength;
+	UINT64 SgdByteOffset;
+	UINT64 SgdByteLength;
+};
+
+struct Ktx2Level
+{
+	UINT64 ByteOffset;
+	UINT64 ByteLength;
+	UINT64 UncompressedByteLength;
+};
+
+static_assert(sizeof(struct DdsHeader) == 124, "");
+static_assert(sizeof(struct DdsHeaderDx10) == 20, "");
+static_assert(sizeof(struct Ktx2Header) == 80, "");
+
+static const UINT8 Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+//a dds or ktx2 file mapped read only. the pixels point straight into the mapping,
+//indexed like d3d12 subresources, mip + slice * MipLevels
+struct TextureFile
+{
+	HANDLE File;
+	HANDLE FileMap;
+	const UINT8* Data;
+	UINT64 Size;
+
+	DXGI_FORMAT Format;
+	UINT Width;
+	UINT Height;
+	UINT ArraySize;
+	UINT MipLevels;
+	const UINT8* Pixels[TEXTURE_MAX_SUBRESOURCES];
+};
+
 static const DXGI_FORMAT RTV_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
 static const DXGI_FORMAT DSV_FORMAT = DXGI_FORMAT_D16_UNORM;
 
 static const UINT64 ConstantBufferPerObjectAlignedSize = (sizeof(mat4) + 255) & ~255;
 
-struct DxObjects
+static const UINT SWAP_CHAIN_FLAGS = DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING | DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+static const UINT PACING_FIXED_RATE_HZ = 60;
+static const UINT BACKGROUND_FRAME_RATE_HZ = 20;
+static const UINT OCCLUDED_PROBE_RATE_HZ = 4;
+
+#define ENCODER_ROOT_PARAMETERS 4
+
+#define COMMAND_STREAM_CAPACITY 65536
+#define COMMAND_STREAM_MAGIC 0x4358444D
+#define COMMAND_STREAM_VERSION 5
+#define REPLAY_ITERATIONS 1000
+
+#define CULL_MAX_OBJECTS 1024
+#define CULL_ROOT_CONSTANTS 25
+#define CULL_BENCH_OBJECTS 65536
+#define CULL_BENCH_ITERATIONS 16
+
+#define BUNDLE_BENCH_ITERATIONS 4096
+
+#define RESOLUTION_HISTORY 4
+#define RESOLUTION_SIM_PHASE_FRAMES 200
+#define UPSCALE_ROOT_CONSTANTS 4
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TILE_SIZE 8
+#define OCCLUSION_TILES_X (OCCLUSION_WIDTH / OCCLUSION_TILE_SIZE)
+#define OCCLUSION_TILES_Y (OCCLUSION_HEIGHT / OCCLUSION_TILE_SIZE)
+#define OCCLUSION_MAX_VERTICES 256
+#define OCCLUSION_BENCH_TRIANGLES 16384
+#define OCCLUSION_BENCH_ITERATIONS 16
+
+static_assert(OCCLUSION_WIDTH % OCCLUSION_TILE_SIZE == 0 && OCCLUSION_HEIGHT % OCCLUSION_TILE_SIZE == 0, "");
+static_assert(OCCLUSION_TILE_SIZE == 8, "a tile row is one avx2 register");
+
+#define PARTICLE_CAPACITY 65536
+#define PARTICLE_MAX_EMITTERS 8
+#define PARTICLE_MAX_CHUNKS 32
+#define PARTICLE_PARALLEL_THRESHOLD 16384
+#define PARTICLE_ROOT_CONSTANTS 24
+#define PARTICLE_BENCH_COUNT (1 << 20)
+#define PARTICLE_BENCH_FRAMES 16
+
+static_assert(PARTICLE_CAPACITY % 4 == 0 && PARTICLE_BENCH_COUNT % 4 == 0, "pools are walked four particles at a time");
+static_assert(PARTICLE_ROOT_CONSTANTS <= CULL_ROOT_CONSTANTS, "root constants are captured into CommandRootConstants");
+
+#define CLUSTER_TILES_X 16
+#define CLUSTER_TILES_Y 9
+#define CLUSTER_SLICES 24
+#define CLUSTER_COUNT (CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+#define CLUSTER_MAX_LIGHTS 1024
+#define CLUSTER_MAX_INDICES 65536
+#define CLUSTER_DEFAULT_LIGHTS 256
+#define CLUSTER_BENCH_MAX_INDICES (1 << 21)
+#define CLUSTER_BENCH_ITERATIONS 16
+#define CLUSTER_BENCH_SAMPLES 1024
+
+//the main pass's descriptor table for each frame slot: texture, lights, cluster ranges, light indices, shadow maps, static shadow maps, cluster constants, shadow constants
+#define MAIN_TABLE_BASE 2
+#define MAIN_TABLE_SIZE 8
+
+//each frame slot's light buffer holds the constants, then the lights, the ranges and the indices
+#define CLUSTER_CONSTANTS_SIZE 256
+#define CLUSTER_LIGHTS_OFFSET CLUSTER_CONSTANTS_SIZE
+#define CLUSTER_RANGES_OFFSET (CLUSTER_LIGHTS_OFFSET + CLUSTER_MAX_LIGHTS * sizeof(struct GpuLight))
+#define CLUSTER_INDICES_OFFSET (CLUSTER_RANGES_OFFSET + CLUSTER_COUNT * 2 * sizeof(UINT))
+#define CLUSTER_BUFFER_SIZE (CLUSTER_INDICES_OFFSET + CLUSTER_MAX_INDICES * sizeof(UINT))
+
+static_assert(CLUSTER_TILES_X % 4 == 0, "a row of tiles is tested four clusters at a time");
+
+static const UINT ClusterBenchLightCounts[] = { 1000, 2500, 5000, 10000 };
+
+#define SHADOW_CASCADES 4
+#define SHADOW_MAP_SIZE 1024
+#define SHADOW_FIRST_CACHED 2
+#define SHADOW_MAX_CASTERS 32
+#define SHADOW_DYNAMIC_CASTERS 2
+#define SHADOW_PILLARS 12
+#define SHADOW_BENCH_ITERATIONS 4096
+
+//each frame slot's shadow buffer holds the pixel shader's constants, the props' main pass constants, then one slot per cascade and caster
+#define SHADOW_CONSTANTS_SIZE 512
+#define SHADOW_OBJECTS_OFFSET SHADOW_CONSTANTS_SIZE
+#define SHADOW_CASTERS_OFFSET (SHADOW_OBJECTS_OFFSET + SHADOW_MAX_CASTERS * ConstantBufferPerObjectAlignedSize)
+#define SHADOW_BUFFER_SIZE (SHADOW_CASTERS_OFFSET + SHADOW_CASCADES * SHADOW_MAX_CASTERS * ConstantBufferPerObjectAlignedSize)
+
+static_assert(SHADOW_CASCADES == 4, "the split depths are one float4 in the shader");
+static_assert(SHADOW_FIRST_CACHED < SHADOW_CASCADES, "");
+static_assert(SHADOW_DYNAMIC_CASTERS + 1 + SHADOW_PILLARS <= SHADOW_MAX_CASTERS && SHADOW_MAX_CASTERS <= 256, "caster lists are UINT8");
+
+//one more slot than frames in flight, so the worker has a frame's time to write one out before the ring is full
+#define RECORDER_SLOTS (BUFFER_COUNT + 1)
+#define RECORDER_SIM_FRAMES 240
+#define RECORDER_SIM_WIDTH 61
+#define RECORDER_SIM_HEIGHT 17
+#define RECORDER_SIM_LATENCY 2
+#define RECORDER_SIM_STALL_BEGIN 100
+#define RECORDER_SIM_STALL_END 120
+
+static const UINT RECORDER_BITMAP_HEADER_SIZE = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+
+//one bit per task in the dependency masks
+#define STARTUP_MAX_TASKS 32
+#define STARTUP_SIM_TASKS 12
+#define STARTUP_SIM_SPIN_US 250
+
+#define LATENCY_MAX_INPUTS 64
+#define LATENCY_MAX_FRAMES 16
+#define LATENCY_HISTORY 1024
+#define LATENCY_SIM_FRAMES 600
+#define LATENCY_SIM_PERIOD 100000
+
+//one arena per frame in flight, threads bump through blocks of it they claim for themselves
+#define FRAME_ARENA_SIZE (8 * 1024 * 1024)
+#define FRAME_ARENA_BLOCK (64 * 1024)
+#define FRAME_ARENA_ALIGNMENT 16
+#define FRAME_ARENA_PAGE 4096
+#define FRAME_ARENA_SIM_WORKERS 8
+#define FRAME_ARENA_SIM_ALLOCATIONS 512
+#define FRAME_ARENA_SIM_MAX_SIZE 600
+#define FRAME_ARENA_BENCH_FRAMES 64
+#define FRAME_ARENA_BENCH_ALLOCATIONS 4096
+#define FRAME_ARENA_BENCH_MAX_SIZE 1024
+
+#define RADIX_SORT_MAX_CHUNKS 32
+#define RADIX_SORT_PARALLEL_THRESHOLD 16384
+#define DRAW_SORT_BENCH_PACKETS 131072
+#define DRAW_SORT_BENCH_ITERATIONS 16
+
+#define BENCHMARK_WARMUP_FRAMES 16
+#define BENCHMARK_DEFAULT_FRAMES 1000
+#define BENCHMARK_MAX_FRAMES (1 << 20)
+
+#define SCENE_SUITE_FRAMES 16
+#define SCENE_SUITE_WARMUP_FRAMES 2
+#define SCENE_SUITE_ROOTS 64
+#define SCENE_SUITE_MATERIALS 64
+#define SCENE_SUITE_PIPELINES 8
+#define SCENE_SUITE_MESHES 32
+#define SCENE_SUITE_CONSTANTS_BASE 0x100000000ull
+
+static const UINT SceneSuiteSizes[] = { 1000, 10000, 100000, 1000000 };
+static const float SCENE_SUITE_SPACING = 3.0f;
+static const float SCENE_DEFAULT_TOLERANCE = 0.15f;
+static const float SCENE_BASELINE_NOISE_MS = 0.02f;
+
+#define PROFILER_MAX_SCOPES 16
+#define PROFILER_MAX_DEPTH 8
+#define PROFILER_HISTORY 256
+#define PROFILER_QUERIES_PER_FRAME (PROFILER_MAX_SCOPES * 2)
+
+static const UINT PROFILER_CALIBRATION_INTERVAL = 120;
+
+static const float DRAW_KEY_MAX_DEPTH = 1000.0f;
+static const float CUBE_BOUNDING_RADIUS = 0.8660254f;
+static const float OCCLUSION_NEAR_W = 0.1f;
+static const float PARTICLE_GRAVITY = -4.0f;
+static const float PARTICLE_MAX_STEP = 0.1f;
+static const float CLUSTER_AMBIENT = 0.15f;
+static const float SHADOW_DISTANCE = 40.0f;
+static const float SHADOW_SPLIT_LAMBDA = 0.75f;
+static const float SHADOW_CASTER_RANGE = 50.0f;
+
+static const float RESOLUTION_MIN_SCALE = 0.5f;
+static const float RESOLUTION_MAX_SCALE = 1.0f;
+static const float RESOLUTION_STEP = 1.0f / 64.0f;
+static const float RESOLUTION_DEADBAND = 0.05f;
+static const float RESOLUTION_KP = 0.2f;
+static const float RESOLUTION_KI = 0.02f;
+static const float RESOLUTION_KD = 0.1f;
+static const float RESOLUTION_DEFAULT_BUDGET_MS = 1000.0f / 60.0f;
+
+enum PacingMode
 {
-	IDXGISwapChain3* SwapChain;
-	ID3D12CommandQueue* CommandQueue;
+	PACING_LOW_LATENCY,
+	PACING_THROUGHPUT,
+	PACING_FIXED_RATE,
+	PACING_MODE_COUNT
+};
 
-	UINT RtvDescriptorSize;
-	D3D12_CPU_DESCRIPTOR_HANDLE RtvHeapHandle;
-	ID3D12Resource* RenderTargets[BUFFER_COUNT];
+//all times are in QueryPerformanceCounter ticks
+struct PacingController
+{
+	enum PacingMode Mode;
+	bool bSynced;
 
-	ID3D12CommandAllocator* CommandAllocator;
-	ID3D12GraphicsCommandList7* CommandList;
-	ID3D12PipelineState* PipelineStateObject;
+	INT64 FixedInterval;
+	INT64 SafetyMargin;
 
-	ID3D12RootSignature* RootSignature;
+	INT64 CpuEstimate;
+	INT64 GpuEstimate;
+	INT64 RefreshEstimate;
 
-	ID3D12Resource* VertexBuffer;
-	ID3D12Resource* IndexBuffer;
+	INT64 LastSlot;
+	INT64 NextDeadline;
+};
 
-	D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
-	D3D12_INDEX_BUFFER_VIEW IndexBufferView;
+//objects released once the submit fence passes the value they were retired at, swept every frame
+struct RetireQueue
+{
+	IUnknown* Objects[RETIRE_QUEUE_CAPACITY];
+	UINT64 FenceValues[RETIRE_QUEUE_CAPACITY];
+	UINT64 Bytes[RETIRE_QUEUE_CAPACITY];
+	UINT Head;
+	UINT Count;
+
+	UINT64 PendingBytes;
+	UINT64 PeakPendingBytes;
+	UINT64 Released;
+	UINT OverflowWaits;
+};
 
-	ID3D12Resource* DepthStencilBuffer;
-	D3D12_CPU_DESCRIPTOR_HANDLE DsvHeapHandle;
+enum MemoryCategory
+{
+	MEMORY_UPLOAD,
+	MEMORY_CONSTANTS,
+	MEMORY_GEOMETRY,
+	MEMORY_TEXTURE,
+	MEMORY_RENDER_TARGET,
+	MEMORY_DEPTH,
+	MEMORY_GPU_BUFFER,
+	MEMORY_READBACK,
+	MEMORY_CPU,
+	MEMORY_CATEGORY_COUNT
+};
 
-	UINT8* ConstantBufferCPUAddress[BUFFER_COUNT];
-	D3D12_GPU_VIRTUAL_ADDRESS ContantBufferGPUAddress[BUFFER_COUNT];
+static const char* const MemoryCategoryNames[MEMORY_CATEGORY_COUNT] = {
+	"upload",
+	"constants",
+	"geometry",
+	"texture",
+	"render_target",
+	"depth",
+	"gpu_buffer",
+	"readback",
+	"cpu",
+};
 
-	ID3D12DescriptorHeap* SRVDescriptorHeap;
-	D3D12_GPU_DESCRIPTOR_HANDLE SrvGpuHandle;
+//always on, unlike SetName. the startup tasks allocate from the threadpool, so tracking takes the lock
+struct MemoryLedger
+{
+	SRWLOCK Lock;
+
+	const void* Objects[MEMORY_MAX_ALLOCATIONS];
+	const char* Labels[MEMORY_MAX_ALLOCATIONS];
+	UINT64 Sizes[MEMORY_MAX_ALLOCATIONS];
+	enum MemoryCategory Categories[MEMORY_MAX_ALLOCATIONS];
+	UINT Count;
+
+	UINT64 Live[MEMORY_CATEGORY_COUNT];
+	UINT64 Peak[MEMORY_CATEGORY_COUNT];
+	UINT64 Allocated[MEMORY_CATEGORY_COUNT];
+	UINT64 Freed[MEMORY_CATEGORY_COUNT];
+
+	//churn is bytes allocated plus bytes freed within one frame
+	UINT64 FrameChurn[MEMORY_CATEGORY_COUNT];
+	UINT64 LastFrameChurn[MEMORY_CATEGORY_COUNT];
+	UINT64 PeakFrameChurn[MEMORY_CATEGORY_COUNT];
+	UINT64 Frames;
 };
 
-struct SyncObjects
+struct MemoryLedger MemoryLedger;
+
+//a diff of two snapshots holds signed changes, except Peak which is the later snapshot's
+struct MemorySnapshot
 {
-	ID3D12Fence* Fence[BUFFER_COUNT];
-	HANDLE FenceEvent;
-	UINT64 FenceValue[BUFFER_COUNT];
-	int FrameIndex;
+	INT64 Frames;
+	INT64 Live[MEMORY_CATEGORY_COUNT];
+	INT64 Peak[MEMORY_CATEGORY_COUNT];
+	INT64 Allocated[MEMORY_CATEGORY_COUNT];
+	INT64 Freed[MEMORY_CATEGORY_COUNT];
 };
 
-struct WindowProcPayload
+//one frame's Evict and EnqueueMakeResident calls, holding a reference to every object in it until they are issued
+struct ResidencyBatch
 {
-	struct DxObjects* DxObjects;
-	struct SyncObjects* SyncObjects;
+	ID3D12Pageable* Evict[RESIDENCY_MAX_OBJECTS];
+	ID3D12Pageable* Resident[RESIDENCY_MAX_OBJECTS];
+	UINT EvictCount;
+	UINT ResidentCount;
+	UINT64 FenceValue;
 };
 
-inline void WaitForPreviousFrame(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects);
+//tracks the resources that can be paged out, LastUsed is the submit fence value of the last frame that referenced one
+struct ResidencyManager
+{
+	ID3D12Pageable* Objects[RESIDENCY_MAX_OBJECTS];
+	UINT64 Sizes[RESIDENCY_MAX_OBJECTS];
+	UINT64 LastUsed[RESIDENCY_MAX_OBJECTS];
+	bool bTracked[RESIDENCY_MAX_OBJECTS];
+	bool bResident[RESIDENCY_MAX_OBJECTS];
+	bool bUsed[RESIDENCY_MAX_OBJECTS];
+
+	UINT64 ResidentBytes;
+	UINT64 Budget;
+	UINT64 BudgetOverride;
+
+	HANDLE BudgetEvent;
+	DWORD BudgetCookie;
+
+	//Evict and MakeResident can take milliseconds, a thread pool worker issues them and the queue waits on the fence
+	PTP_WORK Work;
+	ID3D12Fence* Fence;
+	UINT64 FenceValue;
+
+	//the render thread queues batches and a single worker issues them in the same order, bWorkerActive keeps it single
+	struct ResidencyBatch Batches[RESIDENCY_BATCH_QUEUE];
+	volatile LONG64 BatchesQueued;
+	volatile LONG64 BatchesIssued;
+	volatile LONG bWorkerActive;
+
+	UINT64 Evictions;
+	UINT64 MakeResidents;
+	UINT64 OvercommittedFrames;
+	UINT64 QueueWaits;
+	UINT64 DroppedTracks;
+};
 
-int main()
+//depth buffers are allocated in DEPTH_BUCKET_GRANULARITY steps so a live drag reuses them
+struct DepthBufferPool
 {
-	ConsoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+	ID3D12Resource* Buffers[DEPTH_POOL_CAPACITY];
+	UINT Widths[DEPTH_POOL_CAPACITY];
+	UINT Heights[DEPTH_POOL_CAPACITY];
+	UINT64 LastUsed[DEPTH_POOL_CAPACITY];
+	UINT Count;
+};
 
-	THROW_ON_FAIL(SetProcessDpiAwareness(PROCESS_PER_MONITOR_DPI_AWARE));
-	
-	HINSTANCE Instance = GetModuleHandleW(NULL);
+//WM_SIZE only records the latest size, the frame loop applies it once
+struct ResizeRequest
+{
+	UINT Width;
+	UINT Height;
+	bool bPending;
+};
 
-	HICON Icon = LoadIconW(NULL, IDI_APPLICATION);
-	HCURSOR Cursor = LoadCursorW(NULL, IDC_ARROW);
+enum PowerState
+{
+	POWER_ACTIVE,
+	POWER_BACKGROUND,
+	POWER_OCCLUDED,
+	POWER_MINIMIZED,
+	POWER_STATE_COUNT
+};
 
-	WNDCLASSEXW WindowClass = { 0 };
-	WindowClass.cbSize = sizeof(WNDCLASSEXW);
-	WindowClass.style = CS_HREDRAW | CS_VREDRAW;
-	WindowClass.lpfnWndProc = PreInitProc;
-	WindowClass.cbClsExtra = 0;
-	WindowClass.cbWndExtra = 0;
-	WindowClass.hInstance = Instance;
-	WindowClass.hIcon = Icon;
-	WindowClass.hCursor = Cursor;
-	WindowClass.hbrBackground = (HBRUSH)(COLOR_WINDOW + 2);
-	WindowClass.lpszMenuName = NULL;
-	WindowClass.lpszClassName = WindowClassName;
-	WindowClass.hIconSm = Icon;
+//wall and CPU times are both in QueryPerformanceCounter ticks
+struct IdleScheduler
+{
+	enum PowerState State;
+	bool bMinimized;
+	bool bOccluded;
+	bool bFocused;
+
+	INT64 Frequency;
+	INT64 BackgroundInterval;
+	INT64 OccludedInterval;
+	INT64 NextFrame;
+
+	INT64 StateEntered;
+	INT64 StateCpuEntered;
+	INT64 WallTime[POWER_STATE_COUNT];
+	INT64 CpuTime[POWER_STATE_COUNT];
+};
 
-	ATOM WindowClassAtom = RegisterClassExW(&WindowClass);
-	if (WindowClassAtom == 0)
-		THROW_ON_FAIL(HRESULT_FROM_WIN32(GetLastError()));
+//scopes recorded into one back buffer's command list, resolved into its slice of the readback ring
+struct GpuProfilerFrame
+{
+	const char* Names[PROFILER_MAX_SCOPES];
+	UINT Depths[PROFILER_MAX_SCOPES];
+	UINT ScopeCount;
 
-	RECT WindowRect = { 0 };
-	WindowRect.left = 0;
-	WindowRect.top = 0;
-	WindowRect.right = 800;
-	WindowRect.bottom = 600;
+	UINT Stack[PROFILER_MAX_DEPTH];
+	UINT StackDepth;
+	UINT DroppedDepth;
 
-	THROW_ON_FALSE(AdjustWindowRect(&WindowRect, WS_OVERLAPPEDWINDOW, FALSE));
+	bool bPending;
+};
 
-	HWND Window = CreateWindowExW(
-		0,
-		WindowClassName,
-		L"Minimal DirectX 12",
-		WS_OVERLAPPEDWINDOW,
-		CW_USEDEFAULT,
-		CW_USEDEFAULT,
-		WindowRect.right - WindowRect.left,
-		WindowRect.bottom - WindowRect.top,
-		NULL,
-		NULL,
-		Instance,
-		NULL);
+//rolling durations in milliseconds
+struct GpuScopeStats
+{
+	const char* Name;
+	UINT Depth;
+	float Samples[PROFILER_HISTORY];
+	UINT SampleCount;
+	UINT NextSample;
+};
 
-	VALIDATE_HANDLE(Window);
+struct GpuProfiler
+{
+	ID3D12QueryHeap* QueryHeap;
+	ID3D12Resource* Readback;
+	UINT64* ReadbackData;
 
-	THROW_ON_FALSE(ShowWindow(Window, SW_SHOW));
+	UINT64 TimestampFrequency;
+	INT64 CpuFrequency;
 
-#ifdef _DEBUG
-	ID3D12Debug6* DebugController;
+	UINT64 GpuCalibration;
+	UINT64 CpuCalibration;
+	UINT FramesSinceCalibration;
 
-	{
-		ID3D12Debug* DebugControllerV1;
-		THROW_ON_FAIL(D3D12GetDebugInterface(&IID_ID3D12Debug, &DebugControllerV1));
-		THROW_ON_FAIL(ID3D12Debug_QueryInterface(DebugControllerV1, &IID_ID3D12Debug6, &DebugController));
-		ID3D12Debug_Release(DebugControllerV1);
-	}
+	struct GpuProfilerFrame Frames[BUFFER_COUNT];
+	struct GpuScopeStats Stats[PROFILER_MAX_SCOPES];
+	UINT StatsCount;
 
-	ID3D12Debug6_EnableDebugLayer(DebugController);
-	ID3D12Debug6_SetEnableSynchronizedCommandQueueValidation(DebugController, TRUE);
-	ID3D12Debug6_SetGPUBasedValidationFlags(DebugController, D3D12_GPU_BASED_VALIDATION_FLAGS_DISABLE_STATE_TRACKING);
-	ID3D12Debug6_SetEnableGPUBasedValidation(DebugController, TRUE);
-#endif
+	//root scope of the last collected frame, in QueryPerformanceCounter ticks
+	INT64 LastFrameCpuBegin;
+	INT64 LastFrameCpuEnd;
+};
 
-	IDXGIFactory6* Factory;
+enum CommandOp
+{
+	COMMAND_TEXTURE_BARRIER,
+	COMMAND_SET_RENDER_TARGET,
+	COMMAND_CLEAR_RENDER_TARGET,
+	COMMAND_CLEAR_DEPTH,
+	COMMAND_SET_PIPELINE_STATE,
+	COMMAND_SET_ROOT_SIGNATURE,
+	COMMAND_SET_DESCRIPTOR_HEAP,
+	COMMAND_SET_ROOT_TABLE,
+	COMMAND_SET_VIEWPORT,
+	COMMAND_SET_SCISSOR,
+	COMMAND_SET_TOPOLOGY,
+	COMMAND_SET_VERTEX_BUFFER,
+	COMMAND_SET_INDEX_BUFFER,
+	COMMAND_SET_ROOT_CBV,
+	COMMAND_DRAW_INDEXED,
+	COMMAND_BUFFER_BARRIER,
+	COMMAND_SET_COMPUTE_ROOT_SIGNATURE,
+	COMMAND_SET_COMPUTE_ROOT_CONSTANTS,
+	COMMAND_SET_COMPUTE_ROOT_SRV,
+	COMMAND_SET_COMPUTE_ROOT_UAV,
+	COMMAND_DISPATCH,
+	COMMAND_EXECUTE_INDIRECT,
+	COMMAND_EXECUTE_BUNDLE,
+	COMMAND_SET_ROOT_CONSTANTS,
+	COMMAND_DRAW,
+	COMMAND_OP_COUNT
+};
 
-#ifdef _DEBUG
-	THROW_ON_FAIL(CreateDXGIFactory2(DXGI_CREATE_FACTORY_DEBUG, &IID_IDXGIFactory6, &Factory));
-#else
-	THROW_ON_FAIL(CreateDXGIFactory2(0, &IID_IDXGIFactory6, &Factory));
-#endif
+static const char* const CommandOpNames[COMMAND_OP_COUNT] = {
+	"TextureBarrier",
+	"SetRenderTarget",
+	"ClearRenderTarget",
+	"ClearDepth",
+	"SetPipelineState",
+	"SetRootSignature",
+	"SetDescriptorHeap",
+	"SetRootTable",
+	"SetViewport",
+	"SetScissor",
+	"SetTopology",
+	"SetVertexBuffer",
+	"SetIndexBuffer",
+	"SetRootCbv",
+	"DrawIndexed",
+	"BufferBarrier",
+	"SetComputeRootSig",
+	"SetComputeConstants",
+	"SetComputeRootSrv",
+	"SetComputeRootUav",
+	"Dispatch",
+	"ExecuteIndirect",
+	"ExecuteBundle",
+	"SetRootConstants",
+	"Draw",
+};
 
-	struct DxObjects DxObjects = { 0 };
+//calls issued to the command list and calls dropped as redundant, per op
+struct EncoderStats
+{
+	UINT64 Issued[COMMAND_OP_COUNT];
+	UINT64 Elided[COMMAND_OP_COUNT];
+};
 
-	IDXGIAdapter1* Adapter;
+//one bundle per frame slot since each slot draws with its own constant buffer
+struct BundleCache
+{
+	ID3D12CommandAllocator* Allocators[BUFFER_COUNT];
+	ID3D12GraphicsCommandList7* Bundles[BUFFER_COUNT];
+	UINT64 Keys[BUFFER_COUNT];
+	UINT DrawCounts[BUFFER_COUNT];
+
+	struct EncoderStats Stats;
+	UINT64 Hits;
+	UINT64 Rebuilds;
+	bool bEnabled;
+};
 
-	if (bWarp)
-	{
-		IDXGIFactory6_EnumWarpAdapter(Factory, &IID_IDXGIAdapter1, &Adapter);
-	}
-	else
-	{
-		IDXGIFactory6_EnumAdapterByGpuPreference(Factory, 0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, &IID_IDXGIAdapter1, &Adapter);
-	}
+//matches GpuObject in CullShader.hlsl, Constants is the draw's root cbv address
+struct GpuObject
+{
+	vec4 Sphere;
+	UINT ConstantsLow;
+	UINT ConstantsHigh;
+	UINT IndexCount;
+	UINT StartIndex;
+};
 
-	THROW_ON_FAIL(D3D12CreateDevice(Adapter, D3D_FEATURE_LEVEL_12_1, &IID_ID3D12Device10, &Device));
+//matches IndirectCommand in CullShader.hlsl, a root cbv followed by D3D12_DRAW_INDEXED_ARGUMENTS
+struct IndirectCommand
+{
+	UINT ConstantsLow;
+	UINT ConstantsHigh;
+	UINT IndexCountPerInstance;
+	UINT InstanceCount;
+	UINT StartIndexLocation;
+	INT BaseVertexLocation;
+	UINT StartInstanceLocation;
+};
 
-	THROW_ON_FAIL(IDXGIAdapter1_Release(Adapter));
+static_assert(sizeof(struct IndirectCommand) == 28, "");
 
-#ifdef _DEBUG
-	ID3D12InfoQueue* InfoQueue;
-	THROW_ON_FAIL(ID3D12Device10_QueryInterface(Device, &IID_ID3D12InfoQueue, &InfoQueue));
+//passed as CULL_ROOT_CONSTANTS root constants, planes point inwards
+struct CullConstants
+{
+	vec4 Planes[6];
+	UINT ObjectCount;
+};
 
-	THROW_ON_FAIL(ID3D12InfoQueue_SetBreakOnSeverity(InfoQueue, D3D12_MESSAGE_SEVERITY_CORRUPTION, TRUE));
-	THROW_ON_FAIL(ID3D12InfoQueue_SetBreakOnSeverity(InfoQueue, D3D12_MESSAGE_SEVERITY_ERROR, TRUE));
-	THROW_ON_FAIL(ID3D12InfoQueue_SetBreakOnSeverity(InfoQueue, D3D12_MESSAGE_SEVERITY_WARNING, TRUE));
-#endif
+struct GpuCulling
+{
+	ID3D12RootSignature* RootSignature;
+	ID3D12PipelineState* PipelineState;
+	ID3D12CommandSignature* CommandSignature;
 
-	{
-		D3D12_COMMAND_QUEUE_DESC CommandQueueDesc = { 0 };
-		CommandQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-		CommandQueueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
-		CommandQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-		THROW_ON_FAIL(ID3D12Device10_CreateCommandQueue(Device, &CommandQueueDesc, &IID_ID3D12CommandQueue, &DxObjects.CommandQueue));
-	}
+	ID3D12Resource* ObjectBuffers[BUFFER_COUNT];
+	struct GpuObject* ObjectData[BUFFER_COUNT];
+	struct CullConstants Constants[BUFFER_COUNT];
 
-	{
-		DXGI_SWAP_CHAIN_DESC SwapChainDesc = { 0 };
-		SwapChainDesc.BufferDesc.Width = 1;
-		SwapChainDesc.BufferDesc.Height = 1;
-		SwapChainDesc.BufferDesc.Format = RTV_FORMAT;
-		SwapChainDesc.SampleDesc.Count = 1;
-		SwapChainDesc.SampleDesc.Quality = 0;
-		SwapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		SwapChainDesc.BufferCount = BUFFER_COUNT;
-		SwapChainDesc.OutputWindow = Window;
-		SwapChainDesc.Windowed = TRUE;
-		SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-		SwapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
-		THROW_ON_FAIL(IDXGIFactory6_CreateSwapChain(Factory, DxObjects.CommandQueue, &SwapChainDesc, &DxObjects.SwapChain));
-	}
+	ID3D12Resource* CommandBuffer;
+	ID3D12Resource* CountBuffer;
+	ID3D12Resource* Readback;
 
-	THROW_ON_FAIL(IDXGIFactory6_MakeWindowAssociation(Factory, Window, DXGI_MWA_NO_ALT_ENTER));
-	THROW_ON_FAIL(IDXGIFactory6_Release(Factory));
-	
-	struct SyncObjects SyncObjects = { 0 };
+	bool bEnabled;
+};
 
-	SyncObjects.FrameIndex = IDXGISwapChain3_GetCurrentBackBufferIndex(DxObjects.SwapChain);
+enum ParticleStream
+{
+	PARTICLE_POSITION_X,
+	PARTICLE_POSITION_Y,
+	PARTICLE_POSITION_Z,
+	PARTICLE_VELOCITY_X,
+	PARTICLE_VELOCITY_Y,
+	PARTICLE_VELOCITY_Z,
+	PARTICLE_AGE,
+	PARTICLE_LIFE,
+	PARTICLE_SIZE,
+	PARTICLE_STREAM_COUNT
+};
 
-	ID3D12DescriptorHeap* RtvDescriptorHeap;
+//matches the per instance input layout of ParticleVertexShader.hlsl, Color is rgba8 with the fade in alpha
+struct ParticleInstance
+{
+	vec3 Position;
+	float Size;
+	UINT Color;
+};
 
-	{
-		D3D12_DESCRIPTOR_HEAP_DESC RtvHeapDesc = { 0 };
-		RtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-		RtvHeapDesc.NumDescriptors = BUFFER_COUNT;
-		RtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-		THROW_ON_FAIL(ID3D12Device10_CreateDescriptorHeap(Device, &RtvHeapDesc, &IID_ID3D12DescriptorHeap, &RtvDescriptorHeap));
-	}
+static_assert(sizeof(struct ParticleInstance) == 20, "");
 
-	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(RtvDescriptorHeap, &DxObjects.RtvHeapHandle);
-	
-	DxObjects.RtvDescriptorSize = ID3D12Device10_GetDescriptorHandleIncrementSize(Device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+//structure of arrays, one set is live and the other is what the next step compacts into
+struct ParticlePool
+{
+	float* Streams[2][PARTICLE_STREAM_COUNT];
+	UINT* Colors[2];
+	UINT Current;
+	UINT Count;
+	UINT Capacity;
+};
 
-	THROW_ON_FAIL(ID3D12Device10_CreateCommandAllocator(Device, D3D12_COMMAND_LIST_TYPE_DIRECT, &IID_ID3D12CommandAllocator, &DxObjects.CommandAllocator));
-	
-	THROW_ON_FAIL(ID3D12Device10_CreateCommandList(Device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT, DxObjects.CommandAllocator, NULL, &IID_ID3D12GraphicsCommandList7, &DxObjects.CommandList));
+//spawns Rate particles a second, but never more than Budget in one frame
+struct ParticleEmitter
+{
+	vec3 Position;
+	vec3 Velocity;
+	float Spread;
+	float Rate;
+	float Life;
+	float Size;
+	UINT Color;
+	UINT Budget;
+	float Pending;
+};
 
-	for (int i = 0; i < BUFFER_COUNT; i++)
-	{
-		THROW_ON_FAIL(ID3D12Device10_CreateFence(Device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, &SyncObjects.Fence[i]));
-		SyncObjects.FenceValue[i] = 0;
-	}
+//the count phase sizes each chunk's survivors, the scatter phase integrates and writes them out at their offsets
+struct ParticleJob
+{
+	struct ParticlePool* Pool;
+	struct ParticleInstance* Instances;
+	float DeltaTime;
+	UINT Count;
+	UINT ChunkCount;
+	bool bScatter;
+	volatile LONG NextChunk;
+	UINT Offsets[PARTICLE_MAX_CHUNKS];
+};
 
-	SyncObjects.FenceEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
-	VALIDATE_HANDLE(SyncObjects.FenceEvent);
+struct ParticleSystem
+{
+	struct ParticlePool Pool;
+	struct ParticleEmitter Emitters[PARTICLE_MAX_EMITTERS];
+	UINT EmitterCount;
+	UINT64 Random;
 
-	{
-		D3D12_DESCRIPTOR_RANGE1  DescriptorRange = { 0 };
-		DescriptorRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-		DescriptorRange.NumDescriptors = 1;
-		DescriptorRange.BaseShaderRegister = 0;
-		DescriptorRange.RegisterSpace = 0;
-		DescriptorRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
-		DescriptorRange.OffsetInDescriptorsFromTableStart = 0;
+	UINT WorkerCount;
+	PTP_WORK Work;
+	struct ParticleJob Job;
 
-		D3D12_ROOT_PARAMETER1  RootParameters[2] = { 0 };
-		RootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-		RootParameters[0].Descriptor.ShaderRegister = 0;
-		RootParameters[0].Descriptor.RegisterSpace = 0;
-		RootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+	UINT64 Spawned;
+	UINT64 Dropped;
 
-		RootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-		RootParameters[1].DescriptorTable.NumDescriptorRanges = 1;
-		RootParameters[1].DescriptorTable.pDescriptorRanges = &DescriptorRange;
-		RootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	ID3D12RootSignature* RootSignature;
+	ID3D12PipelineState* PipelineState;
+	ID3D12Resource* InstanceBuffers[BUFFER_COUNT];
+	struct ParticleInstance* InstanceData[BUFFER_COUNT];
+	D3D12_VERTEX_BUFFER_VIEW InstanceViews[BUFFER_COUNT];
+	UINT InstanceCounts[BUFFER_COUNT];
 
-		D3D12_STATIC_SAMPLER_DESC Sampler = { 0 };
-		Sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
-		Sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-		Sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-		Sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
-		Sampler.MipLODBias = 0;
-		Sampler.MaxAnisotropy = 0;
-		Sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
-		Sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
-		Sampler.MinLOD = 0.0f;
-		Sampler.MaxLOD = D3D12_FLOAT32_MAX;
-		Sampler.ShaderRegister = 0;
-		Sampler.RegisterSpace = 0;
-		Sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	bool bEnabled;
+};
 
-		D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDesc = { 0 };
-		RootSignatureDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
-		RootSignatureDesc.Desc_1_1.NumParameters = ARRAYSIZE(RootParameters);
-		RootSignatureDesc.Desc_1_1.pParameters = RootParameters;
-		RootSignatureDesc.Desc_1_1.NumStaticSamplers = 1;
-		RootSignatureDesc.Desc_1_1.pStaticSamplers = &Sampler;
-		RootSignatureDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
-			D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
-			D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
-			D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+//one light as the pixel shader reads it, in view space
+struct GpuLight
+{
+	vec3 Position;
+	float Radius;
+	vec3 Color;
+	float Padding;
+};
 
-		ID3D10Blob* Signature;
-		THROW_ON_FAIL(D3D12SerializeVersionedRootSignature(&RootSignatureDesc, &Signature, NULL));
-		THROW_ON_FAIL(ID3D12Device10_CreateRootSignature(Device, 0, ID3D10Blob_GetBufferPointer(Signature), ID3D10Blob_GetBufferSize(Signature), &IID_ID3D12RootSignature, &DxObjects.RootSignature));
-		THROW_ON_FAIL(ID3D10Blob_Release(Signature));
-	}
+static_assert(sizeof(struct GpuLight) == 32, "matches the shader's Light");
+static_assert(CLUSTER_RANGES_OFFSET % (2 * sizeof(UINT)) == 0 && CLUSTER_INDICES_OFFSET % sizeof(UINT) == 0, "each view starts on a whole element");
 
-	HANDLE VertexShaderFile = CreateFileW(L"VertexShader.cso", GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-	VALIDATE_HANDLE(VertexShaderFile);
+//at the head of each frame slot's light buffer, read by the pixel shader as b1
+struct ClusterConstants
+{
+	float Viewport[4];
+	float Projection[4];
+	float SliceScale;
+	float SliceBias;
+	float Ambient;
+	UINT bEnabled;
+	UINT Grid[4];
+};
+
+//the view frustum cut into screen tiles and exponential depth slices, each cluster gets a compact list of the lights touching it
+struct ClusterGrid
+{
+	float Projection[4];
+	float Near;
+	float Far;
+	float SliceDepths[CLUSTER_SLICES + 1];
+
+	//view space bounds of every cluster, x fastest, then y from the top of the screen, then slice
+	float* MinX;
+	float* MinY;
+	float* MinZ;
+	float* MaxX;
+	float* MaxY;
+	float* MaxZ;
+
+	//(cluster, light) pairs in light order, counting sorted into the per cluster lists
+	UINT* Counts;
+	UINT* PairClusters;
+	UINT* PairLights;
+	UINT IndexCapacity;
+
+	UINT64 Dropped;
+};
+
+//a light circling the cubes
+struct SceneLight
+{
+	float Orbit;
+	float Height;
+	float Phase;
+	float Speed;
+	float Radius;
+	vec3 Color;
+};
+
+struct ClusteredLighting
+{
+	struct ClusterGrid Grid;
+	struct SceneLight* Lights;
+	struct GpuLight* ViewLights;
+	UINT LightCount;
+	UINT IndexCount;
+	float Time;
+
+	ID3D12Resource* Buffers[BUFFER_COUNT];
+	UINT8* BufferData[BUFFER_COUNT];
+	D3D12_GPU_DESCRIPTOR_HANDLE Tables[BUFFER_COUNT];
+
+	bool bEnabled;
+};
+
+//at the head of each frame slot's shadow buffer, read by the pixel shader as b2. a view space position goes straight to a cascade's clip space
+struct ShadowConstants
+{
+	mat4 ViewToShadow[SHADOW_CASCADES];
+	float Splits[4];
+	float SunDirection[4];
+	float SunColor[4];
+	UINT bEnabled;
+	UINT FirstCached;
+	UINT Padding[2];
+};
+
+static_assert(sizeof(struct ShadowConstants) <= SHADOW_CONSTANTS_SIZE, "");
+
+//a bounding sphere of one slice of the view frustum, in a light space box a whole number of texels from the origin so the map does not swim as the camera moves
+struct ShadowCascade
+{
+	float Near;
+	float Far;
+	float Radius;
+	INT32 Offset[3];
+	vec3 Center;
+	mat4 ViewProj;
+};
+
+//a box drawn with the cube mesh, Depth orders the props in the main pass
+struct ShadowCaster
+{
+	mat4 WorldMat;
+	float Radius;
+	float Depth;
+	bool bStatic;
+};
+
+//the first SHADOW_FIRST_CACHED cascades draw everything every frame. the rest draw the static casters into a cache that is only redrawn when the cascade's box or the static casters change, and the dynamic ones on top every frame
+struct ShadowMaps
+{
+	vec3 LightDirection;
+	mat4 LightView;
+	struct ShadowCascade Cascades[SHADOW_CASCADES];
+
+	//what each cached cascade's static map was last drawn with
+	INT32 CachedOffsets[SHADOW_CASCADES][3];
+	float CachedRadii[SHADOW_CASCADES];
+	UINT CachedVersions[SHADOW_CASCADES];
+	bool bCacheValid[SHADOW_CASCADES];
+	bool bCacheDirty[SHADOW_CASCADES];
+	UINT StaticVersion;
+
+	//the two cubes, then the props
+	struct ShadowCaster Casters[SHADOW_MAX_CASTERS];
+	UINT CasterCount;
+
+	UINT8 LiveCasters[SHADOW_CASCADES][SHADOW_MAX_CASTERS];
+	UINT8 StaticCasters[SHADOW_CASCADES][SHADOW_MAX_CASTERS];
+	UINT LiveCounts[SHADOW_CASCADES];
+	UINT StaticCounts[SHADOW_CASCADES];
+
+	ID3D12Resource* Maps;
+	ID3D12Resource* StaticMaps;
+	ID3D12DescriptorHeap* DsvHeap;
+	D3D12_CPU_DESCRIPTOR_HANDLE DsvStart;
+	UINT DsvDescriptorSize;
+	ID3D12PipelineState* PipelineState;
+
+	ID3D12Resource* Buffers[BUFFER_COUNT];
+	UINT8* BufferData[BUFFER_COUNT];
+	D3D12_GPU_VIRTUAL_ADDRESS BufferAddresses[BUFFER_COUNT];
+
+	UINT64 StaticRenders;
+	UINT64 CacheHits;
+	UINT64 CasterDraws;
+	UINT64 CulledCasters;
+
+	bool bEnabled;
+};
+
+enum RecorderSlotState
+{
+	RECORDER_SLOT_FREE,
+	RECORDER_SLOT_PENDING,
+	RECORDER_SLOT_ENCODING
+};
+
+//back buffer copies on their way to disk. a slot is filled by the GPU, mapped once the submit fence has passed it and handed to
+//a thread pool worker that writes it out. the render thread only ever looks at slot states, a frame with no free slot is dropped
+struct FrameRecorder
+{
+	ID3D12Resource* Buffers[RECORDER_SLOTS];
+	UINT8* Data[RECORDER_SLOTS];
+	UINT8* Bitmaps[RECORDER_SLOTS];
+	UINT64 FenceValues[RECORDER_SLOTS];
+	UINT FrameNumbers[RECORDER_SLOTS];
+	volatile LONG States[RECORDER_SLOTS];
+
+	//slots are filled and collected in order, so the pending ones run from Tail up to Head
+	UINT Head;
+	UINT Tail;
+	INT Current;
+
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT Footprint;
+	UINT64 BufferSize;
+	UINT BitmapSize;
+
+	//each submit is matched by exactly one slot in the handoff ring
+	PTP_WORK Work;
+	SRWLOCK Lock;
+	UINT Handoff[RECORDER_SLOTS];
+	UINT HandoffHead;
+	UINT HandoffCount;
+
+	WCHAR Directory[MAX_PATH];
+	UINT FrameNumber;
+
+	UINT64 Captured;
+	UINT64 Dropped;
+	volatile LONG64 Encoded;
+	volatile LONG64 EncodedBytes;
+	volatile LONG64 EncodeTicks;
+	volatile LONG64 Checksum;
+
+	bool bEnabled;
+};
+
+//a task only runs once every task in its Dependencies has finished. Proc is NULL for phases main times itself
+struct StartupTask
+{
+	const char* Name;
+	void (*Proc)(void* Context);
+	void* Context;
+	UINT Dependencies;
+	volatile LONG Waiting;
+	PTP_WORK Work;
+	struct StartupGraph* Graph;
+
+	LONGLONG Begin;
+	LONGLONG End;
+	DWORD ThreadId;
+};
+
+//tasks can only depend on the ones added before them, so the graph can't have a cycle
+struct StartupGraph
+{
+	struct StartupTask Tasks[STARTUP_MAX_TASKS];
+	UINT Count;
+	UINT Scheduled;
+	UINT Waited;
+
+	LONGLONG Frequency;
+	LONGLONG Begin;
+};
+
+struct StartupSimTask
+{
+	volatile LONG* Sequence;
+	LONGLONG SpinTicks;
+	volatile LONG Runs;
+	LONG Started;
+	LONG Finished;
+};
+
+struct LatencyHistory
+{
+	float Samples[LATENCY_HISTORY];
+	UINT SampleCount;
+	UINT NextSample;
+};
+
+//all times are in QueryPerformanceCounter ticks
+struct LatencyTracker
+{
+	INT64 Frequency;
+
+	//inputs no presented frame has shown yet, the first Tagged of them went into the frame being built
+	INT64 Pending[LATENCY_MAX_INPUTS];
+	UINT PendingCount;
+	UINT Tagged;
+
+	//presents the frame statistics have not caught up with, oldest first
+	UINT PresentCounts[LATENCY_MAX_FRAMES];
+	INT64 PresentTimes[LATENCY_MAX_FRAMES];
+	UINT FrameHead;
+	UINT FrameCount;
+
+	bool bSynced;
+	UINT LastPresentCount;
+	UINT LastPresentRefresh;
+	UINT LastSyncRefresh;
+	INT64 LastSyncTime;
+	INT64 RefreshPeriod;
+
+	struct LatencyHistory InputToPresent;
+	struct LatencyHistory PresentToDisplay;
+
+	UINT64 Inputs;
+	UINT64 LostInputs;
+	UINT64 Presented;
+	UINT64 Displayed;
+	UINT64 Dropped;
+	UINT64 Repeated;
+	UINT64 Disjoints;
+};
+
+//Claimed only grows until the reset, so no byte is handed out twice in a frame. Generation is unique across every arena and reset
+struct FrameArena
+{
+	UINT8* Base;
+	volatile LONG64 Claimed;
+	volatile LONG Generation;
+	bool bGuardPages;
+
+	UINT64 HighWater;
+	UINT64 Resets;
+	volatile LONG64 Overflows;
+};
+
+//the block a thread is bumping through, stale as soon as the arena it came from gets a new generation
+struct FrameArenaCursor
+{
+	LONG Generation;
+	UINT8* Next;
+	UINT8* End;
+};
+
+__declspec(thread) struct FrameArenaCursor FrameArenaThreadCursor;
+volatile LONG FrameArenaGenerations;
+
+struct FrameArenaSim
+{
+	struct FrameArena* Arena;
+	volatile LONG NextWorker;
+	UINT8* Allocations[FRAME_ARENA_SIM_WORKERS][FRAME_ARENA_SIM_ALLOCATIONS];
+	UINT Sizes[FRAME_ARENA_SIM_WORKERS][FRAME_ARENA_SIM_ALLOCATIONS];
+};
+
+//everything needed to issue one draw
+struct DrawPacket
+{
+	ID3D12PipelineState* PipelineState;
+	ID3D12RootSignature* RootSignature;
+	D3D12_GPU_DESCRIPTOR_HANDLE DescriptorTable;
+	const D3D12_VERTEX_BUFFER_VIEW* VertexBuffer;
+	const D3D12_INDEX_BUFFER_VIEW* IndexBuffer;
+	D3D12_GPU_VIRTUAL_ADDRESS Constants;
+	UINT IndexCount;
+};
+
+struct DrawSortEntry
+{
+	UINT64 Key;
+	UINT Index;
+};
+
+//one radix pass is a histogram phase and a scatter phase, each split into ChunkCount pieces
+struct RadixSortJob
+{
+	struct DrawSortEntry* Source;
+	struct DrawSortEntry* Dest;
+	UINT Count;
+	UINT ChunkCount;
+	UINT Shift;
+	bool bScatter;
+	volatile LONG NextChunk;
+	UINT Offsets[RADIX_SORT_MAX_CHUNKS][256];
+};
+
+struct DrawQueue
+{
+	struct DrawPacket* Packets;
+	struct DrawSortEntry* Entries;
+	struct DrawSortEntry* Scratch;
+	UINT Count;
+	UINT Capacity;
+	UINT64 Dropped;
+
+	//without it the packets and entries come from a frame arena and are only good for that frame
+	bool bOwnsStorage;
+
+	UINT WorkerCount;
+	PTP_WORK SortWork;
+	struct RadixSortJob Job;
+};
+
+//a small depth buffer the occluders are rasterized into, with the farthest depth of each tile for testing bounds
+struct OcclusionBuffer
+{
+	float* Depth;
+	float* TileMaxDepth;
+
+	UINT64 Tested;
+	UINT64 Culled;
+
+	bool bAvx2;
+	bool bEnabled;
+};
+
+//PID on the normalized frame time error, the output scales the pixel count so the response is roughly linear in cost
+struct ResolutionController
+{
+	float TargetMs;
+	float Scale;
+	float Integral;
+	float PreviousError;
+
+	float History[RESOLUTION_HISTORY];
+	UINT HistoryCount;
+	UINT NextHistory;
+
+	bool bEnabled;
+};
+
+struct DxObjects
+{
+	IDXGIAdapter3* Adapter;
+	IDXGISwapChain3* SwapChain;
+	ID3D12CommandQueue* CommandQueue;
+
+	UINT RtvDescriptorSize;
+	D3D12_CPU_DESCRIPTOR_HANDLE RtvHeapHandle;
+	ID3D12Resource* RenderTargets[BUFFER_COUNT];
+
+	ID3D12CommandAllocator* CommandAllocators[BUFFER_COUNT];
+	ID3D12GraphicsCommandList7* CommandList;
+	ID3D12PipelineState* PipelineStateObject;
+
+	ID3D12RootSignature* RootSignature;
+
+	ID3D12Resource* VertexBuffer;
+	ID3D12Resource* IndexBuffer;
+	ID3D12Resource* Texture;
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView;
+
+	ID3D12Resource* DepthStencilBuffer;
+	UINT DepthStencilWidth;
+	UINT DepthStencilHeight;
+	struct DepthBufferPool DepthBufferPool;
+	D3D12_CPU_DESCRIPTOR_HANDLE DsvHeapHandle;
+
+	UINT8* ConstantBufferCPUAddress[BUFFER_COUNT];
+	D3D12_GPU_VIRTUAL_ADDRESS ContantBufferGPUAddress[BUFFER_COUNT];
+
+	ID3D12DescriptorHeap* SRVDescriptorHeap;
+	D3D12_GPU_DESCRIPTOR_HANDLE SrvGpuHandle;
+	UINT SrvDescriptorSize;
+
+	//window sized, the scene renders into its top left corner at the controller's scale
+	ID3D12Resource* SceneColor;
+	D3D12_CPU_DESCRIPTOR_HANDLE SceneColorRtv;
+	D3D12_GPU_DESCRIPTOR_HANDLE SceneColorSrv;
+
+	ID3D12RootSignature* UpscaleRootSignature;
+	ID3D12PipelineState* UpscalePipelineState;
+
+	struct GpuProfiler Profiler;
+	struct DrawQueue DrawQueue;
+	struct EncoderStats EncoderStats;
+	struct GpuCulling Culling;
+	struct BundleCache Bundles;
+	struct OcclusionBuffer Occlusion;
+	struct ParticleSystem Particles;
+	struct ClusteredLighting Lighting;
+	struct ShadowMaps Shadows;
+	struct FrameRecorder Recorder;
+	struct ResolutionController Resolution;
+	struct ResidencyManager Residency;
+	struct StartupGraph Startup;
+	struct FrameArena FrameArenas[BUFFER_COUNT];
+};
+
+struct SyncObjects
+{
+	ID3D12Fence* Fence[BUFFER_COUNT];
+	HANDLE FenceEvent;
+	UINT64 FenceValue[BUFFER_COUNT];
+	int FrameIndex;
+
+	ID3D12Fence* SubmitFence;
+	UINT64 SubmitFenceValue;
+	struct RetireQueue RetireQueue;
+
+	HANDLE FrameLatencyWaitable;
+	HANDLE PacingTimer;
+	HANDLE IdleFenceEvent;
+};
+
+struct Scene
+{
+	mat4 cube1RotMat;
+	vec3 cube1Position;
+	mat4 cube1WorldMat;
+
+	mat4 cube2RotMat;
+	vec3 cube2PositionOffset;
+	mat4 cube2WorldMat;
+
+	mat4 cameraViewMat;
+	mat4 cameraProjMat;
+
+	float cube1Depth;
+	float cube2Depth;
+};
+
+//every packet starts with this, Size covers the header and is a multiple of 8
+struct CommandPacketHeader
+{
+	UINT16 Op;
+	UINT16 Size;
+	UINT32 Padding;
+};
 
+static_assert(sizeof(struct CommandPacketHeader) % 8 == 0, "payloads hold 8 byte handles and gpu addresses");
+
+struct CommandRenderTarget
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE Rtv;
+	D3D12_CPU_DESCRIPTOR_HANDLE Dsv;
+};
+
+struct CommandClear
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE View;
+	float Values[4];
+};
+
+//shared by root descriptor tables and root cbvs
+struct CommandRootArgument
+{
+	UINT Index;
+	UINT64 Value;
+};
+
+struct CommandRootConstants
+{
+	UINT Index;
+	UINT Count;
+	UINT Values[CULL_ROOT_CONSTANTS];
+};
+
+struct CommandExecuteIndirect
+{
+	ID3D12CommandSignature* Signature;
+	ID3D12Resource* ArgumentBuffer;
+	ID3D12Resource* CountBuffer;
+	UINT MaxCommandCount;
+};
+
+struct CommandDraw
+{
+	UINT IndexCount;
+	UINT InstanceCount;
+	UINT StartIndex;
+	INT BaseVertex;
+	UINT StartInstance;
+};
+
+//object pointers and addresses are captured as they were, so a trace only replays on the device of the process that made it
+struct CommandStream
+{
+	UINT8* Data;
+	UINT Used;
+	UINT PacketCount;
+	bool bOverflow;
+};
+
+//the state last bound on the command list, zero means unbound
+struct EncoderShadow
+{
+	ID3D12PipelineState* PipelineState;
+	ID3D12RootSignature* RootSignature;
+	ID3D12DescriptorHeap* DescriptorHeap;
+	UINT64 RootArguments[ENCODER_ROOT_PARAMETERS];
+
+	struct CommandRenderTarget RenderTarget;
+	D3D12_VIEWPORT Viewport;
+	D3D12_RECT ScissorRect;
+	bool bViewport;
+	bool bScissor;
+
+	D3D12_PRIMITIVE_TOPOLOGY Topology;
+	D3D12_VERTEX_BUFFER_VIEW VertexBuffer;
+	D3D12_INDEX_BUFFER_VIEW IndexBuffer;
+};
+
+//drops calls that would rebind the current state, then forwards to CommandList and appends to Capture, either may be NULL
+struct CommandEncoder
+{
+	ID3D12GraphicsCommandList7* CommandList;
+	struct CommandStream* Capture;
+	struct EncoderStats* Stats;
+	struct EncoderShadow Shadow;
+};
+
+struct CommandStreamFileHeader
+{
+	UINT32 Magic;
+	UINT32 Version;
+	UINT32 PacketCount;
+	UINT32 Size;
+};
+
+struct TraceWriter
+{
+	HANDLE File;
+	int Used;
+	bool bOverflow;
+	char Buffer[65536];
+};
+
+//parsed from the command line, --headless renders offscreen with no window or swap chain
+struct BenchmarkOptions
+{
+	bool bHeadless;
+	bool bWarp;
+	UINT Width;
+	UINT Height;
+	UINT FrameCount;
+	double Seconds;
+	WCHAR ReportPath[MAX_PATH];
+	WCHAR CapturePath[MAX_PATH];
+	WCHAR ReplayPath[MAX_PATH];
+	bool bGpuCulling;
+	bool bBundles;
+	bool bOcclusion;
+	bool bParticles;
+	bool bLights;
+	UINT LightCount;
+	bool bShadows;
+	WCHAR RecordPath[MAX_PATH];
+	bool bDynamicResolution;
+	float FrameBudgetMs;
+	UINT ResidencyBudgetMB;
+	WCHAR MemoryReportPath[MAX_PATH];
+	WCHAR TexturePath[MAX_PATH];
+	WCHAR SceneSuitePath[MAX_PATH];
+	WCHAR SceneBaselinePath[MAX_PATH];
+	float SceneTolerance;
+	UINT SceneMaxObjects;
+	bool bArenaGuard;
+};
+
+//what main keeps hold of while the startup tasks fill it in
+struct StartupObjects
+{
+	struct DxObjects* DxObjects;
+	struct SyncObjects* SyncObjects;
+	const struct BenchmarkOptions* Options;
+
+#ifdef _DEBUG
+	ID3D12Debug6* DebugController;
+	ID3D12InfoQueue* InfoQueue;
+#endif
+
+	IDXGIFactory6* Factory;
+
+	ID3D12DescriptorHeap* RtvDescriptorHeap;
+	ID3D12DescriptorHeap* DepthStencilDescriptorHeap;
+	ID3D12Resource* ConstantBufferHeaps[BUFFER_COUNT];
+
+	HANDLE VertexShaderFile;
+	HANDLE VertexShaderFileMap;
+	const void* VertexShaderBytecode;
 	LONGLONG VertexShaderSize;
-	THROW_ON_FALSE(GetFileSizeEx(VertexShaderFile, &VertexShaderSize));
 
-	HANDLE VertexShaderFileMap = CreateFileMappingW(VertexShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
-	VALIDATE_HANDLE(VertexShaderFileMap);
+	HANDLE PixelShaderFile;
+	HANDLE PixelShaderFileMap;
+	const void* PixelShaderBytecode;
+	LONGLONG PixelShaderSize;
+
+	struct TextureFile TextureFile;
+	bool bTextureFile;
+};
+
+struct TimeSummary
+{
+	float Min;
+	float Avg;
+	float P50;
+	float P90;
+	float P99;
+	float Max;
+};
+
+enum SceneWorkload
+{
+	SCENE_WORKLOAD_CUBES,
+	SCENE_WORKLOAD_MESHES,
+	SCENE_WORKLOAD_HIERARCHY,
+	SCENE_WORKLOAD_COUNT
+};
+
+static const char* const SceneWorkloadNames[SCENE_WORKLOAD_COUNT] = {
+	"cubes",
+	"meshes",
+	"hierarchy",
+};
+
+enum SceneStage
+{
+	SCENE_STAGE_UPDATE,
+	SCENE_STAGE_CULL,
+	SCENE_STAGE_SORT,
+	SCENE_STAGE_RECORD,
+	SCENE_STAGE_COUNT
+};
+
+static const char* const SceneStageNames[SCENE_STAGE_COUNT] = {
+	"update",
+	"cull",
+	"sort",
+	"record",
+};
+
+//cubes share one mesh and material, meshes vary both, hierarchy also parents most objects to an earlier one
+struct GeneratedScene
+{
+	enum SceneWorkload Workload;
+	UINT ObjectCount;
+	float Extent;
+
+	//offset from the parent, w is the spin in radians per frame
+	vec4* Locals;
+	//UINT_MAX for roots, otherwise always a lower index so one pass in order resolves the hierarchy
+	UINT* Parents;
+	UINT16* Materials;
+	UINT16* Meshes;
+
+	mat4* World;
+	mat4* Constants;
+	struct GpuObject* Objects;
+	struct IndirectCommand* Visible;
+};
+
+//stage times are medians over the measured frames
+struct SceneResult
+{
+	char Name[32];
+	UINT ObjectCount;
+	UINT Visible;
+	UINT64 StateChanges;
+	float StageMs[SCENE_STAGE_COUNT];
+	float BaselineMs[SCENE_STAGE_COUNT];
+	bool bBaseline;
+	bool bRegressed[SCENE_STAGE_COUNT];
+};
+
+struct WindowProcPayload
+{
+	struct DxObjects* DxObjects;
+	struct SyncObjects* SyncObjects;
+	struct IdleScheduler* IdleScheduler;
+};
+
+void ResetScene(struct Scene* restrict Scene, UINT Width, UINT Height);
+void UpdateScene(struct Scene* restrict Scene, float MovementFactor, UINT8* ConstantBuffer);
+UINT RecordFrame(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, UINT FrameIndex, const D3D12_VIEWPORT* Viewport, const D3D12_RECT* ScissorRect, struct CommandStream* Capture);
+
+void CreateGpuCulling(struct DxObjects* restrict DxObjects);
+void FreeGpuCulling(struct GpuCulling* restrict Culling);
+UINT RecordGpuDrivenDraws(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, UINT FrameIndex, struct CommandEncoder* restrict Encoder);
+inline void SetGpuObject(struct GpuObject* restrict Object, const mat4 WorldMat, float Radius, D3D12_GPU_VIRTUAL_ADDRESS Constants);
+UINT CullObjectsReference(const struct GpuObject* restrict Objects, const struct CullConstants* restrict Constants, struct IndirectCommand* restrict Commands);
+bool ValidateGpuCulling(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT* restrict GpuCount, UINT* restrict CpuCount);
+double BenchmarkCullReference(void);
+
+void CreateBundleCache(struct BundleCache* restrict Cache);
+void FreeBundleCache(struct BundleCache* restrict Cache);
+UINT64 BundleKey(const struct DrawQueue* restrict Queue, ID3D12DescriptorHeap* DescriptorHeap);
+inline bool BundleCacheLookup(struct BundleCache* restrict Cache, UINT Slot, UINT64 Key);
+UINT RecordCubeDraws(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, UINT FrameIndex, struct CommandEncoder* restrict Encoder);
+void BenchmarkBundleRecording(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, double* restrict DirectMicroseconds, double* restrict BundleMicroseconds);
+
+void CreateUpscalePipeline(struct DxObjects* restrict DxObjects);
+void CreateSceneColor(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height);
+void InitResolutionController(struct ResolutionController* restrict Controller, float TargetMs);
+
+void LedgerTrack(struct MemoryLedger* restrict Ledger, const void* Object, enum MemoryCategory Category, UINT64 Size, const char* Label);
+bool LedgerUntrack(struct MemoryLedger* restrict Ledger, const void* Object);
+void LedgerEndFrame(struct MemoryLedger* restrict Ledger);
+void MemoryTrack(const void* Object, enum MemoryCategory Category, UINT64 Size, const char* Label);
+void MemoryTrackResource(ID3D12Resource* Resource, enum MemoryCategory Category, const D3D12_RESOURCE_DESC1* Desc, const char* Label);
+bool MemoryUntrack(const void* Object);
+UINT64 MemoryTrackedSize(const void* Object);
+void MemoryEndFrame(void);
+void MemoryTakeSnapshot(struct MemorySnapshot* restrict Snapshot);
+void MemoryDiffSnapshots(const struct MemorySnapshot* restrict Before, const struct MemorySnapshot* restrict After, struct MemorySnapshot* restrict Diff);
+void PrintMemorySnapshot(const struct MemorySnapshot* restrict Snapshot);
+void ExportMemoryReport(LPCWSTR Path);
+inline void TraceWrite(struct TraceWriter* restrict Writer, const char* Format, ...);
+inline void TraceFlush(struct TraceWriter* restrict Writer);
+double BenchmarkMemoryAccounting(void);
+
+void InitResidencyManager(struct ResidencyManager* restrict Manager, IDXGIAdapter3* Adapter);
+void FreeResidencyManager(struct ResidencyManager* restrict Manager, IDXGIAdapter3* Adapter);
+void ResidencyTrack(struct ResidencyManager* restrict Manager, ID3D12Resource* Resource, const D3D12_RESOURCE_DESC1* Desc);
+void ResidencyUntrack(struct ResidencyManager* restrict Manager, ID3D12Resource* Resource);
+UINT PlanResidency(struct ResidencyManager* restrict Manager, UINT64 Budget, UINT64 FenceValue, UINT64 CompletedValue, UINT* restrict Evicted, UINT* restrict MadeResident, UINT* restrict MadeResidentCount);
+void FlushResidency(struct ResidencyManager* restrict Manager, IDXGIAdapter3* Adapter, ID3D12CommandQueue* CommandQueue, UINT64 FenceValue, UINT64 CompletedValue);
+VOID CALLBACK ResidencyWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+bool SimulateResidency(UINT64* restrict Evictions, UINT64* restrict MakeResidents, UINT64* restrict OvercommittedFrames);
+float UpdateResolutionScale(struct ResolutionController* restrict Controller, float FrameMs);
+void SimulateResolutionController(float TargetMs, UINT* restrict SettleFrames, float* restrict Scales, float* restrict FrameMs);
+
+bool OpenTextureFile(struct TextureFile* restrict Texture, LPCWSTR Path);
+void CloseTextureFile(struct TextureFile* restrict Texture);
+bool ParseDdsTexture(struct TextureFile* restrict Texture, const UINT8* Data, UINT64 Size);
+bool ParseKtx2Texture(struct TextureFile* restrict Texture, const UINT8* Data, UINT64 Size);
+bool ValidateTextureFile(const struct TextureFile* restrict Texture);
+inline UINT TextureSurfaceInfo(DXGI_FORMAT Format, UINT Width, UINT Height, UINT64* restrict RowBytes, UINT* restrict RowCount);
+void DescribeTextureFile(const struct TextureFile* restrict Texture, D3D12_RESOURCE_DESC1* restrict Desc);
+void CopyTextureSubresources(const struct TextureFile* restrict Texture, UINT8* restrict Dest, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* Layouts, const UINT* RowCounts, const UINT64* RowSizes);
+void UploadTextureFile(struct DxObjects* restrict DxObjects, const struct TextureFile* restrict Texture, ID3D12Resource** restrict Resource, ID3D12Resource** restrict UploadHeap);
+bool BenchmarkTextureLoader(double* restrict DdsParseMicroseconds, double* restrict Ktx2ParseMicroseconds, double* restrict CopyGigabytesPerSecond);
+
+void InitOcclusionBuffer(struct OcclusionBuffer* restrict Buffer);
+void FreeOcclusionBuffer(struct OcclusionBuffer* restrict Buffer);
+void ClearOcclusionBuffer(struct OcclusionBuffer* restrict Buffer);
+void RasterizeOccluder(struct OcclusionBuffer* restrict Buffer, const mat4 WorldViewProj, const struct Vertex* Vertices, UINT VertexCount, const WORD* Indices, UINT IndexCount);
+void RasterizeOcclusionTriangle(struct OcclusionBuffer* restrict Buffer, const float* V0, const float* V1, const float* V2, bool bAvx2);
+inline void RasterizeOcclusionSpanAvx2(float* restrict Depth, int MinX, int MaxX, float Py, const float* restrict EdgeA, const float* restrict EdgeB, const float* restrict EdgeC, const float* restrict Plane);
+void BuildOcclusionHierarchy(struct OcclusionBuffer* restrict Buffer);
+bool OcclusionTestBox(struct OcclusionBuffer* restrict Buffer, const mat4 WorldViewProj, const vec3 Min, const vec3 Max);
+bool BenchmarkOcclusionRaster(double* restrict ScalarMilliseconds, double* restrict Avx2Milliseconds);
+
+void InitParticleSystem(struct ParticleSystem* restrict System, UINT Capacity);
+void FreeParticleSystem(struct ParticleSystem* restrict System);
+void CreateParticleRenderer(struct ParticleSystem* restrict System);
+void FreeParticleRenderer(struct ParticleSystem* restrict System);
+void AddParticleEmitter(struct ParticleSystem* restrict System, const struct ParticleEmitter* restrict Emitter);
+void EmitParticles(struct ParticleSystem* restrict System, float DeltaTime);
+VOID CALLBACK ParticleWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+inline void RunParticlePhase(struct ParticleSystem* restrict System);
+UINT SimulateParticles(struct ParticleSystem* restrict System, float DeltaTime, struct ParticleInstance* restrict Instances);
+UINT RecordParticleDraw(struct ParticleSystem* restrict System, const struct Scene* restrict Scene, UINT FrameIndex, struct CommandEncoder* restrict Encoder);
+bool BenchmarkParticles(double* restrict SingleMilliseconds, double* restrict ParallelMilliseconds, UINT* restrict WorkerCount, UINT* restrict AliveCount);
+void InitClusterGrid(struct ClusterGrid* restrict Grid, UINT IndexCapacity);
+void FreeClusterGrid(struct ClusterGrid* restrict Grid);
+void BuildClusterBounds(struct ClusterGrid* restrict Grid, const mat4 ProjMat);
+inline UINT ClusterTile(float Ndc, UINT TileCount);
+inline UINT ClusterSlice(const struct ClusterGrid* restrict Grid, float Depth);
+inline bool ClusterLightBounds(const struct ClusterGrid* restrict Grid, const struct GpuLight* restrict Light, UINT* restrict Bounds);
+UINT BinClusterLights(struct ClusterGrid* restrict Grid, const struct GpuLight* restrict Lights, UINT LightCount, bool bSimd, UINT* restrict Ranges, UINT* restrict Indices);
+void CreateClusteredLighting(struct DxObjects* restrict DxObjects, UINT LightCount);
+void FreeClusteredLighting(struct ClusteredLighting* restrict Lighting);
+void UpdateClusteredLights(struct ClusteredLighting* restrict Lighting, const struct Scene* restrict Scene, float DeltaTime, UINT FrameIndex);
+void WriteClusterConstants(const struct ClusteredLighting* restrict Lighting, const struct Scene* restrict Scene, UINT FrameIndex, const D3D12_VIEWPORT* Viewport);
+bool BenchmarkClusteredLights(double* restrict ScalarMilliseconds, double* restrict SimdMilliseconds, UINT* restrict IndexCounts, bool* restrict bConservative);
+void InitShadowCasters(struct ShadowMaps* restrict Shadows);
+void CreateShadowMaps(struct DxObjects* restrict DxObjects);
+void FreeShadowMaps(struct ShadowMaps* restrict Shadows);
+void FitShadowCascades(struct ShadowCascade* restrict Cascades, const mat4 LightView, const mat4 ViewMat, const mat4 ProjMat);
+UINT UpdateShadowCache(struct ShadowMaps* restrict Shadows);
+void CullShadowCasters(struct ShadowMaps* restrict Shadows);
+void MoveShadowCaster(struct ShadowMaps* restrict Shadows, UINT Index, const mat4 WorldMat);
+inline float ShadowCasterRadius(const mat4 WorldMat);
+inline bool ShadowCascadeTest(const struct ShadowCascade* restrict Cascade, const mat4 LightView, const struct ShadowCaster* restrict Caster);
+void UpdateShadows(struct ShadowMaps* restrict Shadows, const struct Scene* restrict Scene, UINT FrameIndex);
+void WriteShadowConstants(const struct ShadowMaps* restrict Shadows, const struct Scene* restrict Scene, UINT FrameIndex);
+UINT RecordShadowPasses(struct DxObjects* restrict DxObjects, UINT FrameIndex, struct CommandEncoder* restrict Encoder);
+bool ValidateShadowCascades(UINT* restrict StaticRenders, double* restrict FitMicroseconds);
+
+void CreateFrameRecorder(struct FrameRecorder* restrict Recorder, LPCWSTR Directory);
+void FreeFrameRecorder(struct FrameRecorder* restrict Recorder);
+void CreateRecorderBuffers(struct FrameRecorder* restrict Recorder, ID3D12Resource* BackBuffer);
+void FreeRecorderBuffers(struct FrameRecorder* restrict Recorder);
+void InitRecorderBitmaps(struct FrameRecorder* restrict Recorder, UINT Width, UINT Height);
+void FreeRecorderBitmaps(struct FrameRecorder* restrict Recorder);
+INT AcquireRecorderSlot(struct FrameRecorder* restrict Recorder, UINT64 FenceValue);
+void BeginFrameRecording(struct FrameRecorder* restrict Recorder, ID3D12Resource* BackBuffer, UINT64 FenceValue);
+void RecordReadbackCopy(struct FrameRecorder* restrict Recorder, ID3D12GraphicsCommandList7* CommandList, ID3D12Resource* BackBuffer);
+UINT CollectFrameRecordings(struct FrameRecorder* restrict Recorder, UINT64 CompletedValue);
+void FinishFrameRecordings(struct FrameRecorder* restrict Recorder);
+VOID CALLBACK FrameRecorderWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+UINT EncodeBitmap(const UINT8* restrict Source, UINT RowPitch, UINT Width, UINT Height, UINT8* restrict Destination);
+inline UINT64 BitmapChecksum(const UINT8* Data, UINT Size);
+bool SimulateFrameRecorder(UINT64* restrict Encoded, UINT64* restrict Dropped);
+
+void InitStartupGraph(struct StartupGraph* restrict Graph);
+UINT AddStartupTask(struct StartupGraph* restrict Graph, const char* Name, void (*Proc)(void* Context), void* Context, UINT Dependencies);
+void LaunchStartupGraph(struct StartupGraph* restrict Graph);
+VOID CALLBACK StartupTaskWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+void WaitStartupTasks(struct StartupGraph* restrict Graph, UINT Tasks);
+void FinishStartupGraph(struct StartupGraph* restrict Graph);
+UINT BeginStartupPhase(struct StartupGraph* restrict Graph, const char* Name);
+void EndStartupPhase(struct StartupGraph* restrict Graph, UINT Phase);
+double StartupMilliseconds(const struct StartupGraph* restrict Graph, double* restrict SerialMilliseconds);
+void ReportStartup(const struct StartupGraph* restrict Graph);
+void SimulatedStartupTask(void* Context);
+bool ValidateStartupGraph(double* restrict Milliseconds, double* restrict SerialMilliseconds);
+void StartupDevice(void* Context);
+void StartupShaders(void* Context);
+void StartupTextureFile(void* Context);
+void StartupRootSignature(void* Context);
+void StartupCommandObjects(void* Context);
+void StartupFrameResources(void* Context);
+void StartupPipelineState(void* Context);
+void StartupDrawSystems(void* Context);
+void StartupLighting(void* Context);
+
+void InitLatencyTracker(struct LatencyTracker* restrict Latency, INT64 Frequency);
+inline void LatencyRecordInput(struct LatencyTracker* restrict Latency, INT64 Now);
+inline void LatencyBeginFrame(struct LatencyTracker* restrict Latency);
+void LatencyPresented(struct LatencyTracker* restrict Latency, UINT PresentCount, INT64 Now);
+void LatencyFrameStatistics(struct LatencyTracker* restrict Latency, const DXGI_FRAME_STATISTICS* Statistics);
+void LatencyDisjoint(struct LatencyTracker* restrict Latency);
+inline void LatencyAddSample(struct LatencyHistory* restrict History, float Milliseconds);
+void LatencySummarize(const struct LatencyHistory* restrict History, struct TimeSummary* restrict Summary);
+void ReportLatency(const struct LatencyTracker* restrict Latency);
+bool SimulateLatencyTimeline(UINT64* restrict Dropped, UINT64* restrict Repeated, struct TimeSummary* restrict InputToPresent, struct TimeSummary* restrict PresentToDisplay);
+
+void CreateFrameArena(struct FrameArena* restrict Arena, bool bGuardPages);
+void FreeFrameArena(struct FrameArena* restrict Arena);
+inline LONG64 ClaimFrameArena(struct FrameArena* restrict Arena, SIZE_T Size);
+void* FrameAlloc(struct FrameArena* restrict Arena, SIZE_T Size);
+void* FrameAllocGuarded(struct FrameArena* restrict Arena, SIZE_T Size);
+void ResetFrameArena(struct FrameArena* restrict Arena);
+void ReportFrameArenas(const struct FrameArena* Arenas, UINT Count);
+VOID CALLBACK FrameArenaSimWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+bool ValidateFrameArena(UINT64* restrict HighWater);
+void BenchmarkFrameArena(double* restrict ArenaMicroseconds, double* restrict MallocMicroseconds);
+
+void InitDrawQueue(struct DrawQueue* restrict Queue, UINT Capacity);
+void FreeDrawQueue(struct DrawQueue* restrict Queue);
+void BeginFrameDrawQueue(struct DrawQueue* restrict Queue, struct FrameArena* restrict Arena, UINT Capacity);
+inline UINT64 MakeDrawKey(UINT Layer, UINT Pipeline, UINT RootSignature, UINT DescriptorTable, UINT Mesh, float Depth);
+inline void PushDrawPacket(struct DrawQueue* restrict Queue, UINT64 Key, const struct DrawPacket* restrict Packet);
+VOID CALLBACK RadixSortWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work);
+inline void RunRadixPhase(struct DrawQueue* restrict Queue);
+void SortDrawQueue(struct DrawQueue* restrict Queue);
+UINT SubmitDrawQueue(const struct DrawQueue* restrict Queue, struct CommandEncoder* restrict Encoder);
+
+void InitCommandEncoder(struct CommandEncoder* restrict Encoder, ID3D12GraphicsCommandList7* CommandList, ID3D12PipelineState* InitialState, struct CommandStream* Capture, struct EncoderStats* Stats);
+inline bool EncoderFilter(struct CommandEncoder* restrict Encoder, enum CommandOp Op, bool bRedundant);
+inline void CaptureCommand(struct CommandStream* restrict Stream, enum CommandOp Op, const void* Payload, UINT Size);
+inline void EncodeTextureBarrier(struct CommandEncoder* restrict Encoder, const D3D12_TEXTURE_BARRIER* Barrier);
+inline void EncodeSetRenderTarget(struct CommandEncoder* restrict Encoder, D3D12_CPU_DESCRIPTOR_HANDLE Rtv, D3D12_CPU_DESCRIPTOR_HANDLE Dsv);
+inline void EncodeClearRenderTarget(struct CommandEncoder* restrict Encoder, D3D12_CPU_DESCRIPTOR_HANDLE Rtv, const float Color[4]);
+inline void EncodeClearDepth(struct CommandEncoder* restrict Encoder, D3D12_CPU_DESCRIPTOR_HANDLE Dsv, float Depth);
+inline void EncodeSetPipelineState(struct CommandEncoder* restrict Encoder, ID3D12PipelineState* PipelineState);
+inline void EncodeSetRootSignature(struct CommandEncoder* restrict Encoder, ID3D12RootSignature* RootSignature);
+inline void EncodeSetDescriptorHeap(struct CommandEncoder* restrict Encoder, ID3D12DescriptorHeap* Heap);
+inline void EncodeSetRootTable(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_DESCRIPTOR_HANDLE Handle);
+inline void EncodeSetViewport(struct CommandEncoder* restrict Encoder, const D3D12_VIEWPORT* Viewport);
+inline void EncodeSetScissor(struct CommandEncoder* restrict Encoder, const D3D12_RECT* ScissorRect);
+inline void EncodeSetTopology(struct CommandEncoder* restrict Encoder, D3D12_PRIMITIVE_TOPOLOGY Topology);
+inline void EncodeSetVertexBuffer(struct CommandEncoder* restrict Encoder, const D3D12_VERTEX_BUFFER_VIEW* View);
+inline void EncodeSetIndexBuffer(struct CommandEncoder* restrict Encoder, const D3D12_INDEX_BUFFER_VIEW* View);
+inline void EncodeSetRootCbv(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_VIRTUAL_ADDRESS Address);
+inline void EncodeDrawIndexed(struct CommandEncoder* restrict Encoder, UINT IndexCount, UINT InstanceCount, UINT StartIndex, INT BaseVertex, UINT StartInstance);
+inline void EncodeBufferBarrier(struct CommandEncoder* restrict Encoder, const D3D12_BUFFER_BARRIER* Barrier);
+inline void EncodeSetComputeRootSignature(struct CommandEncoder* restrict Encoder, ID3D12RootSignature* RootSignature);
+inline void EncodeSetComputeRootConstants(struct CommandEncoder* restrict Encoder, UINT Index, UINT Count, const void* Values);
+inline void EncodeSetComputeRootSrv(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_VIRTUAL_ADDRESS Address);
+inline void EncodeSetComputeRootUav(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_VIRTUAL_ADDRESS Address);
+inline void EncodeDispatch(struct CommandEncoder* restrict Encoder, UINT X, UINT Y, UINT Z);
+inline void EncodeExecuteIndirect(struct CommandEncoder* restrict Encoder, ID3D12CommandSignature* Signature, UINT MaxCommandCount, ID3D12Resource* ArgumentBuffer, ID3D12Resource* CountBuffer);
+inline void EncodeExecuteBundle(struct CommandEncoder* restrict Encoder, ID3D12GraphicsCommandList7* Bundle);
+inline void EncodeSetRootConstants(struct CommandEncoder* restrict Encoder, UINT Index, UINT Count, const void* Values);
+inline void EncodeDraw(struct CommandEncoder* restrict Encoder, UINT VertexCount, UINT InstanceCount, UINT StartVertex, UINT StartInstance);
+
+inline void ResidencyUse(struct ResidencyManager* restrict Manager, ID3D12Resource* Resource);
+inline UINT64 ResourceAllocationSize(const D3D12_RESOURCE_DESC1* Desc);
+void ReplayCommandStream(const struct CommandStream* restrict Stream, ID3D12GraphicsCommandList7* CommandList, UINT* restrict OpCounts);
+void WriteCommandStream(const struct CommandStream* restrict Stream, LPCWSTR Path);
+void LoadCommandStream(struct CommandStream* restrict Stream, LPCWSTR Path);
+void RunReplayBenchmark(const struct BenchmarkOptions* restrict Options);
+void GenerateScene(struct GeneratedScene* restrict Scene, enum SceneWorkload Workload, UINT ObjectCount);
+void FreeGeneratedScene(struct GeneratedScene* restrict Scene);
+void SceneCameraPath(const struct GeneratedScene* restrict Scene, UINT Frame, mat4 ViewMat, mat4 ProjMat);
+void UpdateGeneratedScene(struct GeneratedScene* restrict Scene, UINT Frame, const mat4 ViewProjMat);
+void RunSceneBenchmark(struct GeneratedScene* restrict Scene, struct DrawQueue* restrict Queue, struct SceneResult* restrict Result);
+bool ReadSceneBaseline(const char* Baseline, const char* Name, float* restrict StageMs);
+UINT RunSceneSuite(const struct BenchmarkOptions* restrict Options);
+void ReportEncoderStats(const struct EncoderStats* restrict Stats);
+
+void CpuZonesInit(void);
+double BenchmarkCpuZones(void);
+void ExportCpuTrace(LPCWSTR Path);
+
+void ParseBenchmarkOptions(struct BenchmarkOptions* restrict Options, int ArgCount, LPWSTR* Args);
+void CreateOffscreenTargets(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height);
+void SummarizeTimes(float* restrict Times, UINT Count, struct TimeSummary* restrict Summary);
+double BenchmarkDrawSort(UINT* restrict WorkerCount, bool* restrict bSorted);
+void RunHeadlessBenchmark(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, const struct BenchmarkOptions* restrict Options);
+void RunWindowed(HWND Window, UINT Width, UINT Height, struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects);
+
+inline void WaitForPreviousFrame(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects);
+inline void WaitForFenceValue(ID3D12Fence* Fence, UINT64 Value, HANDLE FenceEvent);
+inline void SignalSubmission(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects);
+inline void FlushCommandQueue(struct SyncObjects* restrict SyncObjects);
+inline void WaitUntil(HANDLE WaitableTimer, INT64 Target, INT64 Frequency);
+
+inline UINT PacingFrameLatency(enum PacingMode Mode);
+inline void PacingSetMode(struct PacingController* restrict Pacing, enum PacingMode Mode);
+inline void PacingRecordSlot(struct PacingController* restrict Pacing, INT64 Now);
+inline void PacingRecordCpu(struct PacingController* restrict Pacing, INT64 Duration);
+inline void PacingRecordGpu(struct PacingController* restrict Pacing, INT64 Duration);
+inline INT64 PacingFrameStart(const struct PacingController* restrict Pacing, INT64 Now);
+inline void PacingBeginFrame(struct PacingController* restrict Pacing, INT64 Start);
+
+inline UINT ProfilerBeginScope(struct GpuProfilerFrame* restrict Frame, const char* Name);
+inline UINT ProfilerEndScope(struct GpuProfilerFrame* restrict Frame);
+inline INT64 ProfilerGpuToCpu(const struct GpuProfiler* restrict Profiler, UINT64 Timestamp);
+struct GpuScopeStats* ProfilerFindStats(struct GpuProfiler* restrict Profiler, const char* Name, UINT Depth);
+void ProfilerCollectFrame(struct GpuProfiler* restrict Profiler, struct GpuProfilerFrame* restrict Frame, const UINT64* restrict Timestamps);
+int CompareFloat(const void* a, const void* b);
+void ProfilerSummarize(const struct GpuScopeStats* restrict Stats, float* restrict Min, float* restrict Avg, float* restrict P99);
+inline void GpuProfilerBegin(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12GraphicsCommandList7* CommandList, const char* Name);
+inline void GpuProfilerEnd(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12GraphicsCommandList7* CommandList);
+inline void GpuProfilerResolve(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12GraphicsCommandList7* CommandList);
+bool GpuProfilerCollect(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12CommandQueue* CommandQueue);
+void ReportGpuProfile(const struct GpuProfiler* restrict Profiler);
+
+inline enum PowerState IdleTargetState(const struct IdleScheduler* restrict Idle);
+inline void IdleTransition(struct IdleScheduler* restrict Idle, INT64 Now, INT64 CpuNow);
+inline bool IdleFrameDue(const struct IdleScheduler* restrict Idle, INT64 Now);
+inline DWORD IdleTimeout(const struct IdleScheduler* restrict Idle, INT64 Now);
+inline void IdleFrameRendered(struct IdleScheduler* restrict Idle, INT64 Now);
+inline INT64 QueryProcessCpuTicks(INT64 Frequency);
+inline void IdleRefresh(struct IdleScheduler* restrict Idle);
+void ReportIdleStatistics(struct IdleScheduler* restrict Idle);
+
+inline void PostResize(struct ResizeRequest* restrict Request, UINT Width, UINT Height);
+inline bool TakeResize(struct ResizeRequest* restrict Request, UINT CurrentWidth, UINT CurrentHeight, UINT* restrict Width, UINT* restrict Height);
+
+inline bool RetireObject(struct RetireQueue* restrict Queue, IUnknown* Object, UINT64 FenceValue, UINT64 Bytes);
+inline UINT ReleaseRetiredObjects(struct RetireQueue* restrict Queue, UINT64 CompletedValue);
+void RetireResource(struct SyncObjects* restrict SyncObjects, ID3D12Resource* Resource);
+bool SimulateRetireQueue(UINT64* restrict Released, UINT64* restrict PeakPendingBytes);
+
+inline UINT DepthBucketSize(UINT Size);
+inline int FindPooledDepthBuffer(const struct DepthBufferPool* restrict Pool, UINT Width, UINT Height);
+inline int OldestPooledDepthBuffer(const struct DepthBufferPool* restrict Pool);
+void AcquireDepthBuffer(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height);
+void ResizeSwapChain(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height);
+
+int main()
+{
+	ConsoleHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+
+	CpuZonesInit();
+
+	struct BenchmarkOptions BenchmarkOptions = { 0 };
+
+	{
+		int ArgCount;
+		LPWSTR* Args = CommandLineToArgvW(GetCommandLineW(), &ArgCount);
+		VALIDATE_HANDLE(Args);
+		ParseBenchmarkOptions(&BenchmarkOptions, ArgCount, Args);
+		THROW_ON_FALSE(LocalFree(Args) == NULL);
+	}
+
+	if (BenchmarkOptions.ReplayPath[0])
+	{
+		RunReplayBenchmark(&BenchmarkOptions);
+		return 0;
+	}
+
+	//like replay this never creates a device, so the numbers only move when the cpu side does
+	if (BenchmarkOptions.SceneSuitePath[0])
+		return RunSceneSuite(&BenchmarkOptions) == 0 ? 0 : 1;
+
+	THROW_ON_FAIL(SetProcessDpiAwareness(PROCESS_PER_MONITOR_DPI_AWARE));
+
+	struct DxObjects DxObjects = { 0 };
+	struct SyncObjects SyncObjects = { 0 };
+
+	struct StartupObjects Startup = { 0 };
+	Startup.DxObjects = &DxObjects;
+	Startup.SyncObjects = &SyncObjects;
+	Startup.Options = &BenchmarkOptions;
+
+	//the device and the files on disk don't need each other, and main builds the window while they load
+	struct StartupGraph* Graph = &DxObjects.Startup;
+	InitStartupGraph(Graph);
+
+	const UINT DeviceTask = AddStartupTask(Graph, "Device", StartupDevice, &Startup, 0);
+	const UINT ShaderTask = AddStartupTask(Graph, "Shader Load", StartupShaders, &Startup, 0);
+	AddStartupTask(Graph, "Texture File", StartupTextureFile, &Startup, 0);
+	const UINT RootSignatureTask = AddStartupTask(Graph, "Root Signature", StartupRootSignature, &Startup, DeviceTask);
+	AddStartupTask(Graph, "Command Objects", StartupCommandObjects, &Startup, DeviceTask);
+	const UINT FrameResourcesTask = AddStartupTask(Graph, "Frame Resources", StartupFrameResources, &Startup, DeviceTask);
+	AddStartupTask(Graph, "Pipeline State", StartupPipelineState, &Startup, RootSignatureTask | ShaderTask);
+	AddStartupTask(Graph, "Draw Systems", StartupDrawSystems, &Startup, RootSignatureTask);
+	AddStartupTask(Graph, "Lighting", StartupLighting, &Startup, RootSignatureTask | FrameResourcesTask);
+
+	LaunchStartupGraph(Graph);
+
+	UINT Phase = BeginStartupPhase(Graph, "Window");
+
+	HINSTANCE Instance = GetModuleHandleW(NULL);
+
+	HICON Icon = LoadIconW(NULL, IDI_APPLICATION);
+	HCURSOR Cursor = LoadCursorW(NULL, IDC_ARROW);
+
+	WNDCLASSEXW WindowClass = { 0 };
+	WindowClass.cbSize = sizeof(WNDCLASSEXW);
+	WindowClass.style = CS_HREDRAW | CS_VREDRAW;
+	WindowClass.lpfnWndProc = PreInitProc;
+	WindowClass.cbClsExtra = 0;
+	WindowClass.cbWndExtra = 0;
+	WindowClass.hInstance = Instance;
+	WindowClass.hIcon = Icon;
+	WindowClass.hCursor = Cursor;
+	WindowClass.hbrBackground = (HBRUSH)(COLOR_WINDOW + 2);
+	WindowClass.lpszMenuName = NULL;
+	WindowClass.lpszClassName = WindowClassName;
+	WindowClass.hIconSm = Icon;
+
+	ATOM WindowClassAtom = RegisterClassExW(&WindowClass);
+	if (WindowClassAtom == 0)
+		THROW_ON_FAIL(HRESULT_FROM_WIN32(GetLastError()));
+
+	RECT WindowRect = { 0 };
+	WindowRect.left = 0;
+	WindowRect.top = 0;
+	WindowRect.right = BenchmarkOptions.Width;
+	WindowRect.bottom = BenchmarkOptions.Height;
+
+	THROW_ON_FALSE(AdjustWindowRect(&WindowRect, WS_OVERLAPPEDWINDOW, FALSE));
+
+	HWND Window = NULL;
+
+	if (!BenchmarkOptions.bHeadless)
+	{
+		Window = CreateWindowExW(
+			0,
+			WindowClassName,
+			L"Minimal DirectX 12",
+			WS_OVERLAPPEDWINDOW,
+			CW_USEDEFAULT,
+			CW_USEDEFAULT,
+			WindowRect.right - WindowRect.left,
+			WindowRect.bottom - WindowRect.top,
+			NULL,
+			NULL,
+			Instance,
+			NULL);
+
+		VALIDATE_HANDLE(Window);
+
+		THROW_ON_FALSE(ShowWindow(Window, SW_SHOW));
+	}
+
+	EndStartupPhase(Graph, Phase);
+
+	//kept on main, DXGI sends messages to the window and its thread has to be free to answer them
+	WaitStartupTasks(Graph, DeviceTask);
+
+	Phase = BeginStartupPhase(Graph, "Swap Chain");
+
+	if (!BenchmarkOptions.bHeadless)
+	{
+		DXGI_SWAP_CHAIN_DESC SwapChainDesc = { 0 };
+		SwapChainDesc.BufferDesc.Width = 1;
+		SwapChainDesc.BufferDesc.Height = 1;
+		SwapChainDesc.BufferDesc.Format = RTV_FORMAT;
+		SwapChainDesc.SampleDesc.Count = 1;
+		SwapChainDesc.SampleDesc.Quality = 0;
+		SwapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		SwapChainDesc.BufferCount = BUFFER_COUNT;
+		SwapChainDesc.OutputWindow = Window;
+		SwapChainDesc.Windowed = TRUE;
+		SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+		SwapChainDesc.Flags = SWAP_CHAIN_FLAGS;
+		THROW_ON_FAIL(IDXGIFactory6_CreateSwapChain(Startup.Factory, DxObjects.CommandQueue, &SwapChainDesc, &DxObjects.SwapChain));
+		THROW_ON_FAIL(IDXGIFactory6_MakeWindowAssociation(Startup.Factory, Window, DXGI_MWA_NO_ALT_ENTER));
+	}
+
+	THROW_ON_FAIL(IDXGIFactory6_Release(Startup.Factory));
+
+	SyncObjects.FrameIndex = BenchmarkOptions.bHeadless ? 0 : IDXGISwapChain3_GetCurrentBackBufferIndex(DxObjects.SwapChain);
+
+	if (!BenchmarkOptions.bHeadless)
+	{
+		SyncObjects.FrameLatencyWaitable = IDXGISwapChain3_GetFrameLatencyWaitableObject(DxObjects.SwapChain);
+		VALIDATE_HANDLE(SyncObjects.FrameLatencyWaitable);
+	}
+
+	EndStartupPhase(Graph, Phase);
+
+	FinishStartupGraph(Graph);
+
+	Phase = BeginStartupPhase(Graph, "Resource Upload");
+
+	THROW_ON_FAIL(ID3D12Device10_CreateCommandList(Device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT, DxObjects.CommandAllocators[SyncObjects.FrameIndex], NULL, &IID_ID3D12GraphicsCommandList7, &DxObjects.CommandList));
+
+	ID3D12Resource* VertexBufferUploadHeap;
+
+	{
+		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		ResourceDesc.Alignment = 0;
+		ResourceDesc.Width = sizeof(VertexList);
+		ResourceDesc.Height = 1;
+		ResourceDesc.DepthOrArraySize = 1;
+		ResourceDesc.MipLevels = 1;
+		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ResourceDesc.SampleDesc.Count = 1;
+		ResourceDesc.SampleDesc.Quality = 0;
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		{
+			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+			HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects.VertexBuffer));
+			MemoryTrackResource(DxObjects.VertexBuffer, MEMORY_GEOMETRY, &ResourceDesc, "Vertex Buffer");
+		}
+
+#ifdef _DEBUG
+		ID3D12Resource_SetName(DxObjects.VertexBuffer, L"Vertex Buffer Resource");
+#endif
+
+		ResidencyTrack(&DxObjects.Residency, DxObjects.VertexBuffer, &ResourceDesc);
+
+		{
+			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+			HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &VertexBufferUploadHeap));
+			MemoryTrackResource(VertexBufferUploadHeap, MEMORY_UPLOAD, &ResourceDesc, "Vertex Buffer Upload Heap");
+		}
+
+#ifdef _DEBUG
+		ID3D12Resource_SetName(VertexBufferUploadHeap, L"Vertex Buffer Upload Heap");
+#endif
+	}
+	
+	{
+		void* pData;
+		THROW_ON_FAIL(ID3D12Resource_Map(VertexBufferUploadHeap, 0, NULL, &pData));
+		MEMCPY_VERIFY(memcpy_s(pData, sizeof(VertexList), VertexList, sizeof(VertexList)));
+		ID3D12Resource_Unmap(VertexBufferUploadHeap, 0, NULL);
+
+		ID3D12GraphicsCommandList7_CopyBufferRegion(DxObjects.CommandList, DxObjects.VertexBuffer, 0, VertexBufferUploadHeap, 0, sizeof(VertexList));
+	}
+
+	{
+		D3D12_BUFFER_BARRIER BufferBarrier = { 0 };
+		BufferBarrier.SyncBefore = D3D12_BARRIER_SYNC_COPY;
+		BufferBarrier.SyncAfter = D3D12_BARRIER_SYNC_DRAW;
+		BufferBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST;
+		BufferBarrier.AccessAfter = D3D12_BARRIER_ACCESS_VERTEX_BUFFER;
+		BufferBarrier.pResource = DxObjects.VertexBuffer;
+		BufferBarrier.Offset = 0;
+		BufferBarrier.Size = sizeof(VertexList);
+
+		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+		ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
+		ResourceBarrier.NumBarriers = 1;
+		ResourceBarrier.pBufferBarriers = &BufferBarrier;
+		ID3D12GraphicsCommandList7_Barrier(DxObjects.CommandList, 1, &ResourceBarrier);
+	}
+
+	ID3D12Resource* IndexBufferUploadHeap;
+
+	{
+		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		ResourceDesc.Alignment = 0;
+		ResourceDesc.Width = sizeof(IndexList);
+		ResourceDesc.Height = 1;
+		ResourceDesc.DepthOrArraySize = 1;
+		ResourceDesc.MipLevels = 1;
+		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ResourceDesc.SampleDesc.Count = 1;
+		ResourceDesc.SampleDesc.Quality = 0;
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		{
+			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+			HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects.IndexBuffer));
+			MemoryTrackResource(DxObjects.IndexBuffer, MEMORY_GEOMETRY, &ResourceDesc, "Index Buffer");
+		}
+
+#ifdef _DEBUG
+		ID3D12Resource_SetName(DxObjects.IndexBuffer, L"Index Buffer Resource");
+#endif
+
+		ResidencyTrack(&DxObjects.Residency, DxObjects.IndexBuffer, &ResourceDesc);
+
+		{
+			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+			HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &IndexBufferUploadHeap));
+			MemoryTrackResource(IndexBufferUploadHeap, MEMORY_UPLOAD, &ResourceDesc, "Index Buffer Upload Heap");
+		}
+
+#ifdef _DEBUG
+		ID3D12Resource_SetName(IndexBufferUploadHeap, L"Index Buffer Upload Heap");
+#endif
+	}
+
+	{
+		void* pData;
+		THROW_ON_FAIL(ID3D12Resource_Map(IndexBufferUploadHeap, 0, NULL, &pData));
+		MEMCPY_VERIFY(memcpy_s(pData, sizeof(IndexList), IndexList, sizeof(IndexList)));
+		ID3D12Resource_Unmap(IndexBufferUploadHeap, 0, NULL);
+
+		ID3D12GraphicsCommandList7_CopyBufferRegion(DxObjects.CommandList, DxObjects.IndexBuffer, 0, IndexBufferUploadHeap, 0, sizeof(IndexList));
+	}
+
+	{
+		D3D12_BUFFER_BARRIER BufferBarrier = { 0 };
+		BufferBarrier.SyncBefore = D3D12_BARRIER_SYNC_COPY;
+		BufferBarrier.SyncAfter = D3D12_BARRIER_SYNC_DRAW;
+		BufferBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST;
+		BufferBarrier.AccessAfter = D3D12_BARRIER_ACCESS_INDEX_BUFFER;
+		BufferBarrier.pResource = DxObjects.IndexBuffer;
+		BufferBarrier.Offset = 0;
+		BufferBarrier.Size = sizeof(IndexList);
+
+		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+		ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
+		ResourceBarrier.NumBarriers = 1;
+		ResourceBarrier.pBufferBarriers = &BufferBarrier;
+		ID3D12GraphicsCommandList7_Barrier(DxObjects.CommandList, 1, &ResourceBarrier);
+	}
+
+	ID3D12Resource* TextureBuffer;
+	ID3D12Resource* TextureBufferUploadHeap;
+	DXGI_FORMAT TextureFormat = TEXTURE_FORMAT;
+	UINT TextureMipLevels = 1;
+
+	if (Startup.bTextureFile)
+	{
+		UploadTextureFile(&DxObjects, &Startup.TextureFile, &TextureBuffer, &TextureBufferUploadHeap);
+		TextureFormat = Startup.TextureFile.Format;
+		TextureMipLevels = Startup.TextureFile.MipLevels;
+		CloseTextureFile(&Startup.TextureFile);
+	}
+	else
+	{
+		if (BenchmarkOptions.TexturePath[0])
+			WriteConsoleA(ConsoleHandle, "texture file could not be loaded, using the generated texture\n", 62, NULL, NULL);
+
+		{
+			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+			HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+			D3D12_RESOURCE_DESC1 TextureResourceDesc = { 0 };
+			TextureResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+			TextureResourceDesc.Alignment = 0;
+			TextureResourceDesc.Width = TEXTURE_WIDTH;
+			TextureResourceDesc.Height = TEXTURE_HEIGHT;
+			TextureResourceDesc.DepthOrArraySize = 1;
+			TextureResourceDesc.MipLevels = 0;
+			TextureResourceDesc.Format = TEXTURE_FORMAT;
+			TextureResourceDesc.SampleDesc.Count = 1;
+			TextureResourceDesc.SampleDesc.Quality = 0;
+			TextureResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+			TextureResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &TextureResourceDesc, D3D12_BARRIER_LAYOUT_COMMON, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &TextureBuffer));
+			MemoryTrackResource(TextureBuffer, MEMORY_TEXTURE, &TextureResourceDesc, "Texture");
+			ResidencyTrack(&DxObjects.Residency, TextureBuffer, &TextureResourceDesc);
+		}
+
+		{
+			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+			HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+			D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+			ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			ResourceDesc.Alignment = 0;
+			ResourceDesc.Width = TEXTURE_WIDTH * TEXTURE_HEIGHT * BYTES_PER_TEXEL;
+			ResourceDesc.Height = 1;
+			ResourceDesc.DepthOrArraySize = 1;
+			ResourceDesc.MipLevels = 1;
+			ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+			ResourceDesc.SampleDesc.Count = 1;
+			ResourceDesc.SampleDesc.Quality = 0;
+			ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &TextureBufferUploadHeap));
+			MemoryTrackResource(TextureBufferUploadHeap, MEMORY_UPLOAD, &ResourceDesc, "Texture Upload Heap");
+		}
+		
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12Resource_SetName(TextureBufferUploadHeap, L"Texture Buffer Upload Resource Heap"));
+#endif
+
+		{
+			WORD* pData;
+			THROW_ON_FAIL(ID3D12Resource_Map(TextureBufferUploadHeap, 0, NULL, &pData));
+
+			for (UINT y = 0; y < TEXTURE_HEIGHT; y++)
+			{
+				for (UINT x = 0; x < TEXTURE_WIDTH; x++)
+				{
+					pData[(y * TEXTURE_WIDTH + x) * (BYTES_PER_TEXEL / sizeof(WORD))] = x == 0 || x == (TEXTURE_WIDTH - 1) || y == 0 || y == (TEXTURE_HEIGHT - 1) ? 0b1111100000000000 : rand() * (UINT16_MAX / RAND_MAX);
+				}
+			}
+			
+			ID3D12Resource_Unmap(TextureBufferUploadHeap, 0, NULL);
+
+			D3D12_TEXTURE_COPY_LOCATION TextureCopyDest = { 0 };
+			TextureCopyDest.pResource = TextureBuffer;
+			TextureCopyDest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			TextureCopyDest.SubresourceIndex = 0;
+
+			D3D12_TEXTURE_COPY_LOCATION TextureCopySrc = { 0 };
+			TextureCopySrc.pResource = TextureBufferUploadHeap;
+			TextureCopySrc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			TextureCopySrc.PlacedFootprint.Offset = 0;
+			TextureCopySrc.PlacedFootprint.Footprint.Format = TEXTURE_FORMAT;
+			TextureCopySrc.PlacedFootprint.Footprint.Width = TEXTURE_WIDTH;
+			TextureCopySrc.PlacedFootprint.Footprint.Height = TEXTURE_HEIGHT;
+			TextureCopySrc.PlacedFootprint.Footprint.Depth = 1;
+			TextureCopySrc.PlacedFootprint.Footprint.RowPitch = TEXTURE_WIDTH * BYTES_PER_TEXEL;
+			ID3D12GraphicsCommandList7_CopyTextureRegion(DxObjects.CommandList, &TextureCopyDest, 0, 0, 0, &TextureCopySrc, NULL);
+		}
+	}
+
+	DxObjects.Texture = TextureBuffer;
+
+#ifdef _DEBUG
+	ID3D12Resource_SetName(TextureBuffer, L"Texture Buffer Resource Heap");
+#endif
+
+	{
+		D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
+		TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_COPY;
+		TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_ALL;
+		TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST;
+		TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_COMMON;
+		TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_COMMON;
+		TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
+		TextureBarrier.pResource = TextureBuffer;
+		TextureBarrier.Subresources.IndexOrFirstMipLevel = 0xffffffff;
+		TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+
+		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+		ResourceBarrier.Type = D3D12_BARRIER_TYPE_TEXTURE;
+		ResourceBarrier.NumBarriers = 1;
+		ResourceBarrier.pTextureBarriers = &TextureBarrier;
+		ID3D12GraphicsCommandList7_Barrier(DxObjects.CommandList, 1, &ResourceBarrier);
+	}
+
+	{
+		D3D12_SHADER_RESOURCE_VIEW_DESC ResourceViewDesc = { 0 };
+		ResourceViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		ResourceViewDesc.Format = TextureFormat;
+		ResourceViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		ResourceViewDesc.Texture2D.MipLevels = TextureMipLevels;
+
+		D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
+		ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(DxObjects.SRVDescriptorHeap, &srvHandle);
+		ID3D12Device10_CreateShaderResourceView(Device, TextureBuffer, &ResourceViewDesc, srvHandle);
+
+		//and again at the head of every frame slot's table
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			const D3D12_CPU_DESCRIPTOR_HANDLE TableHandle = { srvHandle.ptr + (MAIN_TABLE_BASE + i * MAIN_TABLE_SIZE) * (SIZE_T)DxObjects.SrvDescriptorSize };
+			ID3D12Device10_CreateShaderResourceView(Device, TextureBuffer, &ResourceViewDesc, TableHandle);
+		}
+	}
+
+	ID3D12GraphicsCommandList7_Close(DxObjects.CommandList);
+
+	ID3D12CommandQueue_ExecuteCommandLists(DxObjects.CommandQueue, 1, &DxObjects.CommandList);
+	SignalSubmission(&DxObjects, &SyncObjects);
+
+	SyncObjects.FenceValue[SyncObjects.FrameIndex]++;
+	THROW_ON_FAIL(ID3D12CommandQueue_Signal(DxObjects.CommandQueue, SyncObjects.Fence[SyncObjects.FrameIndex], SyncObjects.FenceValue[SyncObjects.FrameIndex]));
+
+	DxObjects.VertexBufferView.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(DxObjects.VertexBuffer);
+	DxObjects.VertexBufferView.SizeInBytes = sizeof(VertexList);
+	DxObjects.VertexBufferView.StrideInBytes = sizeof(struct Vertex);
+
+	DxObjects.IndexBufferView.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(DxObjects.IndexBuffer);
+	DxObjects.IndexBufferView.SizeInBytes = sizeof(IndexList);
+	DxObjects.IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
+
+	EndStartupPhase(Graph, Phase);
+
+	ReportStartup(Graph);
+
+	//the first frames sweep these once the copies are done, startup does not wait for the GPU
+	RetireResource(&SyncObjects, VertexBufferUploadHeap);
+	RetireResource(&SyncObjects, IndexBufferUploadHeap);
+	RetireResource(&SyncObjects, TextureBufferUploadHeap);
+
+	if (BenchmarkOptions.bHeadless)
+		RunHeadlessBenchmark(&DxObjects, &SyncObjects, &BenchmarkOptions);
+	else
+		RunWindowed(Window, WindowRect.right - WindowRect.left, WindowRect.bottom - WindowRect.top, &DxObjects, &SyncObjects);
+
+	FlushCommandQueue(&SyncObjects);
+
+	ReportGpuProfile(&DxObjects.Profiler);
+	ReportEncoderStats(&DxObjects.EncoderStats);
+	ReportFrameArenas(DxObjects.FrameArenas, BUFFER_COUNT);
+
+#ifdef CPU_ZONES
+	ExportCpuTrace(L"cpu_trace.json");
+#endif
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		ID3D12Resource_Unmap(Startup.ConstantBufferHeaps[i], 0, NULL);
+		THROW_ON_FAIL(ID3D12Resource_Release(Startup.ConstantBufferHeaps[i]));
+	}
+
+	FreeDrawQueue(&DxObjects.DrawQueue);
+	FreeGpuCulling(&DxObjects.Culling);
+	FreeBundleCache(&DxObjects.Bundles);
+	FreeOcclusionBuffer(&DxObjects.Occlusion);
+	FreeParticleRenderer(&DxObjects.Particles);
+	FreeParticleSystem(&DxObjects.Particles);
+	FreeClusteredLighting(&DxObjects.Lighting);
+	FreeShadowMaps(&DxObjects.Shadows);
+	FreeFrameRecorder(&DxObjects.Recorder);
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		FreeFrameArena(&DxObjects.FrameArenas[i]);
+	}
+
+	FreeResidencyManager(&DxObjects.Residency, DxObjects.Adapter);
+
+	THROW_ON_FAIL(ID3D12PipelineState_Release(DxObjects.PipelineStateObject));
+	
+	THROW_ON_FAIL(ID3D12RootSignature_Release(DxObjects.RootSignature));
+
+	THROW_ON_FAIL(ID3D12PipelineState_Release(DxObjects.UpscalePipelineState));
+	THROW_ON_FAIL(ID3D12RootSignature_Release(DxObjects.UpscaleRootSignature));
+	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.SceneColor));
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.RenderTargets[i]));
+	}
+
+	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.DepthStencilBuffer));
+
+	for (UINT i = 0; i < DxObjects.DepthBufferPool.Count; i++)
+	{
+		THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.DepthBufferPool.Buffers[i]));
+	}
+
+	ReleaseRetiredObjects(&SyncObjects.RetireQueue, UINT64_MAX);
+
+	if (DxObjects.SwapChain)
+		THROW_ON_FAIL(IDXGISwapChain3_Release(DxObjects.SwapChain));
+
+	THROW_ON_FALSE(CloseHandle(SyncObjects.FenceEvent));
+
+	if (SyncObjects.FrameLatencyWaitable)
+		THROW_ON_FALSE(CloseHandle(SyncObjects.FrameLatencyWaitable));
+
+	THROW_ON_FALSE(CloseHandle(SyncObjects.PacingTimer));
+	THROW_ON_FALSE(CloseHandle(SyncObjects.IdleFenceEvent));
+
+	THROW_ON_FAIL(ID3D12Fence_Release(SyncObjects.SubmitFence));
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Fence_Release(SyncObjects.Fence[i]));
+	}
+
+	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Release(DxObjects.CommandList));
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12CommandAllocator_Release(DxObjects.CommandAllocators[i]));
+	}
+	
+	THROW_ON_FAIL(ID3D12CommandQueue_Release(DxObjects.CommandQueue));
+
+	THROW_ON_FAIL(ID3D12DescriptorHeap_Release(Startup.RtvDescriptorHeap));
+	THROW_ON_FAIL(ID3D12DescriptorHeap_Release(Startup.DepthStencilDescriptorHeap)); 
+	THROW_ON_FAIL(ID3D12DescriptorHeap_Release(DxObjects.SRVDescriptorHeap));
+
+	ID3D12Resource_Unmap(DxObjects.Profiler.Readback, 0, NULL);
+	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.Profiler.Readback));
+	THROW_ON_FAIL(ID3D12QueryHeap_Release(DxObjects.Profiler.QueryHeap));
+
+	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.VertexBuffer));
+	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.IndexBuffer));
+	THROW_ON_FAIL(ID3D12Resource_Release(TextureBuffer));
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12InfoQueue_Release(Startup.InfoQueue));
+#endif
+
+	THROW_ON_FAIL(ID3D12Device10_Release(Device));
+	THROW_ON_FAIL(IDXGIAdapter3_Release(DxObjects.Adapter));
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12Debug6_Release(Startup.DebugController));
+#endif
+
+	THROW_ON_FALSE(UnregisterClassW(WindowClassName, Instance));
+
+	THROW_ON_FALSE(DestroyCursor(Cursor));
+	THROW_ON_FALSE(DestroyIcon(Icon));
+
+#ifdef _DEBUG
+	{
+		IDXGIDebug1* dxgiDebug;
+		THROW_ON_FAIL(DXGIGetDebugInterface1(0, &IID_IDXGIDebug1, &dxgiDebug));
+		THROW_ON_FAIL(IDXGIDebug1_ReportLiveObjects(dxgiDebug, DXGI_DEBUG_ALL, DXGI_DEBUG_RLO_SUMMARY | DXGI_DEBUG_RLO_IGNORE_INTERNAL));
+	}
+#endif
+	return 0;
+}
+
+LRESULT CALLBACK PreInitProc(HWND Window, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	switch (message)
+	{
+	case WM_DESTROY:
+		PostQuitMessage(0);
+		break;
+	default:
+		return DefWindowProcW(Window, message, wParam, lParam);
+	}
+	return 0;
+}
+
+LRESULT CALLBACK WndProc(HWND Window, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	static struct
+	{
+		UINT WindowWidth;
+		UINT WindowHeight;
+
+		struct ResizeRequest Resize;
+
+		bool bFullScreen;
+		bool bVsync;
+
+		D3D12_VIEWPORT Viewport;
+		D3D12_RECT ScissorRect;
+	} WindowDetails = { 0 };
+	
+	static struct Scene Scene = { 0 };
+	
+	static struct
+	{
+		LARGE_INTEGER ProcessorFrequency;
+		LARGE_INTEGER tickCount;
+	} Timer = { 0 };
+
+	static struct PacingController Pacing = { 0 };
+	static struct LatencyTracker Latency = { 0 };
+
+	static struct DxObjects* DxObjects = NULL;
+	static struct SyncObjects* SyncObjects = NULL;
+	static struct IdleScheduler* IdleScheduler = NULL;
+
+	switch (message)
+	{
+	case WM_INIT:
+		WindowDetails.Viewport.TopLeftX = 0;
+		WindowDetails.Viewport.TopLeftY = 0;
+		WindowDetails.Viewport.MinDepth = 0.0f;
+		WindowDetails.Viewport.MaxDepth = 1.0f;
+
+		WindowDetails.ScissorRect.left = 0;
+		WindowDetails.ScissorRect.top = 0;
+
+		QueryPerformanceFrequency(&Timer.ProcessorFrequency);
+
+		DxObjects = ((struct WindowProcPayload*)wParam)->DxObjects;
+		SyncObjects = ((struct WindowProcPayload*)wParam)->SyncObjects;
+		IdleScheduler = ((struct WindowProcPayload*)wParam)->IdleScheduler;
+
+		Pacing.FixedInterval = Timer.ProcessorFrequency.QuadPart / PACING_FIXED_RATE_HZ;
+		Pacing.SafetyMargin = Timer.ProcessorFrequency.QuadPart / 1000;
+		PacingSetMode(&Pacing, PACING_LOW_LATENCY);
+		THROW_ON_FAIL(IDXGISwapChain3_SetMaximumFrameLatency(DxObjects->SwapChain, PacingFrameLatency(Pacing.Mode)));
+
+		InitLatencyTracker(&Latency, Timer.ProcessorFrequency.QuadPart);
+		break;
+	case WM_KEYDOWN:
+		if (!(lParam & 1 << 30))
+		{
+			LARGE_INTEGER Now;
+			QueryPerformanceCounter(&Now);
+			LatencyRecordInput(&Latency, Now.QuadPart);
+		}
+
+		switch (wParam)
+		{
+		case VK_ESCAPE:
+			THROW_ON_FALSE(DestroyWindow(Window));
+			break;
+		case 'V':
+			if (!(lParam & 1 << 30))
+			{
+				WindowDetails.bVsync = !WindowDetails.bVsync;
+				Pacing.bSynced = WindowDetails.bVsync;
+			}
+			break;
+		case 'P':
+			if (!(lParam & 1 << 30))
+			{
+				PacingSetMode(&Pacing, (Pacing.Mode + 1) % PACING_MODE_COUNT);
+				THROW_ON_FAIL(IDXGISwapChain3_SetMaximumFrameLatency(DxObjects->SwapChain, PacingFrameLatency(Pacing.Mode)));
+			}
+			break;
+		case 'G':
+			if (!(lParam & 1 << 30))
+				ReportGpuProfile(&DxObjects->Profiler);
+			break;
+		case 'T':
+			if (!(lParam & 1 << 30))
+				ReportLatency(&Latency);
+			break;
+		case 'I':
+			if (!(lParam & 1 << 30))
+				DxObjects->Culling.bEnabled = !DxObjects->Culling.bEnabled;
+			break;
+		case 'B':
+			if (!(lParam & 1 << 30))
+				DxObjects->Bundles.bEnabled = !DxObjects->Bundles.bEnabled;
+			break;
+		case 'O':
+			if (!(lParam & 1 << 30))
+				DxObjects->Occlusion.bEnabled = !DxObjects->Occlusion.bEnabled;
+			break;
+		case 'E':
+			if (!(lParam & 1 << 30))
+				DxObjects->Particles.bEnabled = !DxObjects->Particles.bEnabled;
+			break;
+		case 'L':
+			if (!(lParam & 1 << 30))
+				DxObjects->Lighting.bEnabled = !DxObjects->Lighting.bEnabled;
+			break;
+		case 'S':
+			if (!(lParam & 1 << 30))
+				DxObjects->Shadows.bEnabled = !DxObjects->Shadows.bEnabled;
+			break;
+		case 'F':
+			if (!(lParam & 1 << 30))
+				DxObjects->Recorder.bEnabled = !DxObjects->Recorder.bEnabled;
+			break;
+		case 'R':
+			if (!(lParam & 1 << 30))
+			{
+				DxObjects->Resolution.bEnabled = !DxObjects->Resolution.bEnabled;
+				InitResolutionController(&DxObjects->Resolution, DxObjects->Resolution.TargetMs);
+			}
+			break;
+		case 'M':
+			if (!(lParam & 1 << 30))
+			{
+				//prints what changed since the last press and dumps every live allocation
+				static struct MemorySnapshot LastSnapshot;
+
+				struct MemorySnapshot Snapshot;
+				struct MemorySnapshot Diff;
+				MemoryTakeSnapshot(&Snapshot);
+				MemoryDiffSnapshots(&LastSnapshot, &Snapshot, &Diff);
+				PrintMemorySnapshot(&Diff);
+				LastSnapshot = Snapshot;
+
+				ExportMemoryReport(L"memory.json");
+			}
+			break;
+#ifdef CPU_ZONES
+		case 'C':
+			if (!(lParam & 1 << 30))
+				ExportCpuTrace(L"cpu_trace.json");
+			break;
+#endif
+		}
+		break;
+	case WM_SYSKEYDOWN:
+		if (wParam == VK_RETURN && (lParam & 0x60000000) == 0x20000000)
+		{
+			LARGE_INTEGER Now;
+			QueryPerformanceCounter(&Now);
+			LatencyRecordInput(&Latency, Now.QuadPart);
+
+			WindowDetails.bFullScreen = !WindowDetails.bFullScreen;
+
+			if (WindowDetails.bFullScreen)
+			{
+				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_EXSTYLE, WS_EX_TOPMOST) != 0);
+				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_STYLE, 0) != 0);
+
+				THROW_ON_FALSE(ShowWindow(Window, SW_SHOWMAXIMIZED));
+			}
+			else
+			{
+				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_STYLE, WS_OVERLAPPEDWINDOW) != 0);
+				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_EXSTYLE, 0) != 0);
+
+				THROW_ON_FALSE(ShowWindow(Window, SW_SHOWMAXIMIZED));
+			}
+		}
+		break;
+	case WM_ACTIVATEAPP:
+		IdleScheduler->bFocused = wParam != FALSE;
+		IdleRefresh(IdleScheduler);
+		break;
+	case WM_SIZE:
+		IdleScheduler->bMinimized = wParam == SIZE_MINIMIZED;
+		IdleRefresh(IdleScheduler);
+
+		if (wParam == SIZE_MINIMIZED)
+			break;
+
+		PostResize(&WindowDetails.Resize, LOWORD(lParam), HIWORD(lParam));
+		break;
+	case WM_PAINT:
+	{
+		//frames are requested by the message loop, not by a permanently invalid window
+		THROW_ON_FALSE(ValidateRect(Window, NULL));
+
+		if (IdleScheduler->State == POWER_MINIMIZED)
+			break;
+
+		if (IdleScheduler->State == POWER_OCCLUDED)
+		{
+			//probe instead of rendering until some of the window is visible again
+			HRESULT PresentResult = IDXGISwapChain3_Present(DxObjects->SwapChain, 0, DXGI_PRESENT_TEST);
+			THROW_ON_FAIL(PresentResult);
+
+			LARGE_INTEGER Now;
+			QueryPerformanceCounter(&Now);
+			IdleFrameRendered(IdleScheduler, Now.QuadPart);
+
+			if (PresentResult == DXGI_STATUS_OCCLUDED)
+				break;
+
+			IdleScheduler->bOccluded = false;
+			IdleRefresh(IdleScheduler);
+		}
+
+		CPU_ZONE_BEGIN("Pacing Wait");
+		THROW_ON_FALSE(WaitForSingleObjectEx(SyncObjects->FrameLatencyWaitable, 1000, TRUE) != WAIT_FAILED);
+
+		LARGE_INTEGER SlotTime;
+		QueryPerformanceCounter(&SlotTime);
+		PacingRecordSlot(&Pacing, SlotTime.QuadPart);
+
+		WaitUntil(SyncObjects->PacingTimer, PacingFrameStart(&Pacing, SlotTime.QuadPart), Timer.ProcessorFrequency.QuadPart);
+		CPU_ZONE_END();
+
+		LARGE_INTEGER FrameStart;
+		QueryPerformanceCounter(&FrameStart);
+		PacingBeginFrame(&Pacing, FrameStart.QuadPart);
+		LatencyBeginFrame(&Latency);
+
+		CPU_ZONE_BEGIN("Fence Wait");
+		WaitForPreviousFrame(DxObjects, SyncObjects);
+		CPU_ZONE_END();
+
+		//the last frame that allocated from this arena rendered into this back buffer
+		ResetFrameArena(&DxObjects->FrameArenas[SyncObjects->FrameIndex]);
+		ReleaseRetiredObjects(&SyncObjects->RetireQueue, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+
+		UINT NewWidth;
+		UINT NewHeight;
+		if (TakeResize(&WindowDetails.Resize, WindowDetails.WindowWidth, WindowDetails.WindowHeight, &NewWidth, &NewHeight))
+		{
+			WindowDetails.WindowWidth = NewWidth;
+			WindowDetails.WindowHeight = NewHeight;
+
+			WindowDetails.Viewport.Width = WindowDetails.WindowWidth;
+			WindowDetails.Viewport.Height = WindowDetails.WindowHeight;
+
+			WindowDetails.ScissorRect.right = WindowDetails.WindowWidth;
+			WindowDetails.ScissorRect.bottom = WindowDetails.WindowHeight;
+
+			ResetScene(&Scene, WindowDetails.WindowWidth, WindowDetails.WindowHeight);
+
+			CPU_ZONE_BEGIN("Resize");
+			ResizeSwapChain(DxObjects, SyncObjects, WindowDetails.WindowWidth, WindowDetails.WindowHeight);
+			CPU_ZONE_END();
+		}
+
+		if (DxObjects->RenderTargets[0] == NULL)
+			break;
+
+		//this back buffer's fence has passed, so its slice of the readback ring is ready
+		if (GpuProfilerCollect(&DxObjects->Profiler, SyncObjects->FrameIndex, DxObjects->CommandQueue))
+		{
+			const INT64 GpuTicks = DxObjects->Profiler.LastFrameCpuEnd - DxObjects->Profiler.LastFrameCpuBegin;
+			PacingRecordGpu(&Pacing, GpuTicks);
+
+			if (DxObjects->Resolution.bEnabled)
+				UpdateResolutionScale(&DxObjects->Resolution, (float)(GpuTicks * 1000.0 / Timer.ProcessorFrequency.QuadPart));
+		}
+
+		LARGE_INTEGER tickCountNow;
+		QueryPerformanceCounter(&tickCountNow);
+		ULONGLONG tickCountDelta = tickCountNow.QuadPart - Timer.tickCount.QuadPart;
+		Timer.tickCount.QuadPart = tickCountNow.QuadPart;
+
+		float MovementFactor = (tickCountDelta / ((float)Timer.ProcessorFrequency.QuadPart)) * 75.f;
+
+		UpdateScene(&Scene, MovementFactor, DxObjects->ConstantBufferCPUAddress[SyncObjects->FrameIndex]);
+
+		if (DxObjects->Particles.bEnabled)
+		{
+			//a long stall would otherwise fling every particle out of the scene in one step
+			const float DeltaTime = min(tickCountDelta / (float)Timer.ProcessorFrequency.QuadPart, PARTICLE_MAX_STEP);
+
+			CPU_ZONE_BEGIN("Particles");
+			EmitParticles(&DxObjects->Particles, DeltaTime);
+			DxObjects->Particles.InstanceCounts[SyncObjects->FrameIndex] = SimulateParticles(&DxObjects->Particles, DeltaTime, DxObjects->Particles.InstanceData[SyncObjects->FrameIndex]);
+			CPU_ZONE_END();
+		}
+
+		if (DxObjects->Lighting.bEnabled)
+		{
+			CPU_ZONE_BEGIN("Light Binning");
+			UpdateClusteredLights(&DxObjects->Lighting, &Scene, tickCountDelta / (float)Timer.ProcessorFrequency.QuadPart, SyncObjects->FrameIndex);
+			CPU_ZONE_END();
+		}
+
+		if (DxObjects->Shadows.bEnabled)
+		{
+			CPU_ZONE_BEGIN("Shadow Cascades");
+			UpdateShadows(&DxObjects->Shadows, &Scene, SyncObjects->FrameIndex);
+			CPU_ZONE_END();
+		}
+
+		//finished copies go to the worker first, then this frame takes a slot of its own if there is one free
+		CPU_ZONE_BEGIN("Frame Recorder");
+		CollectFrameRecordings(&DxObjects->Recorder, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+		BeginFrameRecording(&DxObjects->Recorder, DxObjects->RenderTargets[SyncObjects->FrameIndex], SyncObjects->SubmitFenceValue + 1);
+		CPU_ZONE_END();
+
+		CPU_ZONE_BEGIN("Command Recording");
+		RecordFrame(DxObjects, &Scene, SyncObjects->FrameIndex, &WindowDetails.Viewport, &WindowDetails.ScissorRect, NULL);
+		CPU_ZONE_END();
+
+		CPU_ZONE_BEGIN("Residency");
+		FlushResidency(&DxObjects->Residency, DxObjects->Adapter, DxObjects->CommandQueue, SyncObjects->SubmitFenceValue + 1, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+		CPU_ZONE_END();
+
+		CPU_ZONE_BEGIN("ExecuteCommandLists");
+		ID3D12CommandQueue_ExecuteCommandLists(DxObjects->CommandQueue, 1, &DxObjects->CommandList);
+		SignalSubmission(DxObjects, SyncObjects);
+		CPU_ZONE_END();
+
+		MemoryEndFrame();
+		THROW_ON_FAIL(ID3D12Fence_SetEventOnCompletion(SyncObjects->SubmitFence, SyncObjects->SubmitFenceValue, SyncObjects->IdleFenceEvent));
+
+		THROW_ON_FAIL(ID3D12CommandQueue_Signal(DxObjects->CommandQueue, SyncObjects->Fence[SyncObjects->FrameIndex], ++SyncObjects->FenceValue[SyncObjects->FrameIndex]));
+
+		LARGE_INTEGER PresentTime;
+		QueryPerformanceCounter(&PresentTime);
+
+		CPU_ZONE_BEGIN("Present");
+		HRESULT PresentResult = IDXGISwapChain3_Present(DxObjects->SwapChain, WindowDetails.bVsync ? 1 : 0, WindowDetails.bVsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		CPU_ZONE_END();
+		THROW_ON_FAIL(PresentResult);
+
+		if (PresentResult == DXGI_STATUS_OCCLUDED)
+		{
+			IdleScheduler->bOccluded = true;
+			IdleRefresh(IdleScheduler);
+		}
+		else
+		{
+			UINT PresentCount;
+			THROW_ON_FAIL(IDXGISwapChain3_GetLastPresentCount(DxObjects->SwapChain, &PresentCount));
+			LatencyPresented(&Latency, PresentCount, PresentTime.QuadPart);
+		}
+
+		//fails with DXGI_ERROR_FRAME_STATISTICS_DISJOINT until a vblank has passed since the last mode change
+		DXGI_FRAME_STATISTICS FrameStatistics;
+		if (SUCCEEDED(IDXGISwapChain3_GetFrameStatistics(DxObjects->SwapChain, &FrameStatistics)))
+			LatencyFrameStatistics(&Latency, &FrameStatistics);
+		else
+			LatencyDisjoint(&Latency);
+
+		LARGE_INTEGER FrameEnd;
+		QueryPerformanceCounter(&FrameEnd);
+		PacingRecordCpu(&Pacing, FrameEnd.QuadPart - FrameStart.QuadPart);
+		IdleFrameRendered(IdleScheduler, FrameEnd.QuadPart);
+		break;
+	}
+	case WM_DESTROY:
+		ReportLatency(&Latency);
+		PostQuitMessage(0);
+		break;
+	default:
+		return DefWindowProcW(Window, message, wParam, lParam);
+	}
+	return 0;
+}
+
+void ResetScene(struct Scene* restrict Scene, UINT Width, UINT Height)
+{
+	glm_vec3_copy((vec3) { 0.0f, 0.0f, 0.0f }, Scene->cube1Position);
+	glm_vec3_copy((vec3) { 1.5f, 0.0f, 0.0f }, Scene->cube2PositionOffset);
+
+	mat4 tmpMat;
+	glm_perspective_lh_zo(45.0f * (3.14f / 180.0f), (float)Width / (float)Height, 0.1f, 1000.0f, tmpMat);
+
+	glm_mat4_copy(tmpMat, Scene->cameraProjMat);
+
+	vec3 cameraPosition = { 0.0f, 2.0f, -4.0f };
+
+	vec3 cameraTarget = { 0.0f , 0.0f , 0.0f };
+
+	vec3 cameraUp = { 0.0f , 1.0f, 0.0f };
+
+	vec3 cPos;
+	glm_vec3_copy(cameraPosition, cPos);
+
+	vec3 cTarg;
+	glm_vec3_copy(cameraTarget, cTarg);
+
+	vec3 cUp;
+	glm_vec3_copy(cameraUp, cUp);
+
+	glm_lookat_lh(cPos, cTarg, cUp, tmpMat);
+
+	glm_mat4_copy(tmpMat, Scene->cameraViewMat);
+
+	vec3 posVec;
+	glm_vec3_copy(Scene->cube1Position, posVec);
+
+	glm_translate_make(tmpMat, posVec);
+
+	glm_mat4_identity(Scene->cube1RotMat);
+
+	glm_mat4_copy(tmpMat, Scene->cube1WorldMat);
+
+	glm_vec3_add(Scene->cube2PositionOffset, Scene->cube1Position, posVec);
+
+	glm_translate_make(tmpMat, posVec);
+
+	glm_mat4_identity(Scene->cube2RotMat);
+
+	glm_mat4_copy(tmpMat, Scene->cube2WorldMat);
+}
+
+void UpdateScene(struct Scene* restrict Scene, float MovementFactor, UINT8* ConstantBuffer)
+{
+	CPU_ZONE_BEGIN("Matrix Math");
+
+	mat4 rotXMat;
+	glm_mat4_identity(rotXMat);
+	glm_rotate_x(rotXMat, 0.01f * MovementFactor, rotXMat);
+
+	mat4 rotYMat;
+	glm_mat4_identity(rotYMat);
+	glm_rotate_y(rotYMat, 0.02f * MovementFactor, rotYMat);
+
+	mat4 rotZMat;
+	glm_mat4_identity(rotZMat);
+	glm_rotate_z(rotZMat, 0.03f * MovementFactor, rotZMat);
+
+	mat4 rotMat;
+	glm_mat4_mul(Scene->cube1RotMat, rotXMat, rotMat);
+	glm_mat4_mul(rotMat, rotYMat, rotMat);
+	glm_mat4_mul(rotMat, rotZMat, rotMat);
+	glm_mat4_copy(rotMat, Scene->cube1RotMat);
+
+	mat4 translationMat;
+	glm_translate_make(translationMat, Scene->cube1Position);
+
+	mat4 worldMat;
+	glm_mat4_mul(rotMat, translationMat, worldMat);
+	glm_mat4_copy(worldMat, Scene->cube1WorldMat);
+
+	mat4 viewMat;
+	glm_mat4_copy(Scene->cameraViewMat, viewMat);
+
+	mat4 projMat;
+	glm_mat4_copy(Scene->cameraProjMat, projMat);
+
+	mat4 wvpMat;
+	glm_mat4_mul(projMat, viewMat, wvpMat);
+	glm_mat4_mul(wvpMat, Scene->cube1WorldMat, wvpMat);
+
+	mat4 ConstantBufferPerObject = { 0 };
+	mat4 transposed;
+	glm_mat4_transpose_to(wvpMat, transposed);
+	glm_mat4_copy(transposed, ConstantBufferPerObject);
+	CPU_ZONE_END();
+
+	CPU_ZONE_BEGIN("Constant Upload");
+	memcpy(ConstantBuffer, &ConstantBufferPerObject, sizeof(ConstantBufferPerObject));
+	CPU_ZONE_END();
+
+	CPU_ZONE_BEGIN("Matrix Math");
+
+	glm_mat4_identity(rotXMat);
+	glm_rotate_x(rotXMat, 0.03f * MovementFactor, rotXMat);
+
+	glm_mat4_identity(rotYMat);
+	glm_rotate_y(rotYMat, 0.02f * MovementFactor, rotYMat);
+
+	glm_mat4_identity(rotZMat);
+	glm_rotate_z(rotZMat, 0.01f * MovementFactor, rotZMat);
+
+	glm_mat4_mul(rotZMat, rotYMat, rotMat);
+	glm_mat4_mul(rotMat, rotXMat, rotMat);
+	glm_mat4_mul(rotMat, Scene->cube2RotMat, rotMat);
+
+	glm_mat4_copy(rotMat, Scene->cube2RotMat);
+
+	mat4 translationOffsetMat;
+	glm_translate_make(translationOffsetMat, Scene->cube2PositionOffset);
+
+	mat4 scaleMat;
+	const vec3 scaleVec = { 0.5f, 0.5f, 0.5f };
+	glm_scale_make(scaleMat, scaleVec);
+
+	glm_mat4_mul(translationMat, rotMat, worldMat);
+	glm_mat4_mul(worldMat, translationOffsetMat, worldMat);
+	glm_mat4_mul(worldMat, scaleMat, worldMat);
+
+	glm_mat4_mul(projMat, viewMat, wvpMat);
+	glm_mat4_mul(wvpMat, Scene->cube2WorldMat, wvpMat);
+
+	glm_mat4_transpose_to(wvpMat, transposed);
+	glm_mat4_copy(transposed, ConstantBufferPerObject);
+	CPU_ZONE_END();
+
+	CPU_ZONE_BEGIN("Constant Upload");
+	memcpy(ConstantBuffer + ConstantBufferPerObjectAlignedSize, &ConstantBufferPerObject, sizeof(ConstantBufferPerObject));
+	CPU_ZONE_END();
+
+	glm_mat4_copy(worldMat, Scene->cube2WorldMat);
+
+	//view space depth of each cube's origin, used to order draws front to back
+	vec3 viewPos;
+	glm_mat4_mulv3(Scene->cameraViewMat, Scene->cube1WorldMat[3], 1.0f, viewPos);
+	Scene->cube1Depth = viewPos[2];
+	glm_mat4_mulv3(Scene->cameraViewMat, Scene->cube2WorldMat[3], 1.0f, viewPos);
+	Scene->cube2Depth = viewPos[2];
+}
+
+//returns the number of draws recorded, Capture may be NULL
+UINT RecordFrame(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, UINT FrameIndex, const D3D12_VIEWPORT* Viewport, const D3D12_RECT* ScissorRect, struct CommandStream* Capture)
+{
+	THROW_ON_FAIL(ID3D12CommandAllocator_Reset(DxObjects->CommandAllocators[FrameIndex]));
+	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Reset(DxObjects->CommandList, DxObjects->CommandAllocators[FrameIndex], DxObjects->PipelineStateObject));
+
+	struct CommandEncoder Encoder;
+	InitCommandEncoder(&Encoder, DxObjects->CommandList, DxObjects->PipelineStateObject, Capture, &DxObjects->EncoderStats);
+
+	//profiler queries go straight to the command list, a trace holds only the frame's own commands
+	GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Frame");
+
+	{
+		D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
+		TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_ALL;
+		TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_RENDER_TARGET;
+		TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COMMON;
+		TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_RENDER_TARGET;
+		TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_PRESENT;
+		TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+		TextureBarrier.pResource = DxObjects->RenderTargets[FrameIndex];
+		TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+		EncodeTextureBarrier(&Encoder, &TextureBarrier);
+	}
+
+	const D3D12_CPU_DESCRIPTOR_HANDLE BackBufferRtv = { .ptr = DxObjects->RtvHeapHandle.ptr + (FrameIndex * DxObjects->RtvDescriptorSize) };
+
+	//with dynamic resolution the scene goes to the corner of SceneColor and is stretched over the back buffer afterwards
+	const bool bScaled = DxObjects->Resolution.bEnabled;
+	const D3D12_CPU_DESCRIPTOR_HANDLE RtvHandle = bScaled ? DxObjects->SceneColorRtv : BackBufferRtv;
+
+	ResidencyUse(&DxObjects->Residency, DxObjects->VertexBuffer);
+	ResidencyUse(&DxObjects->Residency, DxObjects->IndexBuffer);
+	ResidencyUse(&DxObjects->Residency, DxObjects->Texture);
+	ResidencyUse(&DxObjects->Residency, DxObjects->DepthStencilBuffer);
+
+	if (bScaled)
+		ResidencyUse(&DxObjects->Residency, DxObjects->SceneColor);
+
+	D3D12_VIEWPORT SceneViewport = *Viewport;
+	D3D12_RECT SceneScissorRect = *ScissorRect;
+
+	if (bScaled)
+	{
+		SceneViewport.Width = max(1.0f, floorf(Viewport->Width * DxObjects->Resolution.Scale));
+		SceneViewport.Height = max(1.0f, floorf(Viewport->Height * DxObjects->Resolution.Scale));
+		SceneScissorRect.right = SceneScissorRect.left + (LONG)SceneViewport.Width;
+		SceneScissorRect.bottom = SceneScissorRect.top + (LONG)SceneViewport.Height;
+	}
+
+	UINT DrawCount = 0;
+
+	if (DxObjects->Shadows.bEnabled)
+	{
+		GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Shadows");
+		DrawCount += RecordShadowPasses(DxObjects, FrameIndex, &Encoder);
+		GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+	}
+
+	GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Clear");
+	EncodeSetRenderTarget(&Encoder, RtvHandle, DxObjects->DsvHeapHandle);
+	EncodeClearRenderTarget(&Encoder, RtvHandle, ((const float[]) { 0.0f, 0.2f, 0.4f, 1.0f }));
+	EncodeClearDepth(&Encoder, DxObjects->DsvHeapHandle, 1.0f);
+	GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+	
+	EncodeSetDescriptorHeap(&Encoder, DxObjects->SRVDescriptorHeap);
+	EncodeSetViewport(&Encoder, &SceneViewport);
+	EncodeSetScissor(&Encoder, &SceneScissorRect);
+	EncodeSetTopology(&Encoder, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	WriteClusterConstants(&DxObjects->Lighting, Scene, FrameIndex, &SceneViewport);
+	WriteShadowConstants(&DxObjects->Shadows, Scene, FrameIndex);
+
+	GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Cubes");
+
+	if (DxObjects->Culling.bEnabled)
+	{
+		DrawCount += RecordGpuDrivenDraws(DxObjects, Scene, FrameIndex, &Encoder);
+	}
+	else
+	{
+		DrawCount += RecordCubeDraws(DxObjects, Scene, FrameIndex, &Encoder);
+	}
+
+	GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+
+	if (DxObjects->Particles.bEnabled)
+	{
+		GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Particles");
+		DrawCount += RecordParticleDraw(&DxObjects->Particles, Scene, FrameIndex, &Encoder);
+		GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+	}
+
+	if (bScaled)
+	{
+		GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Upscale");
+
+		D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
+		TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_RENDER_TARGET;
+		TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_PIXEL_SHADING;
+		TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_RENDER_TARGET;
+		TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_SHADER_RESOURCE;
+		TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+		TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_SHADER_RESOURCE;
+		TextureBarrier.pResource = DxObjects->SceneColor;
+		TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+		EncodeTextureBarrier(&Encoder, &TextureBarrier);
+
+		//uv covering the rendered corner, clamped half a texel in so bilinear taps stay inside it
+		const float UpscaleConstants[UPSCALE_ROOT_CONSTANTS] = {
+			SceneViewport.Width / Viewport->Width,
+			SceneViewport.Height / Viewport->Height,
+			(SceneViewport.Width - 0.5f) / Viewport->Width,
+			(SceneViewport.Height - 0.5f) / Viewport->Height
+		};
+
+		EncodeSetRenderTarget(&Encoder, BackBufferRtv, (D3D12_CPU_DESCRIPTOR_HANDLE){ 0 });
+		EncodeSetViewport(&Encoder, Viewport);
+		EncodeSetScissor(&Encoder, ScissorRect);
+		EncodeSetPipelineState(&Encoder, DxObjects->UpscalePipelineState);
+		EncodeSetRootSignature(&Encoder, DxObjects->UpscaleRootSignature);
+		EncodeSetRootConstants(&Encoder, 0, UPSCALE_ROOT_CONSTANTS, UpscaleConstants);
+		EncodeSetRootTable(&Encoder, 1, DxObjects->SceneColorSrv);
+		EncodeDraw(&Encoder, 3, 1, 0, 0);
+
+		TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_PIXEL_SHADING;
+		TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_RENDER_TARGET;
+		TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_SHADER_RESOURCE;
+		TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_RENDER_TARGET;
+		TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_SHADER_RESOURCE;
+		TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+		EncodeTextureBarrier(&Encoder, &TextureBarrier);
+
+		GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+	}
+
+	if (DxObjects->Recorder.Current >= 0)
+	{
+		GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Readback Copy");
+		RecordReadbackCopy(&DxObjects->Recorder, DxObjects->CommandList, DxObjects->RenderTargets[FrameIndex]);
+		GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+	}
+
+	GpuProfilerBegin(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList, "Present Transition");
+
+	{
+		D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
+		TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_RENDER_TARGET;
+		TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_ALL;
+		TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_RENDER_TARGET;
+		TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_COMMON;
+		TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+		TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_PRESENT;
+		TextureBarrier.pResource = DxObjects->RenderTargets[FrameIndex];
+		TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+		EncodeTextureBarrier(&Encoder, &TextureBarrier);
+	}
+
+	GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+	GpuProfilerEnd(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+	GpuProfilerResolve(&DxObjects->Profiler, FrameIndex, DxObjects->CommandList);
+
+	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Close(DxObjects->CommandList));
+
+	return DrawCount;
+}
+
+//sorts the cube packets, then either records them directly or replays the slot's bundle, re-recording it if the key changed
+UINT RecordCubeDraws(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, UINT FrameIndex, struct CommandEncoder* restrict Encoder)
+{
+	struct DrawQueue* Queue = &DxObjects->DrawQueue;
+
+	//room for the two cubes and every caster, which counts the cubes again, so culling can only leave it short of full
+	BeginFrameDrawQueue(Queue, &DxObjects->FrameArenas[FrameIndex], 2 + DxObjects->Shadows.CasterCount);
+
+	struct DrawPacket Cube = { 0 };
+	Cube.PipelineState = DxObjects->PipelineStateObject;
+	Cube.RootSignature = DxObjects->RootSignature;
+	Cube.DescriptorTable = DxObjects->Lighting.Tables[FrameIndex];
+	Cube.VertexBuffer = &DxObjects->VertexBufferView;
+	Cube.IndexBuffer = &DxObjects->IndexBufferView;
+	Cube.IndexCount = NUM_CUBE_INDICES;
+
+	//there is only one pipeline, root signature, table and mesh so far, so their ids are all 0
+	Cube.Constants = DxObjects->ContantBufferGPUAddress[FrameIndex];
+	PushDrawPacket(Queue, MakeDrawKey(0, 0, 0, 0, 0, Scene->cube1Depth), &Cube);
+
+	//the big cube is the only occluder, the small one orbiting it is the only occludee
+	bool bCube2Visible = true;
+
+	if (DxObjects->Occlusion.bEnabled)
+	{
+		CPU_ZONE_BEGIN("Occlusion Culling");
+
+		mat4 ViewProjMat;
+		glm_mat4_mul(Scene->cameraProjMat, Scene->cameraViewMat, ViewProjMat);
+
+		mat4 WvpMat;
+		glm_mat4_mul(ViewProjMat, Scene->cube1WorldMat, WvpMat);
+
+		ClearOcclusionBuffer(&DxObjects->Occlusion);
+		RasterizeOccluder(&DxObjects->Occlusion, WvpMat, VertexList, ARRAYSIZE(VertexList), IndexList, NUM_CUBE_INDICES);
+		BuildOcclusionHierarchy(&DxObjects->Occlusion);
+
+		glm_mat4_mul(ViewProjMat, Scene->cube2WorldMat, WvpMat);
+		bCube2Visible = OcclusionTestBox(&DxObjects->Occlusion, WvpMat, (vec3) { -0.5f, -0.5f, -0.5f }, (vec3) { 0.5f, 0.5f, 0.5f });
+
+		CPU_ZONE_END();
+	}
+
+	if (bCube2Visible)
+	{
+		Cube.Constants = DxObjects->ContantBufferGPUAddress[FrameIndex] + ConstantBufferPerObjectAlignedSize;
+		PushDrawPacket(Queue, MakeDrawKey(0, 0, 0, 0, 0, Scene->cube2Depth), &Cube);
+	}
+
+	//the props are only there to catch and cast shadows, their constants are in the shadow buffer
+	if (DxObjects->Shadows.bEnabled)
+	{
+		const struct ShadowMaps* Shadows = &DxObjects->Shadows;
+
+		for (UINT i = SHADOW_DYNAMIC_CASTERS; i < Shadows->CasterCount; i++)
+		{
+			Cube.Constants = Shadows->BufferAddresses[FrameIndex] + SHADOW_OBJECTS_OFFSET + i * ConstantBufferPerObjectAlignedSize;
+			PushDrawPacket(Queue, MakeDrawKey(0, 0, 0, 0, 0, Shadows->Casters[i].Depth), &Cube);
+		}
+	}
+
+	SortDrawQueue(Queue);
+
+	struct BundleCache* Cache = &DxObjects->Bundles;
+
+	if (!Cache->bEnabled)
+		return SubmitDrawQueue(Queue, Encoder);
+
+	if (!BundleCacheLookup(Cache, FrameIndex, BundleKey(Queue, DxObjects->SRVDescriptorHeap)))
+	{
+		//the slot's fence has been waited on, so its last bundle is no longer in flight
+		THROW_ON_FAIL(ID3D12CommandAllocator_Reset(Cache->Allocators[FrameIndex]));
+		THROW_ON_FAIL(ID3D12GraphicsCommandList7_Reset(Cache->Bundles[FrameIndex], Cache->Allocators[FrameIndex], NULL));
+
+		//a bundle inherits no state, except that it must set the same heap as the list that executes it
+		struct CommandEncoder BundleEncoder;
+		InitCommandEncoder(&BundleEncoder, Cache->Bundles[FrameIndex], NULL, NULL, &Cache->Stats);
+		EncodeSetDescriptorHeap(&BundleEncoder, DxObjects->SRVDescriptorHeap);
+		EncodeSetTopology(&BundleEncoder, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		Cache->DrawCounts[FrameIndex] = SubmitDrawQueue(Queue, &BundleEncoder);
+
+		THROW_ON_FAIL(ID3D12GraphicsCommandList7_Close(Cache->Bundles[FrameIndex]));
+	}
+
+	EncodeExecuteBundle(Encoder, Cache->Bundles[FrameIndex]);
+	return Cache->DrawCounts[FrameIndex];
+}
+
+//InitialState is the pipeline the command list was reset with
+void InitCommandEncoder(struct CommandEncoder* restrict Encoder, ID3D12GraphicsCommandList7* CommandList, ID3D12PipelineState* InitialState, struct CommandStream* Capture, struct EncoderStats* Stats)
+{
+	Encoder->CommandList = CommandList;
+	Encoder->Capture = Capture;
+	Encoder->Stats = Stats;
+	Encoder->Shadow = (struct EncoderShadow){ 0 };
+	Encoder->Shadow.PipelineState = InitialState;
+}
+
+void ReportEncoderStats(const struct EncoderStats* restrict Stats)
+{
+	WriteConsoleA(ConsoleHandle, "command                issued   elided\n", 39, NULL, NULL);
+
+	for (UINT i = 0; i < COMMAND_OP_COUNT; i++)
+	{
+		if (Stats->Issued[i] == 0 && Stats->Elided[i] == 0)
+			continue;
+
+		char buffer[96];
+		int stringlength = _snprintf_s(buffer, 96, _TRUNCATE, "%-20s %8llu %8llu\n", CommandOpNames[i], Stats->Issued[i], Stats->Elided[i]);
+		WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+	}
+}
+
+void CreateGpuCulling(struct DxObjects* restrict DxObjects)
+{
+	struct GpuCulling* Culling = &DxObjects->Culling;
+
+	{
+		D3D12_ROOT_PARAMETER1 RootParameters[4] = { 0 };
+		RootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		RootParameters[0].Constants.ShaderRegister = 0;
+		RootParameters[0].Constants.RegisterSpace = 0;
+		RootParameters[0].Constants.Num32BitValues = CULL_ROOT_CONSTANTS;
+		RootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+		RootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		RootParameters[1].Descriptor.ShaderRegister = 0;
+		RootParameters[1].Descriptor.RegisterSpace = 0;
+		RootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+		RootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		RootParameters[2].Descriptor.ShaderRegister = 0;
+		RootParameters[2].Descriptor.RegisterSpace = 0;
+		RootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+		RootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+		RootParameters[3].Descriptor.ShaderRegister = 1;
+		RootParameters[3].Descriptor.RegisterSpace = 0;
+		RootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+		D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDesc = { 0 };
+		RootSignatureDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+		RootSignatureDesc.Desc_1_1.NumParameters = ARRAYSIZE(RootParameters);
+		RootSignatureDesc.Desc_1_1.pParameters = RootParameters;
+		RootSignatureDesc.Desc_1_1.NumStaticSamplers = 0;
+		RootSignatureDesc.Desc_1_1.pStaticSamplers = NULL;
+		RootSignatureDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE;
+
+		ID3D10Blob* Signature;
+		THROW_ON_FAIL(D3D12SerializeVersionedRootSignature(&RootSignatureDesc, &Signature, NULL));
+		THROW_ON_FAIL(ID3D12Device10_CreateRootSignature(Device, 0, ID3D10Blob_GetBufferPointer(Signature), ID3D10Blob_GetBufferSize(Signature), &IID_ID3D12RootSignature, &Culling->RootSignature));
+		THROW_ON_FAIL(ID3D10Blob_Release(Signature));
+	}
+
+	{
+		HANDLE ComputeShaderFile = CreateFileW(L"CullShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		VALIDATE_HANDLE(ComputeShaderFile);
+
+		LONGLONG ComputeShaderSize;
+		THROW_ON_FALSE(GetFileSizeEx(ComputeShaderFile, &ComputeShaderSize));
+
+		HANDLE ComputeShaderFileMap = CreateFileMappingW(ComputeShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		VALIDATE_HANDLE(ComputeShaderFileMap);
+
+		const void* ComputeShaderBytecode = MapViewOfFile(ComputeShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+
+		struct
+		{
+			alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypepRootSignature;
+			ID3D12RootSignature* pRootSignature;
+
+			alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeCS;
+			D3D12_SHADER_BYTECODE CS;
+		} PipelineStateObject = { 0 };
+
+		PipelineStateObject.ObjectTypepRootSignature = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+		PipelineStateObject.pRootSignature = Culling->RootSignature;
+
+		PipelineStateObject.ObjectTypeCS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_CS;
+		PipelineStateObject.CS.pShaderBytecode = ComputeShaderBytecode;
+		PipelineStateObject.CS.BytecodeLength = ComputeShaderSize;
+
+		D3D12_PIPELINE_STATE_STREAM_DESC PsoStreamDesc = { 0 };
+		PsoStreamDesc.SizeInBytes = sizeof(PipelineStateObject);
+		PsoStreamDesc.pPipelineStateSubobjectStream = &PipelineStateObject;
+
+		THROW_ON_FAIL(ID3D12Device10_CreatePipelineState(Device, &PsoStreamDesc, &IID_ID3D12PipelineState, &Culling->PipelineState));
+
+		THROW_ON_FALSE(UnmapViewOfFile(ComputeShaderBytecode));
+		THROW_ON_FALSE(CloseHandle(ComputeShaderFileMap));
+		THROW_ON_FALSE(CloseHandle(ComputeShaderFile));
+	}
+
+	{
+		D3D12_INDIRECT_ARGUMENT_DESC ArgumentDescs[2] = { 0 };
+		ArgumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+		ArgumentDescs[0].ConstantBufferView.RootParameterIndex = 0;
+		ArgumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC CommandSignatureDesc = { 0 };
+		CommandSignatureDesc.ByteStride = sizeof(struct IndirectCommand);
+		CommandSignatureDesc.NumArgumentDescs = ARRAYSIZE(ArgumentDescs);
+		CommandSignatureDesc.pArgumentDescs = ArgumentDescs;
+		CommandSignatureDesc.NodeMask = 0;
+
+		//the root cbv argument needs the graphics root signature it patches
+		THROW_ON_FAIL(ID3D12Device10_CreateCommandSignature(Device, &CommandSignatureDesc, DxObjects->RootSignature, &IID_ID3D12CommandSignature, &Culling->CommandSignature));
+	}
+
+	D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+	ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	ResourceDesc.Alignment = 0;
+	ResourceDesc.Height = 1;
+	ResourceDesc.DepthOrArraySize = 1;
+	ResourceDesc.MipLevels = 1;
+	ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ResourceDesc.SampleDesc.Count = 1;
+	ResourceDesc.SampleDesc.Quality = 0;
+	ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		ResourceDesc.Width = CULL_MAX_OBJECTS * sizeof(struct GpuObject);
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Culling->ObjectBuffers[i]));
+			MemoryTrackResource(Culling->ObjectBuffers[i], MEMORY_UPLOAD, &ResourceDesc, "Cull Object Buffer");
+
+#ifdef _DEBUG
+			THROW_ON_FAIL(ID3D12Resource_SetName(Culling->ObjectBuffers[i], L"Cull Object Buffer"));
+#endif
+
+			THROW_ON_FAIL(ID3D12Resource_Map(Culling->ObjectBuffers[i], 0, NULL, &Culling->ObjectData[i]));
+		}
+	}
+
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+		ResourceDesc.Width = CULL_MAX_OBJECTS * sizeof(struct IndirectCommand);
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Culling->CommandBuffer));
+		MemoryTrackResource(Culling->CommandBuffer, MEMORY_GPU_BUFFER, &ResourceDesc, "Indirect Command Buffer");
+
+		ResourceDesc.Width = sizeof(UINT);
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Culling->CountBuffer));
+		MemoryTrackResource(Culling->CountBuffer, MEMORY_GPU_BUFFER, &ResourceDesc, "Indirect Count Buffer");
+	}
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12Resource_SetName(Culling->CommandBuffer, L"Indirect Command Buffer"));
+	THROW_ON_FAIL(ID3D12Resource_SetName(Culling->CountBuffer, L"Indirect Count Buffer"));
+#endif
+
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		//the commands followed by the count
+		ResourceDesc.Width = CULL_MAX_OBJECTS * sizeof(struct IndirectCommand) + sizeof(UINT);
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Culling->Readback));
+		MemoryTrackResource(Culling->Readback, MEMORY_READBACK, &ResourceDesc, "Cull Readback");
+	}
+}
+
+void FreeGpuCulling(struct GpuCulling* restrict Culling)
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		ID3D12Resource_Unmap(Culling->ObjectBuffers[i], 0, NULL);
+		THROW_ON_FAIL(ID3D12Resource_Release(Culling->ObjectBuffers[i]));
+	}
+
+	THROW_ON_FAIL(ID3D12Resource_Release(Culling->CommandBuffer));
+	THROW_ON_FAIL(ID3D12Resource_Release(Culling->CountBuffer));
+	THROW_ON_FAIL(ID3D12Resource_Release(Culling->Readback));
+	THROW_ON_FAIL(ID3D12CommandSignature_Release(Culling->CommandSignature));
+	THROW_ON_FAIL(ID3D12PipelineState_Release(Culling->PipelineState));
+	THROW_ON_FAIL(ID3D12RootSignature_Release(Culling->RootSignature));
+}
+
+//one dispatch culls and compacts the objects, one ExecuteIndirect draws the survivors, returns the indirect call count
+UINT RecordGpuDrivenDraws(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, UINT FrameIndex, struct CommandEncoder* restrict Encoder)
+{
+	struct GpuCulling* Culling = &DxObjects->Culling;
+	struct GpuObject* Objects = Culling->ObjectData[FrameIndex];
+	struct CullConstants* Constants = &Culling->Constants[FrameIndex];
+
+	SetGpuObject(&Objects[0], Scene->cube1WorldMat, CUBE_BOUNDING_RADIUS, DxObjects->ContantBufferGPUAddress[FrameIndex]);
+	SetGpuObject(&Objects[1], Scene->cube2WorldMat, CUBE_BOUNDING_RADIUS * 0.5f, DxObjects->ContantBufferGPUAddress[FrameIndex] + ConstantBufferPerObjectAlignedSize);
+	Constants->ObjectCount = 2;
+
+	if (DxObjects->Shadows.bEnabled)
+	{
+		const struct ShadowMaps* Shadows = &DxObjects->Shadows;
+
+		for (UINT i = SHADOW_DYNAMIC_CASTERS; i < Shadows->CasterCount; i++)
+		{
+			SetGpuObject(&Objects[Constants->ObjectCount++], Shadows->Casters[i].WorldMat, Shadows->Casters[i].Radius, Shadows->BufferAddresses[FrameIndex] + SHADOW_OBJECTS_OFFSET + i * ConstantBufferPerObjectAlignedSize);
+		}
+	}
+
+	//glm_frustum_planes assumes a -1..1 depth range, which only moves the near plane behind the camera
+	mat4 ViewProjMat;
+	glm_mat4_mul(Scene->cameraProjMat, Scene->cameraViewMat, ViewProjMat);
+	glm_frustum_planes(ViewProjMat, Constants->Planes);
+
+	D3D12_BUFFER_BARRIER BufferBarriers[2] = { 0 };
+	BufferBarriers[0].pResource = Culling->CommandBuffer;
+	BufferBarriers[0].Size = UINT64_MAX;
+	BufferBarriers[1].pResource = Culling->CountBuffer;
+	BufferBarriers[1].Size = UINT64_MAX;
+
+	for (int i = 0; i < ARRAYSIZE(BufferBarriers); i++)
+	{
+		BufferBarriers[i].SyncBefore = D3D12_BARRIER_SYNC_EXECUTE_INDIRECT;
+		BufferBarriers[i].SyncAfter = D3D12_BARRIER_SYNC_COMPUTE_SHADING;
+		BufferBarriers[i].AccessBefore = D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT;
+		BufferBarriers[i].AccessAfter = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS;
+		EncodeBufferBarrier(Encoder, &BufferBarriers[i]);
+	}
+
+	EncodeSetPipelineState(Encoder, Culling->PipelineState);
+	EncodeSetComputeRootSignature(Encoder, Culling->RootSignature);
+	EncodeSetComputeRootConstants(Encoder, 0, CULL_ROOT_CONSTANTS, Constants);
+	EncodeSetComputeRootSrv(Encoder, 1, ID3D12Resource_GetGPUVirtualAddress(Culling->ObjectBuffers[FrameIndex]));
+	EncodeSetComputeRootUav(Encoder, 2, ID3D12Resource_GetGPUVirtualAddress(Culling->CommandBuffer));
+	EncodeSetComputeRootUav(Encoder, 3, ID3D12Resource_GetGPUVirtualAddress(Culling->CountBuffer));
+	EncodeDispatch(Encoder, 1, 1, 1);
+
+	for (int i = 0; i < ARRAYSIZE(BufferBarriers); i++)
+	{
+		BufferBarriers[i].SyncBefore = D3D12_BARRIER_SYNC_COMPUTE_SHADING;
+		BufferBarriers[i].SyncAfter = D3D12_BARRIER_SYNC_EXECUTE_INDIRECT;
+		BufferBarriers[i].AccessBefore = D3D12_BARRIER_ACCESS_UNORDERED_ACCESS;
+		BufferBarriers[i].AccessAfter = D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT;
+		EncodeBufferBarrier(Encoder, &BufferBarriers[i]);
+	}
+
+	EncodeSetPipelineState(Encoder, DxObjects->PipelineStateObject);
+	EncodeSetRootSignature(Encoder, DxObjects->RootSignature);
+	EncodeSetRootTable(Encoder, 1, DxObjects->Lighting.Tables[FrameIndex]);
+	EncodeSetVertexBuffer(Encoder, &DxObjects->VertexBufferView);
+	EncodeSetIndexBuffer(Encoder, &DxObjects->IndexBufferView);
+	EncodeExecuteIndirect(Encoder, Culling->CommandSignature, CULL_MAX_OBJECTS, Culling->CommandBuffer, Culling->CountBuffer);
+
+	return 1;
+}
+
+//mirrors CullShader.hlsl operation for operation, so the commands and their order match it bit for bit
+UINT CullObjectsReference(const struct GpuObject* restrict Objects, const struct CullConstants* restrict Constants, struct IndirectCommand* restrict Commands)
+{
+	UINT Count = 0;
+
+	for (UINT i = 0; i < Constants->ObjectCount; i++)
+	{
+		const float* Sphere = Objects[i].Sphere;
+		bool bVisible = true;
+
+		for (UINT p = 0; p < 6 && bVisible; p++)
+		{
+			const float* Plane = Constants->Planes[p];
+			const float Distance = Plane[0] * Sphere[0] + Plane[1] * Sphere[1] + Plane[2] * Sphere[2] + Plane[3];
+
+			if (Distance < -Sphere[3])
+				bVisible = false;
+		}
+
+		if (!bVisible)
+			continue;
+
+		struct IndirectCommand* Command = &Commands[Count++];
+		Command->ConstantsLow = Objects[i].ConstantsLow;
+		Command->ConstantsHigh = Objects[i].ConstantsHigh;
+		Command->IndexCountPerInstance = Objects[i].IndexCount;
+		Command->InstanceCount = 1;
+		Command->StartIndexLocation = Objects[i].StartIndex;
+		Command->BaseVertexLocation = 0;
+		Command->StartInstanceLocation = 0;
+	}
+
+	return Count;
+}
+
+//reads back the last frame's commands and compares them with the reference, the queue must be idle
+bool ValidateGpuCulling(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT* restrict GpuCount, UINT* restrict CpuCount)
+{
+	struct GpuCulling* Culling = &DxObjects->Culling;
+	const UINT Slot = SyncObjects->FrameIndex;
+	const UINT64 CommandBytes = CULL_MAX_OBJECTS * sizeof(struct IndirectCommand);
+
+	THROW_ON_FAIL(ID3D12CommandAllocator_Reset(DxObjects->CommandAllocators[Slot]));
+	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Reset(DxObjects->CommandList, DxObjects->CommandAllocators[Slot], NULL));
+
+	{
+		D3D12_BUFFER_BARRIER BufferBarriers[2] = { 0 };
+		BufferBarriers[0].pResource = Culling->CommandBuffer;
+		BufferBarriers[1].pResource = Culling->CountBuffer;
+
+		for (int i = 0; i < ARRAYSIZE(BufferBarriers); i++)
+		{
+			BufferBarriers[i].SyncBefore = D3D12_BARRIER_SYNC_EXECUTE_INDIRECT;
+			BufferBarriers[i].SyncAfter = D3D12_BARRIER_SYNC_COPY;
+			BufferBarriers[i].AccessBefore = D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT;
+			BufferBarriers[i].AccessAfter = D3D12_BARRIER_ACCESS_COPY_SOURCE;
+			BufferBarriers[i].Size = UINT64_MAX;
+		}
+
+		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+		ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
+		ResourceBarrier.NumBarriers = ARRAYSIZE(BufferBarriers);
+		ResourceBarrier.pBufferBarriers = BufferBarriers;
+		ID3D12GraphicsCommandList7_Barrier(DxObjects->CommandList, 1, &ResourceBarrier);
+	}
+
+	ID3D12GraphicsCommandList7_CopyBufferRegion(DxObjects->CommandList, Culling->Readback, 0, Culling->CommandBuffer, 0, CommandBytes);
+	ID3D12GraphicsCommandList7_CopyBufferRegion(DxObjects->CommandList, Culling->Readback, CommandBytes, Culling->CountBuffer, 0, sizeof(UINT));
+
+	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Close(DxObjects->CommandList));
+	ID3D12CommandQueue_ExecuteCommandLists(DxObjects->CommandQueue, 1, &DxObjects->CommandList);
+	SignalSubmission(DxObjects, SyncObjects);
+	FlushCommandQueue(SyncObjects);
+
+	struct IndirectCommand Reference[CULL_MAX_OBJECTS];
+	*CpuCount = CullObjectsReference(Culling->ObjectData[Slot], &Culling->Constants[Slot], Reference);
+
+	UINT8* ReadbackData;
+	THROW_ON_FAIL(ID3D12Resource_Map(Culling->Readback, 0, &(D3D12_RANGE){ 0, CommandBytes + sizeof(UINT) }, &ReadbackData));
+
+	*GpuCount = *(const UINT*)(ReadbackData + CommandBytes);
+	const bool bMatch = *GpuCount == *CpuCount && memcmp(ReadbackData, Reference, *CpuCount * sizeof(struct IndirectCommand)) == 0;
+
+	ID3D12Resource_Unmap(Culling->Readback, 0, &(D3D12_RANGE){ 0, 0 });
+
+	//the buffers are left in the state the next frame's first barrier expects
+	THROW_ON_FAIL(ID3D12CommandAllocator_Reset(DxObjects->CommandAllocators[Slot]));
+	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Reset(DxObjects->CommandList, DxObjects->CommandAllocators[Slot], NULL));
+
+	{
+		D3D12_BUFFER_BARRIER BufferBarriers[2] = { 0 };
+		BufferBarriers[0].pResource = Culling->CommandBuffer;
+		BufferBarriers[1].pResource = Culling->CountBuffer;
+
+		for (int i = 0; i < ARRAYSIZE(BufferBarriers); i++)
+		{
+			BufferBarriers[i].SyncBefore = D3D12_BARRIER_SYNC_COPY;
+			BufferBarriers[i].SyncAfter = D3D12_BARRIER_SYNC_EXECUTE_INDIRECT;
+			BufferBarriers[i].AccessBefore = D3D12_BARRIER_ACCESS_COPY_SOURCE;
+			BufferBarriers[i].AccessAfter = D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT;
+			BufferBarriers[i].Size = UINT64_MAX;
+		}
+
+		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+		ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
+		ResourceBarrier.NumBarriers = ARRAYSIZE(BufferBarriers);
+		ResourceBarrier.pBufferBarriers = BufferBarriers;
+		ID3D12GraphicsCommandList7_Barrier(DxObjects->CommandList, 1, &ResourceBarrier);
+	}
+
+	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Close(DxObjects->CommandList));
+	ID3D12CommandQueue_ExecuteCommandLists(DxObjects->CommandQueue, 1, &DxObjects->CommandList);
+	SignalSubmission(DxObjects, SyncObjects);
+	FlushCommandQueue(SyncObjects);
+
+	return bMatch;
+}
+
+//culls CULL_BENCH_OBJECTS random spheres against a fixed frustum, returns the average microseconds per pass
+double BenchmarkCullReference(void)
+{
+	const SIZE_T ObjectBytes = CULL_BENCH_OBJECTS * sizeof(struct GpuObject);
+	const SIZE_T CommandBytes = CULL_BENCH_OBJECTS * sizeof(struct IndirectCommand);
+
+	UINT8* Memory = VirtualAlloc(NULL, ObjectBytes + CommandBytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Memory);
+
+	struct GpuObject* Objects = (struct GpuObject*)Memory;
+	struct IndirectCommand* Commands = (struct IndirectCommand*)(Memory + ObjectBytes);
+
+	UINT64 Random = 0x9E3779B97F4A7C15;
+
+	for (UINT i = 0; i < CULL_BENCH_OBJECTS; i++)
+	{
+		for (UINT c = 0; c < 4; c++)
+		{
+			Objects[i].Sphere[c] = RandomFloat(&Random) * (c == 3 ? 2.0f : 40.0f) - (c == 3 ? 0.0f : 20.0f);
+		}
+
+		Objects[i].IndexCount = NUM_CUBE_INDICES;
+	}
+
+	struct CullConstants Constants = { 0 };
+	Constants.ObjectCount = CULL_BENCH_OBJECTS;
+
+	{
+		mat4 ProjMat;
+		mat4 ViewMat;
+		mat4 ViewProjMat;
+		glm_perspective_lh_zo(45.0f * (3.14f / 180.0f), 16.0f / 9.0f, 0.1f, 1000.0f, ProjMat);
+		glm_lookat_lh((vec3) { 0.0f, 2.0f, -4.0f }, (vec3) { 0.0f, 0.0f, 0.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, ViewMat);
+		glm_mat4_mul(ProjMat, ViewMat, ViewProjMat);
+		glm_frustum_planes(ViewProjMat, Constants.Planes);
+	}
+
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < CULL_BENCH_ITERATIONS; i++)
+	{
+		CullObjectsReference(Objects, &Constants, Commands);
+	}
+
+	QueryPerformanceCounter(&End);
+
+	THROW_ON_FALSE(VirtualFree(Memory, 0, MEM_RELEASE));
+
+	return (double)(End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / CULL_BENCH_ITERATIONS;
+}
+
+void CreateBundleCache(struct BundleCache* restrict Cache)
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Device10_CreateCommandAllocator(Device, D3D12_COMMAND_LIST_TYPE_BUNDLE, &IID_ID3D12CommandAllocator, &Cache->Allocators[i]));
+		THROW_ON_FAIL(ID3D12Device10_CreateCommandList1(Device, 0, D3D12_COMMAND_LIST_TYPE_BUNDLE, D3D12_COMMAND_LIST_FLAG_NONE, &IID_ID3D12GraphicsCommandList7, &Cache->Bundles[i]));
+
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12GraphicsCommandList7_SetName(Cache->Bundles[i], L"Cube Bundle"));
+#endif
+	}
+}
+
+void FreeBundleCache(struct BundleCache* restrict Cache)
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12GraphicsCommandList7_Release(Cache->Bundles[i]));
+		THROW_ON_FAIL(ID3D12CommandAllocator_Release(Cache->Allocators[i]));
+	}
+}
+
+//FNV-1a over everything a bundle bakes in, in draw order, so any rebind or reorder gives a new key
+UINT64 BundleKey(const struct DrawQueue* restrict Queue, ID3D12DescriptorHeap* DescriptorHeap)
+{
+	UINT64 Hash = 0xCBF29CE484222325;
+
+#define HASH_BYTES(Data, Size) \
+	for (SIZE_T b = 0; b < (Size); b++) \
+	{ \
+		Hash ^= ((const UINT8*)(Data))[b]; \
+		Hash *= 0x100000001B3; \
+	}
+
+	HASH_BYTES(&DescriptorHeap, sizeof(DescriptorHeap));
+
+	for (UINT i = 0; i < Queue->Count; i++)
+	{
+		const struct DrawPacket* Packet = &Queue->Packets[Queue->Entries[i].Index];
+
+		HASH_BYTES(&Packet->PipelineState, sizeof(Packet->PipelineState));
+		HASH_BYTES(&Packet->RootSignature, sizeof(Packet->RootSignature));
+		HASH_BYTES(&Packet->DescriptorTable, sizeof(Packet->DescriptorTable));
+		HASH_BYTES(Packet->VertexBuffer, sizeof(*Packet->VertexBuffer));
+		HASH_BYTES(Packet->IndexBuffer, sizeof(*Packet->IndexBuffer));
+		HASH_BYTES(&Packet->Constants, sizeof(Packet->Constants));
+		HASH_BYTES(&Packet->IndexCount, sizeof(Packet->IndexCount));
+	}
+
+#undef HASH_BYTES
+
+	//zero marks an empty slot
+	return Hash ? Hash : 1;
+}
+
+//records the time for BUNDLE_BENCH_ITERATIONS cube sections on each path, the queue must be idle and nothing is executed
+void BenchmarkBundleRecording(struct DxObjects* restrict DxObjects, const struct Scene* restrict Scene, double* restrict DirectMicroseconds, double* restrict BundleMicroseconds)
+{
+	const bool bEnabled = DxObjects->Bundles.bEnabled;
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	for (UINT Path = 0; Path < 2; Path++)
+	{
+		DxObjects->Bundles.bEnabled = Path == 1;
+
+		struct EncoderStats Stats = { 0 };
+		INT64 Elapsed = 0;
+
+		for (UINT i = 0; i < BUNDLE_BENCH_ITERATIONS; i++)
+		{
+			THROW_ON_FAIL(ID3D12CommandAllocator_Reset(DxObjects->CommandAllocators[0]));
+			THROW_ON_FAIL(ID3D12GraphicsCommandList7_Reset(DxObjects->CommandList, DxObjects->CommandAllocators[0], DxObjects->PipelineStateObject));
+
+			struct CommandEncoder Encoder;
+			InitCommandEncoder(&Encoder, DxObjects->CommandList, DxObjects->PipelineStateObject, NULL, &Stats);
+			EncodeSetDescriptorHeap(&Encoder, DxObjects->SRVDescriptorHeap);
+			EncodeSetTopology(&Encoder, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+			//nothing is in flight, so slot 0's arena can be handed out again every iteration
+			ResetFrameArena(&DxObjects->FrameArenas[0]);
+
+			LARGE_INTEGER Start;
+			LARGE_INTEGER End;
+			QueryPerformanceCounter(&Start);
+			RecordCubeDraws(DxObjects, Scene, 0, &Encoder);
+			QueryPerformanceCounter(&End);
+			Elapsed += End.QuadPart - Start.QuadPart;
+
+			THROW_ON_FAIL(ID3D12GraphicsCommandList7_Close(DxObjects->CommandList));
+		}
+
+		*(Path == 0 ? DirectMicroseconds : BundleMicroseconds) = (double)Elapsed * 1000000.0 / Frequency.QuadPart / BUNDLE_BENCH_ITERATIONS;
+	}
+
+	DxObjects->Bundles.bEnabled = bEnabled;
+}
+
+void CreateUpscalePipeline(struct DxObjects* restrict DxObjects)
+{
+	{
+		D3D12_DESCRIPTOR_RANGE1 DescriptorRange = { 0 };
+		DescriptorRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		DescriptorRange.NumDescriptors = 1;
+		DescriptorRange.BaseShaderRegister = 0;
+		DescriptorRange.RegisterSpace = 0;
+		DescriptorRange.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+		DescriptorRange.OffsetInDescriptorsFromTableStart = 0;
+
+		D3D12_ROOT_PARAMETER1 RootParameters[2] = { 0 };
+		RootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		RootParameters[0].Constants.ShaderRegister = 0;
+		RootParameters[0].Constants.RegisterSpace = 0;
+		RootParameters[0].Constants.Num32BitValues = UPSCALE_ROOT_CONSTANTS;
+		RootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+		RootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		RootParameters[1].DescriptorTable.NumDescriptorRanges = 1;
+		RootParameters[1].DescriptorTable.pDescriptorRanges = &DescriptorRange;
+		RootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+		D3D12_STATIC_SAMPLER_DESC Sampler = { 0 };
+		Sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+		Sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		Sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		Sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+		Sampler.MipLODBias = 0;
+		Sampler.MaxAnisotropy = 0;
+		Sampler.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+		Sampler.BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+		Sampler.MinLOD = 0.0f;
+		Sampler.MaxLOD = D3D12_FLOAT32_MAX;
+		Sampler.ShaderRegister = 0;
+		Sampler.RegisterSpace = 0;
+		Sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+		D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDesc = { 0 };
+		RootSignatureDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+		RootSignatureDesc.Desc_1_1.NumParameters = ARRAYSIZE(RootParameters);
+		RootSignatureDesc.Desc_1_1.pParameters = RootParameters;
+		RootSignatureDesc.Desc_1_1.NumStaticSamplers = 1;
+		RootSignatureDesc.Desc_1_1.pStaticSamplers = &Sampler;
+		RootSignatureDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+		ID3D10Blob* Signature;
+		THROW_ON_FAIL(D3D12SerializeVersionedRootSignature(&RootSignatureDesc, &Signature, NULL));
+		THROW_ON_FAIL(ID3D12Device10_CreateRootSignature(Device, 0, ID3D10Blob_GetBufferPointer(Signature), ID3D10Blob_GetBufferSize(Signature), &IID_ID3D12RootSignature, &DxObjects->UpscaleRootSignature));
+		THROW_ON_FAIL(ID3D10Blob_Release(Signature));
+	}
+
+	HANDLE VertexShaderFile = CreateFileW(L"UpscaleVertexShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(VertexShaderFile);
+
+	LONGLONG VertexShaderSize;
+	THROW_ON_FALSE(GetFileSizeEx(VertexShaderFile, &VertexShaderSize));
+
+	HANDLE VertexShaderFileMap = CreateFileMappingW(VertexShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(VertexShaderFileMap);
+
+	const void* VertexShaderBytecode = MapViewOfFile(VertexShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+
+	HANDLE PixelShaderFile = CreateFileW(L"UpscalePixelShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(PixelShaderFile);
+
+	LONGLONG PixelShaderSize;
+	THROW_ON_FALSE(GetFileSizeEx(PixelShaderFile, &PixelShaderSize));
+
+	HANDLE PixelShaderFileMap = CreateFileMappingW(PixelShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(PixelShaderFileMap);
+
+	const void* PixelShaderBytecode = MapViewOfFile(PixelShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+
+	//no depth and no vertex input, the triangle comes from SV_VertexID
+	struct
+	{
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypepRootSignature;
+		ID3D12RootSignature* pRootSignature;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeVS;
+		D3D12_SHADER_BYTECODE VS;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypePS;
+		D3D12_SHADER_BYTECODE PS;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDepthStencilState;
+		D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeRTVFormats;
+		struct D3D12_RT_FORMAT_ARRAY RTVFormats;
+	} PipelineStateObject = { 0 };
+
+	PipelineStateObject.ObjectTypepRootSignature = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+	PipelineStateObject.pRootSignature = DxObjects->UpscaleRootSignature;
+
+	PipelineStateObject.ObjectTypeVS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS;
+	PipelineStateObject.VS.pShaderBytecode = VertexShaderBytecode;
+	PipelineStateObject.VS.BytecodeLength = VertexShaderSize;
+
+	PipelineStateObject.ObjectTypePS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS;
+	PipelineStateObject.PS.pShaderBytecode = PixelShaderBytecode;
+	PipelineStateObject.PS.BytecodeLength = PixelShaderSize;
+
+	PipelineStateObject.ObjectTypeDepthStencilState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL;
+	PipelineStateObject.DepthStencilState.DepthEnable = FALSE;
+	PipelineStateObject.DepthStencilState.StencilEnable = FALSE;
+
+	PipelineStateObject.ObjectTypeRTVFormats = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
+	PipelineStateObject.RTVFormats.RTFormats[0] = RTV_FORMAT;
+	PipelineStateObject.RTVFormats.NumRenderTargets = 1;
+
+	D3D12_PIPELINE_STATE_STREAM_DESC PsoStreamDesc = { 0 };
+	PsoStreamDesc.SizeInBytes = sizeof(PipelineStateObject);
+	PsoStreamDesc.pPipelineStateSubobjectStream = &PipelineStateObject;
+
+	THROW_ON_FAIL(ID3D12Device10_CreatePipelineState(Device, &PsoStreamDesc, &IID_ID3D12PipelineState, &DxObjects->UpscalePipelineState));
+
+	THROW_ON_FALSE(UnmapViewOfFile(VertexShaderBytecode));
+	THROW_ON_FALSE(CloseHandle(VertexShaderFileMap));
+	THROW_ON_FALSE(CloseHandle(VertexShaderFile));
+
+	THROW_ON_FALSE(UnmapViewOfFile(PixelShaderBytecode));
+	THROW_ON_FALSE(CloseHandle(PixelShaderFileMap));
+	THROW_ON_FALSE(CloseHandle(PixelShaderFile));
+}
+
+void CreateSceneColor(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height)
+{
+	if (DxObjects->SceneColor)
+	{
+		ResidencyUntrack(&DxObjects->Residency, DxObjects->SceneColor);
+		RetireResource(SyncObjects, DxObjects->SceneColor);
+	}
+
+	D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+	HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+	D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+	ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	ResourceDesc.Alignment = 0;
+	ResourceDesc.Width = Width;
+	ResourceDesc.Height = Height;
+	ResourceDesc.DepthOrArraySize = 1;
+	ResourceDesc.MipLevels = 1;
+	ResourceDesc.Format = RTV_FORMAT;
+	ResourceDesc.SampleDesc.Count = 1;
+	ResourceDesc.SampleDesc.Quality = 0;
+	ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	ResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+	D3D12_CLEAR_VALUE ClearValue = { 0 };
+	ClearValue.Format = RTV_FORMAT;
+	ClearValue.Color[0] = 0.0f;
+	ClearValue.Color[1] = 0.2f;
+	ClearValue.Color[2] = 0.4f;
+	ClearValue.Color[3] = 1.0f;
+
+	THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_RENDER_TARGET, &ClearValue, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects->SceneColor));
+	MemoryTrackResource(DxObjects->SceneColor, MEMORY_RENDER_TARGET, &ResourceDesc, "Scene Color");
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12Resource_SetName(DxObjects->SceneColor, L"Scene Color"));
+#endif
+
+	ResidencyTrack(&DxObjects->Residency, DxObjects->SceneColor, &ResourceDesc);
+
+	//the slots after the back buffers' rtvs and the cube texture's srv
+	DxObjects->SceneColorRtv.ptr = DxObjects->RtvHeapHandle.ptr + BUFFER_COUNT * DxObjects->RtvDescriptorSize;
+	ID3D12Device10_CreateRenderTargetView(Device, DxObjects->SceneColor, NULL, DxObjects->SceneColorRtv);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE SrvCpuHandle;
+	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(DxObjects->SRVDescriptorHeap, &SrvCpuHandle);
+	SrvCpuHandle.ptr += DxObjects->SrvDescriptorSize;
+	ID3D12Device10_CreateShaderResourceView(Device, DxObjects->SceneColor, NULL, SrvCpuHandle);
+
+	DxObjects->SceneColorSrv.ptr = DxObjects->SrvGpuHandle.ptr + DxObjects->SrvDescriptorSize;
+}
+
+void InitResolutionController(struct ResolutionController* restrict Controller, float TargetMs)
+{
+	const bool bEnabled = Controller->bEnabled;
+
+	*Controller = (struct ResolutionController){ 0 };
+	Controller->TargetMs = TargetMs;
+	Controller->Scale = RESOLUTION_MAX_SCALE;
+	Controller->bEnabled = bEnabled;
+}
+
+//deterministic, the same frame times always give the same scales
+float UpdateResolutionScale(struct ResolutionController* restrict Controller, float FrameMs)
+{
+	Controller->History[Controller->NextHistory] = FrameMs;
+	Controller->NextHistory = (Controller->NextHistory + 1) % RESOLUTION_HISTORY;
+	Controller->HistoryCount = min(Controller->HistoryCount + 1, RESOLUTION_HISTORY);
+
+	float Sum = 0.0f;
+
+	for (UINT i = 0; i < Controller->HistoryCount; i++)
+	{
+		Sum += Controller->History[i];
+	}
+
+	//positive when there is time to spare
+	const float Error = (Controller->TargetMs - Sum / Controller->HistoryCount) / Controller->TargetMs;
+	const float Derivative = Error - Controller->PreviousError;
+	Controller->PreviousError = Error;
+
+	//close enough, changing the scale for a few percent only makes the image shimmer
+	if (fabsf(Error) < RESOLUTION_DEADBAND)
+		return Controller->Scale;
+
+	const float Integral = Controller->Integral + Error;
+	const float Output = glm_clamp(RESOLUTION_KP * Error + RESOLUTION_KI * Integral + RESOLUTION_KD * Derivative, -0.5f, 0.5f);
+
+	float Scale = sqrtf(Controller->Scale * Controller->Scale * (1.0f + Output));
+	Scale = roundf(Scale / RESOLUTION_STEP) * RESOLUTION_STEP;
+
+	//the integral stops growing while the scale is pinned, or it would hold the scale there long after the load changes
+	if (Scale < RESOLUTION_MIN_SCALE || Scale > RESOLUTION_MAX_SCALE)
+		Scale = glm_clamp(Scale, RESOLUTION_MIN_SCALE, RESOLUTION_MAX_SCALE);
+	else
+		Controller->Integral = Integral;
+
+	Controller->Scale = Scale;
+	return Scale;
+}
+
+//drives the controller with a modelled GPU cost of 2ms plus a per pixel part that steps between three loads,
+//reports per phase the frames until it stays inside the deadband and where it ends up
+void SimulateResolutionController(float TargetMs, UINT* restrict SettleFrames, float* restrict Scales, float* restrict FrameMs)
+{
+	static const float PHASE_PIXEL_MS[3] = { 10.0f, 30.0f, 20.0f };
+
+	struct ResolutionController Controller = { 0 };
+	InitResolutionController(&Controller, TargetMs);
+
+	for (UINT Phase = 0; Phase < ARRAYSIZE(PHASE_PIXEL_MS); Phase++)
+	{
+		UINT LastOutside = 0;
+		float Ms = 0.0f;
+
+		for (UINT Frame = 0; Frame < RESOLUTION_SIM_PHASE_FRAMES; Frame++)
+		{
+			Ms = 2.0f + PHASE_PIXEL_MS[Phase] * Controller.Scale * Controller.Scale;
+
+			if (fabsf(TargetMs - Ms) / TargetMs >= RESOLUTION_DEADBAND && Controller.Scale > RESOLUTION_MIN_SCALE && Controller.Scale < RESOLUTION_MAX_SCALE)
+				LastOutside = Frame + 1;
+
+			UpdateResolutionScale(&Controller, Ms);
+		}
+
+		SettleFrames[Phase] = LastOutside;
+		Scales[Phase] = Controller.Scale;
+		FrameMs[Phase] = Ms;
+	}
+}
+
+void LedgerTrack(struct MemoryLedger* restrict Ledger, const void* Object, enum MemoryCategory Category, UINT64 Size, const char* Label)
+{
+	AcquireSRWLockExclusive(&Ledger->Lock);
+
+	//untracking needs the entry to find the size and category, so a full table is fatal rather than leaving Live wrong
+	if (Ledger->Count == MEMORY_MAX_ALLOCATIONS)
+	{
+		ReleaseSRWLockExclusive(&Ledger->Lock);
+		THROW_ON_FAIL(HRESULT_FROM_WIN32(ERROR_NOT_ENOUGH_MEMORY));
+	}
+
+	Ledger->Objects[Ledger->Count] = Object;
+	Ledger->Labels[Ledger->Count] = Label;
+	Ledger->Sizes[Ledger->Count] = Size;
+	Ledger->Categories[Ledger->Count] = Category;
+	Ledger->Count++;
+
+	Ledger->Live[Category] += Size;
+	Ledger->Peak[Category] = max(Ledger->Peak[Category], Ledger->Live[Category]);
+	Ledger->Allocated[Category] += Size;
+	Ledger->FrameChurn[Category] += Size;
+
+	ReleaseSRWLockExclusive(&Ledger->Lock);
+}
+
+void MemoryTrack(const void* Object, enum MemoryCategory Category, UINT64 Size, const char* Label)
+{
+	LedgerTrack(&MemoryLedger, Object, Category, Size, Label);
+}
+
+void MemoryTrackResource(ID3D12Resource* Resource, enum MemoryCategory Category, const D3D12_RESOURCE_DESC1* Desc, const char* Label)
+{
+	MemoryTrack(Resource, Category, ResourceAllocationSize(Desc), Label);
+}
+
+UINT64 MemoryTrackedSize(const void* Object)
+{
+	UINT64 Size = 0;
+
+	AcquireSRWLockShared(&MemoryLedger.Lock);
+
+	for (UINT i = 0; i < MemoryLedger.Count; i++)
+	{
+		if (MemoryLedger.Objects[i] == Object)
+		{
+			Size = MemoryLedger.Sizes[i];
+			break;
+		}
+	}
+
+	ReleaseSRWLockShared(&MemoryLedger.Lock);
+	return Size;
+}
+
+//returns false for objects that were never tracked, so generic release paths can call it blindly
+bool LedgerUntrack(struct MemoryLedger* restrict Ledger, const void* Object)
+{
+	AcquireSRWLockExclusive(&Ledger->Lock);
+
+	for (UINT i = 0; i < Ledger->Count; i++)
+	{
+		if (Ledger->Objects[i] != Object)
+			continue;
+
+		const enum MemoryCategory Category = Ledger->Categories[i];
+		Ledger->Live[Category] -= Ledger->Sizes[i];
+		Ledger->Freed[Category] += Ledger->Sizes[i];
+		Ledger->FrameChurn[Category] += Ledger->Sizes[i];
+
+		Ledger->Count--;
+		Ledger->Objects[i] = Ledger->Objects[Ledger->Count];
+		Ledger->Labels[i] = Ledger->Labels[Ledger->Count];
+		Ledger->Sizes[i] = Ledger->Sizes[Ledger->Count];
+		Ledger->Categories[i] = Ledger->Categories[Ledger->Count];
+
+		ReleaseSRWLockExclusive(&Ledger->Lock);
+		return true;
+	}
+
+	ReleaseSRWLockExclusive(&Ledger->Lock);
+	return false;
+}
+
+bool MemoryUntrack(const void* Object)
+{
+	return LedgerUntrack(&MemoryLedger, Object);
+}
+
+void LedgerEndFrame(struct MemoryLedger* restrict Ledger)
+{
+	AcquireSRWLockExclusive(&Ledger->Lock);
+
+	for (UINT i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		Ledger->LastFrameChurn[i] = Ledger->FrameChurn[i];
+		Ledger->PeakFrameChurn[i] = max(Ledger->PeakFrameChurn[i], Ledger->FrameChurn[i]);
+		Ledger->FrameChurn[i] = 0;
+	}
+
+	Ledger->Frames++;
+
+	ReleaseSRWLockExclusive(&Ledger->Lock);
+}
+
+void MemoryEndFrame(void)
+{
+	LedgerEndFrame(&MemoryLedger);
+}
+
+void MemoryTakeSnapshot(struct MemorySnapshot* restrict Snapshot)
+{
+	AcquireSRWLockShared(&MemoryLedger.Lock);
+
+	Snapshot->Frames = MemoryLedger.Frames;
+
+	for (UINT i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		Snapshot->Live[i] = MemoryLedger.Live[i];
+		Snapshot->Peak[i] = MemoryLedger.Peak[i];
+		Snapshot->Allocated[i] = MemoryLedger.Allocated[i];
+		Snapshot->Freed[i] = MemoryLedger.Freed[i];
+	}
+
+	ReleaseSRWLockShared(&MemoryLedger.Lock);
+}
+
+void MemoryDiffSnapshots(const struct MemorySnapshot* restrict Before, const struct MemorySnapshot* restrict After, struct MemorySnapshot* restrict Diff)
+{
+	Diff->Frames = After->Frames - Before->Frames;
+
+	for (UINT i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		Diff->Live[i] = After->Live[i] - Before->Live[i];
+		Diff->Peak[i] = After->Peak[i];
+		Diff->Allocated[i] = After->Allocated[i] - Before->Allocated[i];
+		Diff->Freed[i] = After->Freed[i] - Before->Freed[i];
+	}
+}
+
+void PrintMemorySnapshot(const struct MemorySnapshot* restrict Snapshot)
+{
+	char buffer[128];
+	int stringlength = _snprintf_s(buffer, 128, _TRUNCATE, "memory over %lld frames       live KB  peak KB  alloc KB   free KB\n", Snapshot->Frames);
+	WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+
+	for (UINT i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		stringlength = _snprintf_s(buffer, 128, _TRUNCATE, "%-20s %+14lld %8lld %9lld %9lld\n", MemoryCategoryNames[i],
+			Snapshot->Live[i] / 1024, Snapshot->Peak[i] / 1024, Snapshot->Allocated[i] / 1024, Snapshot->Freed[i] / 1024);
+		WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+	}
+}
+
+void ExportMemoryReport(LPCWSTR Path)
+{
+	static struct TraceWriter Writer;
+
+	Writer.File = CreateFileW(Path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(Writer.File);
+	Writer.Used = 0;
+
+	AcquireSRWLockShared(&MemoryLedger.Lock);
+
+	TraceWrite(&Writer, "{\n\t\"frames\": %llu,\n\t\"categories\": {", MemoryLedger.Frames);
+
+	for (UINT i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		TraceWrite(&Writer,
+			"%s\n\t\t\"%s\": { \"live\": %llu, \"peak\": %llu, \"allocated\": %llu, \"freed\": %llu, \"last_frame_churn\": %llu, \"peak_frame_churn\": %llu }",
+			i == 0 ? "" : ",", MemoryCategoryNames[i], MemoryLedger.Live[i], MemoryLedger.Peak[i], MemoryLedger.Allocated[i], MemoryLedger.Freed[i],
+			MemoryLedger.LastFrameChurn[i], MemoryLedger.PeakFrameChurn[i]);
+	}
+
+	TraceWrite(&Writer, "\n\t},\n\t\"allocations\": [");
+
+	for (UINT i = 0; i < MemoryLedger.Count; i++)
+	{
+		TraceWrite(&Writer,
+			"%s\n\t\t{ \"label\": \"%s\", \"category\": \"%s\", \"bytes\": %llu }",
+			i == 0 ? "" : ",", MemoryLedger.Labels[i], MemoryCategoryNames[MemoryLedger.Categories[i]], MemoryLedger.Sizes[i]);
+	}
+
+	ReleaseSRWLockShared(&MemoryLedger.Lock);
+
+	TraceWrite(&Writer, "\n\t]\n}\n");
+	TraceFlush(&Writer);
+	THROW_ON_FALSE(CloseHandle(Writer.File));
+}
+
+//nanoseconds for one track, untrack and end of frame with the table as full as the renderer keeps it. runs on a copy
+//of the live entries so the real ledger and its lock are never touched
+double BenchmarkMemoryAccounting(void)
+{
+	static struct MemoryLedger Ledger;
+	Ledger = (struct MemoryLedger){ 0 };
+	InitializeSRWLock(&Ledger.Lock);
+
+	AcquireSRWLockShared(&MemoryLedger.Lock);
+
+	for (UINT i = 0; i < MemoryLedger.Count; i++)
+	{
+		LedgerTrack(&Ledger, MemoryLedger.Objects[i], MemoryLedger.Categories[i], MemoryLedger.Sizes[i], MemoryLedger.Labels[i]);
+	}
+
+	ReleaseSRWLockShared(&MemoryLedger.Lock);
+
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < MEMORY_BENCH_ITERATIONS; i++)
+	{
+		const void* Object = (const void*)(UINT_PTR)(i + 1);
+		LedgerTrack(&Ledger, Object, (enum MemoryCategory)(i % MEMORY_CATEGORY_COUNT), 65536, "Benchmark");
+		LedgerUntrack(&Ledger, Object);
+		LedgerEndFrame(&Ledger);
+	}
+
+	QueryPerformanceCounter(&End);
+
+	return (double)(End.QuadPart - Start.QuadPart) * 1000000000.0 / Frequency.QuadPart / MEMORY_BENCH_ITERATIONS;
+}
+
+void InitResidencyManager(struct ResidencyManager* restrict Manager, IDXGIAdapter3* Adapter)
+{
+	*Manager = (struct ResidencyManager){ 0 };
+
+	THROW_ON_FAIL(ID3D12Device10_CreateFence(Device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, &Manager->Fence));
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12Fence_SetName(Manager->Fence, L"Residency Fence"));
+#endif
+
+	Manager->Work = CreateThreadpoolWork(ResidencyWork, Manager, NULL);
+	VALIDATE_HANDLE(Manager->Work);
+
+	//signalled by the OS whenever the budget moves, so it is only queried when it changed
+	Manager->BudgetEvent = CreateEventW(NULL, FALSE, TRUE, NULL);
+	VALIDATE_HANDLE(Manager->BudgetEvent);
+
+	THROW_ON_FAIL(IDXGIAdapter3_RegisterVideoMemoryBudgetChangeNotificationEvent(Adapter, Manager->BudgetEvent, &Manager->BudgetCookie));
+}
+
+void FreeResidencyManager(struct ResidencyManager* restrict Manager, IDXGIAdapter3* Adapter)
+{
+	WaitForThreadpoolWorkCallbacks(Manager->Work, FALSE);
+	CloseThreadpoolWork(Manager->Work);
+
+	IDXGIAdapter3_UnregisterVideoMemoryBudgetChangeNotification(Adapter, Manager->BudgetCookie);
+	THROW_ON_FALSE(CloseHandle(Manager->BudgetEvent));
+
+	THROW_ON_FAIL(ID3D12Fence_Release(Manager->Fence));
+}
+
+//newly created committed resources start out resident
+void ResidencyTrack(struct ResidencyManager* restrict Manager, ID3D12Resource* Resource, const D3D12_RESOURCE_DESC1* Desc)
+{
+	for (UINT i = 0; i < RESIDENCY_MAX_OBJECTS; i++)
+	{
+		if (Manager->bTracked[i])
+			continue;
+
+		Manager->Objects[i] = (ID3D12Pageable*)Resource;
+		Manager->Sizes[i] = ResourceAllocationSize(Desc);
+		Manager->LastUsed[i] = 0;
+		Manager->bTracked[i] = true;
+		Manager->bResident[i] = true;
+		Manager->bUsed[i] = false;
+		Manager->ResidentBytes += Manager->Sizes[i];
+		return;
+	}
+
+	//untracked resources simply stay resident, counted so a full table shows up in the report
+	assert(!"RESIDENCY_MAX_OBJECTS is too small");
+	Manager->DroppedTracks++;
+}
+
+void ResidencyUntrack(struct ResidencyManager* restrict Manager, ID3D12Resource* Resource)
+{
+	for (UINT i = 0; i < RESIDENCY_MAX_OBJECTS; i++)
+	{
+		if (!Manager->bTracked[i] || Manager->Objects[i] != (ID3D12Pageable*)Resource)
+			continue;
+
+		//a queued batch holds its own reference, so the resource can go before the worker gets to it
+		if (Manager->bResident[i])
+			Manager->ResidentBytes -= Manager->Sizes[i];
+
+		Manager->Objects[i] = NULL;
+		Manager->bTracked[i] = false;
+		return;
+	}
+}
+
+//decides which of the resources the frame at FenceValue does not use get evicted, least recently used first, so that
+//the ones it does use fit in the budget. anything the GPU may still be reading is skipped. updates the bookkeeping but
+//touches no device objects, returns the number of evictions
+UINT PlanResidency(struct ResidencyManager* restrict Manager, UINT64 Budget, UINT64 FenceValue, UINT64 CompletedValue, UINT* restrict Evicted, UINT* restrict MadeResident, UINT* restrict MadeResidentCount)
+{
+	UINT64 Required = Manager->ResidentBytes;
+	*MadeResidentCount = 0;
+
+	for (UINT i = 0; i < RESIDENCY_MAX_OBJECTS; i++)
+	{
+		if (!Manager->bTracked[i] || !Manager->bUsed[i])
+			continue;
+
+		Manager->LastUsed[i] = FenceValue;
+
+		if (!Manager->bResident[i])
+		{
+			MadeResident[(*MadeResidentCount)++] = i;
+			Required += Manager->Sizes[i];
+		}
+	}
+
+	UINT EvictedCount = 0;
+
+	while (Required > Budget)
+	{
+		int Victim = -1;
+
+		for (UINT i = 0; i < RESIDENCY_MAX_OBJECTS; i++)
+		{
+			if (!Manager->bTracked[i] || !Manager->bResident[i] || Manager->bUsed[i] || Manager->LastUsed[i] > CompletedValue)
+				continue;
+
+			if (Victim == -1 || Manager->LastUsed[i] < Manager->LastUsed[Victim])
+				Victim = i;
+		}
+
+		//the frame needs more than the budget allows, D3D12 will have to page for us
+		if (Victim == -1)
+		{
+			Manager->OvercommittedFrames++;
+			break;
+		}
+
+		Manager->bResident[Victim] = false;
+		Required -= Manager->Sizes[Victim];
+		Evicted[EvictedCount++] = Victim;
+	}
+
+	for (UINT i = 0; i < *MadeResidentCount; i++)
+	{
+		Manager->bResident[MadeResident[i]] = true;
+	}
+
+	for (UINT i = 0; i < RESIDENCY_MAX_OBJECTS; i++)
+	{
+		Manager->bUsed[i] = false;
+	}
+
+	Manager->ResidentBytes = Required;
+	Manager->Evictions += EvictedCount;
+	Manager->MakeResidents += *MadeResidentCount;
+
+	return EvictedCount;
+}
+
+//called between recording and submitting a frame that will signal FenceValue
+void FlushResidency(struct ResidencyManager* restrict Manager, IDXGIAdapter3* Adapter, ID3D12CommandQueue* CommandQueue, UINT64 FenceValue, UINT64 CompletedValue)
+{
+	if (Manager->BudgetOverride)
+	{
+		Manager->Budget = Manager->BudgetOverride;
+	}
+	else if (WaitForSingleObject(Manager->BudgetEvent, 0) == WAIT_OBJECT_0)
+	{
+		DXGI_QUERY_VIDEO_MEMORY_INFO LocalMemory;
+		THROW_ON_FAIL(IDXGIAdapter3_QueryVideoMemoryInfo(Adapter, 0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &LocalMemory));
+
+		//the swap chain, upload heaps and everything else untracked come out of the same budget
+		const UINT64 Untracked = LocalMemory.CurrentUsage > Manager->ResidentBytes ? LocalMemory.CurrentUsage - Manager->ResidentBytes : 0;
+		Manager->Budget = LocalMemory.Budget > Untracked ? LocalMemory.Budget - Untracked : 0;
+	}
+
+	//only a worker that has fallen a whole queue behind makes the render thread wait
+	if (Manager->BatchesQueued - ReadAcquire64(&Manager->BatchesIssued) == RESIDENCY_BATCH_QUEUE)
+	{
+		Manager->QueueWaits++;
+		WaitForThreadpoolWorkCallbacks(Manager->Work, FALSE);
+	}
+
+	UINT Evicted[RESIDENCY_MAX_OBJECTS];
+	UINT MadeResident[RESIDENCY_MAX_OBJECTS];
+	UINT MadeResidentCount;
+	const UINT EvictedCount = PlanResidency(Manager, Manager->Budget, FenceValue, CompletedValue, Evicted, MadeResident, &MadeResidentCount);
+
+	if (EvictedCount == 0 && MadeResidentCount == 0)
+		return;
+
+	struct ResidencyBatch* Batch = &Manager->Batches[Manager->BatchesQueued % RESIDENCY_BATCH_QUEUE];
+
+	for (UINT i = 0; i < EvictedCount; i++)
+	{
+		Batch->Evict[i] = Manager->Objects[Evicted[i]];
+		ID3D12Pageable_AddRef(Batch->Evict[i]);
+	}
+
+	for (UINT i = 0; i < MadeResidentCount; i++)
+	{
+		Batch->Resident[i] = Manager->Objects[MadeResident[i]];
+		ID3D12Pageable_AddRef(Batch->Resident[i]);
+	}
+
+	Batch->EvictCount = EvictedCount;
+	Batch->ResidentCount = MadeResidentCount;
+	Batch->FenceValue = 0;
+
+	//the frame only has to wait when something it uses is coming back
+	if (MadeResidentCount > 0)
+	{
+		Batch->FenceValue = ++Manager->FenceValue;
+		THROW_ON_FAIL(ID3D12CommandQueue_Wait(CommandQueue, Manager->Fence, Batch->FenceValue));
+	}
+
+	WriteRelease64(&Manager->BatchesQueued, Manager->BatchesQueued + 1);
+
+	//an active worker picks the batch up before it stops
+	if (InterlockedExchange(&Manager->bWorkerActive, TRUE) == FALSE)
+		SubmitThreadpoolWork(Manager->Work);
+}
+
+//issues every queued batch in order, an evict never overtakes an earlier make resident
+VOID CALLBACK ResidencyWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+	struct ResidencyManager* Manager = Context;
+
+	do
+	{
+		for (LONG64 Issued = Manager->BatchesIssued; Issued < ReadAcquire64(&Manager->BatchesQueued); Issued++)
+		{
+			struct ResidencyBatch* Batch = &Manager->Batches[Issued % RESIDENCY_BATCH_QUEUE];
+
+			if (Batch->EvictCount > 0)
+				THROW_ON_FAIL(ID3D12Device10_Evict(Device, Batch->EvictCount, Batch->Evict));
+
+			if (Batch->ResidentCount > 0)
+				THROW_ON_FAIL(ID3D12Device10_EnqueueMakeResident(Device, D3D12_RESIDENCY_FLAG_NONE, Batch->ResidentCount, Batch->Resident, Manager->Fence, Batch->FenceValue));
+
+			for (UINT i = 0; i < Batch->EvictCount; i++)
+			{
+				ID3D12Pageable_Release(Batch->Evict[i]);
+			}
+
+			for (UINT i = 0; i < Batch->ResidentCount; i++)
+			{
+				ID3D12Pageable_Release(Batch->Resident[i]);
+			}
+
+			WriteRelease64(&Manager->BatchesIssued, Issued + 1);
+		}
+
+		InterlockedExchange(&Manager->bWorkerActive, FALSE);
+
+		//a batch queued after the last check but before the flag cleared saw the worker as active and did not submit
+	} while (ReadAcquire64(&Manager->BatchesIssued) < ReadAcquire64(&Manager->BatchesQueued) && InterlockedExchange(&Manager->bWorkerActive, TRUE) == FALSE);
+}
+
+//runs the policy against a made up working set and budget with no device involved, checking that what a frame uses
+//is always resident, that nothing in flight is evicted, that victims go in LRU order and that the budget holds
+//whenever it can
+bool SimulateResidency(UINT64* restrict Evictions, UINT64* restrict MakeResidents, UINT64* restrict OvercommittedFrames)
+{
+	static struct ResidencyManager Manager;
+	Manager = (struct ResidencyManager){ 0 };
+
+	const UINT64 MB = 1024 * 1024;
+
+	for (UINT i = 0; i < RESIDENCY_SIM_OBJECTS; i++)
+	{
+		Manager.bTracked[i] = true;
+		Manager.bResident[i] = true;
+		Manager.Sizes[i] = (1 + i % 4) * MB;
+		Manager.ResidentBytes += Manager.Sizes[i];
+	}
+
+	bool bValid = true;
+
+	for (UINT Frame = 0; Frame < RESIDENCY_SIM_FRAMES; Frame++)
+	{
+		//the first four are used every frame, the rest in a sliding window of four
+		for (UINT i = 0; i < 4; i++)
+		{
+			Manager.bUsed[i] = true;
+			Manager.bUsed[4 + (Frame / 8 + i) % (RESIDENCY_SIM_OBJECTS - 4)] = true;
+		}
+
+		//the budget drops to the bare working set for the middle third, as it would with another application competing for memory
+		const UINT64 Budget = (Frame >= RESIDENCY_SIM_FRAMES / 3 && Frame < RESIDENCY_SIM_FRAMES * 2 / 3) ? 20 * MB : 32 * MB;
+		const UINT64 FenceValue = Frame + 1;
+		const UINT64 CompletedValue = Frame >= BUFFER_COUNT ? Frame + 1 - BUFFER_COUNT : 0;
+
+		bool bUsed[RESIDENCY_SIM_OBJECTS];
+		UINT64 LastUsed[RESIDENCY_SIM_OBJECTS];
+		memcpy(bUsed, Manager.bUsed, sizeof(bUsed));
+		memcpy(LastUsed, Manager.LastUsed, sizeof(LastUsed));
+
+		UINT Evicted[RESIDENCY_MAX_OBJECTS];
+		UINT MadeResident[RESIDENCY_MAX_OBJECTS];
+		UINT MadeResidentCount;
+		const UINT64 Overcommitted = Manager.OvercommittedFrames;
+		const UINT EvictedCount = PlanResidency(&Manager, Budget, FenceValue, CompletedValue, Evicted, MadeResident, &MadeResidentCount);
+
+		UINT64 OldestKept = UINT64_MAX;
+
+		for (UINT i = 0; i < RESIDENCY_SIM_OBJECTS; i++)
+		{
+			if (bUsed[i] && !Manager.bResident[i])
+				bValid = false;
+
+			if (Manager.bResident[i] && !bUsed[i] && LastUsed[i] <= CompletedValue)
+				OldestKept = min(OldestKept, LastUsed[i]);
+		}
+
+		for (UINT i = 0; i < EvictedCount; i++)
+		{
+			if (bUsed[Evicted[i]] || LastUsed[Evicted[i]] > CompletedValue || LastUsed[Evicted[i]] > OldestKept)
+				bValid = false;
+		}
+
+		if (Manager.OvercommittedFrames == Overcommitted && Manager.ResidentBytes > Budget)
+			bValid = false;
+	}
+
+	*Evictions = Manager.Evictions;
+	*MakeResidents = Manager.MakeResidents;
+	*OvercommittedFrames = Manager.OvercommittedFrames;
+	return bValid;
+}
+
+//limits both parsers share, checked once the format and counts are known and before any offsets are computed
+bool ValidateTextureFile(const struct TextureFile* restrict Texture)
+{
+	UINT64 RowBytes;
+	UINT RowCount;
+	const UINT BlockSize = TextureSurfaceInfo(Texture->Format, Texture->Width, Texture->Height, &RowBytes, &RowCount);
+
+	if (BlockSize == 0)
+		return false;
+
+	if (Texture->Width == 0 || Texture->Height == 0 || Texture->Width > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION || Texture->Height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+		return false;
+
+	//d3d12 wants the top level of a block compressed texture to be whole blocks
+	if (Texture->Width % BlockSize || Texture->Height % BlockSize)
+		return false;
+
+	if (Texture->ArraySize == 0 || Texture->ArraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+		return false;
+
+	UINT FullChain = 1;
+	for (UINT Size = max(Texture->Width, Texture->Height); Size > 1; Size >>= 1)
+		FullChain++;
+
+	if (Texture->MipLevels == 0 || Texture->MipLevels > FullChain)
+		return false;
+
+	return (UINT64)Texture->MipLevels * Texture->ArraySize <= TEXTURE_MAX_SUBRESOURCES;
+}
+
+bool ParseDdsTexture(struct TextureFile* restrict Texture, const UINT8* Data, UINT64 Size)
+{
+	struct DdsHeader Header;
+	UINT64 Offset = sizeof(UINT32) + sizeof(Header);
+
+	if (Size < Offset || memcmp(Data, "DDS ", 4) != 0)
+		return false;
+
+	memcpy(&Header, Data + sizeof(UINT32), sizeof(Header));
+
+	if (Header.Size != sizeof(struct DdsHeader) || Header.PixelFormat.Size != sizeof(struct DdsPixelFormat))
+		return false;
+
+	if (Header.Caps2 & DDS_CAPS2_VOLUME)
+		return false;
+
+	Texture->Format = DXGI_FORMAT_UNKNOWN;
+	Texture->Width = Header.Width;
+	Texture->Height = Header.Height;
+	Texture->ArraySize = 1;
+	Texture->MipLevels = max(Header.MipMapCount, 1);
+
+	const struct DdsPixelFormat* PixelFormat = &Header.PixelFormat;
+	bool bDx10 = false;
+
+	if (PixelFormat->Flags & DDS_PF_FOURCC)
+	{
+		switch (PixelFormat->FourCC)
+		{
+		case DDS_FOURCC('D', 'X', 'T', '1'):
+			Texture->Format = DXGI_FORMAT_BC1_UNORM;
+			break;
+		case DDS_FOURCC('D', 'X', 'T', '2'):
+		case DDS_FOURCC('D', 'X', 'T', '3'):
+			Texture->Format = DXGI_FORMAT_BC2_UNORM;
+			break;
+		case DDS_FOURCC('D', 'X', 'T', '4'):
+		case DDS_FOURCC('D', 'X', 'T', '5'):
+			Texture->Format = DXGI_FORMAT_BC3_UNORM;
+			break;
+		case DDS_FOURCC('A', 'T', 'I', '1'):
+		case DDS_FOURCC('B', 'C', '4', 'U'):
+			Texture->Format = DXGI_FORMAT_BC4_UNORM;
+			break;
+		case DDS_FOURCC('B', 'C', '4', 'S'):
+			Texture->Format = DXGI_FORMAT_BC4_SNORM;
+			break;
+		case DDS_FOURCC('A', 'T', 'I', '2'):
+		case DDS_FOURCC('B', 'C', '5', 'U'):
+			Texture->Format = DXGI_FORMAT_BC5_UNORM;
+			break;
+		case DDS_FOURCC('B', 'C', '5', 'S'):
+			Texture->Format = DXGI_FORMAT_BC5_SNORM;
+			break;
+		case DDS_FOURCC('D', 'X', '1', '0'):
+		{
+			struct DdsHeaderDx10 Dx10;
+
+			if (Size - Offset < sizeof(Dx10))
+				return false;
+
+			memcpy(&Dx10, Data + Offset, sizeof(Dx10));
+			Offset += sizeof(Dx10);
+
+			if (Dx10.ResourceDimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D || Dx10.ArraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+				return false;
+
+			//cube maps are loaded as their six faces per element, the order d3d12 expects for a cube array
+			Texture->Format = (DXGI_FORMAT)Dx10.DxgiFormat;
+			Texture->ArraySize = Dx10.ArraySize * (Dx10.MiscFlag & DDS_MISC_TEXTURECUBE ? 6 : 1);
+			bDx10 = true;
+			break;
+		}
+		}
+	}
+	else if (PixelFormat->Flags & DDS_PF_RGB)
+	{
+		if (PixelFormat->RgbBitCount == 32 && PixelFormat->RBitMask == 0x000000FF && PixelFormat->GBitMask == 0x0000FF00 && PixelFormat->BBitMask == 0x00FF0000)
+			Texture->Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		else if (PixelFormat->RgbBitCount == 32 && PixelFormat->RBitMask == 0x00FF0000 && PixelFormat->GBitMask == 0x0000FF00 && PixelFormat->BBitMask == 0x000000FF)
+			Texture->Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+		else if (PixelFormat->RgbBitCount == 16 && PixelFormat->RBitMask == 0xF800 && PixelFormat->GBitMask == 0x07E0 && PixelFormat->BBitMask == 0x001F)
+			Texture->Format = DXGI_FORMAT_B5G6R5_UNORM;
+	}
+	else if (PixelFormat->Flags & DDS_PF_LUMINANCE && PixelFormat->RgbBitCount == 8)
+	{
+		Texture->Format = DXGI_FORMAT_R8_UNORM;
+	}
+
+	if (!bDx10 && Header.Caps2 & DDS_CAPS2_CUBEMAP)
+	{
+		if ((Header.Caps2 & DDS_CAPS2_CUBEMAP_ALLFACES) != DDS_CAPS2_CUBEMAP_ALLFACES)
+			return false;
+
+		Texture->ArraySize = 6;
+	}
+
+	if (!ValidateTextureFile(Texture))
+		return false;
+
+	//dds stores the whole chain of one slice before the next slice
+	for (UINT Slice = 0; Slice < Texture->ArraySize; Slice++)
+	{
+		for (UINT Mip = 0; Mip < Texture->MipLevels; Mip++)
+		{
+			UINT64 RowBytes;
+			UINT RowCount;
+			TextureSurfaceInfo(Texture->Format, max(Texture->Width >> Mip, 1), max(Texture->Height >> Mip, 1), &RowBytes, &RowCount);
+
+			const UINT64 SurfaceBytes = RowBytes * RowCount;
+
+			if (SurfaceBytes > Size - Offset)
+				return false;
+
+			Texture->Pixels[Mip + Slice * Texture->MipLevels] = Data + Offset;
+			Offset += SurfaceBytes;
+		}
+	}
+
+	return true;
+}
+
+bool ParseKtx2Texture(struct TextureFile* restrict Texture, const UINT8* Data, UINT64 Size)
+{
+	struct Ktx2Header Header;
+
+	if (Size < sizeof(Header))
+		return false;
+
+	memcpy(&Header, Data, sizeof(Header));
+
+	if (memcmp(Header.Identifier, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0)
+		return false;
+
+	//supercompressed levels would need a decoder in between, which is the copy this loader exists to avoid
+	if (Header.SupercompressionScheme != 0 || Header.PixelDepth > 1)
+		return false;
+
+	if ((Header.FaceCount != 1 && Header.FaceCount != 6) || Header.LayerCount > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+		return false;
+
+	switch (Header.VkFormat)
+	{
+	case 4: //VK_FORMAT_R5G6B5_UNORM_PACK16
+		Texture->Format = DXGI_FORMAT_B5G6R5_UNORM;
+		break;
+	case 9: //VK_FORMAT_R8_UNORM
+		Texture->Format = DXGI_FORMAT_R8_UNORM;
+		break;
+	case 37: //VK_FORMAT_R8G8B8A8_UNORM
+		Texture->Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		break;
+	case 43: //VK_FORMAT_R8G8B8A8_SRGB
+		Texture->Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		break;
+	case 44: //VK_FORMAT_B8G8R8A8_UNORM
+		Texture->Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+		break;
+	case 50: //VK_FORMAT_B8G8R8A8_SRGB
+		Texture->Format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+		break;
+	case 97: //VK_FORMAT_R16G16B16A16_SFLOAT
+		Texture->Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		break;
+	case 109: //VK_FORMAT_R32G32B32A32_SFLOAT
+		Texture->Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		break;
+	case 131: //VK_FORMAT_BC1_RGB_UNORM_BLOCK
+	case 133: //VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC1_UNORM;
+		break;
+	case 132: //VK_FORMAT_BC1_RGB_SRGB_BLOCK
+	case 134: //VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		Texture->Format = DXGI_FORMAT_BC1_UNORM_SRGB;
+		break;
+	case 135: //VK_FORMAT_BC2_UNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC2_UNORM;
+		break;
+	case 136: //VK_FORMAT_BC2_SRGB_BLOCK
+		Texture->Format = DXGI_FORMAT_BC2_UNORM_SRGB;
+		break;
+	case 137: //VK_FORMAT_BC3_UNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC3_UNORM;
+		break;
+	case 138: //VK_FORMAT_BC3_SRGB_BLOCK
+		Texture->Format = DXGI_FORMAT_BC3_UNORM_SRGB;
+		break;
+	case 139: //VK_FORMAT_BC4_UNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC4_UNORM;
+		break;
+	case 140: //VK_FORMAT_BC4_SNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC4_SNORM;
+		break;
+	case 141: //VK_FORMAT_BC5_UNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC5_UNORM;
+		break;
+	case 142: //VK_FORMAT_BC5_SNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC5_SNORM;
+		break;
+	case 143: //VK_FORMAT_BC6H_UFLOAT_BLOCK
+		Texture->Format = DXGI_FORMAT_BC6H_UF16;
+		break;
+	case 144: //VK_FORMAT_BC6H_SFLOAT_BLOCK
+		Texture->Format = DXGI_FORMAT_BC6H_SF16;
+		break;
+	case 145: //VK_FORMAT_BC7_UNORM_BLOCK
+		Texture->Format = DXGI_FORMAT_BC7_UNORM;
+		break;
+	case 146: //VK_FORMAT_BC7_SRGB_BLOCK
+		Texture->Format = DXGI_FORMAT_BC7_UNORM_SRGB;
+		break;
+	default:
+		return false;
+	}
+
+	//a level count of zero asks the reader to generate mips, only the base level is in the file
+	Texture->Width = Header.PixelWidth;
+	Texture->Height = max(Header.PixelHeight, 1);
+	Texture->ArraySize = max(Header.LayerCount, 1) * Header.FaceCount;
+	Texture->MipLevels = max(Header.LevelCount, 1);
+
+	if (!ValidateTextureFile(Texture))
+		return false;
+
+	if (Size - sizeof(Header) < (UINT64)Texture->MipLevels * sizeof(struct Ktx2Level))
+		return false;
+
+	//within a level the images run layer by layer and face by face, which is d3d12's slice order
+	for (UINT Mip = 0; Mip < Texture->MipLevels; Mip++)
+	{
+		struct Ktx2Level Level;
+		memcpy(&Level, Data + sizeof(Header) + Mip * sizeof(Level), sizeof(Level));
+
+		UINT64 RowBytes;
+		UINT RowCount;
+		TextureSurfaceInfo(Texture->Format, max(Texture->Width >> Mip, 1), max(Texture->Height >> Mip, 1), &RowBytes, &RowCount);
+
+		const UINT64 ImageBytes = RowBytes * RowCount;
+
+		if (Level.ByteOffset > Size || Level.ByteLength > Size - Level.ByteOffset || Level.ByteLength < ImageBytes * Texture->ArraySize)
+			return false;
+
+		for (UINT Slice = 0; Slice < Texture->ArraySize; Slice++)
+		{
+			Texture->Pixels[Mip + Slice * Texture->MipLevels] = Data + Level.ByteOffset + Slice * ImageBytes;
+		}
+	}
+
+	return true;
+}
+
+void DescribeTextureFile(const struct TextureFile* restrict Texture, D3D12_RESOURCE_DESC1* restrict Desc)
+{
+	Desc->Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	Desc->Alignment = 0;
+	Desc->Width = Texture->Width;
+	Desc->Height = Texture->Height;
+	Desc->DepthOrArraySize = (UINT16)Texture->ArraySize;
+	Desc->MipLevels = (UINT16)Texture->MipLevels;
+	Desc->Format = Texture->Format;
+	Desc->SampleDesc.Count = 1;
+	Desc->SampleDesc.Quality = 0;
+	Desc->Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	Desc->Flags = D3D12_RESOURCE_FLAG_NONE;
+}
+
+//each row goes from the mapping straight to its footprint, the file is tightly packed and only the pitch differs
+void CopyTextureSubresources(const struct TextureFile* restrict Texture, UINT8* restrict Dest, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT* Layouts, const UINT* RowCounts, const UINT64* RowSizes)
+{
+	const UINT SubresourceCount = Texture->MipLevels * Texture->ArraySize;
+
+	for (UINT i = 0; i < SubresourceCount; i++)
+	{
+		const UINT8* Source = Texture->Pixels[i];
+		UINT8* Target = Dest + Layouts[i].Offset;
+		const UINT64 RowSize = RowSizes[i];
+		const UINT64 RowPitch = Layouts[i].Footprint.RowPitch;
+
+		if (RowSize == RowPitch)
+		{
+			MEMCPY_VERIFY(memcpy_s(Target, RowSize * RowCounts[i], Source, RowSize * RowCounts[i]));
+			continue;
+		}
+
+		for (UINT Row = 0; Row < RowCounts[i]; Row++)
+		{
+			MEMCPY_VERIFY(memcpy_s(Target + Row * RowPitch, RowPitch, Source + Row * RowSize, RowSize));
+		}
+	}
+}
+
+//maps the file and parses it in place, on failure nothing is left open
+bool OpenTextureFile(struct TextureFile* restrict Texture, LPCWSTR Path)
+{
+	Texture->File = CreateFileW(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (Texture->File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER FileSize;
+	THROW_ON_FALSE(GetFileSizeEx(Texture->File, &FileSize));
+
+	//an empty file cannot be mapped
+	if (FileSize.QuadPart == 0)
+	{
+		THROW_ON_FALSE(CloseHandle(Texture->File));
+		return false;
+	}
+
+	Texture->FileMap = CreateFileMappingW(Texture->File, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(Texture->FileMap);
+
+	Texture->Data = MapViewOfFile(Texture->FileMap, FILE_MAP_READ, 0, 0, 0);
+	VALIDATE_HANDLE(Texture->Data);
+
+	Texture->Size = FileSize.QuadPart;
+
+	const bool bParsed = memcmp(Texture->Data, "DDS ", min(Texture->Size, 4)) == 0 ?
+		ParseDdsTexture(Texture, Texture->Data, Texture->Size) :
+		ParseKtx2Texture(Texture, Texture->Data, Texture->Size);
+
+	if (!bParsed)
+	{
+		CloseTextureFile(Texture);
+		return false;
+	}
+
+	//the copy reads the whole mapping front to back, so fault it in ahead of time instead of a page at a time
+	WIN32_MEMORY_RANGE_ENTRY Range = { (PVOID)Texture->Data, Texture->Size };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+
+	return true;
+}
+
+void CloseTextureFile(struct TextureFile* restrict Texture)
+{
+	THROW_ON_FALSE(UnmapViewOfFile(Texture->Data));
+	THROW_ON_FALSE(CloseHandle(Texture->FileMap));
+	THROW_ON_FALSE(CloseHandle(Texture->File));
+	Texture->Data = NULL;
+}
+
+//records the copies on the open command list, the file can be closed as soon as this returns
+void UploadTextureFile(struct DxObjects* restrict DxObjects, const struct TextureFile* restrict Texture, ID3D12Resource** restrict Resource, ID3D12Resource** restrict UploadHeap)
+{
+	static D3D12_PLACED_SUBRESOURCE_FOOTPRINT Layouts[TEXTURE_MAX_SUBRESOURCES];
+	static UINT RowCounts[TEXTURE_MAX_SUBRESOURCES];
+	static UINT64 RowSizes[TEXTURE_MAX_SUBRESOURCES];
+
+	const UINT SubresourceCount = Texture->MipLevels * Texture->ArraySize;
+
+	D3D12_RESOURCE_DESC1 TextureResourceDesc = { 0 };
+	DescribeTextureFile(Texture, &TextureResourceDesc);
+
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &TextureResourceDesc, D3D12_BARRIER_LAYOUT_COMMON, NULL, NULL, 0, NULL, &IID_ID3D12Resource, Resource));
+		MemoryTrackResource(*Resource, MEMORY_TEXTURE, &TextureResourceDesc, "Texture");
+		ResidencyTrack(&DxObjects->Residency, *Resource, &TextureResourceDesc);
+	}
+
+	UINT64 UploadSize;
+	ID3D12Device10_GetCopyableFootprints1(Device, &TextureResourceDesc, 0, SubresourceCount, 0, Layouts, RowCounts, RowSizes, &UploadSize);
+
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		ResourceDesc.Alignment = 0;
+		ResourceDesc.Width = UploadSize;
+		ResourceDesc.Height = 1;
+		ResourceDesc.DepthOrArraySize = 1;
+		ResourceDesc.MipLevels = 1;
+		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ResourceDesc.SampleDesc.Count = 1;
+		ResourceDesc.SampleDesc.Quality = 0;
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, UploadHeap));
+		MemoryTrackResource(*UploadHeap, MEMORY_UPLOAD, &ResourceDesc, "Texture Upload Heap");
+	}
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12Resource_SetName(*UploadHeap, L"Texture Buffer Upload Resource Heap"));
+#endif
+
+	UINT8* UploadData;
+	THROW_ON_FAIL(ID3D12Resource_Map(*UploadHeap, 0, NULL, &UploadData));
+	CopyTextureSubresources(Texture, UploadData, Layouts, RowCounts, RowSizes);
+	ID3D12Resource_Unmap(*UploadHeap, 0, NULL);
+
+	for (UINT i = 0; i < SubresourceCount; i++)
+	{
+		D3D12_TEXTURE_COPY_LOCATION TextureCopyDest = { 0 };
+		TextureCopyDest.pResource = *Resource;
+		TextureCopyDest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		TextureCopyDest.SubresourceIndex = i;
+
+		D3D12_TEXTURE_COPY_LOCATION TextureCopySrc = { 0 };
+		TextureCopySrc.pResource = *UploadHeap;
+		TextureCopySrc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		TextureCopySrc.PlacedFootprint = Layouts[i];
+		ID3D12GraphicsCommandList7_CopyTextureRegion(DxObjects->CommandList, &TextureCopyDest, 0, 0, 0, &TextureCopySrc, NULL);
+	}
+}
+
+//parse time for a bc1 dds and an rgba8 ktx2 array with full chains, and the rate the ktx2 goes into its footprints.
+//both files are built in memory, so this measures the loader and not the disk
+bool BenchmarkTextureLoader(double* restrict DdsParseMicroseconds, double* restrict Ktx2ParseMicroseconds, double* restrict CopyGigabytesPerSecond)
+{
+	static struct TextureFile Texture;
+	static struct TextureFile Rejected;
+	static D3D12_PLACED_SUBRESOURCE_FOOTPRINT Layouts[TEXTURE_MAX_SUBRESOURCES];
+	static UINT RowCounts[TEXTURE_MAX_SUBRESOURCES];
+	static UINT64 RowSizes[TEXTURE_MAX_SUBRESOURCES];
+
+	UINT MipLevels = 1;
+	for (UINT Size = TEXTURE_BENCH_DIMENSION; Size > 1; Size >>= 1)
+		MipLevels++;
+
+	UINT64 Ktx2LevelBytes[D3D12_REQ_MIP_LEVELS];
+	UINT64 DdsSize = sizeof(UINT32) + sizeof(struct DdsHeader);
+	UINT64 Ktx2Size = sizeof(struct Ktx2Header) + MipLevels * sizeof(struct Ktx2Level);
+	const UINT64 Ktx2PayloadOffset = Ktx2Size;
+
+	for (UINT Mip = 0; Mip < MipLevels; Mip++)
+	{
+		const UINT Dimension = max(TEXTURE_BENCH_DIMENSION >> Mip, 1);
+		UINT64 RowBytes;
+		UINT RowCount;
+
+		TextureSurfaceInfo(DXGI_FORMAT_BC1_UNORM, Dimension, Dimension, &RowBytes, &RowCount);
+		DdsSize += RowBytes * RowCount;
+
+		TextureSurfaceInfo(DXGI_FORMAT_R8G8B8A8_UNORM, Dimension, Dimension, &RowBytes, &RowCount);
+		Ktx2LevelBytes[Mip] = RowBytes * RowCount * TEXTURE_BENCH_LAYERS;
+		Ktx2Size += Ktx2LevelBytes[Mip];
+	}
+
+	UINT8* DdsData = VirtualAlloc(NULL, DdsSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(DdsData);
+
+	UINT8* Ktx2Data = VirtualAlloc(NULL, Ktx2Size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Ktx2Data);
+
+	for (UINT64 i = 0; i < DdsSize; i++)
+		DdsData[i] = (UINT8)(i * 31 + 7);
+
+	for (UINT64 i = 0; i < Ktx2Size; i++)
+		Ktx2Data[i] = (UINT8)(i * 17 + 3);
+
+	struct DdsHeader DdsHeader = { 0 };
+	DdsHeader.Size = sizeof(struct DdsHeader);
+	DdsHeader.Width = TEXTURE_BENCH_DIMENSION;
+	DdsHeader.Height = TEXTURE_BENCH_DIMENSION;
+	DdsHeader.MipMapCount = MipLevels;
+	DdsHeader.PixelFormat.Size = sizeof(struct DdsPixelFormat);
+	DdsHeader.PixelFormat.Flags = DDS_PF_FOURCC;
+	DdsHeader.PixelFormat.FourCC = DDS_FOURCC('D', 'X', 'T', '1');
+	MEMCPY_VERIFY(memcpy_s(DdsData, DdsSize, "DDS ", 4));
+	MEMCPY_VERIFY(memcpy_s(DdsData + sizeof(UINT32), DdsSize - sizeof(UINT32), &DdsHeader, sizeof(DdsHeader)));
+
+	struct Ktx2Header Ktx2Header = { 0 };
+	MEMCPY_VERIFY(memcpy_s(Ktx2Header.Identifier, sizeof(Ktx2Header.Identifier), Ktx2Identifier, sizeof(Ktx2Identifier)));
+	Ktx2Header.VkFormat = 37;
+	Ktx2Header.TypeSize = 1;
+	Ktx2Header.PixelWidth = TEXTURE_BENCH_DIMENSION;
+	Ktx2Header.PixelHeight = TEXTURE_BENCH_DIMENSION;
+	Ktx2Header.LayerCount = TEXTURE_BENCH_LAYERS;
+	Ktx2Header.FaceCount = 1;
+	Ktx2Header.LevelCount = MipLevels;
+	MEMCPY_VERIFY(memcpy_s(Ktx2Data, Ktx2Size, &Ktx2Header, sizeof(Ktx2Header)));
+
+	//levels are stored smallest first like the spec lays them out, so only the index says where each one starts
+	UINT64 LevelOffset = Ktx2Size;
+
+	for (UINT Mip = 0; Mip < MipLevels; Mip++)
+	{
+		LevelOffset -= Ktx2LevelBytes[Mip];
+
+		struct Ktx2Level Level = { LevelOffset, Ktx2LevelBytes[Mip], Ktx2LevelBytes[Mip] };
+		MEMCPY_VERIFY(memcpy_s(Ktx2Data + sizeof(Ktx2Header) + Mip * sizeof(Level), sizeof(Level), &Level, sizeof(Level)));
+	}
+
+	bool bValid = true;
+
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	QueryPerformanceFrequency(&Frequency);
+
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < TEXTURE_BENCH_ITERATIONS; i++)
+	{
+		bValid &= ParseDdsTexture(&Texture, DdsData, DdsSize);
+	}
+
+	QueryPerformanceCounter(&End);
+	*DdsParseMicroseconds = (double)(End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / TEXTURE_BENCH_ITERATIONS;
+
+	//the 1x1 mip is the last block in the file
+	bValid &= Texture.Format == DXGI_FORMAT_BC1_UNORM && Texture.MipLevels == MipLevels && Texture.Pixels[MipLevels - 1] + 8 == DdsData + DdsSize;
+
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < TEXTURE_BENCH_ITERATIONS; i++)
+	{
+		bValid &= ParseKtx2Texture(&Texture, Ktx2Data, Ktx2Size);
+	}
+
+	QueryPerformanceCounter(&End);
+	*Ktx2ParseMicroseconds = (double)(End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / TEXTURE_BENCH_ITERATIONS;
+
+	bValid &= Texture.ArraySize == TEXTURE_BENCH_LAYERS && Texture.MipLevels == MipLevels && Texture.Pixels[0] == Ktx2Data + Ktx2Size - Ktx2LevelBytes[0];
+
+	//a file one byte short or with the wrong identifier has to be refused rather than read past its end
+	bValid &= !ParseDdsTexture(&Rejected, DdsData, DdsSize - 1);
+	bValid &= !ParseKtx2Texture(&Rejected, Ktx2Data, Ktx2Size - 1);
+	bValid &= !ParseKtx2Texture(&Rejected, DdsData, DdsSize);
+
+	D3D12_RESOURCE_DESC1 Desc = { 0 };
+	DescribeTextureFile(&Texture, &Desc);
+
+	const UINT SubresourceCount = Texture.MipLevels * Texture.ArraySize;
+
+	UINT64 UploadSize;
+	ID3D12Device10_GetCopyableFootprints1(Device, &Desc, 0, SubresourceCount, 0, Layouts, RowCounts, RowSizes, &UploadSize);
+
+	UINT8* UploadData = VirtualAlloc(NULL, UploadSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(UploadData);
+
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < TEXTURE_COPY_ITERATIONS; i++)
+	{
+		CopyTextureSubresources(&Texture, UploadData, Layouts, RowCounts, RowSizes);
+	}
+
+	QueryPerformanceCounter(&End);
+	*CopyGigabytesPerSecond = (double)(Ktx2Size - Ktx2PayloadOffset) * TEXTURE_COPY_ITERATIONS * Frequency.QuadPart / (End.QuadPart - Start.QuadPart) / 1000000000.0;
+
+	for (UINT i = 0; i < SubresourceCount; i++)
+	{
+		for (UINT Row = 0; Row < RowCounts[i]; Row++)
+		{
+			bValid &= memcmp(UploadData + Layouts[i].Offset + Row * Layouts[i].Footprint.RowPitch, Texture.Pixels[i] + Row * RowSizes[i], RowSizes[i]) == 0;
+		}
+	}
+
+	THROW_ON_FALSE(VirtualFree(UploadData, 0, MEM_RELEASE));
+	THROW_ON_FALSE(VirtualFree(Ktx2Data, 0, MEM_RELEASE));
+	THROW_ON_FALSE(VirtualFree(DdsData, 0, MEM_RELEASE));
+
+	return bValid;
+}
+
+void InitOcclusionBuffer(struct OcclusionBuffer* restrict Buffer)
+{
+	Buffer->Depth = VirtualAlloc(NULL, (OCCLUSION_WIDTH * OCCLUSION_HEIGHT + OCCLUSION_TILES_X * OCCLUSION_TILES_Y) * sizeof(float), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Buffer->Depth);
+	Buffer->TileMaxDepth = Buffer->Depth + OCCLUSION_WIDTH * OCCLUSION_HEIGHT;
+
+	MemoryTrack(Buffer->Depth, MEMORY_CPU, (OCCLUSION_WIDTH * OCCLUSION_HEIGHT + OCCLUSION_TILES_X * OCCLUSION_TILES_Y) * sizeof(float), "Occlusion Depth");
+
+	Buffer->Tested = 0;
+	Buffer->Culled = 0;
+	Buffer->bAvx2 = IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE);
+}
+
+void FreeOcclusionBuffer(struct OcclusionBuffer* restrict Buffer)
+{
+	MemoryUntrack(Buffer->Depth);
+	THROW_ON_FALSE(VirtualFree(Buffer->Depth, 0, MEM_RELEASE));
+}
+
+void ClearOcclusionBuffer(struct OcclusionBuffer* restrict Buffer)
+{
+	for (UINT i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; i++)
+	{
+		Buffer->Depth[i] = 1.0f;
+	}
+}
+
+//triangles crossing the near plane are dropped rather than clipped, that only ever lets more through
+void RasterizeOccluder(struct OcclusionBuffer* restrict Buffer, const mat4 WorldViewProj, const struct Vertex* Vertices, UINT VertexCount, const WORD* Indices, UINT IndexCount)
+{
+	assert(VertexCount <= OCCLUSION_MAX_VERTICES);
+
+	vec3 Screen[OCCLUSION_MAX_VERTICES];
+	bool bInFront[OCCLUSION_MAX_VERTICES];
+
+	for (UINT i = 0; i < VertexCount; i++)
+	{
+		vec4 Clip;
+		glm_mat4_mulv(WorldViewProj, (vec4) { Vertices[i].pos[0], Vertices[i].pos[1], Vertices[i].pos[2], 1.0f }, Clip);
+
+		bInFront[i] = Clip[3] >= OCCLUSION_NEAR_W;
+
+		if (!bInFront[i])
+			continue;
+
+		Screen[i][0] = (Clip[0] / Clip[3] * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		Screen[i][1] = (0.5f - Clip[1] / Clip[3] * 0.5f) * OCCLUSION_HEIGHT;
+		Screen[i][2] = Clip[2] / Clip[3];
+	}
+
+	for (UINT i = 0; i + 2 < IndexCount; i += 3)
+	{
+		if (!bInFront[Indices[i]] || !bInFront[Indices[i + 1]] || !bInFront[Indices[i + 2]])
+			continue;
+
+		RasterizeOcclusionTriangle(Buffer, Screen[Indices[i]], Screen[Indices[i + 1]], Screen[Indices[i + 2]], Buffer->bAvx2);
+	}
+}
+
+//pixel centers inside all three edges take the nearer depth, the avx2 and scalar paths do the same float operations in the same order
+void RasterizeOcclusionTriangle(struct OcclusionBuffer* restrict Buffer, const float* V0, const float* V1, const float* V2, bool bAvx2)
+{
+	float Area = (V1[0] - V0[0]) * (V2[1] - V0[1]) - (V1[1] - V0[1]) * (V2[0] - V0[0]);
+
+	if (!(Area != 0.0f))
+		return;
+
+	//an occluder only needs its nearest surface, so both windings are filled
+	if (Area < 0.0f)
+	{
+		const float* Swap = V1;
+		V1 = V2;
+		V2 = Swap;
+		Area = -Area;
+	}
+
+	const int MinX = max(0, (int)floorf(min(V0[0], min(V1[0], V2[0]))));
+	const int MaxX = min(OCCLUSION_WIDTH - 1, (int)ceilf(max(V0[0], max(V1[0], V2[0]))));
+	const int MinY = max(0, (int)floorf(min(V0[1], min(V1[1], V2[1]))));
+	const int MaxY = min(OCCLUSION_HEIGHT - 1, (int)ceilf(max(V0[1], max(V1[1], V2[1]))));
+
+	if (MinX > MaxX || MinY > MaxY)
+		return;
+
+	//edge i is A * x + B * y + C, positive inside
+	const float* Edges[3][2] = { { V1, V2 }, { V2, V0 }, { V0, V1 } };
+	float EdgeA[3];
+	float EdgeB[3];
+	float EdgeC[3];
+
+	for (int i = 0; i < 3; i++)
+	{
+		const float* A = Edges[i][0];
+		const float* B = Edges[i][1];
+		EdgeA[i] = A[1] - B[1];
+		EdgeB[i] = B[0] - A[0];
+		EdgeC[i] = A[0] * B[1] - A[1] * B[0];
+	}
+
+	//depth as a plane z = Plane[0] * x + Plane[1] * y + Plane[2]
+	float Plane[3];
+	Plane[0] = ((V1[2] - V0[2]) * (V2[1] - V0[1]) - (V2[2] - V0[2]) * (V1[1] - V0[1])) / Area;
+	Plane[1] = ((V2[2] - V0[2]) * (V1[0] - V0[0]) - (V1[2] - V0[2]) * (V2[0] - V0[0])) / Area;
+	Plane[2] = V0[2] - Plane[0] * V0[0] - Plane[1] * V0[1];
+
+	for (int y = MinY; y <= MaxY; y++)
+	{
+		float* Depth = Buffer->Depth + y * OCCLUSION_WIDTH;
+		const float Py = (float)y + 0.5f;
+
+		if (bAvx2)
+		{
+			RasterizeOcclusionSpanAvx2(Depth, MinX, MaxX, Py, EdgeA, EdgeB, EdgeC, Plane);
+			continue;
+		}
+
+		const float Row0 = EdgeB[0] * Py + EdgeC[0];
+		const float Row1 = EdgeB[1] * Py + EdgeC[1];
+		const float Row2 = EdgeB[2] * Py + EdgeC[2];
+		const float RowZ = Plane[1] * Py + Plane[2];
+
+		for (int x = MinX; x <= MaxX; x++)
+		{
+			const float Px = (float)x + 0.5f;
+
+			if (EdgeA[0] * Px + Row0 >= 0.0f && EdgeA[1] * Px + Row1 >= 0.0f && EdgeA[2] * Px + Row2 >= 0.0f)
+			{
+				const float Z = Plane[0] * Px + RowZ;
+
+				if (Z < Depth[x])
+					Depth[x] = Z;
+			}
+		}
+	}
+}
+
+void BuildOcclusionHierarchy(struct OcclusionBuffer* restrict Buffer)
+{
+	for (UINT TileY = 0; TileY < OCCLUSION_TILES_Y; TileY++)
+	{
+		for (UINT TileX = 0; TileX < OCCLUSION_TILES_X; TileX++)
+		{
+			const float* Depth = Buffer->Depth + TileY * OCCLUSION_TILE_SIZE * OCCLUSION_WIDTH + TileX * OCCLUSION_TILE_SIZE;
+			float MaxDepth = 0.0f;
+
+			if (Buffer->bAvx2)
+			{
+				__m256 Max = _mm256_loadu_ps(Depth);
+
+				for (UINT y = 1; y < OCCLUSION_TILE_SIZE; y++)
+				{
+					Max = _mm256_max_ps(Max, _mm256_loadu_ps(Depth + y * OCCLUSION_WIDTH));
+				}
+
+				__m128 Half = _mm_max_ps(_mm256_castps256_ps128(Max), _mm256_extractf128_ps(Max, 1));
+				Half = _mm_max_ps(Half, _mm_movehl_ps(Half, Half));
+				Half = _mm_max_ss(Half, _mm_shuffle_ps(Half, Half, 1));
+				MaxDepth = _mm_cvtss_f32(Half);
+			}
+			else
+			{
+				for (UINT y = 0; y < OCCLUSION_TILE_SIZE; y++)
+				{
+					for (UINT x = 0; x < OCCLUSION_TILE_SIZE; x++)
+					{
+						MaxDepth = max(MaxDepth, Depth[y * OCCLUSION_WIDTH + x]);
+					}
+				}
+			}
+
+			Buffer->TileMaxDepth[TileY * OCCLUSION_TILES_X + TileX] = MaxDepth;
+		}
+	}
+}
+
+//returns false only when the box's nearest depth lies behind every tile its screen bounds touch
+bool OcclusionTestBox(struct OcclusionBuffer* restrict Buffer, const mat4 WorldViewProj, const vec3 Min, const vec3 Max)
+{
+	float MinX = FLT_MAX;
+	float MinY = FLT_MAX;
+	float MaxX = -FLT_MAX;
+	float MaxY = -FLT_MAX;
+	float MinZ = FLT_MAX;
+
+	for (UINT i = 0; i < 8; i++)
+	{
+		vec4 Corner = { (i & 1) ? Max[0] : Min[0], (i & 2) ? Max[1] : Min[1], (i & 4) ? Max[2] : Min[2], 1.0f };
+		vec4 Clip;
+		glm_mat4_mulv(WorldViewProj, Corner, Clip);
+
+		//a box reaching behind the camera can not be bounded on screen
+		if (Clip[3] < OCCLUSION_NEAR_W)
+			return true;
+
+		const float X = (Clip[0] / Clip[3] * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		const float Y = (0.5f - Clip[1] / Clip[3] * 0.5f) * OCCLUSION_HEIGHT;
+
+		MinX = min(MinX, X);
+		MaxX = max(MaxX, X);
+		MinY = min(MinY, Y);
+		MaxY = max(MaxY, Y);
+		MinZ = min(MinZ, Clip[2] / Clip[3]);
+	}
+
+	//off screen boxes are left to frustum culling
+	if (MaxX < 0.0f || MaxY < 0.0f || MinX >= OCCLUSION_WIDTH || MinY >= OCCLUSION_HEIGHT)
+		return true;
+
+	Buffer->Tested++;
+
+	const int TileX0 = max(0, (int)MinX) / OCCLUSION_TILE_SIZE;
+	const int TileY0 = max(0, (int)MinY) / OCCLUSION_TILE_SIZE;
+	const int TileX1 = min(OCCLUSION_WIDTH - 1, (int)MaxX) / OCCLUSION_TILE_SIZE;
+	const int TileY1 = min(OCCLUSION_HEIGHT - 1, (int)MaxY) / OCCLUSION_TILE_SIZE;
+
+	for (int TileY = TileY0; TileY <= TileY1; TileY++)
+	{
+		for (int TileX = TileX0; TileX <= TileX1; TileX++)
+		{
+			if (MinZ <= Buffer->TileMaxDepth[TileY * OCCLUSION_TILES_X + TileX])
+				return true;
+		}
+	}
+
+	Buffer->Culled++;
+	return false;
+}
+
+//rasterizes the same random triangles on both paths, returns whether the depth buffers came out identical
+bool BenchmarkOcclusionRaster(double* restrict ScalarMilliseconds, double* restrict Avx2Milliseconds)
+{
+	struct OcclusionBuffer Buffers[2] = { 0 };
+	InitOcclusionBuffer(&Buffers[0]);
+	InitOcclusionBuffer(&Buffers[1]);
+
+	vec3* Triangles = VirtualAlloc(NULL, OCCLUSION_BENCH_TRIANGLES * 3 * sizeof(vec3), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Triangles);
+
+	UINT64 Random = 0x9E3779B97F4A7C15;
+
+	for (UINT i = 0; i < OCCLUSION_BENCH_TRIANGLES; i++)
+	{
+		float Values[11];
+
+		for (UINT c = 0; c < ARRAYSIZE(Values); c++)
+		{
+			Values[c] = RandomFloat(&Random);
+		}
+
+		//corners up to 32 pixels from a center that may itself be slightly off screen
+		const float CenterX = Values[0] * (OCCLUSION_WIDTH + 32) - 16.0f;
+		const float CenterY = Values[1] * (OCCLUSION_HEIGHT + 32) - 16.0f;
+
+		for (UINT v = 0; v < 3; v++)
+		{
+			Triangles[i * 3 + v][0] = CenterX + Values[2 + v * 3] * 64.0f - 32.0f;
+			Triangles[i * 3 + v][1] = CenterY + Values[3 + v * 3] * 64.0f - 32.0f;
+			Triangles[i * 3 + v][2] = Values[4 + v * 3];
+		}
+	}
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	for (UINT Path = 0; Path < 2; Path++)
+	{
+		if (Path == 1 && !Buffers[1].bAvx2)
+		{
+			*Avx2Milliseconds = 0.0;
+			break;
+		}
+
+		LARGE_INTEGER Start;
+		LARGE_INTEGER End;
+		QueryPerformanceCounter(&Start);
+
+		for (UINT Iteration = 0; Iteration < OCCLUSION_BENCH_ITERATIONS; Iteration++)
+		{
+			ClearOcclusionBuffer(&Buffers[Path]);
+
+			for (UINT i = 0; i < OCCLUSION_BENCH_TRIANGLES; i++)
+			{
+				RasterizeOcclusionTriangle(&Buffers[Path], Triangles[i * 3], Triangles[i * 3 + 1], Triangles[i * 3 + 2], Path == 1);
+			}
+		}
+
+		QueryPerformanceCounter(&End);
+
+		*(Path == 0 ? ScalarMilliseconds : Avx2Milliseconds) = (double)(End.QuadPart - Start.QuadPart) * 1000.0 / Frequency.QuadPart / OCCLUSION_BENCH_ITERATIONS;
+	}
+
+	const bool bMatch = !Buffers[1].bAvx2 || memcmp(Buffers[0].Depth, Buffers[1].Depth, OCCLUSION_WIDTH * OCCLUSION_HEIGHT * sizeof(float)) == 0;
+
+	THROW_ON_FALSE(VirtualFree(Triangles, 0, MEM_RELEASE));
+	FreeOcclusionBuffer(&Buffers[0]);
+	FreeOcclusionBuffer(&Buffers[1]);
+
+	return bMatch;
+}
+
+void InitParticleSystem(struct ParticleSystem* restrict System, UINT Capacity)
+{
+	struct ParticlePool* Pool = &System->Pool;
+	Pool->Capacity = Capacity;
+	Pool->Count = 0;
+	Pool->Current = 0;
+
+	//the capacity is a multiple of four, so every stream starts 16 byte aligned
+	const SIZE_T SetSize = (PARTICLE_STREAM_COUNT + 1) * (SIZE_T)Capacity * sizeof(float);
+
+	float* Memory = VirtualAlloc(NULL, SetSize * 2, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Memory);
+	MemoryTrack(Memory, MEMORY_CPU, SetSize * 2, "Particle Pool");
+
+	for (UINT Set = 0; Set < 2; Set++)
+	{
+		for (UINT i = 0; i < PARTICLE_STREAM_COUNT; i++)
+		{
+			Pool->Streams[Set][i] = Memory;
+			Memory += Capacity;
+		}
+
+		Pool->Colors[Set] = (UINT*)Memory;
+		Memory += Capacity;
+	}
+
+	System->EmitterCount = 0;
+	System->Random = 0x9E3779B97F4A7C15;
+	System->Spawned = 0;
+	System->Dropped = 0;
+
+	System->WorkerCount = min(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), PARTICLE_MAX_CHUNKS);
+
+	System->Work = CreateThreadpoolWork(ParticleWork, &System->Job, NULL);
+	VALIDATE_HANDLE(System->Work);
+}
+
+void FreeParticleSystem(struct ParticleSystem* restrict System)
+{
+	CloseThreadpoolWork(System->Work);
+
+	MemoryUntrack(System->Pool.Streams[0][0]);
+	THROW_ON_FALSE(VirtualFree(System->Pool.Streams[0][0], 0, MEM_RELEASE));
+}
+
+void CreateParticleRenderer(struct ParticleSystem* restrict System)
+{
+	{
+		D3D12_ROOT_PARAMETER1 RootParameters[1] = { 0 };
+		RootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		RootParameters[0].Constants.ShaderRegister = 0;
+		RootParameters[0].Constants.RegisterSpace = 0;
+		RootParameters[0].Constants.Num32BitValues = PARTICLE_ROOT_CONSTANTS;
+		RootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+		D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDesc = { 0 };
+		RootSignatureDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+		RootSignatureDesc.Desc_1_1.NumParameters = ARRAYSIZE(RootParameters);
+		RootSignatureDesc.Desc_1_1.pParameters = RootParameters;
+		RootSignatureDesc.Desc_1_1.NumStaticSamplers = 0;
+		RootSignatureDesc.Desc_1_1.pStaticSamplers = NULL;
+		RootSignatureDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
+
+		ID3D10Blob* Signature;
+		THROW_ON_FAIL(D3D12SerializeVersionedRootSignature(&RootSignatureDesc, &Signature, NULL));
+		THROW_ON_FAIL(ID3D12Device10_CreateRootSignature(Device, 0, ID3D10Blob_GetBufferPointer(Signature), ID3D10Blob_GetBufferSize(Signature), &IID_ID3D12RootSignature, &System->RootSignature));
+		THROW_ON_FAIL(ID3D10Blob_Release(Signature));
+	}
+
+	HANDLE VertexShaderFile = CreateFileW(L"ParticleVertexShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(VertexShaderFile);
+
+	LONGLONG VertexShaderSize;
+	THROW_ON_FALSE(GetFileSizeEx(VertexShaderFile, &VertexShaderSize));
+
+	HANDLE VertexShaderFileMap = CreateFileMappingW(VertexShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(VertexShaderFileMap);
+
+	const void* VertexShaderBytecode = MapViewOfFile(VertexShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+
+	HANDLE PixelShaderFile = CreateFileW(L"ParticlePixelShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(PixelShaderFile);
+
+	LONGLONG PixelShaderSize;
+	THROW_ON_FALSE(GetFileSizeEx(PixelShaderFile, &PixelShaderSize));
+
+	HANDLE PixelShaderFileMap = CreateFileMappingW(PixelShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(PixelShaderFileMap);
+
+	const void* PixelShaderBytecode = MapViewOfFile(PixelShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+
+	//additive, so the quads can be drawn in any order, depth tested against the cubes but never written
+	struct
+	{
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypepRootSignature;
+		ID3D12RootSignature* pRootSignature;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeInputLayout;
+		D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeVS;
+		D3D12_SHADER_BYTECODE VS;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypePS;
+		D3D12_SHADER_BYTECODE PS;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeBlendState;
+		D3D12_BLEND_DESC BlendState;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeRasterizerState;
+		D3D12_RASTERIZER_DESC RasterizerState;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDepthStencilState;
+		D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDSVFormat;
+		DXGI_FORMAT DSVFormat;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeRTVFormats;
+		struct D3D12_RT_FORMAT_ARRAY RTVFormats;
+	} PipelineStateObject = { 0 };
+
+	PipelineStateObject.ObjectTypepRootSignature = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+	PipelineStateObject.pRootSignature = System->RootSignature;
+
+	PipelineStateObject.ObjectTypeInputLayout = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT;
+	PipelineStateObject.InputLayout.pInputElementDescs = (D3D12_INPUT_ELEMENT_DESC[]){
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "SIZE", 0, DXGI_FORMAT_R32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+		{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }};
+	PipelineStateObject.InputLayout.NumElements = 3;
+
+	PipelineStateObject.ObjectTypeVS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS;
+	PipelineStateObject.VS.pShaderBytecode = VertexShaderBytecode;
+	PipelineStateObject.VS.BytecodeLength = VertexShaderSize;
+
+	PipelineStateObject.ObjectTypePS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS;
+	PipelineStateObject.PS.pShaderBytecode = PixelShaderBytecode;
+	PipelineStateObject.PS.BytecodeLength = PixelShaderSize;
+
+	PipelineStateObject.ObjectTypeBlendState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND;
+	PipelineStateObject.BlendState.RenderTarget[0].BlendEnable = TRUE;
+	PipelineStateObject.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	PipelineStateObject.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_ONE;
+	PipelineStateObject.BlendState.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+	PipelineStateObject.BlendState.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ZERO;
+	PipelineStateObject.BlendState.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_ONE;
+	PipelineStateObject.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	PipelineStateObject.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_NOOP;
+	PipelineStateObject.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+	PipelineStateObject.ObjectTypeRasterizerState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER;
+	PipelineStateObject.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	PipelineStateObject.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	PipelineStateObject.RasterizerState.DepthClipEnable = TRUE;
+
+	PipelineStateObject.ObjectTypeDepthStencilState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL;
+	PipelineStateObject.DepthStencilState.DepthEnable = TRUE;
+	PipelineStateObject.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	PipelineStateObject.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	PipelineStateObject.DepthStencilState.StencilEnable = FALSE;
+
+	PipelineStateObject.ObjectTypeDSVFormat = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT;
+	PipelineStateObject.DSVFormat = DSV_FORMAT;
+
+	PipelineStateObject.ObjectTypeRTVFormats = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
+	PipelineStateObject.RTVFormats.RTFormats[0] = RTV_FORMAT;
+	PipelineStateObject.RTVFormats.NumRenderTargets = 1;
+
+	D3D12_PIPELINE_STATE_STREAM_DESC PsoStreamDesc = { 0 };
+	PsoStreamDesc.SizeInBytes = sizeof(PipelineStateObject);
+	PsoStreamDesc.pPipelineStateSubobjectStream = &PipelineStateObject;
+
+	THROW_ON_FAIL(ID3D12Device10_CreatePipelineState(Device, &PsoStreamDesc, &IID_ID3D12PipelineState, &System->PipelineState));
+
+	THROW_ON_FALSE(UnmapViewOfFile(VertexShaderBytecode));
+	THROW_ON_FALSE(CloseHandle(VertexShaderFileMap));
+	THROW_ON_FALSE(CloseHandle(VertexShaderFile));
+
+	THROW_ON_FALSE(UnmapViewOfFile(PixelShaderBytecode));
+	THROW_ON_FALSE(CloseHandle(PixelShaderFileMap));
+	THROW_ON_FALSE(CloseHandle(PixelShaderFile));
+
+	D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+	HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+	D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+	ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	ResourceDesc.Alignment = 0;
+	ResourceDesc.Width = PARTICLE_CAPACITY * sizeof(struct ParticleInstance);
+	ResourceDesc.Height = 1;
+	ResourceDesc.DepthOrArraySize = 1;
+	ResourceDesc.MipLevels = 1;
+	ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ResourceDesc.SampleDesc.Count = 1;
+	ResourceDesc.SampleDesc.Quality = 0;
+	ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	//one per frame slot, written by the simulation once the slot's fence has passed
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &System->InstanceBuffers[i]));
+		MemoryTrackResource(System->InstanceBuffers[i], MEMORY_UPLOAD, &ResourceDesc, "Particle Instance Buffer");
+
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12Resource_SetName(System->InstanceBuffers[i], L"Particle Instance Buffer"));
+#endif
+
+		THROW_ON_FAIL(ID3D12Resource_Map(System->InstanceBuffers[i], 0, NULL, &System->InstanceData[i]));
+
+		System->InstanceViews[i].BufferLocation = ID3D12Resource_GetGPUVirtualAddress(System->InstanceBuffers[i]);
+		System->InstanceViews[i].SizeInBytes = (UINT)ResourceDesc.Width;
+		System->InstanceViews[i].StrideInBytes = sizeof(struct ParticleInstance);
+		System->InstanceCounts[i] = 0;
+	}
+}
+
+void FreeParticleRenderer(struct ParticleSystem* restrict System)
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		ID3D12Resource_Unmap(System->InstanceBuffers[i], 0, NULL);
+		THROW_ON_FAIL(ID3D12Resource_Release(System->InstanceBuffers[i]));
+	}
+
+	THROW_ON_FAIL(ID3D12PipelineState_Release(System->PipelineState));
+	THROW_ON_FAIL(ID3D12RootSignature_Release(System->RootSignature));
+}
+
+void AddParticleEmitter(struct ParticleSystem* restrict System, const struct ParticleEmitter* restrict Emitter)
+{
+	assert(System->EmitterCount < PARTICLE_MAX_EMITTERS);
+
+	System->Emitters[System->EmitterCount++] = *Emitter;
+}
+
+//appends new particles to the live set, whatever the budget or the pool turns away is dropped rather than saved up for a burst
+void EmitParticles(struct ParticleSystem* restrict System, float DeltaTime)
+{
+	struct ParticlePool* Pool = &System->Pool;
+	float* const* Streams = Pool->Streams[Pool->Current];
+	UINT* Colors = Pool->Colors[Pool->Current];
+
+	for (UINT e = 0; e < System->EmitterCount; e++)
+	{
+		struct ParticleEmitter* Emitter = &System->Emitters[e];
+
+		Emitter->Pending += Emitter->Rate * DeltaTime;
+		const UINT Requested = (UINT)Emitter->Pending;
+		Emitter->Pending -= Requested;
+
+		const UINT Spawn = min(min(Requested, Emitter->Budget), Pool->Capacity - Pool->Count);
+		System->Spawned += Spawn;
+		System->Dropped += Requested - Spawn;
+
+		for (UINT i = Pool->Count; i < Pool->Count + Spawn; i++)
+		{
+			Streams[PARTICLE_POSITION_X][i] = Emitter->Position[0];
+			Streams[PARTICLE_POSITION_Y][i] = Emitter->Position[1];
+			Streams[PARTICLE_POSITION_Z][i] = Emitter->Position[2];
+			Streams[PARTICLE_VELOCITY_X][i] = Emitter->Velocity[0] + (RandomFloat(&System->Random) - 0.5f) * Emitter->Spread;
+			Streams[PARTICLE_VELOCITY_Y][i] = Emitter->Velocity[1] + (RandomFloat(&System->Random) - 0.5f) * Emitter->Spread;
+			Streams[PARTICLE_VELOCITY_Z][i] = Emitter->Velocity[2] + (RandomFloat(&System->Random) - 0.5f) * Emitter->Spread;
+			Streams[PARTICLE_AGE][i] = 0.0f;
+			Streams[PARTICLE_LIFE][i] = Emitter->Life * (0.75f + RandomFloat(&System->Random) * 0.5f);
+			Streams[PARTICLE_SIZE][i] = Emitter->Size;
+			Colors[i] = Emitter->Color;
+		}
+
+		Pool->Count += Spawn;
+	}
+}
+
+//each call takes the next chunk, chunks start on a multiple of four so only the last one can end partway through a group
+VOID CALLBACK ParticleWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+	struct ParticleJob* Job = Context;
+	const struct ParticlePool* Pool = Job->Pool;
+
+	const UINT Chunk = InterlockedIncrement(&Job->NextChunk) - 1;
+	const UINT Groups = (Job->Count + 3) / 4;
+	const UINT Begin = (UINT)((UINT64)Groups * Chunk / Job->ChunkCount) * 4;
+	const UINT End = min((UINT)((UINT64)Groups * (Chunk + 1) / Job->ChunkCount) * 4, Job->Count);
+
+	float* const* Source = Pool->Streams[Pool->Current];
+	const __m128 Step = _mm_set1_ps(Job->DeltaTime);
+
+	if (!Job->bScatter)
+	{
+		UINT Alive = 0;
+
+		for (UINT i = Begin; i < End; i += 4)
+		{
+			const __m128 Age = _mm_add_ps(_mm_load_ps(Source[PARTICLE_AGE] + i), Step);
+			UINT Mask = _mm_movemask_ps(_mm_cmplt_ps(Age, _mm_load_ps(Source[PARTICLE_LIFE] + i)));
+
+			//the lanes past the end hold whatever was last compacted there
+			if (End - i < 4)
+				Mask &= (1 << (End - i)) - 1;
+
+			Alive += (Mask & 1) + (Mask >> 1 & 1) + (Mask >> 2 & 1) + (Mask >> 3);
+		}
+
+		Job->Offsets[Chunk] = Alive;
+		return;
+	}
+
+	float* const* Dest = Pool->Streams[Pool->Current ^ 1];
+	const UINT* SourceColors = Pool->Colors[Pool->Current];
+	UINT* DestColors = Pool->Colors[Pool->Current ^ 1];
+	struct ParticleInstance* Instances = Job->Instances;
+
+	const __m128 Gravity = _mm_set1_ps(PARTICLE_GRAVITY * Job->DeltaTime);
+	const __m128 One = _mm_set1_ps(1.0f);
+	const __m128 AlphaScale = _mm_set1_ps(255.0f);
+	UINT Out = Job->Offsets[Chunk];
+
+	for (UINT i = Begin; i < End; i += 4)
+	{
+		__m128 Lanes[PARTICLE_STREAM_COUNT];
+		Lanes[PARTICLE_AGE] = _mm_add_ps(_mm_load_ps(Source[PARTICLE_AGE] + i), Step);
+		Lanes[PARTICLE_LIFE] = _mm_load_ps(Source[PARTICLE_LIFE] + i);
+
+		UINT Mask = _mm_movemask_ps(_mm_cmplt_ps(Lanes[PARTICLE_AGE], Lanes[PARTICLE_LIFE]));
+
+		if (End - i < 4)
+			Mask &= (1 << (End - i)) - 1;
+
+		if (Mask == 0)
+			continue;
+
+		//semi-implicit euler, the updated velocity is the one that moves the particle
+		Lanes[PARTICLE_VELOCITY_X] = _mm_load_ps(Source[PARTICLE_VELOCITY_X] + i);
+		Lanes[PARTICLE_VELOCITY_Y] = _mm_add_ps(_mm_load_ps(Source[PARTICLE_VELOCITY_Y] + i), Gravity);
+		Lanes[PARTICLE_VELOCITY_Z] = _mm_load_ps(Source[PARTICLE_VELOCITY_Z] + i);
+		Lanes[PARTICLE_POSITION_X] = _mm_add_ps(_mm_load_ps(Source[PARTICLE_POSITION_X] + i), _mm_mul_ps(Lanes[PARTICLE_VELOCITY_X], Step));
+		Lanes[PARTICLE_POSITION_Y] = _mm_add_ps(_mm_load_ps(Source[PARTICLE_POSITION_Y] + i), _mm_mul_ps(Lanes[PARTICLE_VELOCITY_Y], Step));
+		Lanes[PARTICLE_POSITION_Z] = _mm_add_ps(_mm_load_ps(Source[PARTICLE_POSITION_Z] + i), _mm_mul_ps(Lanes[PARTICLE_VELOCITY_Z], Step));
+		Lanes[PARTICLE_SIZE] = _mm_load_ps(Source[PARTICLE_SIZE] + i);
+
+		//alpha fades out linearly over the particle's life
+		alignas(16) INT32 Alpha[4];
+		_mm_store_si128((__m128i*)Alpha, _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(One, _mm_div_ps(Lanes[PARTICLE_AGE], Lanes[PARTICLE_LIFE])), AlphaScale)));
+
+		alignas(16) float Values[PARTICLE_STREAM_COUNT][4];
+
+		for (UINT s = 0; s < PARTICLE_STREAM_COUNT; s++)
+		{
+			_mm_store_ps(Values[s], Lanes[s]);
+		}
+
+		//a whole group of survivors is stored as it is, anything else is packed one lane at a time
+		if (Mask == 0xF)
+		{
+			for (UINT s = 0; s < PARTICLE_STREAM_COUNT; s++)
+			{
+				_mm_storeu_ps(Dest[s] + Out, Lanes[s]);
+			}
+
+			memcpy(DestColors + Out, SourceColors + i, sizeof(UINT) * 4);
+		}
+
+		for (UINT Lane = 0; Lane < 4; Lane++)
+		{
+			if (!(Mask >> Lane & 1))
+				continue;
+
+			if (Mask != 0xF)
+			{
+				for (UINT s = 0; s < PARTICLE_STREAM_COUNT; s++)
+				{
+					Dest[s][Out] = Values[s][Lane];
+				}
+
+				DestColors[Out] = SourceColors[i + Lane];
+			}
+
+			//the instances are write combined upload memory, so each one is written once and never read
+			if (Instances)
+			{
+				Instances[Out] = (struct ParticleInstance){
+					.Position = { Values[PARTICLE_POSITION_X][Lane], Values[PARTICLE_POSITION_Y][Lane], Values[PARTICLE_POSITION_Z][Lane] },
+					.Size = Values[PARTICLE_SIZE][Lane],
+					.Color = (SourceColors[i + Lane] & 0x00FFFFFF) | (UINT)Alpha[Lane] << 24
+				};
+			}
+
+			Out++;
+		}
+	}
+}
+
+//integrates the live set and compacts the survivors into the other set, streaming them into Instances unless it is NULL, returns the survivor count
+UINT SimulateParticles(struct ParticleSystem* restrict System, float DeltaTime, struct ParticleInstance* restrict Instances)
+{
+	struct ParticlePool* Pool = &System->Pool;
+
+	if (Pool->Count == 0)
+		return 0;
+
+	struct ParticleJob* Job = &System->Job;
+	Job->Pool = Pool;
+	Job->Instances = Instances;
+	Job->DeltaTime = DeltaTime;
+	Job->Count = Pool->Count;
+	Job->ChunkCount = Pool->Count >= PARTICLE_PARALLEL_THRESHOLD ? System->WorkerCount : 1;
+
+	Job->bScatter = false;
+	RunParticlePhase(System);
+
+	//chunks keep their order, so the result is the same for any worker count
+	UINT Total = 0;
+
+	for (UINT Chunk = 0; Chunk < Job->ChunkCount; Chunk++)
+	{
+		const UINT Count = Job->Offsets[Chunk];
+		Job->Offsets[Chunk] = Total;
+		Total += Count;
+	}
+
+	Job->bScatter = true;
+	RunParticlePhase(System);
+
+	Pool->Current ^= 1;
+	Pool->Count = Total;
+	return Total;
+}
+
+//one instanced draw of a camera facing quad per particle, returns the draw count
+UINT RecordParticleDraw(struct ParticleSystem* restrict System, const struct Scene* restrict Scene, UINT FrameIndex, struct CommandEncoder* restrict Encoder)
+{
+	if (System->InstanceCounts[FrameIndex] == 0)
+		return 0;
+
+	mat4 ViewProjMat;
+	glm_mat4_mul(Scene->cameraProjMat, Scene->cameraViewMat, ViewProjMat);
+
+	mat4 Transposed;
+	glm_mat4_transpose_to(ViewProjMat, Transposed);
+
+	//the view matrix's first two rows are the camera's right and up axes in world space
+	float Constants[PARTICLE_ROOT_CONSTANTS] = { 0 };
+	memcpy(Constants, Transposed, sizeof(Transposed));
+	Constants[16] = Scene->cameraViewMat[0][0];
+	Constants[17] = Scene->cameraViewMat[1][0];
+	Constants[18] = Scene->cameraViewMat[2][0];
+	Constants[20] = Scene->cameraViewMat[0][1];
+	Constants[21] = Scene->cameraViewMat[1][1];
+	Constants[22] = Scene->cameraViewMat[2][1];
+
+	EncodeSetPipelineState(Encoder, System->PipelineState);
+	EncodeSetRootSignature(Encoder, System->RootSignature);
+	EncodeSetRootConstants(Encoder, 0, PARTICLE_ROOT_CONSTANTS, Constants);
+	EncodeSetVertexBuffer(Encoder, &System->InstanceViews[FrameIndex]);
+	EncodeDraw(Encoder, 6, System->InstanceCounts[FrameIndex], 0, 0);
+
+	return 1;
+}
+
+//runs the same emitter on one worker and then on all of them, the two pools must come out identical
+bool BenchmarkParticles(double* restrict SingleMilliseconds, double* restrict ParallelMilliseconds, UINT* restrict WorkerCount, UINT* restrict AliveCount)
+{
+	static struct ParticleSystem Systems[2];
+
+	struct ParticleInstance* Instances = VirtualAlloc(NULL, PARTICLE_BENCH_COUNT * sizeof(struct ParticleInstance), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Instances);
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	//lives are shorter than the run, so the later frames compact out the dead while the emitter refills the pool
+	const float DeltaTime = 1.0f / 30.0f;
+	double* Results[2] = { SingleMilliseconds, ParallelMilliseconds };
+
+	for (UINT Run = 0; Run < 2; Run++)
+	{
+		struct ParticleSystem* System = &Systems[Run];
+		InitParticleSystem(System, PARTICLE_BENCH_COUNT);
+
+		if (Run == 0)
+			System->WorkerCount = 1;
+
+		struct ParticleEmitter Emitter = { 0 };
+		Emitter.Velocity[1] = 2.0f;
+		Emitter.Spread = 4.0f;
+		Emitter.Life = 0.5f;
+		Emitter.Rate = PARTICLE_BENCH_COUNT / Emitter.Life;
+		Emitter.Size = 0.01f;
+		Emitter.Color = 0xFFFFFFFF;
+		Emitter.Budget = PARTICLE_BENCH_COUNT;
+
+		//the first frame fills the whole pool
+		Emitter.Pending = PARTICLE_BENCH_COUNT;
+		AddParticleEmitter(System, &Emitter);
+
+		INT64 Ticks = 0;
+
+		for (UINT Frame = 0; Frame < PARTICLE_BENCH_FRAMES; Frame++)
+		{
+			EmitParticles(System, DeltaTime);
+
+			LARGE_INTEGER Start;
+			QueryPerformanceCounter(&Start);
+
+			SimulateParticles(System, DeltaTime, Instances);
+
+			LARGE_INTEGER End;
+			QueryPerformanceCounter(&End);
+			Ticks += End.QuadPart - Start.QuadPart;
+		}
+
+		*Results[Run] = Ticks * 1000.0 / Frequency.QuadPart / PARTICLE_BENCH_FRAMES;
+	}
+
+	const struct ParticlePool* Single = &Systems[0].Pool;
+	const struct ParticlePool* Parallel = &Systems[1].Pool;
+	bool bMatch = Single->Count == Parallel->Count;
+
+	for (UINT s = 0; s < PARTICLE_STREAM_COUNT && bMatch; s++)
+	{
+		bMatch = memcmp(Single->Streams[Single->Current][s], Parallel->Streams[Parallel->Current][s], Single->Count * sizeof(float)) == 0;
+	}
+
+	if (bMatch)
+		bMatch = memcmp(Single->Colors[Single->Current], Parallel->Colors[Parallel->Current], Single->Count * sizeof(UINT)) == 0;
+
+	*WorkerCount = Systems[1].WorkerCount;
+	*AliveCount = Parallel->Count;
+
+	FreeParticleSystem(&Systems[0]);
+	FreeParticleSystem(&Systems[1]);
+	THROW_ON_FALSE(VirtualFree(Instances, 0, MEM_RELEASE));
+
+	return bMatch;
+}
+
+void InitClusterGrid(struct ClusterGrid* restrict Grid, UINT IndexCapacity)
+{
+	Grid->IndexCapacity = IndexCapacity;
+	Grid->Dropped = 0;
+
+	//a zero projection never matches, so the first BuildClusterBounds always builds
+	memset(Grid->Projection, 0, sizeof(Grid->Projection));
+
+	//six bound arrays and the counts, then the pairs. CLUSTER_COUNT is a multiple of four, so every row of bounds is 16 byte aligned
+	const SIZE_T Size = (7 * (SIZE_T)CLUSTER_COUNT + 2 * (SIZE_T)IndexCapacity) * sizeof(float);
+
+	float* Memory = VirtualAlloc(NULL, Size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Memory);
+	MemoryTrack(Memory, MEMORY_CPU, Size, "Cluster Grid");
+
+	Grid->MinX = Memory;
+	Grid->MinY = Memory + CLUSTER_COUNT;
+	Grid->MinZ = Memory + CLUSTER_COUNT * 2;
+	Grid->MaxX = Memory + CLUSTER_COUNT * 3;
+	Grid->MaxY = Memory + CLUSTER_COUNT * 4;
+	Grid->MaxZ = Memory + CLUSTER_COUNT * 5;
+	Grid->Counts = (UINT*)(Memory + CLUSTER_COUNT * 6);
+	Grid->PairClusters = (UINT*)(Memory + CLUSTER_COUNT * 7);
+	Grid->PairLights = Grid->PairClusters + IndexCapacity;
+}
+
+void FreeClusterGrid(struct ClusterGrid* restrict Grid)
+{
+	MemoryUntrack(Grid->MinX);
+	THROW_ON_FALSE(VirtualFree(Grid->MinX, 0, MEM_RELEASE));
+}
+
+//only the projection shapes the grid, so the bounds are rebuilt when it changes, on a resize
+void BuildClusterBounds(struct ClusterGrid* restrict Grid, const mat4 ProjMat)
+{
+	const float Projection[4] = { ProjMat[0][0], ProjMat[1][1], ProjMat[2][2], ProjMat[3][2] };
+
+	if (memcmp(Projection, Grid->Projection, sizeof(Projection)) == 0)
+		return;
+
+	memcpy(Grid->Projection, Projection, sizeof(Projection));
+
+	//ndc depth is p22 + p32 / z, 0 on the near plane and 1 on the far plane
+	Grid->Near = -Projection[3] / Projection[2];
+	Grid->Far = Projection[3] / (1.0f - Projection[2]);
+
+	for (UINT Slice = 0; Slice < CLUSTER_SLICES; Slice++)
+	{
+		Grid->SliceDepths[Slice] = Grid->Near * powf(Grid->Far / Grid->Near, (float)Slice / CLUSTER_SLICES);
+	}
+
+	Grid->SliceDepths[CLUSTER_SLICES] = Grid->Far;
+
+	for (UINT Slice = 0; Slice < CLUSTER_SLICES; Slice++)
+	{
+		const float NearZ = Grid->SliceDepths[Slice];
+		const float FarZ = Grid->SliceDepths[Slice + 1];
+
+		for (UINT y = 0; y < CLUSTER_TILES_Y; y++)
+		{
+			const float Top = 1.0f - 2.0f * y / CLUSTER_TILES_Y;
+			const float Bottom = 1.0f - 2.0f * (y + 1) / CLUSTER_TILES_Y;
+
+			for (UINT x = 0; x < CLUSTER_TILES_X; x++)
+			{
+				const float Left = -1.0f + 2.0f * x / CLUSTER_TILES_X;
+				const float Right = -1.0f + 2.0f * (x + 1) / CLUSTER_TILES_X;
+				const UINT Cluster = (Slice * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x;
+
+				//a tile's edge leans outwards or inwards with depth, so its extreme is at one end of the slice or the other
+				Grid->MinX[Cluster] = min(Left * NearZ, Left * FarZ) / Projection[0];
+				Grid->MaxX[Cluster] = max(Right * NearZ, Right * FarZ) / Projection[0];
+				Grid->MinY[Cluster] = min(Bottom * NearZ, Bottom * FarZ) / Projection[1];
+				Grid->MaxY[Cluster] = max(Top * NearZ, Top * FarZ) / Projection[1];
+				Grid->MinZ[Cluster] = NearZ;
+				Grid->MaxZ[Cluster] = FarZ;
+			}
+		}
+	}
+}
+
+//writes each cluster's (offset, count) into Ranges and the lists themselves into Indices, each list in light order. returns the index count
+UINT BinClusterLights(struct ClusterGrid* restrict Grid, const struct GpuLight* restrict Lights, UINT LightCount, bool bSimd, UINT* restrict Ranges, UINT* restrict Indices)
+{
+	UINT PairCount = 0;
+
+	for (UINT Light = 0; Light < LightCount; Light++)
+	{
+		UINT Bounds[6];
+
+		if (!ClusterLightBounds(Grid, &Lights[Light], Bounds))
+			continue;
+
+		const float* Center = Lights[Light].Position;
+		const float RadiusSquared = Lights[Light].Radius * Lights[Light].Radius;
+
+		for (UINT Slice = Bounds[4]; Slice <= Bounds[5]; Slice++)
+		{
+			for (UINT y = Bounds[2]; y <= Bounds[3]; y++)
+			{
+				const UINT Row = (Slice * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X;
+
+				if (bSimd)
+				{
+					const __m128 CenterX = _mm_set1_ps(Center[0]);
+					const __m128 CenterY = _mm_set1_ps(Center[1]);
+					const __m128 CenterZ = _mm_set1_ps(Center[2]);
+					const __m128 Zero = _mm_setzero_ps();
+
+					//four neighbouring clusters against the sphere, lanes outside the light's tile range are masked off afterwards
+					for (UINT x = Bounds[0] & ~3u; x <= Bounds[1]; x += 4)
+					{
+						const UINT Cluster = Row + x;
+
+						const __m128 DistanceX = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(Grid->MinX + Cluster), CenterX), Zero), _mm_max_ps(_mm_sub_ps(CenterX, _mm_load_ps(Grid->MaxX + Cluster)), Zero));
+						const __m128 DistanceY = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(Grid->MinY + Cluster), CenterY), Zero), _mm_max_ps(_mm_sub_ps(CenterY, _mm_load_ps(Grid->MaxY + Cluster)), Zero));
+						const __m128 DistanceZ = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(Grid->MinZ + Cluster), CenterZ), Zero), _mm_max_ps(_mm_sub_ps(CenterZ, _mm_load_ps(Grid->MaxZ + Cluster)), Zero));
+						const __m128 DistanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DistanceX, DistanceX), _mm_mul_ps(DistanceY, DistanceY)), _mm_mul_ps(DistanceZ, DistanceZ));
+
+						UINT Mask = _mm_movemask_ps(_mm_cmple_ps(DistanceSquared, _mm_set1_ps(RadiusSquared)));
+						Mask &= 0xF << (Bounds[0] > x ? Bounds[0] - x : 0);
+						Mask &= 0xF >> (x + 3 > Bounds[1] ? x + 3 - Bounds[1] : 0);
+
+						for (UINT Lane = 0; Lane < 4; Lane++)
+						{
+							if (!(Mask & 1 << Lane))
+								continue;
+
+							if (PairCount < Grid->IndexCapacity)
+							{
+								Grid->PairClusters[PairCount] = Cluster + Lane;
+								Grid->PairLights[PairCount] = Light;
+								PairCount++;
+							}
+							else
+							{
+								Grid->Dropped++;
+							}
+						}
+					}
+				}
+				else
+				{
+					for (UINT x = Bounds[0]; x <= Bounds[1]; x++)
+					{
+						const UINT Cluster = Row + x;
+
+						const float DistanceX = max(Grid->MinX[Cluster] - Center[0], 0.0f) + max(Center[0] - Grid->MaxX[Cluster], 0.0f);
+						const float DistanceY = max(Grid->MinY[Cluster] - Center[1], 0.0f) + max(Center[1] - Grid->MaxY[Cluster], 0.0f);
+						const float DistanceZ = max(Grid->MinZ[Cluster] - Center[2], 0.0f) + max(Center[2] - Grid->MaxZ[Cluster], 0.0f);
+
+						if (DistanceX * DistanceX + DistanceY * DistanceY + DistanceZ * DistanceZ > RadiusSquared)
+							continue;
+
+						if (PairCount < Grid->IndexCapacity)
+						{
+							Grid->PairClusters[PairCount] = Cluster;
+							Grid->PairLights[PairCount] = Light;
+							PairCount++;
+						}
+						else
+						{
+							Grid->Dropped++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	//counting sort by cluster, stable so every list stays in light order
+	memset(Grid->Counts, 0, CLUSTER_COUNT * sizeof(UINT));
+
+	for (UINT i = 0; i < PairCount; i++)
+	{
+		Grid->Counts[Grid->PairClusters[i]]++;
+	}
+
+	UINT Offset = 0;
+
+	for (UINT Cluster = 0; Cluster < CLUSTER_COUNT; Cluster++)
+	{
+		//Ranges may be write combined, so the cursor comes from Offset rather than reading it back
+		const UINT First = Offset;
+		Ranges[Cluster * 2] = First;
+		Ranges[Cluster * 2 + 1] = Grid->Counts[Cluster];
+		Offset += Grid->Counts[Cluster];
+		Grid->Counts[Cluster] = First;
+	}
+
+	for (UINT i = 0; i < PairCount; i++)
+	{
+		Indices[Grid->Counts[Grid->PairClusters[i]]++] = Grid->PairLights[i];
+	}
+
+	return PairCount;
+}
+
+void CreateClusteredLighting(struct DxObjects* restrict DxObjects, UINT LightCount)
+{
+	struct ClusteredLighting* Lighting = &DxObjects->Lighting;
+
+	InitClusterGrid(&Lighting->Grid, CLUSTER_MAX_INDICES);
+
+	Lighting->LightCount = min(LightCount, CLUSTER_MAX_LIGHTS);
+	Lighting->IndexCount = 0;
+	Lighting->Time = 0.0f;
+
+	const SIZE_T LightsSize = CLUSTER_MAX_LIGHTS * (sizeof(struct GpuLight) + sizeof(struct SceneLight));
+
+	Lighting->ViewLights = VirtualAlloc(NULL, LightsSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Lighting->ViewLights);
+	MemoryTrack(Lighting->ViewLights, MEMORY_CPU, LightsSize, "Scene Lights");
+
+	Lighting->Lights = (struct SceneLight*)(Lighting->ViewLights + CLUSTER_MAX_LIGHTS);
+
+	//rings at different heights around the cubes, half of them turning each way
+	UINT64 Random = 0x9E3779B97F4A7C15;
+
+	for (UINT i = 0; i < Lighting->LightCount; i++)
+	{
+		float Values[8];
+
+		for (UINT c = 0; c < ARRAYSIZE(Values); c++)
+		{
+			Values[c] = RandomFloat(&Random);
+		}
+
+		struct SceneLight* Light = &Lighting->Lights[i];
+		Light->Orbit = 1.2f + Values[0] * 3.0f;
+		Light->Height = -1.0f + Values[1] * 3.0f;
+		Light->Phase = Values[2] * 2.0f * GLM_PIf;
+		Light->Speed = (Values[3] - 0.5f) * 2.0f;
+		Light->Radius = 0.6f + Values[4] * 0.9f;
+		glm_vec3_copy((vec3) { Values[5], Values[6], Values[7] }, Light->Color);
+	}
+
+	D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+	HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+	D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+	ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	ResourceDesc.Alignment = 0;
+	ResourceDesc.Width = CLUSTER_BUFFER_SIZE;
+	ResourceDesc.Height = 1;
+	ResourceDesc.DepthOrArraySize = 1;
+	ResourceDesc.MipLevels = 1;
+	ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ResourceDesc.SampleDesc.Count = 1;
+	ResourceDesc.SampleDesc.Quality = 0;
+	ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE HeapStart;
+	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(DxObjects->SRVDescriptorHeap, &HeapStart);
+
+	//one per frame slot, written by the binning once the slot's fence has passed. the texture view at the head of each table is written with the texture, the shadow views by CreateShadowMaps
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Lighting->Buffers[i]));
+		MemoryTrackResource(Lighting->Buffers[i], MEMORY_UPLOAD, &ResourceDesc, "Cluster Light Buffer");
+
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12Resource_SetName(Lighting->Buffers[i], L"Cluster Light Buffer"));
+#endif
+
+		THROW_ON_FAIL(ID3D12Resource_Map(Lighting->Buffers[i], 0, NULL, &Lighting->BufferData[i]));
+
+		const UINT First = MAIN_TABLE_BASE + i * MAIN_TABLE_SIZE;
+		Lighting->Tables[i].ptr = DxObjects->SrvGpuHandle.ptr + First * (UINT64)DxObjects->SrvDescriptorSize;
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC ViewDesc = { 0 };
+		ViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		ViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ViewDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		ViewDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+		ViewDesc.Buffer.FirstElement = CLUSTER_LIGHTS_OFFSET / sizeof(struct GpuLight);
+		ViewDesc.Buffer.NumElements = CLUSTER_MAX_LIGHTS;
+		ViewDesc.Buffer.StructureByteStride = sizeof(struct GpuLight);
+		ID3D12Device10_CreateShaderResourceView(Device, Lighting->Buffers[i], &ViewDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { HeapStart.ptr + (First + 1) * (SIZE_T)DxObjects->SrvDescriptorSize });
+
+		ViewDesc.Buffer.FirstElement = CLUSTER_RANGES_OFFSET / (2 * sizeof(UINT));
+		ViewDesc.Buffer.NumElements = CLUSTER_COUNT;
+		ViewDesc.Buffer.StructureByteStride = 2 * sizeof(UINT);
+		ID3D12Device10_CreateShaderResourceView(Device, Lighting->Buffers[i], &ViewDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { HeapStart.ptr + (First + 2) * (SIZE_T)DxObjects->SrvDescriptorSize });
+
+		ViewDesc.Buffer.FirstElement = CLUSTER_INDICES_OFFSET / sizeof(UINT);
+		ViewDesc.Buffer.NumElements = CLUSTER_MAX_INDICES;
+		ViewDesc.Buffer.StructureByteStride = sizeof(UINT);
+		ID3D12Device10_CreateShaderResourceView(Device, Lighting->Buffers[i], &ViewDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { HeapStart.ptr + (First + 3) * (SIZE_T)DxObjects->SrvDescriptorSize });
+
+		D3D12_CONSTANT_BUFFER_VIEW_DESC ConstantsDesc = { 0 };
+		ConstantsDesc.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(Lighting->Buffers[i]);
+		ConstantsDesc.SizeInBytes = CLUSTER_CONSTANTS_SIZE;
+		ID3D12Device10_CreateConstantBufferView(Device, &ConstantsDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { HeapStart.ptr + (First + 6) * (SIZE_T)DxObjects->SrvDescriptorSize });
+	}
+}
+
+void FreeClusteredLighting(struct ClusteredLighting* restrict Lighting)
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		ID3D12Resource_Unmap(Lighting->Buffers[i], 0, NULL);
+		THROW_ON_FAIL(ID3D12Resource_Release(Lighting->Buffers[i]));
+	}
+
+	MemoryUntrack(Lighting->ViewLights);
+	THROW_ON_FALSE(VirtualFree(Lighting->ViewLights, 0, MEM_RELEASE));
+
+	FreeClusterGrid(&Lighting->Grid);
+}
+
+//moves the lights along their orbits, takes them into view space and bins them into the frame slot's buffer
+void UpdateClusteredLights(struct ClusteredLighting* restrict Lighting, const struct Scene* restrict Scene, float DeltaTime, UINT FrameIndex)
+{
+	Lighting->Time += DeltaTime;
+
+	for (UINT i = 0; i < Lighting->LightCount; i++)
+	{
+		const struct SceneLight* Light = &Lighting->Lights[i];
+		const float Angle = Light->Phase + Lighting->Time * Light->Speed;
+
+		vec4 ViewPosition;
+		glm_mat4_mulv(Scene->cameraViewMat, (vec4) { cosf(Angle) * Light->Orbit, Light->Height, sinf(Angle) * Light->Orbit, 1.0f }, ViewPosition);
+
+		struct GpuLight* ViewLight = &Lighting->ViewLights[i];
+		glm_vec3_copy(ViewPosition, ViewLight->Position);
+		ViewLight->Radius = Light->Radius;
+		glm_vec3_copy(Light->Color, ViewLight->Color);
+		ViewLight->Padding = 0.0f;
+	}
+
+	BuildClusterBounds(&Lighting->Grid, Scene->cameraProjMat);
+
+	//the binning scatters all over the index list, so it works from the cached copy of the lights and only writes to the upload heap
+	UINT8* Data = Lighting->BufferData[FrameIndex];
+	memcpy(Data + CLUSTER_LIGHTS_OFFSET, Lighting->ViewLights, Lighting->LightCount * sizeof(struct GpuLight));
+	Lighting->IndexCount = BinClusterLights(&Lighting->Grid, Lighting->ViewLights, Lighting->LightCount, true, (UINT*)(Data + CLUSTER_RANGES_OFFSET), (UINT*)(Data + CLUSTER_INDICES_OFFSET));
+}
+
+//Viewport is the one the scene is drawn with, so the pixel shader can find its tile from SV_Position. the shadows rebuild the view space position from the same constants
+void WriteClusterConstants(const struct ClusteredLighting* restrict Lighting, const struct Scene* restrict Scene, UINT FrameIndex, const D3D12_VIEWPORT* Viewport)
+{
+	struct ClusterConstants Constants = { 0 };
+
+	Constants.Viewport[0] = Viewport->TopLeftX;
+	Constants.Viewport[1] = Viewport->TopLeftY;
+	Constants.Viewport[2] = 1.0f / Viewport->Width;
+	Constants.Viewport[3] = 1.0f / Viewport->Height;
+	Constants.Projection[0] = 1.0f / Scene->cameraProjMat[0][0];
+	Constants.Projection[1] = 1.0f / Scene->cameraProjMat[1][1];
+	Constants.Projection[2] = Scene->cameraProjMat[2][2];
+	Constants.Projection[3] = Scene->cameraProjMat[3][2];
+	Constants.Ambient = CLUSTER_AMBIENT;
+
+	//with the lights off the grid may never have been built
+	if (Lighting->bEnabled)
+	{
+		const struct ClusterGrid* Grid = &Lighting->Grid;
+		const float SliceRange = log2f(Grid->Far / Grid->Near);
+
+		//the inverse of SliceDepths, slice = log2(z) * scale + bias
+		Constants.SliceScale = CLUSTER_SLICES / SliceRange;
+		Constants.SliceBias = -CLUSTER_SLICES * log2f(Grid->Near) / SliceRange;
+		Constants.bEnabled = 1;
+		Constants.Grid[0] = CLUSTER_TILES_X;
+		Constants.Grid[1] = CLUSTER_TILES_Y;
+		Constants.Grid[2] = CLUSTER_SLICES;
+	}
+
+	memcpy(Lighting->BufferData[FrameIndex], &Constants, sizeof(Constants));
+}
+
+//bins each light set on the scalar and the sse path, the lists must match and a point inside a light must find it in its cluster's list
+bool BenchmarkClusteredLights(double* restrict ScalarMilliseconds, double* restrict SimdMilliseconds, UINT* restrict IndexCounts, bool* restrict bConservative)
+{
+	struct ClusterGrid Grid;
+	InitClusterGrid(&Grid, CLUSTER_BENCH_MAX_INDICES);
+
+	mat4 ProjMat;
+	glm_perspective_lh_zo(45.0f * (3.14f / 180.0f), 16.0f / 9.0f, 0.1f, 1000.0f, ProjMat);
+	BuildClusterBounds(&Grid, ProjMat);
+
+	const UINT MaxLights = ClusterBenchLightCounts[ARRAYSIZE(ClusterBenchLightCounts) - 1];
+	const SIZE_T ListSize = (2 * (SIZE_T)CLUSTER_COUNT + CLUSTER_BENCH_MAX_INDICES) * sizeof(UINT);
+
+	struct GpuLight* Lights = VirtualAlloc(NULL, MaxLights * sizeof(struct GpuLight) + ListSize * 2, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Lights);
+
+	UINT* Lists[2] = { (UINT*)(Lights + MaxLights), (UINT*)(Lights + MaxLights) + ListSize / sizeof(UINT) };
+
+	//spread through the nearer part of the frustum, where the slices are thin and a light covers the most clusters
+	UINT64 Random = 0x9E3779B97F4A7C15;
+
+	for (UINT i = 0; i < MaxLights; i++)
+	{
+		float Values[4];
+
+		for (UINT c = 0; c < ARRAYSIZE(Values); c++)
+		{
+			Values[c] = RandomFloat(&Random);
+		}
+
+		const float Depth = 1.0f + Values[0] * 79.0f;
+		glm_vec3_copy((vec3) { (Values[1] * 2.0f - 1.0f) * Depth / ProjMat[0][0], (Values[2] * 2.0f - 1.0f) * Depth / ProjMat[1][1], Depth }, Lights[i].Position);
+		Lights[i].Radius = 0.5f + Values[3] * 2.5f;
+		glm_vec3_copy((vec3) { 1.0f, 1.0f, 1.0f }, Lights[i].Color);
+		Lights[i].Padding = 0.0f;
+	}
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	bool bMatch = true;
+	*bConservative = true;
+
+	for (UINT Set = 0; Set < ARRAYSIZE(ClusterBenchLightCounts); Set++)
+	{
+		const UINT LightCount = ClusterBenchLightCounts[Set];
+		double* Results[2] = { &ScalarMilliseconds[Set], &SimdMilliseconds[Set] };
+		UINT Counts[2] = { 0 };
+
+		for (UINT Path = 0; Path < 2; Path++)
+		{
+			LARGE_INTEGER Start;
+			QueryPerformanceCounter(&Start);
+
+			for (UINT i = 0; i < CLUSTER_BENCH_ITERATIONS; i++)
+			{
+				Counts[Path] = BinClusterLights(&Grid, Lights, LightCount, Path == 1, Lists[Path], Lists[Path] + CLUSTER_COUNT * 2);
+			}
+
+			LARGE_INTEGER End;
+			QueryPerformanceCounter(&End);
+			*Results[Path] = (End.QuadPart - Start.QuadPart) * 1000.0 / Frequency.QuadPart / CLUSTER_BENCH_ITERATIONS;
+		}
+
+		bMatch = bMatch && Counts[0] == Counts[1] && memcmp(Lists[0], Lists[1], (CLUSTER_COUNT * 2 + Counts[0]) * sizeof(UINT)) == 0;
+		IndexCounts[Set] = Counts[1];
+
+		const UINT* Ranges = Lists[1];
+		const UINT* Indices = Lists[1] + CLUSTER_COUNT * 2;
+
+		//points found the way the pixel shader finds them, every light reaching one has to be in its cluster's list
+		for (UINT Sample = 0; Sample < CLUSTER_BENCH_SAMPLES && *bConservative; Sample++)
+		{
+			float Values[3];
+
+			for (UINT c = 0; c < ARRAYSIZE(Values); c++)
+			{
+				Values[c] = RandomFloat(&Random);
+			}
+
+			const float Depth = 1.0f + Values[0] * 79.0f;
+			const float NdcX = Values[1] * 2.0f - 1.0f;
+			const float NdcY = Values[2] * 2.0f - 1.0f;
+			vec3 Point = { NdcX * Depth / ProjMat[0][0], NdcY * Depth / ProjMat[1][1], Depth };
+
+			const UINT Cluster = (ClusterSlice(&Grid, Depth) * CLUSTER_TILES_Y + ClusterTile(-NdcY, CLUSTER_TILES_Y)) * CLUSTER_TILES_X + ClusterTile(NdcX, CLUSTER_TILES_X);
+
+			for (UINT Light = 0; Light < LightCount; Light++)
+			{
+				if (glm_vec3_distance2(Point, Lights[Light].Position) >= Lights[Light].Radius * Lights[Light].Radius)
+					continue;
+
+				bool bFound = false;
+
+				for (UINT i = 0; i < Ranges[Cluster * 2 + 1] && !bFound; i++)
+				{
+					bFound = Indices[Ranges[Cluster * 2] + i] == Light;
+				}
+
+				*bConservative = *bConservative && bFound;
+			}
+		}
+	}
+
+	FreeClusterGrid(&Grid);
+	THROW_ON_FALSE(VirtualFree(Lights, 0, MEM_RELEASE));
+
+	return bMatch;
+}
+
+//the cubes first, then a ground slab and a ring of pillars that never move
+void InitShadowCasters(struct ShadowMaps* restrict Shadows)
+{
+	//the sun is behind the camera's left shoulder
+	glm_vec3_copy((vec3) { 0.4f, -1.0f, 0.3f }, Shadows->LightDirection);
+	glm_vec3_normalize(Shadows->LightDirection);
+
+	//light space only turns with the sun and never moves, so a box snapped to its texels stays snapped
+	glm_lookat_lh((vec3) { 0.0f, 0.0f, 0.0f }, Shadows->LightDirection, (vec3) { 0.0f, 1.0f, 0.0f }, Shadows->LightView);
+
+	for (UINT i = 0; i < SHADOW_DYNAMIC_CASTERS; i++)
+	{
+		glm_mat4_identity(Shadows->Casters[i].WorldMat);
+		Shadows->Casters[i].Radius = CUBE_BOUNDING_RADIUS;
+		Shadows->Casters[i].Depth = 0.0f;
+		Shadows->Casters[i].bStatic = false;
+	}
+
+	Shadows->CasterCount = SHADOW_DYNAMIC_CASTERS;
+
+	for (UINT i = 0; i < SHADOW_PILLARS + 1; i++)
+	{
+		const float Angle = i * 2.0f * GLM_PIf / SHADOW_PILLARS;
+
+		mat4 TranslationMat;
+		mat4 ScaleMat;
+
+		if (i == SHADOW_PILLARS)
+		{
+			glm_translate_make(TranslationMat, (vec3) { 0.0f, -2.0f, 0.0f });
+			glm_scale_make(ScaleMat, (vec3) { 24.0f, 0.25f, 24.0f });
+		}
+		else
+		{
+			glm_translate_make(TranslationMat, (vec3) { cosf(Angle) * 6.0f, -0.5f, sinf(Angle) * 6.0f });
+			glm_scale_make(ScaleMat, (vec3) { 0.6f, 3.0f, 0.6f });
+		}
+
+		struct ShadowCaster* Caster = &Shadows->Casters[Shadows->CasterCount++];
+		glm_mat4_mul(TranslationMat, ScaleMat, Caster->WorldMat);
+		Caster->Radius = ShadowCasterRadius(Caster->WorldMat);
+		Caster->Depth = 0.0f;
+		Caster->bStatic = true;
+	}
+}
+
+void CreateShadowMaps(struct DxObjects* restrict DxObjects)
+{
+	struct ShadowMaps* Shadows = &DxObjects->Shadows;
+
+	InitShadowCasters(Shadows);
+
+	HANDLE VertexShaderFile = CreateFileW(L"VertexShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(VertexShaderFile);
+
+	LONGLONG VertexShaderSize;
+	THROW_ON_FALSE(GetFileSizeEx(VertexShaderFile, &VertexShaderSize));
+
+	HANDLE VertexShaderFileMap = CreateFileMappingW(VertexShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(VertexShaderFileMap);
+
+	const void* VertexShaderBytecode = MapViewOfFile(VertexShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+
+	//depth only, with the main pass's root signature and vertex shader. the slope scaled bias keeps lit faces from shadowing themselves
+	struct
+	{
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypepRootSignature;
+		ID3D12RootSignature* pRootSignature;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeInputLayout;
+		D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeVS;
+		D3D12_SHADER_BYTECODE VS;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeRasterizerState;
+		D3D12_RASTERIZER_DESC RasterizerState;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDepthStencilState;
+		D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDSVFormat;
+		DXGI_FORMAT DSVFormat;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeRTVFormats;
+		struct D3D12_RT_FORMAT_ARRAY RTVFormats;
+	} PipelineStateObject = { 0 };
+
+	PipelineStateObject.ObjectTypepRootSignature = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+	PipelineStateObject.pRootSignature = DxObjects->RootSignature;
+
+	PipelineStateObject.ObjectTypeInputLayout = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT;
+	PipelineStateObject.InputLayout.pInputElementDescs = (D3D12_INPUT_ELEMENT_DESC[]){
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }};
+	PipelineStateObject.InputLayout.NumElements = 2;
+
+	PipelineStateObject.ObjectTypeVS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS;
+	PipelineStateObject.VS.pShaderBytecode = VertexShaderBytecode;
+	PipelineStateObject.VS.BytecodeLength = VertexShaderSize;
+
+	PipelineStateObject.ObjectTypeRasterizerState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER;
+	PipelineStateObject.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	PipelineStateObject.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+	PipelineStateObject.RasterizerState.DepthBias = 1000;
+	PipelineStateObject.RasterizerState.DepthBiasClamp = 0.0f;
+	PipelineStateObject.RasterizerState.SlopeScaledDepthBias = 2.0f;
+	PipelineStateObject.RasterizerState.DepthClipEnable = TRUE;
+
+	PipelineStateObject.ObjectTypeDepthStencilState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL;
+	PipelineStateObject.DepthStencilState.DepthEnable = TRUE;
+	PipelineStateObject.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+	PipelineStateObject.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	PipelineStateObject.DepthStencilState.StencilEnable = FALSE;
+
+	PipelineStateObject.ObjectTypeDSVFormat = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT;
+	PipelineStateObject.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+
+	PipelineStateObject.ObjectTypeRTVFormats = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
+	PipelineStateObject.RTVFormats.NumRenderTargets = 0;
+
+	D3D12_PIPELINE_STATE_STREAM_DESC PsoStreamDesc = { 0 };
+	PsoStreamDesc.SizeInBytes = sizeof(PipelineStateObject);
+	PsoStreamDesc.pPipelineStateSubobjectStream = &PipelineStateObject;
+
+	THROW_ON_FAIL(ID3D12Device10_CreatePipelineState(Device, &PsoStreamDesc, &IID_ID3D12PipelineState, &Shadows->PipelineState));
+
+	THROW_ON_FALSE(UnmapViewOfFile(VertexShaderBytecode));
+	THROW_ON_FALSE(CloseHandle(VertexShaderFileMap));
+	THROW_ON_FALSE(CloseHandle(VertexShaderFile));
+
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		//one slice per cascade, typeless so the pixel shader can read the depth
+		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		ResourceDesc.Alignment = 0;
+		ResourceDesc.Width = SHADOW_MAP_SIZE;
+		ResourceDesc.Height = SHADOW_MAP_SIZE;
+		ResourceDesc.DepthOrArraySize = SHADOW_CASCADES;
+		ResourceDesc.MipLevels = 1;
+		ResourceDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		ResourceDesc.SampleDesc.Count = 1;
+		ResourceDesc.SampleDesc.Quality = 0;
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+		D3D12_CLEAR_VALUE ClearValue = { 0 };
+		ClearValue.Format = DXGI_FORMAT_D32_FLOAT;
+		ClearValue.DepthStencil.Depth = 1.0f;
+		ClearValue.DepthStencil.Stencil = 0;
+
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE, &ClearValue, NULL, 0, NULL, &IID_ID3D12Resource, &Shadows->Maps));
+		MemoryTrackResource(Shadows->Maps, MEMORY_DEPTH, &ResourceDesc, "Shadow Maps");
+
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE, &ClearValue, NULL, 0, NULL, &IID_ID3D12Resource, &Shadows->StaticMaps));
+		MemoryTrackResource(Shadows->StaticMaps, MEMORY_DEPTH, &ResourceDesc, "Static Shadow Maps");
+
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12Resource_SetName(Shadows->Maps, L"Shadow Maps"));
+		THROW_ON_FAIL(ID3D12Resource_SetName(Shadows->StaticMaps, L"Static Shadow Maps"));
+#endif
+	}
+
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC DsvHeapDesc = { 0 };
+		DsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+		DsvHeapDesc.NumDescriptors = SHADOW_CASCADES * 2;
+		DsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateDescriptorHeap(Device, &DsvHeapDesc, &IID_ID3D12DescriptorHeap, &Shadows->DsvHeap));
+	}
+
+	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(Shadows->DsvHeap, &Shadows->DsvStart);
+	Shadows->DsvDescriptorSize = ID3D12Device10_GetDescriptorHandleIncrementSize(Device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+
+	//each cascade's live slice, then its static slice
+	for (UINT c = 0; c < SHADOW_CASCADES * 2; c++)
+	{
+		D3D12_DEPTH_STENCIL_VIEW_DESC DepthStencilViewDesc = { 0 };
+		DepthStencilViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		DepthStencilViewDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+		DepthStencilViewDesc.Flags = D3D12_DSV_FLAG_NONE;
+		DepthStencilViewDesc.Texture2DArray.MipSlice = 0;
+		DepthStencilViewDesc.Texture2DArray.FirstArraySlice = c % SHADOW_CASCADES;
+		DepthStencilViewDesc.Texture2DArray.ArraySize = 1;
+		ID3D12Device10_CreateDepthStencilView(Device, c < SHADOW_CASCADES ? Shadows->Maps : Shadows->StaticMaps, &DepthStencilViewDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { Shadows->DsvStart.ptr + c * (SIZE_T)Shadows->DsvDescriptorSize });
+	}
+
+	D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+	HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+	HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+	D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+	ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	ResourceDesc.Alignment = 0;
+	ResourceDesc.Width = SHADOW_BUFFER_SIZE;
+	ResourceDesc.Height = 1;
+	ResourceDesc.DepthOrArraySize = 1;
+	ResourceDesc.MipLevels = 1;
+	ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ResourceDesc.SampleDesc.Count = 1;
+	ResourceDesc.SampleDesc.Quality = 0;
+	ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE HeapStart;
+	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(DxObjects->SRVDescriptorHeap, &HeapStart);
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC ViewDesc = { 0 };
+	ViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	ViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	ViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	ViewDesc.Texture2DArray.MostDetailedMip = 0;
+	ViewDesc.Texture2DArray.MipLevels = 1;
+	ViewDesc.Texture2DArray.FirstArraySlice = 0;
+	ViewDesc.Texture2DArray.ArraySize = SHADOW_CASCADES;
+
+	//one per frame slot, written by UpdateShadows once the slot's fence has passed. the maps themselves are shared, the queue runs the frames in order
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Shadows->Buffers[i]));
+		MemoryTrackResource(Shadows->Buffers[i], MEMORY_UPLOAD, &ResourceDesc, "Shadow Constant Buffer");
+
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12Resource_SetName(Shadows->Buffers[i], L"Shadow Constant Buffer"));
+#endif
+
+		THROW_ON_FAIL(ID3D12Resource_Map(Shadows->Buffers[i], 0, NULL, &Shadows->BufferData[i]));
+		Shadows->BufferAddresses[i] = ID3D12Resource_GetGPUVirtualAddress(Shadows->Buffers[i]);
+
+		const UINT First = MAIN_TABLE_BASE + i * MAIN_TABLE_SIZE;
+		ID3D12Device10_CreateShaderResourceView(Device, Shadows->Maps, &ViewDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { HeapStart.ptr + (First + 4) * (SIZE_T)DxObjects->SrvDescriptorSize });
+		ID3D12Device10_CreateShaderResourceView(Device, Shadows->StaticMaps, &ViewDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { HeapStart.ptr + (First + 5) * (SIZE_T)DxObjects->SrvDescriptorSize });
+
+		D3D12_CONSTANT_BUFFER_VIEW_DESC ConstantsDesc = { 0 };
+		ConstantsDesc.BufferLocation = Shadows->BufferAddresses[i];
+		ConstantsDesc.SizeInBytes = SHADOW_CONSTANTS_SIZE;
+		ID3D12Device10_CreateConstantBufferView(Device, &ConstantsDesc, (D3D12_CPU_DESCRIPTOR_HANDLE) { HeapStart.ptr + (First + 7) * (SIZE_T)DxObjects->SrvDescriptorSize });
+	}
+}
+
+void FreeShadowMaps(struct ShadowMaps* restrict Shadows)
+{
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		ID3D12Resource_Unmap(Shadows->Buffers[i], 0, NULL);
+		THROW_ON_FAIL(ID3D12Resource_Release(Shadows->Buffers[i]));
+	}
+
+	THROW_ON_FAIL(ID3D12Resource_Release(Shadows->Maps));
+	THROW_ON_FAIL(ID3D12Resource_Release(Shadows->StaticMaps));
+	THROW_ON_FAIL(ID3D12DescriptorHeap_Release(Shadows->DsvHeap));
+	THROW_ON_FAIL(ID3D12PipelineState_Release(Shadows->PipelineState));
+}
+
+//practical splits out to SHADOW_DISTANCE. each slice is bounded by a sphere, so a cascade's size never changes as the camera turns, only where its box sits
+void FitShadowCascades(struct ShadowCascade* restrict Cascades, const mat4 LightView, const mat4 ViewMat, const mat4 ProjMat)
+{
+	//ndc depth is p22 + p32 / z, as in BuildClusterBounds
+	const float Near = -ProjMat[3][2] / ProjMat[2][2];
+	const float Far = min(ProjMat[3][2] / (1.0f - ProjMat[2][2]), SHADOW_DISTANCE);
+
+	//squared distance from the view axis to a corner of the frustum, per unit of depth squared
+	const float CornerScale = 1.0f / (ProjMat[0][0] * ProjMat[0][0]) + 1.0f / (ProjMat[1][1] * ProjMat[1][1]);
+
+	mat4 InverseView;
+	glm_mat4_inv(ViewMat, InverseView);
+
+	float SplitNear = Near;
+
+	for (UINT c = 0; c < SHADOW_CASCADES; c++)
+	{
+		struct ShadowCascade* Cascade = &Cascades[c];
+
+		const float Fraction = (float)(c + 1) / SHADOW_CASCADES;
+		const float SplitFar = c + 1 == SHADOW_CASCADES ? Far : SHADOW_SPLIT_LAMBDA * Near * powf(Far / Near, Fraction) + (1.0f - SHADOW_SPLIT_LAMBDA) * (Near + (Far - Near) * Fraction);
+
+		//the sphere through the corners at both ends has its center on the view axis, clamped to the far end for short, wide slices
+		const float CenterZ = min((SplitNear + SplitFar) * (1.0f + CornerScale) * 0.5f, SplitFar);
+		const float NearDistance2 = (CenterZ - SplitNear) * (CenterZ - SplitNear) + SplitNear * SplitNear * CornerScale;
+		const float FarDistance2 = (SplitFar - CenterZ) * (SplitFar - CenterZ) + SplitFar * SplitFar * CornerScale;
+
+		//two texels of padding so snapping the center cannot uncover the slice, rounded to 1/16 so the texel size and the snapped box are exact
+		const float Radius = ceilf(sqrtf(max(NearDistance2, FarDistance2)) * (SHADOW_MAP_SIZE + 4.0f) / SHADOW_MAP_SIZE * 16.0f) / 16.0f;
+		const float TexelSize = 2.0f * Radius / SHADOW_MAP_SIZE;
+
+		vec3 WorldCenter;
+		glm_mat4_mulv3(InverseView, (vec3) { 0.0f, 0.0f, CenterZ }, 1.0f, WorldCenter);
+
+		vec3 LightCenter;
+		glm_mat4_mulv3(LightView, WorldCenter, 1.0f, LightCenter);
+
+		for (UINT i = 0; i < 3; i++)
+		{
+			Cascade->Offset[i] = (INT32)floorf(LightCenter[i] / TexelSize);
+			Cascade->Center[i] = Cascade->Offset[i] * TexelSize;
+		}
+
+		Cascade->Near = SplitNear;
+		Cascade->Far = SplitFar;
+		Cascade->Radius = Radius;
+
+		//reaching SHADOW_CASTER_RANGE back towards the sun, so casters between it and the slice still land in the map
+		mat4 LightProj;
+		glm_ortho_lh_zo(Cascade->Center[0] - Radius, Cascade->Center[0] + Radius, Cascade->Center[1] - Radius, Cascade->Center[1] + Radius, Cascade->Center[2] - Radius - SHADOW_CASTER_RANGE, Cascade->Center[2] + Radius, LightProj);
+		glm_mat4_mul(LightProj, LightView, Cascade->ViewProj);
+
+		SplitNear = SplitFar;
+	}
+}
+
+//picks the cached cascades that redraw their static casters this frame, a box that moved by a texel or a static caster that moved leaves the cache stale
+UINT UpdateShadowCache(struct ShadowMaps* restrict Shadows)
+{
+	UINT Renders = 0;
+
+	for (UINT c = SHADOW_FIRST_CACHED; c < SHADOW_CASCADES; c++)
+	{
+		const struct ShadowCascade* Cascade = &Shadows->Cascades[c];
+
+		Shadows->bCacheDirty[c] = !Shadows->bCacheValid[c] ||
+			memcmp(Shadows->CachedOffsets[c], Cascade->Offset, sizeof(Cascade->Offset)) != 0 ||
+			Shadows->CachedRadii[c] != Cascade->Radius ||
+			Shadows->CachedVersions[c] != Shadows->StaticVersion;
+
+		if (!Shadows->bCacheDirty[c])
+		{
+			Shadows->CacheHits++;
+			continue;
+		}
+
+		memcpy(Shadows->CachedOffsets[c], Cascade->Offset, sizeof(Cascade->Offset));
+		Shadows->CachedRadii[c] = Cascade->Radius;
+		Shadows->CachedVersions[c] = Shadows->StaticVersion;
+		Shadows->bCacheValid[c] = true;
+		Renders++;
+	}
+
+	Shadows->StaticRenders += Renders;
+
+	return Renders;
+}
+
+//a cached cascade only tests its static casters when its cache is being redrawn, they are never drawn into the live map
+void CullShadowCasters(struct ShadowMaps* restrict Shadows)
+{
+	for (UINT c = 0; c < SHADOW_CASCADES; c++)
+	{
+		const bool bCached = c >= SHADOW_FIRST_CACHED;
+
+		Shadows->LiveCounts[c] = 0;
+		Shadows->StaticCounts[c] = 0;
+
+		for (UINT i = 0; i < Shadows->CasterCount; i++)
+		{
+			const struct ShadowCaster* Caster = &Shadows->Casters[i];
+			const bool bToCache = bCached && Caster->bStatic;
+
+			if (bToCache && !Shadows->bCacheDirty[c])
+				continue;
+
+			if (!ShadowCascadeTest(&Shadows->Cascades[c], Shadows->LightView, Caster))
+			{
+				Shadows->CulledCasters++;
+				continue;
+			}
+
+			if (bToCache)
+				Shadows->StaticCasters[c][Shadows->StaticCounts[c]++] = (UINT8)i;
+			else
+				Shadows->LiveCasters[c][Shadows->LiveCounts[c]++] = (UINT8)i;
+		}
+	}
+}
+
+//moving a static caster invalidates every cached cascade, the dynamic ones are drawn every frame anyway
+void MoveShadowCaster(struct ShadowMaps* restrict Shadows, UINT Index, const mat4 WorldMat)
+{
+	struct ShadowCaster* Caster = &Shadows->Casters[Index];
+
+	glm_mat4_copy(WorldMat, Caster->WorldMat);
+	Caster->Radius = ShadowCasterRadius(WorldMat);
+
+	if (Caster->bStatic)
+		Shadows->StaticVersion++;
+}
+
+//refits the cascades to the camera, works out what the cache needs and writes the constants of every draw into the frame slot's buffer
+void UpdateShadows(struct ShadowMaps* restrict Shadows, const struct Scene* restrict Scene, UINT FrameIndex)
+{
+	MoveShadowCaster(Shadows, 0, Scene->cube1WorldMat);
+	MoveShadowCaster(Shadows, 1, Scene->cube2WorldMat);
+
+	FitShadowCascades(Shadows->Cascades, Shadows->LightView, Scene->cameraViewMat, Scene->cameraProjMat);
+	UpdateShadowCache(Shadows);
+	CullShadowCasters(Shadows);
+
+	UINT8* Data = Shadows->BufferData[FrameIndex];
+
+	mat4 ViewProjMat;
+	glm_mat4_mul(Scene->cameraProjMat, Scene->cameraViewMat, ViewProjMat);
+
+	//the props in the main pass
+	for (UINT i = SHADOW_DYNAMIC_CASTERS; i < Shadows->CasterCount; i++)
+	{
+		struct ShadowCaster* Caster = &Shadows->Casters[i];
+
+		mat4 WvpMat;
+		glm_mat4_mul(ViewProjMat, Caster->WorldMat, WvpMat);
+
+		mat4 Transposed;
+		glm_mat4_transpose_to(WvpMat, Transposed);
+		memcpy(Data + SHADOW_OBJECTS_OFFSET + i * ConstantBufferPerObjectAlignedSize, Transposed, sizeof(Transposed));
+
+		vec3 ViewPosition;
+		glm_mat4_mulv3(Scene->cameraViewMat, Caster->WorldMat[3], 1.0f, ViewPosition);
+		Caster->Depth = ViewPosition[2];
+	}
+
+	for (UINT c = 0; c < SHADOW_CASCADES; c++)
+	{
+		for (UINT List = 0; List < 2; List++)
+		{
+			const UINT8* Casters = List == 0 ? Shadows->LiveCasters[c] : Shadows->StaticCasters[c];
+			const UINT Count = List == 0 ? Shadows->LiveCounts[c] : Shadows->StaticCounts[c];
+
+			for (UINT i = 0; i < Count; i++)
+			{
+				mat4 WvpMat;
+				glm_mat4_mul(Shadows->Cascades[c].ViewProj, Shadows->Casters[Casters[i]].WorldMat, WvpMat);
+
+				mat4 Transposed;
+				glm_mat4_transpose_to(WvpMat, Transposed);
+				memcpy(Data + SHADOW_CASTERS_OFFSET + (c * SHADOW_MAX_CASTERS + Casters[i]) * ConstantBufferPerObjectAlignedSize, Transposed, sizeof(Transposed));
+			}
+
+			Shadows->CasterDraws += Count;
+		}
+	}
+}
+
+//the view to cascade matrices follow the camera, so these are written for every frame. with the shadows off the shader never reads the maps
+void WriteShadowConstants(const struct ShadowMaps* restrict Shadows, const struct Scene* restrict Scene, UINT FrameIndex)
+{
+	struct ShadowConstants Constants = { 0 };
+
+	if (Shadows->bEnabled)
+	{
+		mat4 InverseView;
+		glm_mat4_inv(Scene->cameraViewMat, InverseView);
+
+		for (UINT c = 0; c < SHADOW_CASCADES; c++)
+		{
+			mat4 ViewToShadow;
+			glm_mat4_mul(Shadows->Cascades[c].ViewProj, InverseView, ViewToShadow);
+			glm_mat4_transpose_to(ViewToShadow, Constants.ViewToShadow[c]);
+			Constants.Splits[c] = Shadows->Cascades[c].Far;
+		}
+
+		//towards the sun, in view space
+		vec3 SunDirection;
+		glm_mat4_mulv3(Scene->cameraViewMat, Shadows->LightDirection, 0.0f, SunDirection);
+		glm_vec3_negate_to(SunDirection, Constants.SunDirection);
+
+		glm_vec3_copy((vec3) { 0.9f, 0.85f, 0.7f }, Constants.SunColor);
+		Constants.bEnabled = 1;
+		Constants.FirstCached = SHADOW_FIRST_CACHED;
+	}
+
+	memcpy(Shadows->BufferData[FrameIndex], &Constants, sizeof(Constants));
+}
+
+//every live slice is discarded and redrawn, a cached cascade's static slice only when UpdateShadowCache marked it
+UINT RecordShadowPasses(struct DxObjects* restrict DxObjects, UINT FrameIndex, struct CommandEncoder* restrict Encoder)
+{
+	struct ShadowMaps* Shadows = &DxObjects->Shadows;
+
+	D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
+	TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_NONE;
+	TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_DEPTH_STENCIL;
+	TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_NO_ACCESS;
+	TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE;
+	TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_UNDEFINED;
+	TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE;
+	TextureBarrier.pResource = Shadows->Maps;
+	TextureBarrier.Subresources.IndexOrFirstMipLevel = 0xFFFFFFFF;
+	TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_DISCARD;
+	EncodeTextureBarrier(Encoder, &TextureBarrier);
+
+	TextureBarrier.pResource = Shadows->StaticMaps;
+	TextureBarrier.Subresources.IndexOrFirstMipLevel = 0;
+	TextureBarrier.Subresources.NumMipLevels = 1;
+	TextureBarrier.Subresources.NumArraySlices = 1;
+	TextureBarrier.Subresources.FirstPlane = 0;
+	TextureBarrier.Subresources.NumPlanes = 1;
+
+	for (UINT c = SHADOW_FIRST_CACHED; c < SHADOW_CASCADES; c++)
+	{
+		if (!Shadows->bCacheDirty[c])
+			continue;
+
+		TextureBarrier.Subresources.FirstArraySlice = c;
+		EncodeTextureBarrier(Encoder, &TextureBarrier);
+	}
+
+	const D3D12_VIEWPORT ShadowViewport = { 0.0f, 0.0f, (float)SHADOW_MAP_SIZE, (float)SHADOW_MAP_SIZE, 0.0f, 1.0f };
+	const D3D12_RECT ShadowScissorRect = { 0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE };
+
+	EncodeSetPipelineState(Encoder, Shadows->PipelineState);
+	EncodeSetRootSignature(Encoder, DxObjects->RootSignature);
+	EncodeSetViewport(Encoder, &ShadowViewport);
+	EncodeSetScissor(Encoder, &ShadowScissorRect);
+	EncodeSetTopology(Encoder, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	EncodeSetVertexBuffer(Encoder, &DxObjects->VertexBufferView);
+	EncodeSetIndexBuffer(Encoder, &DxObjects->IndexBufferView);
+
+	UINT DrawCount = 0;
+
+	for (UINT c = 0; c < SHADOW_CASCADES; c++)
+	{
+		//the static slice first, it is the one that is usually skipped
+		for (UINT List = 0; List < 2; List++)
+		{
+			const bool bStatic = List == 0;
+
+			if (bStatic && !Shadows->bCacheDirty[c])
+				continue;
+
+			const D3D12_CPU_DESCRIPTOR_HANDLE Dsv = { Shadows->DsvStart.ptr + ((bStatic ? SHADOW_CASCADES : 0) + c) * (SIZE_T)Shadows->DsvDescriptorSize };
+			const UINT8* Casters = bStatic ? Shadows->StaticCasters[c] : Shadows->LiveCasters[c];
+			const UINT Count = bStatic ? Shadows->StaticCounts[c] : Shadows->LiveCounts[c];
+
+			EncodeSetRenderTarget(Encoder, (D3D12_CPU_DESCRIPTOR_HANDLE){ 0 }, Dsv);
+			EncodeClearDepth(Encoder, Dsv, 1.0f);
+
+			for (UINT i = 0; i < Count; i++)
+			{
+				EncodeSetRootCbv(Encoder, 0, Shadows->BufferAddresses[FrameIndex] + SHADOW_CASTERS_OFFSET + (c * SHADOW_MAX_CASTERS + Casters[i]) * ConstantBufferPerObjectAlignedSize);
+				EncodeDrawIndexed(Encoder, NUM_CUBE_INDICES, 1, 0, 0, 0);
+			}
+
+			DrawCount += Count;
+		}
+	}
+
+	TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_DEPTH_STENCIL;
+	TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_PIXEL_SHADING;
+	TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE;
+	TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_SHADER_RESOURCE;
+	TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE;
+	TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_SHADER_RESOURCE;
+	TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+
+	for (UINT c = SHADOW_FIRST_CACHED; c < SHADOW_CASCADES; c++)
+	{
+		if (!Shadows->bCacheDirty[c])
+			continue;
+
+		TextureBarrier.Subresources.FirstArraySlice = c;
+		EncodeTextureBarrier(Encoder, &TextureBarrier);
+	}
+
+	TextureBarrier.pResource = Shadows->Maps;
+	TextureBarrier.Subresources = (D3D12_BARRIER_SUBRESOURCE_RANGE){ .IndexOrFirstMipLevel = 0xFFFFFFFF };
+	EncodeTextureBarrier(Encoder, &TextureBarrier);
+
+	return DrawCount;
+}
+
+//a scripted camera through the fitting and the cache, no device needed. sub texel moves must leave the boxes alone, a fixed point must keep its place within a texel,
+//turning must not resize anything, the slices must stay covered and the cache must only be redrawn for a box or a static caster that moved
+bool ValidateShadowCascades(UINT* restrict StaticRenders, double* restrict FitMicroseconds)
+{
+	struct ShadowMaps Shadows = { 0 };
+	InitShadowCasters(&Shadows);
+
+	mat4 ProjMat;
+	glm_perspective_lh_zo(45.0f * (3.14f / 180.0f), 16.0f / 9.0f, 0.1f, 1000.0f, ProjMat);
+
+	mat4 ViewMat;
+	glm_lookat_lh((vec3) { 0.0f, 2.0f, -4.0f }, (vec3) { 0.0f, 0.0f, 0.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, ViewMat);
+
+	bool bValid = true;
+
+	//the first frame fills every cache, the same camera again draws none of them
+	FitShadowCascades(Shadows.Cascades, Shadows.LightView, ViewMat, ProjMat);
+	bValid = bValid && UpdateShadowCache(&Shadows) == SHADOW_CASCADES - SHADOW_FIRST_CACHED;
+
+	FitShadowCascades(Shadows.Cascades, Shadows.LightView, ViewMat, ProjMat);
+	bValid = bValid && UpdateShadowCache(&Shadows) == 0;
+
+	struct ShadowCascade Reference[SHADOW_CASCADES];
+	memcpy(Reference, Shadows.Cascades, sizeof(Reference));
+
+	//every corner of every slice inside its box
+	mat4 InverseView;
+	glm_mat4_inv(ViewMat, InverseView);
+
+	for (UINT c = 0; c < SHADOW_CASCADES; c++)
+	{
+		for (UINT Corner = 0; Corner < 8; Corner++)
+		{
+			const float Depth = Corner & 4 ? Reference[c].Far : Reference[c].Near;
+
+			vec3 WorldCorner;
+			glm_mat4_mulv3(InverseView, (vec3) { (Corner & 1 ? 1.0f : -1.0f) * Depth / ProjMat[0][0], (Corner & 2 ? 1.0f : -1.0f) * Depth / ProjMat[1][1], Depth }, 1.0f, WorldCorner);
+
+			vec3 Clip;
+			glm_mat4_mulv3(Reference[c].ViewProj, WorldCorner, 1.0f, Clip);
+
+			bValid = bValid && fabsf(Clip[0]) <= 1.0f && fabsf(Clip[1]) <= 1.0f && Clip[2] >= 0.0f && Clip[2] <= 1.0f;
+		}
+	}
+
+	//a slow dolly across many texels of the near cascades and a few of the far ones
+	vec3 FixedPoint = { 1.0f, 0.5f, 2.0f };
+	float ReferenceTexels[SHADOW_CASCADES];
+
+	for (UINT c = 0; c < SHADOW_CASCADES; c++)
+	{
+		vec3 Clip;
+		glm_mat4_mulv3(Reference[c].ViewProj, FixedPoint, 1.0f, Clip);
+		ReferenceTexels[c] = (Clip[0] * 0.5f + 0.5f) * SHADOW_MAP_SIZE;
+	}
+
+	*StaticRenders = 0;
+
+	struct ShadowCascade Previous[SHADOW_CASCADES];
+	memcpy(Previous, Reference, sizeof(Previous));
+
+	for (UINT Step = 1; Step <= 256; Step++)
+	{
+		vec3 Move = { Step * 0.0013f, Step * 0.0007f, Step * 0.0011f };
+
+		vec3 Eye = { 0.0f, 2.0f, -4.0f };
+		vec3 Target = { 0.0f, 0.0f, 0.0f };
+		glm_vec3_add(Eye, Move, Eye);
+		glm_vec3_add(Target, Move, Target);
+		glm_lookat_lh(Eye, Target, (vec3) { 0.0f, 1.0f, 0.0f }, ViewMat);
+
+		FitShadowCascades(Shadows.Cascades, Shadows.LightView, ViewMat, ProjMat);
+
+		UINT Moved = 0;
+
+		for (UINT c = 0; c < SHADOW_CASCADES; c++)
+		{
+			const struct ShadowCascade* Cascade = &Shadows.Cascades[c];
+			const bool bSameBox = memcmp(Cascade->Offset, Previous[c].Offset, sizeof(Cascade->Offset)) == 0;
+
+			//an unmoved box has to give the very same matrix, or the map would shimmer without the cache noticing
+			bValid = bValid && (!bSameBox || memcmp(Cascade->ViewProj, Previous[c].ViewProj, sizeof(mat4)) == 0);
+
+			if (!bSameBox && c >= SHADOW_FIRST_CACHED)
+				Moved++;
+
+			vec3 Clip;
+			glm_mat4_mulv3(Shadows.Cascades[c].ViewProj, FixedPoint, 1.0f, Clip);
+
+			const float Drift = (Clip[0] * 0.5f + 0.5f) * SHADOW_MAP_SIZE - ReferenceTexels[c];
+			bValid = bValid && fabsf(Drift - roundf(Drift)) < 0.01f;
+		}
+
+		const UINT Renders = UpdateShadowCache(&Shadows);
+		bValid = bValid && Renders == Moved;
+		*StaticRenders += Renders;
+
+		memcpy(Previous, Shadows.Cascades, sizeof(Previous));
+	}
+
+	//turning on the spot moves the boxes but never resizes them
+	for (UINT Step = 0; Step < 16; Step++)
+	{
+		const float Angle = Step * 0.4f;
+		glm_lookat_lh((vec3) { 0.0f, 2.0f, -4.0f }, (vec3) { sinf(Angle) * 4.0f, 2.0f - cosf(Angle * 0.5f) * 2.0f, cosf(Angle) * 4.0f - 4.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, ViewMat);
+		FitShadowCascades(Shadows.Cascades, Shadows.LightView, ViewMat, ProjMat);
+
+		for (UINT c = 0; c < SHADOW_CASCADES; c++)
+		{
+			bValid = bValid && Shadows.Cascades[c].Radius == Reference[c].Radius;
+		}
+	}
+
+	//back to the start, then a static caster moves and every cached cascade is drawn once
+	glm_lookat_lh((vec3) { 0.0f, 2.0f, -4.0f }, (vec3) { 0.0f, 0.0f, 0.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, ViewMat);
+	FitShadowCascades(Shadows.Cascades, Shadows.LightView, ViewMat, ProjMat);
+	*StaticRenders += UpdateShadowCache(&Shadows);
+
+	MoveShadowCaster(&Shadows, SHADOW_DYNAMIC_CASTERS, Shadows.Casters[SHADOW_DYNAMIC_CASTERS].WorldMat);
+	const UINT VersionRenders = UpdateShadowCache(&Shadows);
+	bValid = bValid && VersionRenders == SHADOW_CASCADES - SHADOW_FIRST_CACHED && UpdateShadowCache(&Shadows) == 0;
+	*StaticRenders += VersionRenders;
+
+	//the big cube has to be drawn into the cascade its center falls in, and a cube far off to the side into none
+	mat4 FarMat;
+	glm_translate_make(FarMat, (vec3) { 500.0f, 0.0f, 500.0f });
+	MoveShadowCaster(&Shadows, 1, FarMat);
+	CullShadowCasters(&Shadows);
+
+	vec3 ViewPosition;
+	glm_mat4_mulv3(ViewMat, Shadows.Casters[0].WorldMat[3], 1.0f, ViewPosition);
+
+	for (UINT c = 0; c < SHADOW_CASCADES; c++)
+	{
+		bool bNear = false;
+		bool bFar = false;
+
+		for (UINT i = 0; i < Shadows.LiveCounts[c]; i++)
+		{
+			bNear = bNear || Shadows.LiveCasters[c][i] == 0;
+			bFar = bFar || Shadows.LiveCasters[c][i] == 1;
+		}
+
+		const bool bInSlice = ViewPosition[2] >= Shadows.Cascades[c].Near && ViewPosition[2] <= Shadows.Cascades[c].Far;
+		bValid = bValid && (bNear || !bInSlice) && !bFar;
+	}
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	LARGE_INTEGER Start;
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < SHADOW_BENCH_ITERATIONS; i++)
+	{
+		FitShadowCascades(Shadows.Cascades, Shadows.LightView, ViewMat, ProjMat);
+	}
+
+	LARGE_INTEGER End;
+	QueryPerformanceCounter(&End);
+	*FitMicroseconds = (End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / SHADOW_BENCH_ITERATIONS;
+
+	return bValid;
+}
+
+void CreateFrameRecorder(struct FrameRecorder* restrict Recorder, LPCWSTR Directory)
+{
+	*Recorder = (struct FrameRecorder){ 0 };
+	Recorder->Current = -1;
+
+	MEMCPY_VERIFY(wcscpy_s(Recorder->Directory, MAX_PATH, Directory));
+	InitializeSRWLock(&Recorder->Lock);
+
+	Recorder->Work = CreateThreadpoolWork(FrameRecorderWork, Recorder, NULL);
+	VALIDATE_HANDLE(Recorder->Work);
+}
+
+//the GPU is idle by now, so whatever is left in the ring can still be written out
+void FreeFrameRecorder(struct FrameRecorder* restrict Recorder)
+{
+	FinishFrameRecordings(Recorder);
+
+	if (Recorder->Buffers[0])
+		FreeRecorderBuffers(Recorder);
+
+	CloseThreadpoolWork(Recorder->Work);
+}
+
+//sized for BackBuffer, only called with every slot free
+void CreateRecorderBuffers(struct FrameRecorder* restrict Recorder, ID3D12Resource* BackBuffer)
+{
+	D3D12_RESOURCE_DESC BackBufferDesc;
+	ID3D12Resource_GetDesc(BackBuffer, &BackBufferDesc);
+
+	ID3D12Device10_GetCopyableFootprints(Device, &BackBufferDesc, 0, 1, 0, &Recorder->Footprint, NULL, NULL, &Recorder->BufferSize);
+
+	D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+	HeapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+	HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+	D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+	ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	ResourceDesc.Alignment = 0;
+	ResourceDesc.Width = Recorder->BufferSize;
+	ResourceDesc.Height = 1;
+	ResourceDesc.DepthOrArraySize = 1;
+	ResourceDesc.MipLevels = 1;
+	ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ResourceDesc.SampleDesc.Count = 1;
+	ResourceDesc.SampleDesc.Quality = 0;
+	ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	for (UINT i = 0; i < RECORDER_SLOTS; i++)
+	{
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Recorder->Buffers[i]));
+		MemoryTrackResource(Recorder->Buffers[i], MEMORY_READBACK, &ResourceDesc, "Frame Recorder Readback");
+
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12Resource_SetName(Recorder->Buffers[i], L"Frame Recorder Readback"));
+#endif
+	}
+
+	InitRecorderBitmaps(Recorder, Recorder->Footprint.Footprint.Width, Recorder->Footprint.Footprint.Height);
+
+	//made on the first recording, an existing directory is written into
+	if (Recorder->Directory[0])
+		THROW_ON_FALSE(CreateDirectoryW(Recorder->Directory, NULL) || GetLastError() == ERROR_ALREADY_EXISTS);
+}
+
+//only called with every slot free, nothing else holds the buffers then
+void FreeRecorderBuffers(struct FrameRecorder* restrict Recorder)
+{
+	for (UINT i = 0; i < RECORDER_SLOTS; i++)
+	{
+		MemoryUntrack(Recorder->Buffers[i]);
+		THROW_ON_FAIL(ID3D12Resource_Release(Recorder->Buffers[i]));
+		Recorder->Buffers[i] = NULL;
+	}
+
+	FreeRecorderBitmaps(Recorder);
+}
+
+void InitRecorderBitmaps(struct FrameRecorder* restrict Recorder, UINT Width, UINT Height)
+{
+	Recorder->BitmapSize = RECORDER_BITMAP_HEADER_SIZE + Width * Height * 4;
+
+	UINT8* Memory = VirtualAlloc(NULL, (SIZE_T)Recorder->BitmapSize * RECORDER_SLOTS, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Memory);
+
+	MemoryTrack(Memory, MEMORY_CPU, (UINT64)Recorder->BitmapSize * RECORDER_SLOTS, "Frame Recorder Bitmaps");
+
+	for (UINT i = 0; i < RECORDER_SLOTS; i++)
+	{
+		Recorder->Bitmaps[i] = Memory + (SIZE_T)Recorder->BitmapSize * i;
+	}
+}
+
+void FreeRecorderBitmaps(struct FrameRecorder* restrict Recorder)
+{
+	MemoryUntrack(Recorder->Bitmaps[0]);
+	THROW_ON_FALSE(VirtualFree(Recorder->Bitmaps[0], 0, MEM_RELEASE));
+
+	for (UINT i = 0; i < RECORDER_SLOTS; i++)
+	{
+		Recorder->Bitmaps[i] = NULL;
+	}
+}
+
+//takes the slot at Head for the frame the submit fence reaches FenceValue with, -1 when the GPU or the worker still has it.
+//dropped frames still use up a frame number, so the gaps in the sequence show where they were
+INT AcquireRecorderSlot(struct FrameRecorder* restrict Recorder, UINT64 FenceValue)
+{
+	const UINT FrameNumber = Recorder->FrameNumber++;
+	const UINT Slot = Recorder->Head;
+
+	if (InterlockedCompareExchange(&Recorder->States[Slot], RECORDER_SLOT_PENDING, RECORDER_SLOT_FREE) != RECORDER_SLOT_FREE)
+	{
+		Recorder->Dropped++;
+		return -1;
+	}
+
+	Recorder->FenceValues[Slot] = FenceValue;
+	Recorder->FrameNumbers[Slot] = FrameNumber;
+	Recorder->Head = (Slot + 1) % RECORDER_SLOTS;
+	Recorder->Captured++;
+
+	return Slot;
+}
+
+//picks the slot this frame's back buffer is copied into, if any. after a resize the buffers are only rebuilt once the ring has
+//drained, the frames until then are dropped rather than the render thread waiting for it
+void BeginFrameRecording(struct FrameRecorder* restrict Recorder, ID3D12Resource* BackBuffer, UINT64 FenceValue)
+{
+	Recorder->Current = -1;
+
+	if (!Recorder->bEnabled)
+		return;
+
+	D3D12_RESOURCE_DESC BackBufferDesc;
+	ID3D12Resource_GetDesc(BackBuffer, &BackBufferDesc);
+
+	if (BackBufferDesc.Width != Recorder->Footprint.Footprint.Width || BackBufferDesc.Height != Recorder->Footprint.Footprint.Height)
+	{
+		for (UINT i = 0; i < RECORDER_SLOTS; i++)
+		{
+			if (Recorder->States[i] != RECORDER_SLOT_FREE)
+			{
+				Recorder->FrameNumber++;
+				Recorder->Dropped++;
+				return;
+			}
+		}
+
+		if (Recorder->Buffers[0])
+			FreeRecorderBuffers(Recorder);
+
+		CreateRecorderBuffers(Recorder, BackBuffer);
+	}
+
+	Recorder->Current = AcquireRecorderSlot(Recorder, FenceValue);
+}
+
+//straight to the command list like the profiler queries, a trace holds only the frame's own commands. the back buffer is left
+//as a render target, so the present transition after this is the same either way
+void RecordReadbackCopy(struct FrameRecorder* restrict Recorder, ID3D12GraphicsCommandList7* CommandList, ID3D12Resource* BackBuffer)
+{
+	D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
+	TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_RENDER_TARGET;
+	TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_COPY;
+	TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_RENDER_TARGET;
+	TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_COPY_SOURCE;
+	TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+	TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_COPY_SOURCE;
+	TextureBarrier.pResource = BackBuffer;
+	TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+
+	D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+	ResourceBarrier.Type = D3D12_BARRIER_TYPE_TEXTURE;
+	ResourceBarrier.NumBarriers = 1;
+	ResourceBarrier.pTextureBarriers = &TextureBarrier;
+	ID3D12GraphicsCommandList7_Barrier(CommandList, 1, &ResourceBarrier);
+
+	D3D12_TEXTURE_COPY_LOCATION TextureCopyDest = { 0 };
+	TextureCopyDest.pResource = Recorder->Buffers[Recorder->Current];
+	TextureCopyDest.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	TextureCopyDest.PlacedFootprint = Recorder->Footprint;
+
+	D3D12_TEXTURE_COPY_LOCATION TextureCopySrc = { 0 };
+	TextureCopySrc.pResource = BackBuffer;
+	TextureCopySrc.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	TextureCopySrc.SubresourceIndex = 0;
+	ID3D12GraphicsCommandList7_CopyTextureRegion(CommandList, &TextureCopyDest, 0, 0, 0, &TextureCopySrc, NULL);
+
+	TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_COPY;
+	TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_RENDER_TARGET;
+	TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COPY_SOURCE;
+	TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_RENDER_TARGET;
+	TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_COPY_SOURCE;
+	TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
+	ID3D12GraphicsCommandList7_Barrier(CommandList, 1, &ResourceBarrier);
+
+	//the slot belongs to this frame's submission now
+	Recorder->Current = -1;
+}
+
+//hands every slot whose copy the submit fence has passed to the worker, oldest first. the simulated frames have no buffers,
+//their Data is set up front
+UINT CollectFrameRecordings(struct FrameRecorder* restrict Recorder, UINT64 CompletedValue)
+{
+	UINT Collected = 0;
+
+	while (Recorder->States[Recorder->Tail] == RECORDER_SLOT_PENDING && Recorder->FenceValues[Recorder->Tail] <= CompletedValue)
+	{
+		const UINT Slot = Recorder->Tail;
+
+		if (Recorder->Buffers[Slot])
+			THROW_ON_FAIL(ID3D12Resource_Map(Recorder->Buffers[Slot], 0, &(D3D12_RANGE){ 0, Recorder->BufferSize }, &Recorder->Data[Slot]));
+
+		//only this thread moves a slot out of PENDING, the worker takes it from here
+		Recorder->States[Slot] = RECORDER_SLOT_ENCODING;
+
+		AcquireSRWLockExclusive(&Recorder->Lock);
+		Recorder->Handoff[(Recorder->HandoffHead + Recorder->HandoffCount) % RECORDER_SLOTS] = Slot;
+		Recorder->HandoffCount++;
+		ReleaseSRWLockExclusive(&Recorder->Lock);
+
+		SubmitThreadpoolWork(Recorder->Work);
+
+		Recorder->Tail = (Slot + 1) % RECORDER_SLOTS;
+		Collected++;
+	}
+
+	return Collected;
+}
+
+//the only place anything waits on the worker, for the end of a run. every submission must have completed
+void FinishFrameRecordings(struct FrameRecorder* restrict Recorder)
+{
+	CollectFrameRecordings(Recorder, UINT64_MAX);
+	WaitForThreadpoolWorkCallbacks(Recorder->Work, FALSE);
+}
+
+//writes out one handed over slot and frees it. several can run at once, each has a slot and a bitmap of its own
+VOID CALLBACK FrameRecorderWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+	struct FrameRecorder* Recorder = Context;
+
+	AcquireSRWLockExclusive(&Recorder->Lock);
+	const UINT Slot = Recorder->Handoff[Recorder->HandoffHead];
+	Recorder->HandoffHead = (Recorder->HandoffHead + 1) % RECORDER_SLOTS;
+	Recorder->HandoffCount--;
+	ReleaseSRWLockExclusive(&Recorder->Lock);
+
+	LARGE_INTEGER Start;
+	QueryPerformanceCounter(&Start);
+
+	const UINT Size = EncodeBitmap(Recorder->Data[Slot], Recorder->Footprint.Footprint.RowPitch, Recorder->Footprint.Footprint.Width, Recorder->Footprint.Footprint.Height, Recorder->Bitmaps[Slot]);
+
+	if (Recorder->Buffers[Slot])
+		ID3D12Resource_Unmap(Recorder->Buffers[Slot], 0, &(D3D12_RANGE){ 0, 0 });
+
+	if (Recorder->Directory[0])
+	{
+		WCHAR Path[MAX_PATH];
+		THROW_ON_FALSE(_snwprintf_s(Path, MAX_PATH, _TRUNCATE, L"%s\\frame_%06u.bmp", Recorder->Directory, Recorder->FrameNumbers[Slot]) > 0);
+
+		HANDLE File = CreateFileW(Path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		VALIDATE_HANDLE(File);
+
+		DWORD Written;
+		THROW_ON_FALSE(WriteFile(File, Recorder->Bitmaps[Slot], Size, &Written, NULL));
+		THROW_ON_FALSE(CloseHandle(File));
+	}
+
+	LARGE_INTEGER End;
+	QueryPerformanceCounter(&End);
+
+	InterlockedAdd64(&Recorder->Checksum, (LONG64)BitmapChecksum(Recorder->Bitmaps[Slot], Size));
+	InterlockedAdd64(&Recorder->EncodedBytes, Size);
+	InterlockedAdd64(&Recorder->EncodeTicks, End.QuadPart - Start.QuadPart);
+	InterlockedIncrement64(&Recorder->Encoded);
+
+	//last, the render thread can take the slot again as soon as it sees this
+	InterlockedExchange(&Recorder->States[Slot], RECORDER_SLOT_FREE);
+}
+
+//a 32 bit top down bmp. the rgba rows are swizzled to bgra and lose the footprint's padding, returns the file size
+UINT EncodeBitmap(const UINT8* restrict Source, UINT RowPitch, UINT Width, UINT Height, UINT8* restrict Destination)
+{
+	const UINT ImageSize = Width * Height * 4;
+
+	BITMAPFILEHEADER FileHeader = { 0 };
+	FileHeader.bfType = 0x4D42;
+	FileHeader.bfSize = RECORDER_BITMAP_HEADER_SIZE + ImageSize;
+	FileHeader.bfOffBits = RECORDER_BITMAP_HEADER_SIZE;
+
+	BITMAPINFOHEADER InfoHeader = { 0 };
+	InfoHeader.biSize = sizeof(BITMAPINFOHEADER);
+	InfoHeader.biWidth = Width;
+	InfoHeader.biHeight = -(LONG)Height;
+	InfoHeader.biPlanes = 1;
+	InfoHeader.biBitCount = 32;
+	InfoHeader.biCompression = BI_RGB;
+	InfoHeader.biSizeImage = ImageSize;
+
+	memcpy(Destination, &FileHeader, sizeof(FileHeader));
+	memcpy(Destination + sizeof(FileHeader), &InfoHeader, sizeof(InfoHeader));
+
+	UINT8* Pixels = Destination + RECORDER_BITMAP_HEADER_SIZE;
+
+	for (UINT y = 0; y < Height; y++)
+	{
+		const UINT8* Row = Source + (SIZE_T)y * RowPitch;
+
+		for (UINT x = 0; x < Width * 4; x += 4)
+		{
+			Pixels[x + 0] = Row[x + 2];
+			Pixels[x + 1] = Row[x + 1];
+			Pixels[x + 2] = Row[x + 0];
+			Pixels[x + 3] = Row[x + 3];
+		}
+
+		Pixels += Width * 4;
+	}
+
+	return RECORDER_BITMAP_HEADER_SIZE + ImageSize;
+}
+
+//the ring and the worker on made up frames, no device needed. the GPU runs RECORDER_SIM_LATENCY frames behind and stalls for a
+//while partway through. checks that no slot is handed over before its fence or left behind after it, that every captured frame
+//is written exactly once with its own pixels, and that frames are dropped rather than waited for
+bool SimulateFrameRecorder(UINT64* restrict Encoded, UINT64* restrict Dropped)
+{
+	static struct FrameRecorder Recorder;
+	CreateFrameRecorder(&Recorder, L"");
+
+	const UINT RowPitch = (RECORDER_SIM_WIDTH * 4 + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+
+	Recorder.Footprint.Footprint.Format = RTV_FORMAT;
+	Recorder.Footprint.Footprint.Width = RECORDER_SIM_WIDTH;
+	Recorder.Footprint.Footprint.Height = RECORDER_SIM_HEIGHT;
+	Recorder.Footprint.Footprint.Depth = 1;
+	Recorder.Footprint.Footprint.RowPitch = RowPitch;
+	Recorder.BufferSize = (UINT64)RowPitch * RECORDER_SIM_HEIGHT;
+	InitRecorderBitmaps(&Recorder, RECORDER_SIM_WIDTH, RECORDER_SIM_HEIGHT);
+
+	//stands in for the readback buffers, with room after them to build the expected bitmaps in
+	UINT8* Memory = VirtualAlloc(NULL, (SIZE_T)Recorder.BufferSize * RECORDER_SLOTS + Recorder.BitmapSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Memory);
+
+	UINT8* Expected = Memory + (SIZE_T)Recorder.BufferSize * RECORDER_SLOTS;
+
+	for (UINT i = 0; i < RECORDER_SLOTS; i++)
+	{
+		Recorder.Data[i] = Memory + (SIZE_T)Recorder.BufferSize * i;
+	}
+
+	bool bValid = true;
+	UINT64 ExpectedChecksum = 0;
+	UINT64 Completed = 0;
+
+	//frame f is submitted with fence value f + 1
+	for (UINT Frame = 0; Frame < RECORDER_SIM_FRAMES; Frame++)
+	{
+		if (Frame >= RECORDER_SIM_LATENCY && (Frame < RECORDER_SIM_STALL_BEGIN || Frame >= RECORDER_SIM_STALL_END))
+			Completed = Frame - RECORDER_SIM_LATENCY + 1;
+
+		bool bWaiting[RECORDER_SLOTS];
+
+		for (UINT i = 0; i < RECORDER_SLOTS; i++)
+		{
+			bWaiting[i] = Recorder.States[i] == RECORDER_SLOT_PENDING && Recorder.FenceValues[i] > Completed;
+		}
+
+		CollectFrameRecordings(&Recorder, Completed);
+
+		for (UINT i = 0; i < RECORDER_SLOTS; i++)
+		{
+			const bool bPending = Recorder.States[i] == RECORDER_SLOT_PENDING;
+			bValid = bValid && (!bWaiting[i] || bPending) && (!bPending || Recorder.FenceValues[i] > Completed);
+		}
+
+		const INT Slot = AcquireRecorderSlot(&Recorder, Frame + 1);
+
+		if (Slot < 0)
+			continue;
+
+		//what the copy would leave, with junk in the padding after each row
+		const UINT FrameNumber = Recorder.FrameNumbers[Slot];
+
+		for (UINT y = 0; y < RECORDER_SIM_HEIGHT; y++)
+		{
+			for (UINT x = 0; x < RowPitch; x++)
+			{
+				Recorder.Data[Slot][y * RowPitch + x] = x < RECORDER_SIM_WIDTH * 4 ? (UINT8)(x * 7 + y * 13 + FrameNumber * 29) : 0xCD;
+			}
+		}
+
+		ExpectedChecksum += BitmapChecksum(Expected, EncodeBitmap(Recorder.Data[Slot], RowPitch, RECORDER_SIM_WIDTH, RECORDER_SIM_HEIGHT, Expected));
+	}
+
+	FinishFrameRecordings(&Recorder);
+
+	*Encoded = Recorder.Encoded;
+	*Dropped = Recorder.Dropped;
+
+	bValid = bValid && Recorder.Captured + Recorder.Dropped == RECORDER_SIM_FRAMES && (UINT64)Recorder.Encoded == Recorder.Captured;
+	bValid = bValid && (UINT64)Recorder.Checksum == ExpectedChecksum;
+
+	//the ring can only hold RECORDER_SLOTS of the frames submitted during the stall
+	bValid = bValid && Recorder.Dropped >= RECORDER_SIM_STALL_END - RECORDER_SIM_STALL_BEGIN - RECORDER_SLOTS;
+
+	for (UINT i = 0; i < RECORDER_SLOTS; i++)
+	{
+		bValid = bValid && Recorder.States[i] == RECORDER_SLOT_FREE;
+	}
+
+	//the layout itself, the last bitmap built is top down and blue first
+	const UINT8* Pixel = Expected + RECORDER_BITMAP_HEADER_SIZE + (5 * RECORDER_SIM_WIDTH + 3) * 4;
+	const UINT8* Source = Recorder.Data[(Recorder.Head + RECORDER_SLOTS - 1) % RECORDER_SLOTS] + 5 * RowPitch + 3 * 4;
+
+	BITMAPINFOHEADER InfoHeader;
+	memcpy(&InfoHeader, Expected + sizeof(BITMAPFILEHEADER), sizeof(InfoHeader));
+
+	bValid = bValid && Expected[0] == 'B' && Expected[1] == 'M' && InfoHeader.biHeight == -RECORDER_SIM_HEIGHT;
+	bValid = bValid && Pixel[0] == Source[2] && Pixel[1] == Source[1] && Pixel[2] == Source[0] && Pixel[3] == Source[3];
+
+	FreeRecorderBitmaps(&Recorder);
+	CloseThreadpoolWork(Recorder.Work);
+	THROW_ON_FALSE(VirtualFree(Memory, 0, MEM_RELEASE));
+
+	return bValid;
+}
+
+void InitStartupGraph(struct StartupGraph* restrict Graph)
+{
+	Graph->Count = 0;
+	Graph->Scheduled = 0;
+	Graph->Waited = 0;
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+	Graph->Frequency = Frequency.QuadPart;
+	Graph->Begin = 0;
+}
+
+//returns the task's bit, for the Dependencies of the tasks added after it
+UINT AddStartupTask(struct StartupGraph* restrict Graph, const char* Name, void (*Proc)(void* Context), void* Context, UINT Dependencies)
+{
+	assert(Graph->Count < STARTUP_MAX_TASKS && Graph->Scheduled == 0);
+	assert((Dependencies >> Graph->Count) == 0);
+
+	struct StartupTask* Task = &Graph->Tasks[Graph->Count];
+	Task->Name = Name;
+	Task->Proc = Proc;
+	Task->Context = Context;
+	Task->Dependencies = Dependencies;
+	Task->Waiting = 0;
+	Task->Work = NULL;
+	Task->Graph = Graph;
+	Task->Begin = 0;
+	Task->End = 0;
+	Task->ThreadId = 0;
+
+	for (UINT i = 0; i < Graph->Count; i++)
+	{
+		Task->Waiting += (Dependencies >> i) & 1;
+	}
+
+	return 1u << Graph->Count++;
+}
+
+void LaunchStartupGraph(struct StartupGraph* restrict Graph)
+{
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+	Graph->Begin = Now.QuadPart;
+	Graph->Scheduled = Graph->Count;
+
+	//every work object exists before the first submit, since a finishing task can submit any later one
+	for (UINT i = 0; i < Graph->Scheduled; i++)
+	{
+		Graph->Tasks[i].Work = CreateThreadpoolWork(StartupTaskWork, &Graph->Tasks[i], NULL);
+		VALIDATE_HANDLE(Graph->Tasks[i].Work);
+	}
+
+	for (UINT i = 0; i < Graph->Scheduled; i++)
+	{
+		if (Graph->Tasks[i].Dependencies == 0)
+			SubmitThreadpoolWork(Graph->Tasks[i].Work);
+	}
+}
+
+VOID CALLBACK StartupTaskWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+	struct StartupTask* Task = Context;
+	struct StartupGraph* Graph = Task->Graph;
+	const UINT Bit = 1u << (UINT)(Task - Graph->Tasks);
+
+	LARGE_INTEGER Time;
+	QueryPerformanceCounter(&Time);
+	Task->Begin = Time.QuadPart;
+	Task->ThreadId = GetCurrentThreadId();
+
+	CPU_ZONE_BEGIN(Task->Name);
+	Task->Proc(Task->Context);
+	CPU_ZONE_END();
+
+	QueryPerformanceCounter(&Time);
+	Task->End = Time.QuadPart;
+
+	//whichever dependency finishes last submits the task
+	for (UINT i = 0; i < Graph->Scheduled; i++)
+	{
+		if ((Graph->Tasks[i].Dependencies & Bit) && InterlockedDecrement(&Graph->Tasks[i].Waiting) == 0)
+			SubmitThreadpoolWork(Graph->Tasks[i].Work);
+	}
+}
+
+//waits in the order the tasks were added, by the time one is reached everything it depends on has returned and submitted it
+void WaitStartupTasks(struct StartupGraph* restrict Graph, UINT Tasks)
+{
+	for (; Graph->Waited < Graph->Scheduled && (Tasks >> Graph->Waited) != 0; Graph->Waited++)
+	{
+		WaitForThreadpoolWorkCallbacks(Graph->Tasks[Graph->Waited].Work, FALSE);
+	}
+}
+
+void FinishStartupGraph(struct StartupGraph* restrict Graph)
+{
+	WaitStartupTasks(Graph, UINT_MAX);
+
+	for (UINT i = 0; i < Graph->Scheduled; i++)
+	{
+		CloseThreadpoolWork(Graph->Tasks[i].Work);
+		Graph->Tasks[i].Work = NULL;
+	}
+}
+
+//for work main does itself once the graph is running. nothing can depend on a phase
+UINT BeginStartupPhase(struct StartupGraph* restrict Graph, const char* Name)
+{
+	assert(Graph->Count < STARTUP_MAX_TASKS && Graph->Scheduled != 0);
+
+	struct StartupTask* Phase = &Graph->Tasks[Graph->Count];
+	Phase->Name = Name;
+	Phase->Proc = NULL;
+	Phase->Context = NULL;
+	Phase->Dependencies = 0;
+	Phase->Waiting = 0;
+	Phase->Work = NULL;
+	Phase->Graph = Graph;
+	Phase->End = 0;
+	Phase->ThreadId = GetCurrentThreadId();
+
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+	Phase->Begin = Now.QuadPart;
+
+	CPU_ZONE_BEGIN(Name);
+	return Graph->Count++;
+}
+
+void EndStartupPhase(struct StartupGraph* restrict Graph, UINT Phase)
+{
+	CPU_ZONE_END();
+
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+	Graph->Tasks[Phase].End = Now.QuadPart;
+}
+
+//launch to the last task or phase finishing, and what the same work would have taken one step after another
+double StartupMilliseconds(const struct StartupGraph* restrict Graph, double* restrict SerialMilliseconds)
+{
+	LONGLONG End = Graph->Begin;
+	LONGLONG Serial = 0;
+
+	for (UINT i = 0; i < Graph->Count; i++)
+	{
+		End = max(End, Graph->Tasks[i].End);
+		Serial += Graph->Tasks[i].End - Graph->Tasks[i].Begin;
+	}
+
+	*SerialMilliseconds = Serial * 1000.0 / Graph->Frequency;
+	return (End - Graph->Begin) * 1000.0 / Graph->Frequency;
+}
+
+void ReportStartup(const struct StartupGraph* restrict Graph)
+{
+	WriteConsoleA(ConsoleHandle, "startup phase          thread   start ms       ms\n", 50, NULL, NULL);
+
+	for (UINT i = 0; i < Graph->Count; i++)
+	{
+		const struct StartupTask* Task = &Graph->Tasks[i];
+
+		char buffer[96];
+		int stringlength = _snprintf_s(buffer, 96, _TRUNCATE, "%-20s %8lu %10.3f %8.3f\n",
+			Task->Name, Task->ThreadId,
+			(Task->Begin - Graph->Begin) * 1000.0 / Graph->Frequency,
+			(Task->End - Task->Begin) * 1000.0 / Graph->Frequency);
+		WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+	}
+
+	double SerialMilliseconds;
+	const double Milliseconds = StartupMilliseconds(Graph, &SerialMilliseconds);
+
+	char buffer[96];
+	int stringlength = _snprintf_s(buffer, 96, _TRUNCATE, "startup: %.3f ms, %.3f ms run one after another\n", Milliseconds, SerialMilliseconds);
+	WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+}
+
+void SimulatedStartupTask(void* Context)
+{
+	struct StartupSimTask* Task = Context;
+
+	InterlockedIncrement(&Task->Runs);
+	Task->Started = InterlockedIncrement(Task->Sequence);
+
+	LARGE_INTEGER Start;
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Start);
+
+	do
+	{
+		QueryPerformanceCounter(&Now);
+	} while (Now.QuadPart - Start.QuadPart < Task->SpinTicks);
+
+	Task->Finished = InterlockedIncrement(Task->Sequence);
+}
+
+//a random graph of tasks that spin for a while, each stamped from one counter as it starts and finishes
+bool ValidateStartupGraph(double* restrict Milliseconds, double* restrict SerialMilliseconds)
+{
+	static struct StartupGraph Graph;
+	struct StartupSimTask Tasks[STARTUP_SIM_TASKS] = { 0 };
+	volatile LONG Sequence = 0;
+
+	InitStartupGraph(&Graph);
+
+	UINT Seed = 0x5EED;
+
+	for (UINT i = 0; i < STARTUP_SIM_TASKS; i++)
+	{
+		//each earlier task is a dependency about one time in four
+		Seed = Seed * 1664525 + 1013904223;
+
+		Tasks[i].Sequence = &Sequence;
+		Tasks[i].SpinTicks = Graph.Frequency * STARTUP_SIM_SPIN_US / 1000000;
+		AddStartupTask(&Graph, "Simulated Task", SimulatedStartupTask, &Tasks[i], (Seed >> 5) & (Seed >> 17) & ((1u << i) - 1));
+	}
+
+	LaunchStartupGraph(&Graph);
+
+	//a partial wait covers the task asked for and everything added before it
+	const UINT Middle = STARTUP_SIM_TASKS / 2;
+	WaitStartupTasks(&Graph, 1u << Middle);
+
+	bool bValid = true;
+
+	for (UINT i = 0; i <= Middle; i++)
+	{
+		bValid = bValid && Tasks[i].Finished != 0;
+	}
+
+	FinishStartupGraph(&Graph);
+
+	for (UINT i = 0; i < STARTUP_SIM_TASKS; i++)
+	{
+		bValid = bValid && Tasks[i].Runs == 1 && Graph.Tasks[i].Waiting == 0;
+
+		for (UINT d = 0; d < i; d++)
+		{
+			if (Graph.Tasks[i].Dependencies & (1u << d))
+				bValid = bValid && Tasks[d].Finished < Tasks[i].Started;
+		}
+	}
+
+	bValid = bValid && Sequence == STARTUP_SIM_TASKS * 2;
+
+	*Milliseconds = StartupMilliseconds(&Graph, SerialMilliseconds);
+	return bValid;
+}
+
+void StartupDevice(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+	struct DxObjects* DxObjects = Startup->DxObjects;
+
+#ifdef _DEBUG
+	{
+		ID3D12Debug* DebugControllerV1;
+		THROW_ON_FAIL(D3D12GetDebugInterface(&IID_ID3D12Debug, &DebugControllerV1));
+		THROW_ON_FAIL(ID3D12Debug_QueryInterface(DebugControllerV1, &IID_ID3D12Debug6, &Startup->DebugController));
+		ID3D12Debug_Release(DebugControllerV1);
+	}
+
+	ID3D12Debug6_EnableDebugLayer(Startup->DebugController);
+	ID3D12Debug6_SetEnableSynchronizedCommandQueueValidation(Startup->DebugController, TRUE);
+	ID3D12Debug6_SetGPUBasedValidationFlags(Startup->DebugController, D3D12_GPU_BASED_VALIDATION_FLAGS_DISABLE_STATE_TRACKING);
+	ID3D12Debug6_SetEnableGPUBasedValidation(Startup->DebugController, TRUE);
+#endif
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(CreateDXGIFactory2(DXGI_CREATE_FACTORY_DEBUG, &IID_IDXGIFactory6, &Startup->Factory));
+#else
+	THROW_ON_FAIL(CreateDXGIFactory2(0, &IID_IDXGIFactory6, &Startup->Factory));
+#endif
+
+	//kept for the lifetime of the device so the benchmark can query video memory usage
+	if (Startup->Options->bWarp)
+	{
+		THROW_ON_FAIL(IDXGIFactory6_EnumWarpAdapter(Startup->Factory, &IID_IDXGIAdapter3, &DxObjects->Adapter));
+	}
+	else
+	{
+		THROW_ON_FAIL(IDXGIFactory6_EnumAdapterByGpuPreference(Startup->Factory, 0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, &IID_IDXGIAdapter3, &DxObjects->Adapter));
+	}
+
+	THROW_ON_FAIL(D3D12CreateDevice(DxObjects->Adapter, D3D_FEATURE_LEVEL_12_1, &IID_ID3D12Device10, &Device));
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12Device10_QueryInterface(Device, &IID_ID3D12InfoQueue, &Startup->InfoQueue));
+
+	THROW_ON_FAIL(ID3D12InfoQueue_SetBreakOnSeverity(Startup->InfoQueue, D3D12_MESSAGE_SEVERITY_CORRUPTION, TRUE));
+	THROW_ON_FAIL(ID3D12InfoQueue_SetBreakOnSeverity(Startup->InfoQueue, D3D12_MESSAGE_SEVERITY_ERROR, TRUE));
+	THROW_ON_FAIL(ID3D12InfoQueue_SetBreakOnSeverity(Startup->InfoQueue, D3D12_MESSAGE_SEVERITY_WARNING, TRUE));
+#endif
+
+	{
+		D3D12_COMMAND_QUEUE_DESC CommandQueueDesc = { 0 };
+		CommandQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+		CommandQueueDesc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+		CommandQueueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateCommandQueue(Device, &CommandQueueDesc, &IID_ID3D12CommandQueue, &DxObjects->CommandQueue));
+	}
+
+	InitResidencyManager(&DxObjects->Residency, DxObjects->Adapter);
+	DxObjects->Residency.BudgetOverride = (UINT64)Startup->Options->ResidencyBudgetMB * 1024 * 1024;
+
+	{
+		LARGE_INTEGER Frequency;
+		QueryPerformanceFrequency(&Frequency);
+		DxObjects->Profiler.CpuFrequency = Frequency.QuadPart;
+
+		THROW_ON_FAIL(ID3D12CommandQueue_GetTimestampFrequency(DxObjects->CommandQueue, &DxObjects->Profiler.TimestampFrequency));
+		THROW_ON_FAIL(ID3D12CommandQueue_GetClockCalibration(DxObjects->CommandQueue, &DxObjects->Profiler.GpuCalibration, &DxObjects->Profiler.CpuCalibration));
+	}
+}
+
+void StartupShaders(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+
+	Startup->VertexShaderFile = CreateFileW(L"VertexShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(Startup->VertexShaderFile);
+
+	THROW_ON_FALSE(GetFileSizeEx(Startup->VertexShaderFile, &Startup->VertexShaderSize));
+
+	Startup->VertexShaderFileMap = CreateFileMappingW(Startup->VertexShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(Startup->VertexShaderFileMap);
+
+	Startup->VertexShaderBytecode = MapViewOfFile(Startup->VertexShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+
+	Startup->PixelShaderFile = CreateFileW(L"PixelShader.cso", GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(Startup->PixelShaderFile);
+
+	THROW_ON_FALSE(GetFileSizeEx(Startup->PixelShaderFile, &Startup->PixelShaderSize));
+
+	Startup->PixelShaderFileMap = CreateFileMappingW(Startup->PixelShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	VALIDATE_HANDLE(Startup->PixelShaderFileMap);
+
+	Startup->PixelShaderBytecode = MapViewOfFile(Startup->PixelShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+}
+
+void StartupTextureFile(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+
+	//a file that does not parse falls back to the generated texture
+	Startup->bTextureFile = Startup->Options->TexturePath[0] && OpenTextureFile(&Startup->TextureFile, Startup->Options->TexturePath);
+}
+
+void StartupRootSignature(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+	struct DxObjects* DxObjects = Startup->DxObjects;
+
+	{
+		D3D12_DESCRIPTOR_RANGE1  DescriptorRanges[3] = { 0 };
+		DescriptorRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		DescriptorRanges[0].NumDescriptors = 1;
+		DescriptorRanges[0].BaseShaderRegister = 0;
+		DescriptorRanges[0].RegisterSpace = 0;
+		DescriptorRanges[0].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
+		DescriptorRanges[0].OffsetInDescriptorsFromTableStart = 0;
+
+		//the light buffers and shadow maps are rewritten every time their frame slot comes around, cached bundles included
+		DescriptorRanges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+		DescriptorRanges[1].NumDescriptors = 5;
+		DescriptorRanges[1].BaseShaderRegister = 1;
+		DescriptorRanges[1].RegisterSpace = 0;
+		DescriptorRanges[1].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+		DescriptorRanges[1].OffsetInDescriptorsFromTableStart = 1;
+
+		DescriptorRanges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+		DescriptorRanges[2].NumDescriptors = 2;
+		DescriptorRanges[2].BaseShaderRegister = 1;
+		DescriptorRanges[2].RegisterSpace = 0;
+		DescriptorRanges[2].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+		DescriptorRanges[2].OffsetInDescriptorsFromTableStart = 6;
+
+		D3D12_ROOT_PARAMETER1  RootParameters[2] = { 0 };
+		RootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		RootParameters[0].Descriptor.ShaderRegister = 0;
+		RootParameters[0].Descriptor.RegisterSpace = 0;
+		RootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+		RootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+		RootParameters[1].DescriptorTable.NumDescriptorRanges = ARRAYSIZE(DescriptorRanges);
+		RootParameters[1].DescriptorTable.pDescriptorRanges = DescriptorRanges;
+		RootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+		D3D12_STATIC_SAMPLER_DESC Samplers[2] = { 0 };
+		Samplers[0].Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+		Samplers[0].AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Samplers[0].AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Samplers[0].AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Samplers[0].MipLODBias = 0;
+		Samplers[0].MaxAnisotropy = 0;
+		Samplers[0].ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+		Samplers[0].BorderColor = D3D12_STATIC_BORDER_COLOR_TRANSPARENT_BLACK;
+		Samplers[0].MinLOD = 0.0f;
+		Samplers[0].MaxLOD = D3D12_FLOAT32_MAX;
+		Samplers[0].ShaderRegister = 0;
+		Samplers[0].RegisterSpace = 0;
+		Samplers[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+		//shadow map lookups, a 2x2 pcf from the bilinear compare. off the edge of a cascade is lit
+		Samplers[1].Filter = D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+		Samplers[1].AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Samplers[1].AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Samplers[1].AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
+		Samplers[1].MipLODBias = 0;
+		Samplers[1].MaxAnisotropy = 0;
+		Samplers[1].ComparisonFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+		Samplers[1].BorderColor = D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE;
+		Samplers[1].MinLOD = 0.0f;
+		Samplers[1].MaxLOD = D3D12_FLOAT32_MAX;
+		Samplers[1].ShaderRegister = 1;
+		Samplers[1].RegisterSpace = 0;
+		Samplers[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+		D3D12_VERSIONED_ROOT_SIGNATURE_DESC RootSignatureDesc = { 0 };
+		RootSignatureDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+		RootSignatureDesc.Desc_1_1.NumParameters = ARRAYSIZE(RootParameters);
+		RootSignatureDesc.Desc_1_1.pParameters = RootParameters;
+		RootSignatureDesc.Desc_1_1.NumStaticSamplers = ARRAYSIZE(Samplers);
+		RootSignatureDesc.Desc_1_1.pStaticSamplers = Samplers;
+		RootSignatureDesc.Desc_1_1.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+			D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+		ID3D10Blob* Signature;
+		THROW_ON_FAIL(D3D12SerializeVersionedRootSignature(&RootSignatureDesc, &Signature, NULL));
+		THROW_ON_FAIL(ID3D12Device10_CreateRootSignature(Device, 0, ID3D10Blob_GetBufferPointer(Signature), ID3D10Blob_GetBufferSize(Signature), &IID_ID3D12RootSignature, &DxObjects->RootSignature));
+		THROW_ON_FAIL(ID3D10Blob_Release(Signature));
+	}
+}
+
+void StartupCommandObjects(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+	struct DxObjects* DxObjects = Startup->DxObjects;
+	struct SyncObjects* SyncObjects = Startup->SyncObjects;
+
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC RtvHeapDesc = { 0 };
+		RtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+		RtvHeapDesc.NumDescriptors = BUFFER_COUNT + 1;
+		RtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateDescriptorHeap(Device, &RtvHeapDesc, &IID_ID3D12DescriptorHeap, &Startup->RtvDescriptorHeap));
+	}
+
+	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(Startup->RtvDescriptorHeap, &DxObjects->RtvHeapHandle);
+
+	DxObjects->RtvDescriptorSize = ID3D12Device10_GetDescriptorHandleIncrementSize(Device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Device10_CreateCommandAllocator(Device, D3D12_COMMAND_LIST_TYPE_DIRECT, &IID_ID3D12CommandAllocator, &DxObjects->CommandAllocators[i]));
+	}
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		THROW_ON_FAIL(ID3D12Device10_CreateFence(Device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, &SyncObjects->Fence[i]));
+		SyncObjects->FenceValue[i] = 0;
+	}
+
+	THROW_ON_FAIL(ID3D12Device10_CreateFence(Device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, &SyncObjects->SubmitFence));
+	SyncObjects->SubmitFenceValue = 0;
+
+	SyncObjects->FenceEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+	VALIDATE_HANDLE(SyncObjects->FenceEvent);
+
+	SyncObjects->PacingTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	VALIDATE_HANDLE(SyncObjects->PacingTimer);
+
+	SyncObjects->IdleFenceEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+	VALIDATE_HANDLE(SyncObjects->IdleFenceEvent);
+
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC DsvHeapDesc = { 0 };
+		DsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+		DsvHeapDesc.NumDescriptors = 1;
+		DsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateDescriptorHeap(Device, &DsvHeapDesc, &IID_ID3D12DescriptorHeap, &Startup->DepthStencilDescriptorHeap));
+	}
+
+#ifdef _DEBUG
+	ID3D12DescriptorHeap_SetName(Startup->DepthStencilDescriptorHeap, L"Depth/Stencil Resource Heap");
+#endif
+
+	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(Startup->DepthStencilDescriptorHeap, &DxObjects->DsvHeapHandle);
+
+	CreateBundleCache(&DxObjects->Bundles);
+	DxObjects->Bundles.bEnabled = Startup->Options->bBundles;
+}
+
+void StartupFrameResources(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+	struct DxObjects* DxObjects = Startup->DxObjects;
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		ResourceDesc.Alignment = 0;
+		ResourceDesc.Width = ConstantBufferPerObjectAlignedSize * 2;
+		ResourceDesc.Height = 1;
+		ResourceDesc.DepthOrArraySize = 1;
+		ResourceDesc.MipLevels = 1;
+		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ResourceDesc.SampleDesc.Count = 1;
+		ResourceDesc.SampleDesc.Quality = 0;
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &Startup->ConstantBufferHeaps[i]));
+		MemoryTrackResource(Startup->ConstantBufferHeaps[i], MEMORY_CONSTANTS, &ResourceDesc, "Constant Buffer");
+
+#ifdef _DEBUG
+		ID3D12Resource_SetName(Startup->ConstantBufferHeaps[i], L"Constant Buffer Upload Resource Heap");
+#endif
+
+		THROW_ON_FAIL(ID3D12Resource_Map(Startup->ConstantBufferHeaps[i], 0, NULL, &DxObjects->ConstantBufferCPUAddress[i]));
+
+		DxObjects->ContantBufferGPUAddress[i] = ID3D12Resource_GetGPUVirtualAddress(Startup->ConstantBufferHeaps[i]);
+	}
+
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC HeapDesc = { 0 };
+		HeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		HeapDesc.NumDescriptors = MAIN_TABLE_BASE + BUFFER_COUNT * MAIN_TABLE_SIZE;
+		HeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+		THROW_ON_FAIL(ID3D12Device10_CreateDescriptorHeap(Device, &HeapDesc, &IID_ID3D12DescriptorHeap, &DxObjects->SRVDescriptorHeap));
+	}
+
+	ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(DxObjects->SRVDescriptorHeap, &DxObjects->SrvGpuHandle);
+	DxObjects->SrvDescriptorSize = ID3D12Device10_GetDescriptorHandleIncrementSize(Device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	//the F key records into frames without a --record directory
+	CreateFrameRecorder(&DxObjects->Recorder, Startup->Options->RecordPath[0] ? Startup->Options->RecordPath : L"frames");
+	DxObjects->Recorder.bEnabled = Startup->Options->RecordPath[0] != 0;
+
+	InitResolutionController(&DxObjects->Resolution, Startup->Options->FrameBudgetMs);
+	DxObjects->Resolution.bEnabled = Startup->Options->bDynamicResolution;
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		CreateFrameArena(&DxObjects->FrameArenas[i], Startup->Options->bArenaGuard);
+	}
+
+	{
+		D3D12_QUERY_HEAP_DESC QueryHeapDesc = { 0 };
+		QueryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		QueryHeapDesc.Count = PROFILER_QUERIES_PER_FRAME * BUFFER_COUNT;
+		QueryHeapDesc.NodeMask = 0;
+		THROW_ON_FAIL(ID3D12Device10_CreateQueryHeap(Device, &QueryHeapDesc, &IID_ID3D12QueryHeap, &DxObjects->Profiler.QueryHeap));
+	}
+
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		ResourceDesc.Alignment = 0;
+		ResourceDesc.Width = PROFILER_QUERIES_PER_FRAME * BUFFER_COUNT * sizeof(UINT64);
+		ResourceDesc.Height = 1;
+		ResourceDesc.DepthOrArraySize = 1;
+		ResourceDesc.MipLevels = 1;
+		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ResourceDesc.SampleDesc.Count = 1;
+		ResourceDesc.SampleDesc.Quality = 0;
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects->Profiler.Readback));
+		MemoryTrackResource(DxObjects->Profiler.Readback, MEMORY_READBACK, &ResourceDesc, "Timestamp Readback Ring");
+	}
+
+#ifdef _DEBUG
+	THROW_ON_FAIL(ID3D12Resource_SetName(DxObjects->Profiler.Readback, L"Timestamp Readback Ring"));
+#endif
+
+	THROW_ON_FAIL(ID3D12Resource_Map(DxObjects->Profiler.Readback, 0, NULL, &DxObjects->Profiler.ReadbackData));
+}
+
+void StartupPipelineState(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+	struct DxObjects* DxObjects = Startup->DxObjects;
+
+	struct
+	{
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypepRootSignature;
+		ID3D12RootSignature* pRootSignature;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeInputLayout;
+		D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeVS;
+		D3D12_SHADER_BYTECODE VS;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypePS;
+		D3D12_SHADER_BYTECODE PS;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDepthStencilState;
+		D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDSVFormat;
+		DXGI_FORMAT DSVFormat;
+
+		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeRTVFormats;
+		struct D3D12_RT_FORMAT_ARRAY RTVFormats;
+	} PipelineStateObject = { 0 };
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC PsoDesc = { 0 };
+	PipelineStateObject.ObjectTypepRootSignature = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
+	PipelineStateObject.pRootSignature = DxObjects->RootSignature;
+
+	PipelineStateObject.ObjectTypeVS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS;
+	PipelineStateObject.VS.pShaderBytecode = Startup->VertexShaderBytecode;
+	PipelineStateObject.VS.BytecodeLength = Startup->VertexShaderSize;
+
+	PipelineStateObject.ObjectTypePS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS;
+	PipelineStateObject.PS.pShaderBytecode = Startup->PixelShaderBytecode;
+	PipelineStateObject.PS.BytecodeLength = Startup->PixelShaderSize;
+
+	PipelineStateObject.ObjectTypeDepthStencilState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL;
+	PipelineStateObject.DepthStencilState.DepthEnable = TRUE;
+	PipelineStateObject.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+	PipelineStateObject.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+	PipelineStateObject.DepthStencilState.StencilEnable = FALSE;
+	PipelineStateObject.DepthStencilState.StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+	PipelineStateObject.DepthStencilState.StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
+	PipelineStateObject.DepthStencilState.FrontFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
+	PipelineStateObject.DepthStencilState.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+	PipelineStateObject.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
+	PipelineStateObject.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	PipelineStateObject.DepthStencilState.BackFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
+	PipelineStateObject.DepthStencilState.BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
+	PipelineStateObject.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
+	PipelineStateObject.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+
+	PipelineStateObject.ObjectTypeInputLayout = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT;
+	PipelineStateObject.InputLayout.pInputElementDescs = (D3D12_INPUT_ELEMENT_DESC[]){
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }};
+	PipelineStateObject.InputLayout.NumElements = 2;
+
+	PipelineStateObject.ObjectTypeDSVFormat = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT;
+	PipelineStateObject.DSVFormat = DSV_FORMAT;
+
+	PipelineStateObject.ObjectTypeRTVFormats = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
+	PipelineStateObject.RTVFormats.RTFormats[0] = RTV_FORMAT;
+	PipelineStateObject.RTVFormats.NumRenderTargets = 1;
+
+	D3D12_PIPELINE_STATE_STREAM_DESC PsoStreamDesc = { 0 };
+	PsoStreamDesc.SizeInBytes = sizeof(PipelineStateObject);
+	PsoStreamDesc.pPipelineStateSubobjectStream = &PipelineStateObject;
+
+	THROW_ON_FAIL(ID3D12Device10_CreatePipelineState(Device, &PsoStreamDesc, &IID_ID3D12PipelineState, &DxObjects->PipelineStateObject));
+
+	THROW_ON_FALSE(UnmapViewOfFile(Startup->VertexShaderBytecode));
+	THROW_ON_FALSE(CloseHandle(Startup->VertexShaderFileMap));
+	THROW_ON_FALSE(CloseHandle(Startup->VertexShaderFile));
+
+	THROW_ON_FALSE(UnmapViewOfFile(Startup->PixelShaderBytecode));
+	THROW_ON_FALSE(CloseHandle(Startup->PixelShaderFileMap));
+	THROW_ON_FALSE(CloseHandle(Startup->PixelShaderFile));
+
+	CreateUpscalePipeline(DxObjects);
+}
+
+void StartupDrawSystems(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+	struct DxObjects* DxObjects = Startup->DxObjects;
+
+	InitDrawQueue(&DxObjects->DrawQueue, 0);
+
+	CreateGpuCulling(DxObjects);
+	DxObjects->Culling.bEnabled = Startup->Options->bGpuCulling;
+
+	InitOcclusionBuffer(&DxObjects->Occlusion);
+	DxObjects->Occlusion.bEnabled = Startup->Options->bOcclusion;
+
+	InitParticleSystem(&DxObjects->Particles, PARTICLE_CAPACITY);
+	CreateParticleRenderer(&DxObjects->Particles);
+	DxObjects->Particles.bEnabled = Startup->Options->bParticles;
+
+	//a fountain out of the top of the big cube and a slower plume drifting past its side
+	AddParticleEmitter(&DxObjects->Particles, &(struct ParticleEmitter){ .Position = { 0.0f, 0.9f, 0.0f }, .Velocity = { 0.0f, 3.0f, 0.0f }, .Spread = 1.5f, .Rate = 20000.0f, .Life = 1.5f, .Size = 0.02f, .Color = 0xFF40A0FF, .Budget = 1024 });
+	AddParticleEmitter(&DxObjects->Particles, &(struct ParticleEmitter){ .Position = { -1.5f, -0.5f, 0.5f }, .Velocity = { 0.3f, 1.0f, 0.0f }, .Spread = 0.4f, .Rate = 4000.0f, .Life = 3.0f, .Size = 0.04f, .Color = 0xFFFF8030, .Budget = 256 });
+}
+
+void StartupLighting(void* Context)
+{
+	struct StartupObjects* Startup = Context;
+	struct DxObjects* DxObjects = Startup->DxObjects;
+
+	CreateClusteredLighting(DxObjects, Startup->Options->LightCount);
+	DxObjects->Lighting.bEnabled = Startup->Options->bLights;
+
+	CreateShadowMaps(DxObjects);
+	DxObjects->Shadows.bEnabled = Startup->Options->bShadows;
+}
+
+void InitLatencyTracker(struct LatencyTracker* restrict Latency, INT64 Frequency)
+{
+	*Latency = (struct LatencyTracker){ 0 };
+	Latency->Frequency = Frequency;
+}
+
+//stamped when WndProc sees the message, so time spent queued behind a frame counts against it
+inline void LatencyRecordInput(struct LatencyTracker* restrict Latency, INT64 Now)
+{
+	Latency->Inputs++;
+
+	if (Latency->PendingCount == LATENCY_MAX_INPUTS)
+	{
+		Latency->LostInputs++;
+		return;
+	}
+
+	Latency->Pending[Latency->PendingCount++] = Now;
+}
+
+//everything that arrived before the frame started is something the frame can show
+inline void LatencyBeginFrame(struct LatencyTracker* restrict Latency)
+{
+	Latency->Tagged = Latency->PendingCount;
+}
+
+//an occluded frame never gets here, so its inputs stay pending and are tagged again by the next one
+void LatencyPresented(struct LatencyTracker* restrict Latency, UINT PresentCount, INT64 Now)
+{
+	for (UINT i = 0; i < Latency->Tagged; i++)
+	{
+		LatencyAddSample(&Latency->InputToPresent, (float)((Now - Latency->Pending[i]) * 1000.0 / Latency->Frequency));
+	}
+
+	memmove(Latency->Pending, Latency->Pending + Latency->Tagged, (Latency->PendingCount - Latency->Tagged) * sizeof(INT64));
+	Latency->PendingCount -= Latency->Tagged;
+	Latency->Tagged = 0;
+
+	//a full ring means the statistics stopped coming, the oldest present is given up on
+	if (Latency->FrameCount == LATENCY_MAX_FRAMES)
+	{
+		Latency->FrameHead = (Latency->FrameHead + 1) % LATENCY_MAX_FRAMES;
+		Latency->FrameCount--;
+	}
+
+	const UINT Slot = (Latency->FrameHead + Latency->FrameCount) % LATENCY_MAX_FRAMES;
+	Latency->PresentCounts[Slot] = PresentCount;
+	Latency->PresentTimes[Slot] = Now;
+	Latency->FrameCount++;
+	Latency->Presented++;
+}
+
+//the statistics only ever describe the newest frame on screen, so frames in between are counted from how far the two counters moved
+void LatencyFrameStatistics(struct LatencyTracker* restrict Latency, const DXGI_FRAME_STATISTICS* Statistics)
+{
+	if (Latency->bSynced && Statistics->SyncRefreshCount != Latency->LastSyncRefresh)
+		Latency->RefreshPeriod = (Statistics->SyncQPCTime.QuadPart - Latency->LastSyncTime) / (INT64)(Statistics->SyncRefreshCount - Latency->LastSyncRefresh);
+
+	Latency->LastSyncRefresh = Statistics->SyncRefreshCount;
+	Latency->LastSyncTime = Statistics->SyncQPCTime.QuadPart;
+
+	if (Latency->bSynced && Statistics->PresentCount == Latency->LastPresentCount)
+		return;
+
+	if (Latency->bSynced)
+	{
+		const UINT Presents = Statistics->PresentCount - Latency->LastPresentCount;
+		const UINT Refreshes = Statistics->PresentRefreshCount - Latency->LastPresentRefresh;
+
+		//every new frame needs a refresh of its own. only the difference is visible, a drop and a repeat between two samples cancel out
+		if (Presents > Refreshes)
+			Latency->Dropped += Presents - Refreshes;
+		else
+			Latency->Repeated += Refreshes - Presents;
+	}
+
+	//the vblank the newest frame first went out on, which can be earlier than the one the sample was taken at
+	INT64 Display = 0;
+
+	if (Statistics->PresentRefreshCount == Statistics->SyncRefreshCount)
+		Display = Statistics->SyncQPCTime.QuadPart;
+	else if (Latency->RefreshPeriod != 0)
+		Display = Statistics->SyncQPCTime.QuadPart - (INT64)(Statistics->SyncRefreshCount - Statistics->PresentRefreshCount) * Latency->RefreshPeriod;
+
+	while (Latency->FrameCount != 0)
+	{
+		const UINT Oldest = Latency->FrameHead;
+
+		//still on its way to the screen
+		if ((INT)(Latency->PresentCounts[Oldest] - Statistics->PresentCount) > 0)
+			break;
+
+		//the first sample after a disjoint only sets the baseline. a tearing flip can land after the vblank it is counted against
+		if (Latency->bSynced && Display != 0 && Latency->PresentCounts[Oldest] == Statistics->PresentCount)
+		{
+			LatencyAddSample(&Latency->PresentToDisplay, (float)(max(Display - Latency->PresentTimes[Oldest], 0) * 1000.0 / Latency->Frequency));
+			Latency->Displayed++;
+		}
+
+		Latency->FrameHead = (Latency->FrameHead + 1) % LATENCY_MAX_FRAMES;
+		Latency->FrameCount--;
+	}
+
+	Latency->LastPresentCount = Statistics->PresentCount;
+	Latency->LastPresentRefresh = Statistics->PresentRefreshCount;
+	Latency->bSynced = true;
+}
+
+//no statistics until the next vblank after a mode change, and the refresh rate may have changed with it
+void LatencyDisjoint(struct LatencyTracker* restrict Latency)
+{
+	if (Latency->bSynced)
+		Latency->Disjoints++;
+
+	Latency->bSynced = false;
+	Latency->RefreshPeriod = 0;
+}
+
+inline void LatencyAddSample(struct LatencyHistory* restrict History, float Milliseconds)
+{
+	History->Samples[History->NextSample] = Milliseconds;
+	History->NextSample = (History->NextSample + 1) % LATENCY_HISTORY;
+	History->SampleCount = min(History->SampleCount + 1, LATENCY_HISTORY);
+}
+
+void LatencySummarize(const struct LatencyHistory* restrict History, struct TimeSummary* restrict Summary)
+{
+	float Sorted[LATENCY_HISTORY];
+	memcpy(Sorted, History->Samples, History->SampleCount * sizeof(float));
+
+	SummarizeTimes(Sorted, History->SampleCount, Summary);
+}
+
+void ReportLatency(const struct LatencyTracker* restrict Latency)
+{
+	static const char* HistoryNames[2] = { "input to present", "present to display" };
+	const struct LatencyHistory* Histories[2] = { &Latency->InputToPresent, &Latency->PresentToDisplay };
+
+	WriteConsoleA(ConsoleHandle, "latency               samples   min ms   avg ms   p50 ms   p99 ms   max ms\n", 75, NULL, NULL);
+
+	for (UINT i = 0; i < 2; i++)
+	{
+		struct TimeSummary Summary;
+		LatencySummarize(Histories[i], &Summary);
+
+		char buffer[96];
+		int stringlength = _snprintf_s(buffer, 96, _TRUNCATE, "%-20s %8u %8.3f %8.3f %8.3f %8.3f %8.3f\n",
+			HistoryNames[i], Histories[i]->SampleCount, Summary.Min, Summary.Avg, Summary.P50, Summary.P99, Summary.Max);
+		WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+	}
+
+	char buffer[160];
+	int stringlength = _snprintf_s(buffer, 160, _TRUNCATE, "frames: %llu presented, %llu displayed, %llu dropped, %llu repeated refreshes, %llu disjoint, %llu inputs lost\n",
+		Latency->Presented, Latency->Displayed, Latency->Dropped, Latency->Repeated, Latency->Disjoints, Latency->LostInputs);
+	WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+}
+
+//a 60hz display fed by a loop with uneven frame times, the tracker only sees what the frame statistics would have told it
+bool SimulateLatencyTimeline(UINT64* restrict Dropped, UINT64* restrict Repeated, struct TimeSummary* restrict InputToPresent, struct TimeSummary* restrict PresentToDisplay)
+{
+	static struct LatencyTracker Latency;
+	static INT64 PresentTimes[LATENCY_SIM_FRAMES + 1];
+	static UINT ShownAt[LATENCY_SIM_FRAMES + 1];
+	static float ExpectedInputs[LATENCY_SIM_FRAMES];
+	static float ExpectedDisplays[LATENCY_SIM_FRAMES];
+
+	const INT64 Period = LATENCY_SIM_PERIOD;
+	InitLatencyTracker(&Latency, Period * 60);
+
+	UINT ExpectedInputCount = 0;
+	UINT ExpectedDisplayCount = 0;
+
+	//vblanks so far, and the present on screen since which of them
+	UINT Refresh = 0;
+	UINT Shown = 0;
+	UINT FirstSampled = 0;
+	UINT LastSampled = 0;
+
+	INT64 Now = Period / 3;
+	UINT Seed = 0x1A7E;
+
+	for (UINT Frame = 1; Frame <= LATENCY_SIM_FRAMES; Frame++)
+	{
+		PresentTimes[Frame] = 0;
+		ShownAt[Frame] = 0;
+
+		//about every other frame a key comes in while the loop is between frames
+		Seed = Seed * 1664525 + 1013904223;
+		const INT64 Gap = (Seed >> 8) % (Period / 5);
+		INT64 InputTime = 0;
+
+		if (Seed & 0x40000000)
+		{
+			InputTime = Now + (Seed >> 12) % (Gap + 1);
+			LatencyRecordInput(&Latency, InputTime);
+		}
+
+		Now += Gap;
+		LatencyBeginFrame(&Latency);
+
+		//stalls make the display repeat a frame, quick frames can replace the one before them unseen
+		Seed = Seed * 1664525 + 1013904223;
+
+		if (Frame % 13 == 0)
+			Now += Period * 2 + (Seed >> 8) % Period;
+		else if (Frame % 7 == 0)
+			Now += Period / 20 + (Seed >> 8) % (Period / 10);
+		else
+			Now += Period / 2 + (Seed >> 8) % (Period * 2 / 3);
+
+		//each vblank up to the present shows the newest frame presented before it
+		while ((INT64)(Refresh + 1) * Period <= Now)
+		{
+			Refresh++;
+
+			if (Frame - 1 > Shown)
+			{
+				Shown = Frame - 1;
+				ShownAt[Shown] = Refresh;
+			}
+		}
+
+		PresentTimes[Frame] = Now;
+		LatencyPresented(&Latency, Frame, Now);
+
+		if (InputTime != 0)
+			ExpectedInputs[ExpectedInputCount++] = (float)((Now - InputTime) * 1000.0 / Latency.Frequency);
+
+		if (Shown == 0)
+		{
+			LatencyDisjoint(&Latency);
+			continue;
+		}
+
+		LatencyFrameStatistics(&Latency, &(DXGI_FRAME_STATISTICS){
+			.PresentCount = Shown,
+			.PresentRefreshCount = ShownAt[Shown],
+			.SyncRefreshCount = Refresh,
+			.SyncQPCTime.QuadPart = (INT64)Refresh * Period
+		});
+
+		if (Shown == LastSampled)
+			continue;
+
+		if (FirstSampled == 0)
+			FirstSampled = Shown;
+		else
+			ExpectedDisplays[ExpectedDisplayCount++] = (float)(((INT64)ShownAt[Shown] * Period - PresentTimes[Shown]) * 1000.0 / Latency.Frequency);
+
+		LastSampled = Shown;
+	}
+
+	//what the display really did between the first and last frames the statistics reported
+	UINT64 TruthDropped = 0;
+	UINT TruthShown = 0;
+
+	for (UINT i = FirstSampled + 1; i <= LastSampled; i++)
+	{
+		if (ShownAt[i] == 0)
+			TruthDropped++;
+		else
+			TruthShown++;
+	}
+
+	const UINT64 TruthRepeated = ShownAt[LastSampled] - ShownAt[FirstSampled] - TruthShown;
+
+	struct TimeSummary Expected;
+	bool bValid = Latency.Presented == LATENCY_SIM_FRAMES && Latency.PendingCount == 0 && Latency.LostInputs == 0;
+
+	bValid = bValid && Latency.Dropped != 0 && Latency.Repeated != 0;
+	bValid = bValid && Latency.Dropped <= TruthDropped && Latency.Repeated <= TruthRepeated;
+	bValid = bValid && (INT64)(Latency.Dropped - Latency.Repeated) == (INT64)(TruthDropped - TruthRepeated);
+
+	LatencySummarize(&Latency.InputToPresent, InputToPresent);
+	SummarizeTimes(ExpectedInputs, ExpectedInputCount, &Expected);
+	bValid = bValid && Latency.InputToPresent.SampleCount == ExpectedInputCount && memcmp(&Expected, InputToPresent, sizeof(Expected)) == 0;
+
+	LatencySummarize(&Latency.PresentToDisplay, PresentToDisplay);
+	SummarizeTimes(ExpectedDisplays, ExpectedDisplayCount, &Expected);
+	bValid = bValid && Latency.Displayed == ExpectedDisplayCount && Latency.PresentToDisplay.SampleCount == ExpectedDisplayCount && memcmp(&Expected, PresentToDisplay, sizeof(Expected)) == 0;
+
+	*Dropped = Latency.Dropped;
+	*Repeated = Latency.Repeated;
+	return bValid;
+}
+
+void CreateFrameArena(struct FrameArena* restrict Arena, bool bGuardPages)
+{
+	*Arena = (struct FrameArena){ 0 };
+	Arena->bGuardPages = bGuardPages;
+	Arena->Generation = InterlockedIncrement(&FrameArenaGenerations);
+
+	Arena->Base = VirtualAlloc(NULL, FRAME_ARENA_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Arena->Base);
+
+	MemoryTrack(Arena->Base, MEMORY_CPU, FRAME_ARENA_SIZE, "Frame Arena");
+}
+
+void FreeFrameArena(struct FrameArena* restrict Arena)
+{
+	MemoryUntrack(Arena->Base);
+	THROW_ON_FALSE(VirtualFree(Arena->Base, 0, MEM_RELEASE));
+	Arena->Base = NULL;
+}
+
+//returns the offset of Size bytes nobody else has been given this frame, or -1 once the arena is full
+inline LONG64 ClaimFrameArena(struct FrameArena* restrict Arena, SIZE_T Size)
+{
+	LONG64 Offset = Arena->Claimed;
+
+	for (;;)
+	{
+		if (Offset + (LONG64)Size > FRAME_ARENA_SIZE)
+			return -1;
+
+		const LONG64 Seen = InterlockedCompareExchange64(&Arena->Claimed, Offset + (LONG64)Size, Offset);
+
+		if (Seen == Offset)
+			return Offset;
+
+		Offset = Seen;
+	}
+}
+
+//NULL once the arena is out of space for the frame. the memory is only good until the frame's fence passes
+void* FrameAlloc(struct FrameArena* restrict Arena, SIZE_T Size)
+{
+	Size = (Size + FRAME_ARENA_ALIGNMENT - 1) & ~(SIZE_T)(FRAME_ARENA_ALIGNMENT - 1);
+
+	if (Arena->bGuardPages)
+		return FrameAllocGuarded(Arena, Size);
+
+	struct FrameArenaCursor* Cursor = &FrameArenaThreadCursor;
+
+	//only claiming a block touches the shared counter, everything in between is a thread's own bump
+	if (Cursor->Generation != Arena->Generation || (SIZE_T)(Cursor->End - Cursor->Next) < Size)
+	{
+		SIZE_T BlockSize = max(Size, FRAME_ARENA_BLOCK);
+		LONG64 Offset = ClaimFrameArena(Arena, BlockSize);
+
+		//the tail of the arena is too short for a whole block but may still fit this allocation
+		if (Offset < 0 && BlockSize != Size)
+		{
+			BlockSize = Size;
+			Offset = ClaimFrameArena(Arena, BlockSize);
+		}
+
+		if (Offset < 0)
+		{
+			InterlockedIncrement64(&Arena->Overflows);
+			return NULL;
+		}
+
+		Cursor->Generation = Arena->Generation;
+		Cursor->Next = Arena->Base + Offset;
+		Cursor->End = Cursor->Next + BlockSize;
+	}
+
+	void* Memory = Cursor->Next;
+	Cursor->Next += Size;
+	return Memory;
+}
+
+//pages of its own for every allocation, its end against a no access page so an overrun faults where it happens
+void* FrameAllocGuarded(struct FrameArena* restrict Arena, SIZE_T Size)
+{
+	const SIZE_T Pages = (Size + FRAME_ARENA_PAGE - 1) & ~(SIZE_T)(FRAME_ARENA_PAGE - 1);
+	const LONG64 Offset = ClaimFrameArena(Arena, Pages + FRAME_ARENA_PAGE);
+
+	if (Offset < 0)
+	{
+		InterlockedIncrement64(&Arena->Overflows);
+		return NULL;
+	}
+
+	DWORD OldProtect;
+	THROW_ON_FALSE(VirtualProtect(Arena->Base + Offset + Pages, FRAME_ARENA_PAGE, PAGE_NOACCESS, &OldProtect));
+
+	return Arena->Base + Offset + Pages - Size;
+}
+
+//only once the frame's fence has passed and every thread that allocated for it has finished. the new generation makes every thread's cursor stale
+void ResetFrameArena(struct FrameArena* restrict Arena)
+{
+	const UINT64 Used = Arena->Claimed;
+	Arena->HighWater = max(Arena->HighWater, Used);
+
+	if (Arena->bGuardPages && Used != 0)
+	{
+		DWORD OldProtect;
+		THROW_ON_FALSE(VirtualProtect(Arena->Base, Used, PAGE_READWRITE, &OldProtect));
+	}
+
+	Arena->Claimed = 0;
+	Arena->Generation = InterlockedIncrement(&FrameArenaGenerations);
+	Arena->Resets++;
+}
+
+void ReportFrameArenas(const struct FrameArena* Arenas, UINT Count)
+{
+	UINT64 HighWater = 0;
+	UINT64 Overflows = 0;
+
+	for (UINT i = 0; i < Count; i++)
+	{
+		HighWater = max(HighWater, max(Arenas[i].HighWater, (UINT64)Arenas[i].Claimed));
+		Overflows += Arenas[i].Overflows;
+	}
+
+	char buffer[96];
+	int stringlength = _snprintf_s(buffer, 96, _TRUNCATE, "frame arenas: %.1f kb high water of %u kb, %llu overflows%s\n",
+		HighWater / 1024.0, FRAME_ARENA_SIZE / 1024, Overflows, Arenas[0].bGuardPages ? ", guard pages" : "");
+	WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+}
+
+VOID CALLBACK FrameArenaSimWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+	struct FrameArenaSim* Sim = Context;
+	const UINT Worker = InterlockedIncrement(&Sim->NextWorker) - 1;
+
+	UINT Seed = 0xA7E4 + Worker;
+
+	for (UINT i = 0; i < FRAME_ARENA_SIM_ALLOCATIONS; i++)
+	{
+		Seed = Seed * 1664525 + 1013904223;
+		const UINT Size = 1 + (Seed >> 8) % FRAME_ARENA_SIM_MAX_SIZE;
+
+		UINT8* Memory = FrameAlloc(Sim->Arena, Size);
+		Sim->Allocations[Worker][i] = Memory;
+		Sim->Sizes[Worker][i] = Size;
+
+		if (Memory != NULL)
+			memset(Memory, (UINT8)(Worker * 37 + i), Size);
+	}
+}
+
+//workers fill everything they get with their own byte, an overlap or a block handed out twice shows up as someone else's byte
+bool ValidateFrameArena(UINT64* restrict HighWater)
+{
+	static struct FrameArenaSim Sim;
+	static struct FrameArena Arena;
+	CreateFrameArena(&Arena, false);
+	Sim.Arena = &Arena;
+
+	PTP_WORK Work = CreateThreadpoolWork(FrameArenaSimWork, &Sim, NULL);
+	VALIDATE_HANDLE(Work);
+
+	bool bValid = true;
+
+	//the second frame has to fit into the same memory the first one left behind, starting with whoever asks first
+	for (UINT Frame = 0; Frame < 2; Frame++)
+	{
+		bValid = bValid && FrameAlloc(&Arena, FRAME_ARENA_ALIGNMENT) == Arena.Base;
+		Sim.NextWorker = 0;
+
+		for (UINT i = 0; i < FRAME_ARENA_SIM_WORKERS; i++)
+		{
+			SubmitThreadpoolWork(Work);
+		}
+
+		WaitForThreadpoolWorkCallbacks(Work, FALSE);
+
+		for (UINT w = 0; w < FRAME_ARENA_SIM_WORKERS; w++)
+		{
+			for (UINT i = 0; i < FRAME_ARENA_SIM_ALLOCATIONS; i++)
+			{
+				const UINT8* Memory = Sim.Allocations[w][i];
+				const UINT8 Expected = (UINT8)(w * 37 + i);
+
+				bValid = bValid && Memory != NULL && ((UINT_PTR)Memory & (FRAME_ARENA_ALIGNMENT - 1)) == 0;
+				bValid = bValid && Memory >= Arena.Base && Memory + Sim.Sizes[w][i] <= Arena.Base + Arena.Claimed;
+
+				for (UINT b = 0; bValid && b < Sim.Sizes[w][i]; b++)
+				{
+					bValid = Memory[b] == Expected;
+				}
+			}
+		}
+
+		ResetFrameArena(&Arena);
+	}
+
+	CloseThreadpoolWork(Work);
+
+	//past the end fails without using any of it, the next allocation still fits
+	bValid = bValid && FrameAlloc(&Arena, FRAME_ARENA_SIZE + 1) == NULL && Arena.Overflows == 1;
+	bValid = bValid && FrameAlloc(&Arena, 1) == Arena.Base;
+
+	//a tail shorter than a block still serves allocations that fit in it
+	const SIZE_T TailSize = FRAME_ARENA_SIZE - 2 * FRAME_ARENA_BLOCK + FRAME_ARENA_ALIGNMENT;
+	UINT8* Tail = FrameAlloc(&Arena, TailSize);
+	bValid = bValid && Tail != NULL && FrameAlloc(&Arena, FRAME_ARENA_ALIGNMENT) == Tail + TailSize && Arena.Overflows == 1;
+
+	*HighWater = Arena.HighWater;
+	FreeFrameArena(&Arena);
+
+	//the last byte of a guarded allocation is the last one before the no access page
+	CreateFrameArena(&Arena, true);
+
+	UINT8* Guarded = FrameAlloc(&Arena, 100);
+	MEMORY_BASIC_INFORMATION GuardInfo;
+	THROW_ON_FALSE(VirtualQuery(Guarded + 112, &GuardInfo, sizeof(GuardInfo)) != 0);
+
+	bValid = bValid && Guarded != NULL && ((UINT_PTR)(Guarded + 112) & (FRAME_ARENA_PAGE - 1)) == 0 && GuardInfo.Protect == PAGE_NOACCESS;
+
+	ResetFrameArena(&Arena);
+	THROW_ON_FALSE(VirtualQuery(Guarded + 112, &GuardInfo, sizeof(GuardInfo)) != 0);
+	bValid = bValid && GuardInfo.Protect == PAGE_READWRITE;
+
+	FreeFrameArena(&Arena);
+	return bValid;
+}
+
+//the same frames of small mixed size allocations from the arena and from malloc, touching each one
+void BenchmarkFrameArena(double* restrict ArenaMicroseconds, double* restrict MallocMicroseconds)
+{
+	static void* Allocations[FRAME_ARENA_BENCH_ALLOCATIONS];
+	static struct FrameArena Arena;
+	CreateFrameArena(&Arena, false);
+
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	QueryPerformanceFrequency(&Frequency);
+
+	UINT Seed = 0xBE4C;
+	QueryPerformanceCounter(&Start);
+
+	for (UINT Frame = 0; Frame < FRAME_ARENA_BENCH_FRAMES; Frame++)
+	{
+		for (UINT i = 0; i < FRAME_ARENA_BENCH_ALLOCATIONS; i++)
+		{
+			Seed = Seed * 1664525 + 1013904223;
+			UINT8* Memory = FrameAlloc(&Arena, 16 + (Seed >> 8) % FRAME_ARENA_BENCH_MAX_SIZE);
+			Memory[0] = (UINT8)i;
+		}
+
+		ResetFrameArena(&Arena);
+	}
+
+	QueryPerformanceCounter(&End);
+	*ArenaMicroseconds = (End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / FRAME_ARENA_BENCH_FRAMES;
+
+	Seed = 0xBE4C;
+	QueryPerformanceCounter(&Start);
+
+	for (UINT Frame = 0; Frame < FRAME_ARENA_BENCH_FRAMES; Frame++)
+	{
+		for (UINT i = 0; i < FRAME_ARENA_BENCH_ALLOCATIONS; i++)
+		{
+			Seed = Seed * 1664525 + 1013904223;
+			UINT8* Memory = malloc(16 + (Seed >> 8) % FRAME_ARENA_BENCH_MAX_SIZE);
+			THROW_ON_FALSE(Memory != NULL);
+			Memory[0] = (UINT8)i;
+			Allocations[i] = Memory;
+		}
+
+		for (UINT i = 0; i < FRAME_ARENA_BENCH_ALLOCATIONS; i++)
+		{
+			free(Allocations[i]);
+		}
+	}
+
+	QueryPerformanceCounter(&End);
+	*MallocMicroseconds = (End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / FRAME_ARENA_BENCH_FRAMES;
+
+	FreeFrameArena(&Arena);
+}
+
+//a Capacity of 0 leaves the queue without storage of its own, BeginFrameDrawQueue hands it some every frame
+void InitDrawQueue(struct DrawQueue* restrict Queue, UINT Capacity)
+{
+	Queue->Capacity = Capacity;
+	Queue->Count = 0;
+	Queue->Dropped = 0;
+	Queue->bOwnsStorage = Capacity != 0;
+
+	if (Queue->bOwnsStorage)
+	{
+		Queue->Packets = VirtualAlloc(NULL, Capacity * sizeof(struct DrawPacket), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		VALIDATE_HANDLE(Queue->Packets);
+
+		Queue->Entries = VirtualAlloc(NULL, Capacity * sizeof(struct DrawSortEntry) * 2, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		VALIDATE_HANDLE(Queue->Entries);
+
+		MemoryTrack(Queue->Packets, MEMORY_CPU, Capacity * sizeof(struct DrawPacket), "Draw Packets");
+		MemoryTrack(Queue->Entries, MEMORY_CPU, Capacity * sizeof(struct DrawSortEntry) * 2, "Draw Sort Entries");
+		Queue->Scratch = Queue->Entries + Capacity;
+	}
+
+	Queue->WorkerCount = min(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), RADIX_SORT_MAX_CHUNKS);
+
+	Queue->SortWork = CreateThreadpoolWork(RadixSortWork, &Queue->Job, NULL);
+	VALIDATE_HANDLE(Queue->SortWork);
+}
+
+void FreeDrawQueue(struct DrawQueue* restrict Queue)
+{
+	CloseThreadpoolWork(Queue->SortWork);
+
+	if (!Queue->bOwnsStorage)
+		return;
+
+	MemoryUntrack(Queue->Entries);
+	MemoryUntrack(Queue->Packets);
+	THROW_ON_FALSE(VirtualFree(Queue->Entries, 0, MEM_RELEASE));
+	THROW_ON_FALSE(VirtualFree(Queue->Packets, 0, MEM_RELEASE));
+}
+
+//empties the queue into room for Capacity packets from the frame's arena. an arena that is out of space leaves no room, so the frame's draws count as dropped
+void BeginFrameDrawQueue(struct DrawQueue* restrict Queue, struct FrameArena* restrict Arena, UINT Capacity)
+{
+	assert(!Queue->bOwnsStorage);
+
+	Queue->Count = 0;
+	Queue->Packets = FrameAlloc(Arena, Capacity * sizeof(struct DrawPacket));
+	Queue->Entries = FrameAlloc(Arena, Capacity * sizeof(struct DrawSortEntry) * 2);
+
+	if (Queue->Packets == NULL || Queue->Entries == NULL)
+	{
+		Queue->Capacity = 0;
+		Queue->Scratch = Queue->Entries;
+		return;
+	}
+
+	Queue->Capacity = Capacity;
+	Queue->Scratch = Queue->Entries + Capacity;
+}
+
+//each call takes the next chunk, so the same callback serves inline and thread pool execution
+VOID CALLBACK RadixSortWork(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work)
+{
+	struct RadixSortJob* Job = Context;
+
+	const UINT Chunk = InterlockedIncrement(&Job->NextChunk) - 1;
+	const UINT Begin = (UINT)((UINT64)Job->Count * Chunk / Job->ChunkCount);
+	const UINT End = (UINT)((UINT64)Job->Count * (Chunk + 1) / Job->ChunkCount);
+	UINT* Offsets = Job->Offsets[Chunk];
+
+	if (Job->bScatter)
+	{
+		for (UINT i = Begin; i < End; i++)
+		{
+			Job->Dest[Offsets[(Job->Source[i].Key >> Job->Shift) & 0xFF]++] = Job->Source[i];
+		}
+	}
+	else
+	{
+		memset(Offsets, 0, sizeof(Job->Offsets[0]));
+
+		for (UINT i = Begin; i < End; i++)
+		{
+			Offsets[(Job->Source[i].Key >> Job->Shift) & 0xFF]++;
+		}
+	}
+}
+
+//stable lsd radix sort of the entries by key, 8 bits per pass
+void SortDrawQueue(struct DrawQueue* restrict Queue)
+{
+	if (Queue->Count < 2)
+		return;
+
+	struct RadixSortJob* Job = &Queue->Job;
+	Job->Source = Queue->Entries;
+	Job->Dest = Queue->Scratch;
+	Job->Count = Queue->Count;
+	Job->ChunkCount = Queue->Count >= RADIX_SORT_PARALLEL_THRESHOLD ? Queue->WorkerCount : 1;
+
+	for (UINT Shift = 0; Shift < 64; Shift += 8)
+	{
+		Job->Shift = Shift;
+		Job->bScatter = false;
+		RunRadixPhase(Queue);
+
+		//offsets run bucket-major then chunk-major, so every chunk scatters into its own range in order
+		UINT Total = 0;
+		bool bSingleBucket = false;
+
+		for (UINT Bucket = 0; Bucket < 256; Bucket++)
+		{
+			const UINT BucketStart = Total;
+
+			for (UINT Chunk = 0; Chunk < Job->ChunkCount; Chunk++)
+			{
+				const UINT Count = Job->Offsets[Chunk][Bucket];
+				Job->Offsets[Chunk][Bucket] = Total;
+				Total += Count;
+			}
+
+			if (Total - BucketStart == Job->Count)
+				bSingleBucket = true;
+		}
+
+		//every key shares this byte, the pass would be a plain copy
+		if (bSingleBucket)
+			continue;
+
+		Job->bScatter = true;
+		RunRadixPhase(Queue);
+
+		struct DrawSortEntry* Swap = Job->Source;
+		Job->Source = Job->Dest;
+		Job->Dest = Swap;
+	}
+
+	if (Job->Source != Queue->Entries)
+		memcpy(Queue->Entries, Job->Source, Queue->Count * sizeof(struct DrawSortEntry));
+}
+
+//binds every packet in full, the encoder drops whatever the previous draw already bound, returns the draw count
+UINT SubmitDrawQueue(const struct DrawQueue* restrict Queue, struct CommandEncoder* restrict Encoder)
+{
+	for (UINT i = 0; i < Queue->Count; i++)
+	{
+		const struct DrawPacket* Packet = &Queue->Packets[Queue->Entries[i].Index];
+
+		EncodeSetPipelineState(Encoder, Packet->PipelineState);
+		EncodeSetRootSignature(Encoder, Packet->RootSignature);
+		EncodeSetRootTable(Encoder, 1, Packet->DescriptorTable);
+		EncodeSetVertexBuffer(Encoder, Packet->VertexBuffer);
+		EncodeSetIndexBuffer(Encoder, Packet->IndexBuffer);
+		EncodeSetRootCbv(Encoder, 0, Packet->Constants);
+		EncodeDrawIndexed(Encoder, Packet->IndexCount, 1, 0, 0, 0);
+	}
+
+	return Queue->Count;
+}
+
+//a NULL CommandList is the null backend, the stream is only walked and counted
+void ReplayCommandStream(const struct CommandStream* restrict Stream, ID3D12GraphicsCommandList7* CommandList, UINT* restrict OpCounts)
+{
+	UINT Offset = 0;
+
+	while (Offset < Stream->Used)
+	{
+		const struct CommandPacketHeader* Header = (const struct CommandPacketHeader*)(Stream->Data + Offset);
+		const void* Payload = Header + 1;
+
+		assert(Header->Size >= sizeof(struct CommandPacketHeader) && Offset + Header->Size <= Stream->Used);
+		assert(Header->Op < COMMAND_OP_COUNT);
+
+		Offset += Header->Size;
+
+		if (OpCounts)
+			OpCounts[Header->Op]++;
+
+		if (CommandList == NULL)
+			continue;
+
+		switch (Header->Op)
+		{
+		case COMMAND_TEXTURE_BARRIER:
+		{
+			D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+			ResourceBarrier.Type = D3D12_BARRIER_TYPE_TEXTURE;
+			ResourceBarrier.NumBarriers = 1;
+			ResourceBarrier.pTextureBarriers = Payload;
+			ID3D12GraphicsCommandList7_Barrier(CommandList, 1, &ResourceBarrier);
+			break;
+		}
+		case COMMAND_SET_RENDER_TARGET:
+		{
+			const struct CommandRenderTarget* Targets = Payload;
+			ID3D12GraphicsCommandList7_OMSetRenderTargets(CommandList, Targets->Rtv.ptr ? 1 : 0, Targets->Rtv.ptr ? &Targets->Rtv : NULL, FALSE, Targets->Dsv.ptr ? &Targets->Dsv : NULL);
+			break;
+		}
+		case COMMAND_CLEAR_RENDER_TARGET:
+		{
+			const struct CommandClear* Clear = Payload;
+			ID3D12GraphicsCommandList7_ClearRenderTargetView(CommandList, Clear->View, Clear->Values, 0, NULL);
+			break;
+		}
+		case COMMAND_CLEAR_DEPTH:
+		{
+			const struct CommandClear* Clear = Payload;
+			ID3D12GraphicsCommandList7_ClearDepthStencilView(CommandList, Clear->View, D3D12_CLEAR_FLAG_DEPTH, Clear->Values[0], 0, 0, NULL);
+			break;
+		}
+		case COMMAND_SET_PIPELINE_STATE:
+			ID3D12GraphicsCommandList7_SetPipelineState(CommandList, *(ID3D12PipelineState* const*)Payload);
+			break;
+		case COMMAND_SET_ROOT_SIGNATURE:
+			ID3D12GraphicsCommandList7_SetGraphicsRootSignature(CommandList, *(ID3D12RootSignature* const*)Payload);
+			break;
+		case COMMAND_SET_DESCRIPTOR_HEAP:
+			ID3D12GraphicsCommandList7_SetDescriptorHeaps(CommandList, 1, (ID3D12DescriptorHeap* const*)Payload);
+			break;
+		case COMMAND_SET_ROOT_TABLE:
+		{
+			const struct CommandRootArgument* Argument = Payload;
+			ID3D12GraphicsCommandList7_SetGraphicsRootDescriptorTable(CommandList, Argument->Index, (D3D12_GPU_DESCRIPTOR_HANDLE) { .ptr = Argument->Value });
+			break;
+		}
+		case COMMAND_SET_VIEWPORT:
+			ID3D12GraphicsCommandList7_RSSetViewports(CommandList, 1, Payload);
+			break;
+		case COMMAND_SET_SCISSOR:
+			ID3D12GraphicsCommandList7_RSSetScissorRects(CommandList, 1, Payload);
+			break;
+		case COMMAND_SET_TOPOLOGY:
+			ID3D12GraphicsCommandList7_IASetPrimitiveTopology(CommandList, *(const D3D12_PRIMITIVE_TOPOLOGY*)Payload);
+			break;
+		case COMMAND_SET_VERTEX_BUFFER:
+			ID3D12GraphicsCommandList7_IASetVertexBuffers(CommandList, 0, 1, Payload);
+			break;
+		case COMMAND_SET_INDEX_BUFFER:
+			ID3D12GraphicsCommandList7_IASetIndexBuffer(CommandList, Payload);
+			break;
+		case COMMAND_SET_ROOT_CBV:
+		{
+			const struct CommandRootArgument* Argument = Payload;
+			ID3D12GraphicsCommandList7_SetGraphicsRootConstantBufferView(CommandList, Argument->Index, Argument->Value);
+			break;
+		}
+		case COMMAND_DRAW_INDEXED:
+		{
+			const struct CommandDraw* Draw = Payload;
+			ID3D12GraphicsCommandList7_DrawIndexedInstanced(CommandList, Draw->IndexCount, Draw->InstanceCount, Draw->StartIndex, Draw->BaseVertex, Draw->StartInstance);
+			break;
+		}
+		case COMMAND_BUFFER_BARRIER:
+		{
+			D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+			ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
+			ResourceBarrier.NumBarriers = 1;
+			ResourceBarrier.pBufferBarriers = Payload;
+			ID3D12GraphicsCommandList7_Barrier(CommandList, 1, &ResourceBarrier);
+			break;
+		}
+		case COMMAND_SET_COMPUTE_ROOT_SIGNATURE:
+			ID3D12GraphicsCommandList7_SetComputeRootSignature(CommandList, *(ID3D12RootSignature* const*)Payload);
+			break;
+		case COMMAND_SET_COMPUTE_ROOT_CONSTANTS:
+		{
+			const struct CommandRootConstants* RootConstants = Payload;
+			ID3D12GraphicsCommandList7_SetComputeRoot32BitConstants(CommandList, RootConstants->Index, RootConstants->Count, RootConstants->Values, 0);
+			break;
+		}
+		case COMMAND_SET_COMPUTE_ROOT_SRV:
+		{
+			const struct CommandRootArgument* Argument = Payload;
+			ID3D12GraphicsCommandList7_SetComputeRootShaderResourceView(CommandList, Argument->Index, Argument->Value);
+			break;
+		}
+		case COMMAND_SET_COMPUTE_ROOT_UAV:
+		{
+			const struct CommandRootArgument* Argument = Payload;
+			ID3D12GraphicsCommandList7_SetComputeRootUnorderedAccessView(CommandList, Argument->Index, Argument->Value);
+			break;
+		}
+		case COMMAND_DISPATCH:
+		{
+			const UINT* Groups = Payload;
+			ID3D12GraphicsCommandList7_Dispatch(CommandList, Groups[0], Groups[1], Groups[2]);
+			break;
+		}
+		case COMMAND_EXECUTE_INDIRECT:
+		{
+			const struct CommandExecuteIndirect* Indirect = Payload;
+			ID3D12GraphicsCommandList7_ExecuteIndirect(CommandList, Indirect->Signature, Indirect->MaxCommandCount, Indirect->ArgumentBuffer, 0, Indirect->CountBuffer, 0);
+			break;
+		}
+		case COMMAND_EXECUTE_BUNDLE:
+			//the bundle is referenced, not copied, so the trace is only valid while the cache keeps it
+			ID3D12GraphicsCommandList7_ExecuteBundle(CommandList, *(ID3D12GraphicsCommandList* const*)Payload);
+			break;
+		case COMMAND_SET_ROOT_CONSTANTS:
+		{
+			const struct CommandRootConstants* RootConstants = Payload;
+			ID3D12GraphicsCommandList7_SetGraphicsRoot32BitConstants(CommandList, RootConstants->Index, RootConstants->Count, RootConstants->Values, 0);
+			break;
+		}
+		case COMMAND_DRAW:
+		{
+			const UINT* Arguments = Payload;
+			ID3D12GraphicsCommandList7_DrawInstanced(CommandList, Arguments[0], Arguments[1], Arguments[2], Arguments[3]);
+			break;
+		}
+		}
+	}
+}
+
+void WriteCommandStream(const struct CommandStream* restrict Stream, LPCWSTR Path)
+{
+	HANDLE File = CreateFileW(Path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(File);
+
+	const struct CommandStreamFileHeader Header = {
+		.Magic = COMMAND_STREAM_MAGIC,
+		.Version = COMMAND_STREAM_VERSION,
+		.PacketCount = Stream->PacketCount,
+		.Size = Stream->Used
+	};
+
+	DWORD Written;
+	THROW_ON_FALSE(WriteFile(File, &Header, sizeof(Header), &Written, NULL));
+	THROW_ON_FALSE(WriteFile(File, Stream->Data, Stream->Used, &Written, NULL));
+	THROW_ON_FALSE(CloseHandle(File));
+}
+
+//Stream->Data must hold COMMAND_STREAM_CAPACITY bytes
+void LoadCommandStream(struct CommandStream* restrict Stream, LPCWSTR Path)
+{
+	HANDLE File = CreateFileW(Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(File);
+
+	struct CommandStreamFileHeader Header;
+	DWORD Read;
+	THROW_ON_FALSE(ReadFile(File, &Header, sizeof(Header), &Read, NULL));
+
+	if (Read != sizeof(Header) || Header.Magic != COMMAND_STREAM_MAGIC || Header.Version != COMMAND_STREAM_VERSION || Header.Size > COMMAND_STREAM_CAPACITY)
+		THROW_ON_FAIL(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+
+	THROW_ON_FALSE(ReadFile(File, Stream->Data, Header.Size, &Read, NULL));
+
+	if (Read != Header.Size)
+		THROW_ON_FAIL(HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+
+	THROW_ON_FALSE(CloseHandle(File));
+
+	//replay trusts every packet, so walk them all once here
+	UINT Offset = 0;
+	UINT PacketCount = 0;
+	while (Offset < Header.Size)
+	{
+		if (Header.Size - Offset < sizeof(struct CommandPacketHeader))
+			THROW_ON_FAIL(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+
+		const struct CommandPacketHeader* Packet = (const struct CommandPacketHeader*)(Stream->Data + Offset);
+
+		if (Packet->Size < sizeof(struct CommandPacketHeader) || Packet->Size % 8 != 0 || Packet->Size > Header.Size - Offset || Packet->Op >= COMMAND_OP_COUNT)
+			THROW_ON_FAIL(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+
+		Offset += Packet->Size;
+		PacketCount++;
+	}
+
+	if (PacketCount != Header.PacketCount)
+		THROW_ON_FAIL(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+
+	Stream->Used = Header.Size;
+	Stream->PacketCount = Header.PacketCount;
+	Stream->bOverflow = false;
+}
+
+//replays a trace from any build against the null backend, no device is created
+void RunReplayBenchmark(const struct BenchmarkOptions* restrict Options)
+{
+	struct CommandStream Stream = { 0 };
+	Stream.Data = VirtualAlloc(NULL, COMMAND_STREAM_CAPACITY, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Stream.Data);
+
+	LoadCommandStream(&Stream, Options->ReplayPath);
+
+	UINT OpCounts[COMMAND_OP_COUNT] = { 0 };
+	ReplayCommandStream(&Stream, NULL, OpCounts);
+
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < Options->FrameCount; i++)
+	{
+		ReplayCommandStream(&Stream, NULL, NULL);
+	}
+
+	QueryPerformanceCounter(&End);
+
+	char buffer[128];
+	int stringlength;
+
+	for (UINT i = 0; i < COMMAND_OP_COUNT; i++)
+	{
+		if (OpCounts[i] == 0)
+			continue;
+
+		stringlength = _snprintf_s(buffer, 128, _TRUNCATE, "%-20s %6u\n", CommandOpNames[i], OpCounts[i]);
+		WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+	}
+
+	double Nanoseconds = (double)(End.QuadPart - Start.QuadPart) * 1000000000.0 / Frequency.QuadPart;
+
+	stringlength = _snprintf_s(buffer, 128, _TRUNCATE, "replay: %u packets, %u bytes, %.1f ns per frame\n",
+		Stream.PacketCount, Stream.Used, Options->FrameCount ? Nanoseconds / Options->FrameCount : 0.0);
+	WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+
+	THROW_ON_FALSE(VirtualFree(Stream.Data, 0, MEM_RELEASE));
+}
+
+struct CpuZoneRing* CpuZoneRegisterThread(void)
+{
+	LONG Slot = ReadAcquire(&CpuZoneRingCount);
+
+	for (;;)
+	{
+		if (Slot >= CPU_ZONE_MAX_THREADS)
+		{
+			bCpuZoneThreadUnregistered = true;
+			return NULL;
+		}
+
+		const LONG Previous = InterlockedCompareExchange(&CpuZoneRingCount, Slot + 1, Slot);
+
+		if (Previous == Slot)
+			break;
+
+		Slot = Previous;
+	}
+
+	struct CpuZoneRing* Ring = VirtualAlloc(NULL, sizeof(struct CpuZoneRing), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Ring);
+
+	Ring->ThreadId = GetCurrentThreadId();
+	CpuZoneThreadRing = Ring;
+	WritePointerRelease((PVOID*)&CpuZoneRings[Slot], Ring);
+	return Ring;
+}
+
+void CpuZonesInit(void)
+{
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+	CpuZoneQpcBase = Now.QuadPart;
+	CpuZoneTscBase = __rdtsc();
+}
+
+//nanoseconds for one begin and end pair, recorded into a scratch ring so the real history is untouched
+double BenchmarkCpuZones(void)
+{
+	struct CpuZoneRing* Saved = CpuZoneThreadRing;
+
+	struct CpuZoneRing* Ring = VirtualAlloc(NULL, sizeof(struct CpuZoneRing), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Ring);
+	CpuZoneThreadRing = Ring;
+
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Start;
+	LARGE_INTEGER End;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Start);
+
+	for (UINT i = 0; i < CPU_ZONE_BENCH_ITERATIONS; i++)
+	{
+		CpuZoneRecord("Benchmark");
+		CpuZoneRecord(NULL);
+	}
+
+	QueryPerformanceCounter(&End);
+
+	CpuZoneThreadRing = Saved;
+	THROW_ON_FALSE(VirtualFree(Ring, 0, MEM_RELEASE));
+
+	return (double)(End.QuadPart - Start.QuadPart) * 1000000000.0 / Frequency.QuadPart / CPU_ZONE_BENCH_ITERATIONS;
+}
+
+//a write that does not fit leaves the buffer full and flags it, nothing past the end is touched
+inline void TraceWrite(struct TraceWriter* restrict Writer, const char* Format, ...)
+{
+	va_list Args;
+	va_start(Args, Format);
+	const int Length = _vsnprintf_s(Writer->Buffer + Writer->Used, sizeof(Writer->Buffer) - Writer->Used, _TRUNCATE, Format, Args);
+	va_end(Args);
+
+	if (Length < 0)
+	{
+		Writer->Used = sizeof(Writer->Buffer) - 1;
+		Writer->bOverflow = true;
+	}
+	else
+	{
+		Writer->Used += Length;
+	}
+}
+
+inline void TraceFlush(struct TraceWriter* restrict Writer)
+{
+	DWORD Written;
+	THROW_ON_FALSE(WriteFile(Writer->File, Writer->Buffer, Writer->Used, &Written, NULL));
+	Writer->Used = 0;
+
+	if (Writer->bOverflow)
+	{
+		WriteConsoleA(ConsoleHandle, "trace buffer overflowed, output is truncated\n", 45, NULL, NULL);
+		Writer->bOverflow = false;
+	}
+}
+
+void ExportCpuTrace(LPCWSTR Path)
+{
+	static struct TraceWriter Writer;
+	static struct CpuZoneEvent Snapshot[CPU_ZONE_RING_SIZE];
+
+	LARGE_INTEGER Frequency;
+	LARGE_INTEGER Now;
+	QueryPerformanceFrequency(&Frequency);
+	QueryPerformanceCounter(&Now);
+	UINT64 TscNow = __rdtsc();
+
+	//the tsc rate is measured against the performance counter over the whole run
+	double TscPerMicrosecond = (double)(TscNow - CpuZoneTscBase) * Frequency.QuadPart / ((double)(Now.QuadPart - CpuZoneQpcBase) * 1000000.0);
+
+	Writer.File = CreateFileW(Path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(Writer.File);
+	Writer.Used = 0;
+	TraceWrite(&Writer, "{\"traceEvents\":[");
+
+	bool bFirst = true;
+	LONG RingCount = ReadAcquire(&CpuZoneRingCount);
+
+	for (LONG r = 0; r < RingCount; r++)
+	{
+		struct CpuZoneRing* Ring = ReadPointerAcquire((PVOID*)&CpuZoneRings[r]);
+
+		if (Ring == NULL)
+			continue;
+
+		LONG64 Head = ReadAcquire64(&Ring->Head);
+		LONG64 Tail = max(Head - CPU_ZONE_RING_SIZE, 0);
+
+		for (LONG64 i = Tail; i < Head; i++)
+			Snapshot[i & (CPU_ZONE_RING_SIZE - 1)] = Ring->Events[i & (CPU_ZONE_RING_SIZE - 1)];
+
+		//the owner keeps recording while the copy is taken, any slot it may have reached since is dropped
+		MemoryBarrier();
+		Tail = max(Tail, ReadAcquire64(&Ring->Head) - CPU_ZONE_RING_SIZE + 1);
+		UINT Depth = 0;
+
+		for (LONG64 i = Tail; i < Head; i++)
+		{
+			const struct CpuZoneEvent* Event = &Snapshot[i & (CPU_ZONE_RING_SIZE - 1)];
+
+			//ends whose begin was overwritten by the ring wrapping are skipped
+			if (Event->Name == NULL && Depth == 0)
+				continue;
+
+			if (Event->Name)
+				Depth++;
+			else
+				Depth--;
+
+			if (sizeof(Writer.Buffer) - Writer.Used < 256)
+				TraceFlush(&Writer);
+
+			double Microseconds = (double)(INT64)(Event->Timestamp - CpuZoneTscBase) / TscPerMicrosecond;
+
+			if (Event->Name)
+			{
+				TraceWrite(&Writer,
+					"%s\n{\"name\":\"%s\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu}", bFirst ? "" : ",", Event->Name, Microseconds, Ring->ThreadId);
+			}
+			else
+			{
+				TraceWrite(&Writer,
+					"%s\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu}", bFirst ? "" : ",", Microseconds, Ring->ThreadId);
+			}
+
+			bFirst = false;
+		}
+	}
+
+	TraceWrite(&Writer, "\n]}\n");
+	TraceFlush(&Writer);
+	THROW_ON_FALSE(CloseHandle(Writer.File));
+}
+
+void GenerateScene(struct GeneratedScene* restrict Scene, enum SceneWorkload Workload, UINT ObjectCount)
+{
+	const SIZE_T ObjectBytes = 2 * sizeof(mat4) + sizeof(vec4) + sizeof(struct GpuObject) + sizeof(struct IndirectCommand) + sizeof(UINT) + 2 * sizeof(UINT16);
+
+	UINT8* Memory = VirtualAlloc(NULL, ObjectBytes * ObjectCount, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(Memory);
+	MemoryTrack(Memory, MEMORY_CPU, ObjectBytes * ObjectCount, "Generated Scene");
+
+	Scene->World = (mat4*)Memory;
+	Scene->Constants = Scene->World + ObjectCount;
+	Scene->Locals = (vec4*)(Scene->Constants + ObjectCount);
+	Scene->Objects = (struct GpuObject*)(Scene->Locals + ObjectCount);
+	Scene->Visible = (struct IndirectCommand*)(Scene->Objects + ObjectCount);
+	Scene->Parents = (UINT*)(Scene->Visible + ObjectCount);
+	Scene->Materials = (UINT16*)(Scene->Parents + ObjectCount);
+	Scene->Meshes = Scene->Materials + ObjectCount;
+
+	Scene->Workload = Workload;
+	Scene->ObjectCount = ObjectCount;
+	Scene->Extent = cbrtf((float)ObjectCount) * SCENE_SUITE_SPACING;
+
+	//the same seed for every workload, so the sizes differ only in what the workload changes
+	UINT64 Random = 0x9E3779B97F4A7C15;
+
+	for (UINT i = 0; i < ObjectCount; i++)
+	{
+		float Values[4];
+
+		for (UINT c = 0; c < 4; c++)
+		{
+			Values[c] = RandomFloat(&Random);
+		}
+
+		//children stay close to their parent, everything else is spread over the whole volume
+		const bool bChild = Workload == SCENE_WORKLOAD_HIERARCHY && i >= SCENE_SUITE_ROOTS;
+		const float Spread = bChild ? SCENE_SUITE_SPACING * 2.0f : Scene->Extent;
+
+		Scene->Locals[i][0] = (Values[0] - 0.5f) * Spread;
+		Scene->Locals[i][1] = (Values[1] - 0.5f) * Spread;
+		Scene->Locals[i][2] = (Values[2] - 0.5f) * Spread;
+		Scene->Locals[i][3] = (Values[3] - 0.5f) * 0.1f;
+
+		Scene->Parents[i] = bChild ? (UINT)(Random % i) : UINT_MAX;
+		Scene->Materials[i] = Workload == SCENE_WORKLOAD_CUBES ? 0 : (UINT16)((Random >> 8) % SCENE_SUITE_MATERIALS);
+		Scene->Meshes[i] = Workload == SCENE_WORKLOAD_CUBES ? 0 : (UINT16)((Random >> 24) % SCENE_SUITE_MESHES);
+	}
+}
+
+void FreeGeneratedScene(struct GeneratedScene* restrict Scene)
+{
+	MemoryUntrack(Scene->World);
+	THROW_ON_FALSE(VirtualFree(Scene->World, 0, MEM_RELEASE));
+	*Scene = (struct GeneratedScene){ 0 };
+}
+
+//a quarter orbit around the middle of the volume over the whole run, the same for every run
+void SceneCameraPath(const struct GeneratedScene* restrict Scene, UINT Frame, mat4 ViewMat, mat4 ProjMat)
+{
+	const float Angle = (float)Frame / (SCENE_SUITE_WARMUP_FRAMES + SCENE_SUITE_FRAMES) * GLM_PI_2f;
+	const float Radius = Scene->Extent * 0.75f;
+
+	vec3 Position = { cosf(Angle) * Radius, Scene->Extent * 0.25f, sinf(Angle) * Radius };
+	glm_lookat_lh(Position, (vec3) { 0.0f, 0.0f, 0.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, ViewMat);
+	glm_perspective_lh_zo(45.0f * (3.14f / 180.0f), 16.0f / 9.0f, 0.1f, Scene->Extent * 2.0f, ProjMat);
+}
+
+//the constants stand in for the upload heap, each object's address is SCENE_SUITE_CONSTANTS_BASE plus its slot
+void UpdateGeneratedScene(struct GeneratedScene* restrict Scene, UINT Frame, const mat4 ViewProjMat)
+{
+	for (UINT i = 0; i < Scene->ObjectCount; i++)
+	{
+		mat4 LocalMat;
+		glm_translate_make(LocalMat, Scene->Locals[i]);
+		glm_rotate_y(LocalMat, Scene->Locals[i][3] * Frame, LocalMat);
+
+		if (Scene->Parents[i] == UINT_MAX)
+			glm_mat4_copy(LocalMat, Scene->World[i]);
+		else
+			glm_mat4_mul(Scene->World[Scene->Parents[i]], LocalMat, Scene->World[i]);
+
+		mat4 WvpMat;
+		glm_mat4_mul(ViewProjMat, Scene->World[i], WvpMat);
+		glm_mat4_transpose_to(WvpMat, Scene->Constants[i]);
+
+		SetGpuObject(&Scene->Objects[i], Scene->World[i], CUBE_BOUNDING_RADIUS, SCENE_SUITE_CONSTANTS_BASE + i * ConstantBufferPerObjectAlignedSize);
+	}
+}
+
+//update, cull, sort and record through the renderer's own paths, recording to the null backend in place of a device
+void RunSceneBenchmark(struct GeneratedScene* restrict Scene, struct DrawQueue* restrict Queue, struct SceneResult* restrict Result)
+{
+	//the null backend only compares bindings, so the addresses and handles never have to be real
+	static D3D12_VERTEX_BUFFER_VIEW VertexBuffers[SCENE_SUITE_MESHES];
+	static D3D12_INDEX_BUFFER_VIEW IndexBuffers[SCENE_SUITE_MESHES];
+	static float StageTimes[SCENE_STAGE_COUNT][SCENE_SUITE_FRAMES];
+
+	for (UINT i = 0; i < SCENE_SUITE_MESHES; i++)
+	{
+		VertexBuffers[i].BufferLocation = SCENE_SUITE_CONSTANTS_BASE - (i + 1) * 65536;
+		VertexBuffers[i].SizeInBytes = sizeof(VertexList);
+		VertexBuffers[i].StrideInBytes = sizeof(struct Vertex);
+
+		IndexBuffers[i].BufferLocation = VertexBuffers[i].BufferLocation + sizeof(VertexList);
+		IndexBuffers[i].SizeInBytes = sizeof(IndexList);
+		IndexBuffers[i].Format = DXGI_FORMAT_R16_UINT;
+	}
+
+	struct EncoderStats Stats = { 0 };
+	UINT64 VisibleSum = 0;
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	for (UINT Frame = 0; Frame < SCENE_SUITE_WARMUP_FRAMES + SCENE_SUITE_FRAMES; Frame++)
+	{
+		LARGE_INTEGER Stamps[SCENE_STAGE_COUNT + 1];
+
+		mat4 ViewMat;
+		mat4 ProjMat;
+		mat4 ViewProjMat;
+		SceneCameraPath(Scene, Frame, ViewMat, ProjMat);
+		glm_mat4_mul(ProjMat, ViewMat, ViewProjMat);
+
+		QueryPerformanceCounter(&Stamps[SCENE_STAGE_UPDATE]);
+
+		UpdateGeneratedScene(Scene, Frame, ViewProjMat);
+
+		QueryPerformanceCounter(&Stamps[SCENE_STAGE_CULL]);
+
+		struct CullConstants CullConstants = { 0 };
+		CullConstants.ObjectCount = Scene->ObjectCount;
+		glm_frustum_planes(ViewProjMat, CullConstants.Planes);
+		const UINT VisibleCount = CullObjectsReference(Scene->Objects, &CullConstants, Scene->Visible);
+
+		QueryPerformanceCounter(&Stamps[SCENE_STAGE_SORT]);
+
+		Queue->Count = 0;
+
+		for (UINT i = 0; i < VisibleCount; i++)
+		{
+			const struct IndirectCommand* Command = &Scene->Visible[i];
+			const D3D12_GPU_VIRTUAL_ADDRESS Constants = (UINT64)Command->ConstantsHigh << 32 | Command->ConstantsLow;
+			const UINT Object = (UINT)((Constants - SCENE_SUITE_CONSTANTS_BASE) / ConstantBufferPerObjectAlignedSize);
+			const UINT Material = Scene->Materials[Object];
+			const UINT Pipeline = Material % SCENE_SUITE_PIPELINES;
+			const UINT Mesh = Scene->Meshes[Object];
+
+			struct DrawPacket Packet;
+			Packet.PipelineState = (ID3D12PipelineState*)(UINT_PTR)(Pipeline + 1);
+			Packet.RootSignature = (ID3D12RootSignature*)(UINT_PTR)1;
+			Packet.DescriptorTable.ptr = (Material + 1) * 32;
+			Packet.VertexBuffer = &VertexBuffers[Mesh];
+			Packet.IndexBuffer = &IndexBuffers[Mesh];
+			Packet.Constants = Constants;
+			Packet.IndexCount = Command->IndexCountPerInstance;
+
+			const float* Sphere = Scene->Objects[Object].Sphere;
+			const float Depth = ViewMat[0][2] * Sphere[0] + ViewMat[1][2] * Sphere[1] + ViewMat[2][2] * Sphere[2] + ViewMat[3][2];
+			PushDrawPacket(Queue, MakeDrawKey(0, Pipeline, 0, Material, Mesh, Depth), &Packet);
+		}
+
+		SortDrawQueue(Queue);
+
+		QueryPerformanceCounter(&Stamps[SCENE_STAGE_RECORD]);
+
+		struct CommandEncoder Encoder;
+		InitCommandEncoder(&Encoder, NULL, NULL, NULL, &Stats);
+		SubmitDrawQueue(Queue, &Encoder);
+
+		QueryPerformanceCounter(&Stamps[SCENE_STAGE_COUNT]);
+
+		if (Frame < SCENE_SUITE_WARMUP_FRAMES)
+		{
+			Stats = (struct EncoderStats){ 0 };
+			continue;
+		}
+
+		for (UINT Stage = 0; Stage < SCENE_STAGE_COUNT; Stage++)
+		{
+			StageTimes[Stage][Frame - SCENE_SUITE_WARMUP_FRAMES] = (float)((double)(Stamps[Stage + 1].QuadPart - Stamps[Stage].QuadPart) * 1000.0 / Frequency.QuadPart);
+		}
+
+		VisibleSum += VisibleCount;
+	}
+
+	for (UINT Stage = 0; Stage < SCENE_STAGE_COUNT; Stage++)
+	{
+		struct TimeSummary Summary;
+		SummarizeTimes(StageTimes[Stage], SCENE_SUITE_FRAMES, &Summary);
+		Result->StageMs[Stage] = Summary.P50;
+	}
+
+	UINT64 StateChanges = 0;
+
+	for (UINT i = 0; i < COMMAND_OP_COUNT; i++)
+	{
+		if (i != COMMAND_DRAW_INDEXED)
+			StateChanges += Stats.Issued[i];
+	}
+
+	Result->ObjectCount = Scene->ObjectCount;
+	Result->Visible = (UINT)(VisibleSum / SCENE_SUITE_FRAMES);
+	Result->StateChanges = StateChanges / SCENE_SUITE_FRAMES;
+}
+
+//reads one scene's stage times back out of a results file this suite wrote, which keeps every scene on one line
+bool ReadSceneBaseline(const char* Baseline, const char* Name, float* restrict StageMs)
+{
+	char Pattern[64];
+	_snprintf_s(Pattern, sizeof(Pattern), _TRUNCATE, "\"name\": \"%s\"", Name);
+
+	const char* Line = strstr(Baseline, Pattern);
+
+	if (Line == NULL)
+		return false;
+
+	const char* LineEnd = strchr(Line, '\n');
+
+	if (LineEnd == NULL)
+		LineEnd = Line + strlen(Line);
+
+	for (UINT Stage = 0; Stage < SCENE_STAGE_COUNT; Stage++)
+	{
+		char Key[32];
+		const int KeyLength = _snprintf_s(Key, sizeof(Key), _TRUNCATE, "\"%s_ms\": ", SceneStageNames[Stage]);
+
+		const char* Value = strstr(Line, Key);
+
+		if (Value == NULL || Value > LineEnd)
+			return false;
+
+		StageMs[Stage] = strtof(Value + KeyLength, NULL);
+	}
+
+	return true;
+}
+
+//returns the number of stages slower than their baseline by more than the tolerance
+UINT RunSceneSuite(const struct BenchmarkOptions* restrict Options)
+{
+	static struct SceneResult Results[SCENE_WORKLOAD_COUNT * ARRAYSIZE(SceneSuiteSizes)];
+	static struct TraceWriter Writer;
+
+	char* Baseline = NULL;
+
+	if (Options->SceneBaselinePath[0])
+	{
+		HANDLE File = CreateFileW(Options->SceneBaselinePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			WriteConsoleA(ConsoleHandle, "scene baseline not found, nothing will be compared\n", 51, NULL, NULL);
+		}
+		else
+		{
+			LARGE_INTEGER FileSize;
+			THROW_ON_FALSE(GetFileSizeEx(File, &FileSize));
+
+			//VirtualAlloc zeroes the pages, so the text comes back null terminated
+			Baseline = VirtualAlloc(NULL, FileSize.QuadPart + 1, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			VALIDATE_HANDLE(Baseline);
+
+			DWORD Read;
+			THROW_ON_FALSE(ReadFile(File, Baseline, (DWORD)FileSize.QuadPart, &Read, NULL));
+			THROW_ON_FALSE(CloseHandle(File));
+		}
+	}
+
+	UINT QueueCapacity = 0;
+
+	for (UINT i = 0; i < ARRAYSIZE(SceneSuiteSizes); i++)
+	{
+		if (SceneSuiteSizes[i] <= Options->SceneMaxObjects)
+			QueueCapacity = max(QueueCapacity, SceneSuiteSizes[i]);
+	}
+
+	struct DrawQueue Queue = { 0 };
+	InitDrawQueue(&Queue, max(QueueCapacity, 1));
+
+	char buffer[256];
+	int stringlength = _snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "%-20s %8s %8s %10s %10s %10s %10s\n", "scene", "objects", "visible", "update ms", "cull ms", "sort ms", "record ms");
+	WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+
+	UINT ResultCount = 0;
+	UINT Regressions = 0;
+
+	for (UINT Workload = 0; Workload < SCENE_WORKLOAD_COUNT; Workload++)
+	{
+		for (UINT i = 0; i < ARRAYSIZE(SceneSuiteSizes); i++)
+		{
+			if (SceneSuiteSizes[i] > Options->SceneMaxObjects)
+				continue;
+
+			struct SceneResult* Result = &Results[ResultCount++];
+			_snprintf_s(Result->Name, sizeof(Result->Name), _TRUNCATE, "%s_%u", SceneWorkloadNames[Workload], SceneSuiteSizes[i]);
+
+			struct GeneratedScene Scene = { 0 };
+			GenerateScene(&Scene, (enum SceneWorkload)Workload, SceneSuiteSizes[i]);
+			RunSceneBenchmark(&Scene, &Queue, Result);
+			FreeGeneratedScene(&Scene);
+
+			//tiny stages are mostly timer noise, so they also have to slow down by a fixed amount to count
+			Result->bBaseline = Baseline && ReadSceneBaseline(Baseline, Result->Name, Result->BaselineMs);
+
+			for (UINT Stage = 0; Stage < SCENE_STAGE_COUNT && Result->bBaseline; Stage++)
+			{
+				Result->bRegressed[Stage] = Result->StageMs[Stage] > Result->BaselineMs[Stage] * (1.0f + Options->SceneTolerance) &&
+					Result->StageMs[Stage] - Result->BaselineMs[Stage] > SCENE_BASELINE_NOISE_MS;
+
+				Regressions += Result->bRegressed[Stage];
+			}
+
+			stringlength = _snprintf_s(buffer, sizeof(buffer), _TRUNCATE, "%-20s %8u %8u %9.3f%c %9.3f%c %9.3f%c %9.3f%c\n", Result->Name, Result->ObjectCount, Result->Visible,
+				Result->StageMs[SCENE_STAGE_UPDATE], Result->bRegressed[SCENE_STAGE_UPDATE] ? '!' : ' ',
+				Result->StageMs[SCENE_STAGE_CULL], Result->bRegressed[SCENE_STAGE_CULL] ? '!' : ' ',
+				Result->StageMs[SCENE_STAGE_SORT], Result->bRegressed[SCENE_STAGE_SORT] ? '!' : ' ',
+				Result->StageMs[SCENE_STAGE_RECORD], Result->bRegressed[SCENE_STAGE_RECORD] ? '!' : ' ');
+			WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+		}
+	}
+
+	FreeDrawQueue(&Queue);
+
+	if (Baseline)
+		THROW_ON_FALSE(VirtualFree(Baseline, 0, MEM_RELEASE));
+
+	Writer.File = CreateFileW(Options->SceneSuitePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(Writer.File);
+	Writer.Used = 0;
+	TraceWrite(&Writer, "{\n\t\"frames\": %u,\n\t\"tolerance\": %.3f,\n\t\"scenes\": [", SCENE_SUITE_FRAMES, Options->SceneTolerance);
+
+	for (UINT i = 0; i < ResultCount; i++)
+	{
+		const struct SceneResult* Result = &Results[i];
+
+		TraceWrite(&Writer,
+			"%s\n\t\t{ \"name\": \"%s\", \"objects\": %u, \"visible\": %u, \"state_changes\": %llu",
+			i == 0 ? "" : ",", Result->Name, Result->ObjectCount, Result->Visible, Result->StateChanges);
+
+		for (UINT Stage = 0; Stage < SCENE_STAGE_COUNT; Stage++)
+		{
+			TraceWrite(&Writer,
+				", \"%s_ms\": %.4f", SceneStageNames[Stage], Result->StageMs[Stage]);
+
+			if (Result->bBaseline)
+			{
+				TraceWrite(&Writer,
+					", \"%s_baseline\": %.4f, \"%s_regressed\": %s", SceneStageNames[Stage], Result->BaselineMs[Stage], SceneStageNames[Stage], Result->bRegressed[Stage] ? "true" : "false");
+			}
+		}
+
+		TraceWrite(&Writer, " }");
+	}
+
+	TraceWrite(&Writer, "\n\t],\n\t\"regressions\": %u\n}\n", Regressions);
+	TraceFlush(&Writer);
+	THROW_ON_FALSE(CloseHandle(Writer.File));
+
+	return Regressions;
+}
+
+void ParseBenchmarkOptions(struct BenchmarkOptions* restrict Options, int ArgCount, LPWSTR* Args)
+{
+	Options->Width = 800;
+	Options->Height = 600;
+	Options->LightCount = CLUSTER_DEFAULT_LIGHTS;
+	MEMCPY_VERIFY(wcscpy_s(Options->ReportPath, MAX_PATH, L"benchmark.json"));
+
+	for (int i = 1; i < ArgCount; i++)
+	{
+		const bool bHasValue = i + 1 < ArgCount;
+
+		if (wcscmp(Args[i], L"--headless") == 0)
+			Options->bHeadless = true;
+		else if (wcscmp(Args[i], L"--warp") == 0)
+			Options->bWarp = true;
+		else if (wcscmp(Args[i], L"--gpu-culling") == 0)
+			Options->bGpuCulling = true;
+		else if (wcscmp(Args[i], L"--bundles") == 0)
+			Options->bBundles = true;
+		else if (wcscmp(Args[i], L"--occlusion") == 0)
+			Options->bOcclusion = true;
+		else if (wcscmp(Args[i], L"--particles") == 0)
+			Options->bParticles = true;
+		else if (wcscmp(Args[i], L"--lights") == 0)
+			Options->bLights = true;
+		else if (wcscmp(Args[i], L"--light-count") == 0 && bHasValue)
+			Options->LightCount = wcstoul(Args[++i], NULL, 10);
+		else if (wcscmp(Args[i], L"--shadows") == 0)
+			Options->bShadows = true;
+		else if (wcscmp(Args[i], L"--record") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->RecordPath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--dynamic-resolution") == 0)
+			Options->bDynamicResolution = true;
+		else if (wcscmp(Args[i], L"--frame-budget") == 0 && bHasValue)
+			Options->FrameBudgetMs = (float)wcstod(Args[++i], NULL);
+		else if (wcscmp(Args[i], L"--residency-budget") == 0 && bHasValue)
+			Options->ResidencyBudgetMB = wcstoul(Args[++i], NULL, 10);
+		else if (wcscmp(Args[i], L"--frames") == 0 && bHasValue)
+			Options->FrameCount = wcstoul(Args[++i], NULL, 10);
+		else if (wcscmp(Args[i], L"--seconds") == 0 && bHasValue)
+			Options->Seconds = wcstod(Args[++i], NULL);
+		else if (wcscmp(Args[i], L"--width") == 0 && bHasValue)
+			Options->Width = wcstoul(Args[++i], NULL, 10);
+		else if (wcscmp(Args[i], L"--height") == 0 && bHasValue)
+			Options->Height = wcstoul(Args[++i], NULL, 10);
+		else if (wcscmp(Args[i], L"--report") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->ReportPath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--capture") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->CapturePath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--replay") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->ReplayPath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--memory-report") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->MemoryReportPath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--texture") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->TexturePath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--scene-suite") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->SceneSuitePath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--scene-baseline") == 0 && bHasValue)
+			MEMCPY_VERIFY(wcscpy_s(Options->SceneBaselinePath, MAX_PATH, Args[++i]));
+		else if (wcscmp(Args[i], L"--scene-tolerance") == 0 && bHasValue)
+			Options->SceneTolerance = (float)wcstod(Args[++i], NULL) / 100.0f;
+		else if (wcscmp(Args[i], L"--scene-max-objects") == 0 && bHasValue)
+			Options->SceneMaxObjects = wcstoul(Args[++i], NULL, 10);
+		else if (wcscmp(Args[i], L"--arena-guard") == 0)
+			Options->bArenaGuard = true;
+		else
+		{
+			WriteConsoleA(ConsoleHandle, "ignoring argument: ", 19, NULL, NULL);
+			WriteConsoleW(ConsoleHandle, Args[i], (DWORD)wcslen(Args[i]), NULL, NULL);
+			WriteConsoleA(ConsoleHandle, "\n", 1, NULL, NULL);
+		}
+	}
+
+	Options->Width = max(Options->Width, 1);
+	Options->Height = max(Options->Height, 1);
+
+	if (!(Options->FrameBudgetMs > 0.0f))
+		Options->FrameBudgetMs = RESOLUTION_DEFAULT_BUDGET_MS;
+
+	//the tolerance is given as a percentage
+	if (!(Options->SceneTolerance > 0.0f))
+		Options->SceneTolerance = SCENE_DEFAULT_TOLERANCE;
+
+	if (Options->SceneMaxObjects == 0)
+		Options->SceneMaxObjects = UINT_MAX;
+
+	//a time limit alone runs until the deadline, bounded only by the sample storage
+	if (Options->FrameCount == 0 && Options->ReplayPath[0])
+		Options->FrameCount = REPLAY_ITERATIONS;
+
+	if (Options->FrameCount == 0)
+		Options->FrameCount = Options->Seconds > 0.0 ? BENCHMARK_MAX_FRAMES : BENCHMARK_DEFAULT_FRAMES;
+
+	Options->FrameCount = min(Options->FrameCount, BENCHMARK_MAX_FRAMES);
+}
+
+void CreateOffscreenTargets(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height)
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE RtvHandle = DxObjects->RtvHeapHandle;
+
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
+		HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		ResourceDesc.Alignment = 0;
+		ResourceDesc.Width = Width;
+		ResourceDesc.Height = Height;
+		ResourceDesc.DepthOrArraySize = 1;
+		ResourceDesc.MipLevels = 1;
+		ResourceDesc.Format = RTV_FORMAT;
+		ResourceDesc.SampleDesc.Count = 1;
+		ResourceDesc.SampleDesc.Quality = 0;
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+		D3D12_CLEAR_VALUE ClearValue = { 0 };
+		ClearValue.Format = RTV_FORMAT;
+		ClearValue.Color[0] = 0.0f;
+		ClearValue.Color[1] = 0.2f;
+		ClearValue.Color[2] = 0.4f;
+		ClearValue.Color[3] = 1.0f;
+
+		//created in the layout a swap chain buffer starts in, so the frame's barriers are shared
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_PRESENT, &ClearValue, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects->RenderTargets[i]));
+		MemoryTrackResource(DxObjects->RenderTargets[i], MEMORY_RENDER_TARGET, &ResourceDesc, "Offscreen Render Target");
+
+#ifdef _DEBUG
+		THROW_ON_FAIL(ID3D12Resource_SetName(DxObjects->RenderTargets[i], L"Offscreen Render Target"));
+#endif
+
+		ID3D12Device10_CreateRenderTargetView(Device, DxObjects->RenderTargets[i], NULL, RtvHandle);
+		RtvHandle.ptr += DxObjects->RtvDescriptorSize;
+	}
+
+	AcquireDepthBuffer(DxObjects, SyncObjects, Width, Height);
+	CreateSceneColor(DxObjects, SyncObjects, Width, Height);
+}
+
+//sorts Times in place
+void SummarizeTimes(float* restrict Times, UINT Count, struct TimeSummary* restrict Summary)
+{
+	*Summary = (struct TimeSummary){ 0 };
+
+	if (Count == 0)
+		return;
+
+	double Sum = 0.0;
+
+	for (UINT i = 0; i < Count; i++)
+	{
+		Sum += Times[i];
+	}
+
+	qsort(Times, Count, sizeof(float), CompareFloat);
+
+	Summary->Min = Times[0];
+	Summary->Avg = (float)(Sum / Count);
+	Summary->P50 = Times[(Count * 50 + 99) / 100 - 1];
+	Summary->P90 = Times[(Count * 90 + 99) / 100 - 1];
+	Summary->P99 = Times[(Count * 99 + 99) / 100 - 1];
+	Summary->Max = Times[Count - 1];
+}
+
+inline void TraceWriteSummary(struct TraceWriter* restrict Writer, const char* Name, const struct TimeSummary* restrict Summary)
+{
+	TraceWrite(Writer,
+		"\t\"%s\": { \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+		Name, Summary->Min, Summary->Avg, Summary->P50, Summary->P90, Summary->P99, Summary->Max);
+}
+
+//sorts DRAW_SORT_BENCH_PACKETS random keys, returns the average milliseconds per sort
+double BenchmarkDrawSort(UINT* restrict WorkerCount, bool* restrict bSorted)
+{
+	struct DrawQueue Queue = { 0 };
+	InitDrawQueue(&Queue, DRAW_SORT_BENCH_PACKETS);
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	INT64 Elapsed = 0;
+	UINT64 Random = 0x9E3779B97F4A7C15;
+	*bSorted = true;
+
+	for (UINT Iteration = 0; Iteration < DRAW_SORT_BENCH_ITERATIONS; Iteration++)
+	{
+		for (UINT i = 0; i < DRAW_SORT_BENCH_PACKETS; i++)
+		{
+			Queue.Entries[i].Key = RandomNext(&Random);
+			Queue.Entries[i].Index = i;
+		}
+
+		Queue.Count = DRAW_SORT_BENCH_PACKETS;
+
+		LARGE_INTEGER Start;
+		LARGE_INTEGER End;
+		QueryPerformanceCounter(&Start);
+		SortDrawQueue(&Queue);
+		QueryPerformanceCounter(&End);
+		Elapsed += End.QuadPart - Start.QuadPart;
+
+		for (UINT i = 1; i < Queue.Count; i++)
+		{
+			if (Queue.Entries[i - 1].Key > Queue.Entries[i].Key)
+				*bSorted = false;
+		}
+	}
+
+	*WorkerCount = Queue.WorkerCount;
+	FreeDrawQueue(&Queue);
+
+	return (double)Elapsed * 1000.0 / Frequency.QuadPart / DRAW_SORT_BENCH_ITERATIONS;
+}
+
+void RunHeadlessBenchmark(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, const struct BenchmarkOptions* restrict Options)
+{
+	CreateOffscreenTargets(DxObjects, SyncObjects, Options->Width, Options->Height);
+
+	D3D12_VIEWPORT Viewport = { 0 };
+	Viewport.Width = (float)Options->Width;
+	Viewport.Height = (float)Options->Height;
+	Viewport.MinDepth = 0.0f;
+	Viewport.MaxDepth = 1.0f;
+
+	D3D12_RECT ScissorRect = { 0 };
+	ScissorRect.right = Options->Width;
+	ScissorRect.bottom = Options->Height;
+
+	struct Scene Scene = { 0 };
+	ResetScene(&Scene, Options->Width, Options->Height);
+
+	//a fixed step makes every run render the same sequence of frames regardless of speed
+	const float MovementFactor = 75.0f / PACING_FIXED_RATE_HZ;
+
+	float* FrameTimes = VirtualAlloc(NULL, Options->FrameCount * sizeof(float) * 2, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	VALIDATE_HANDLE(FrameTimes);
+	float* CpuTimes = FrameTimes + Options->FrameCount;
+
+	LARGE_INTEGER Frequency;
+	QueryPerformanceFrequency(&Frequency);
+
+	UINT SampleCount = 0;
+	UINT64 Submissions = 0;
+	UINT64 Draws = 0;
+	INT64 MeasureStart = 0;
+	INT64 Deadline = INT64_MAX;
+	INT64 PreviousFrameStart = 0;
+
+	struct MemorySnapshot MemoryBefore = { 0 };
+
+	double ScaleSum = 0.0;
+	float ScaleMin = RESOLUTION_MAX_SCALE;
+	UINT ScaleChanges = 0;
+
+	//a measured frame's interval is taken at the start of the next one, so both arrays stay in step
+	for (UINT Frame = 0; ; Frame++)
+	{
+		LARGE_INTEGER FrameStart;
+		QueryPerformanceCounter(&FrameStart);
+
+		if (Frame == BENCHMARK_WARMUP_FRAMES)
+		{
+			//warmup frames pay for pipeline and residency setup, keep them out of the results
+			DxObjects->Profiler.StatsCount = 0;
+			DxObjects->EncoderStats = (struct EncoderStats){ 0 };
+			DxObjects->Bundles.Hits = 0;
+			DxObjects->Bundles.Rebuilds = 0;
+			DxObjects->Occlusion.Tested = 0;
+			DxObjects->Occlusion.Culled = 0;
+			DxObjects->Particles.Spawned = 0;
+			DxObjects->Particles.Dropped = 0;
+			DxObjects->Lighting.Grid.Dropped = 0;
+			DxObjects->Shadows.StaticRenders = 0;
+			DxObjects->Shadows.CacheHits = 0;
+			DxObjects->Shadows.CasterDraws = 0;
+			DxObjects->Shadows.CulledCasters = 0;
+			ScaleChanges = 0;
+			DxObjects->Residency.Evictions = 0;
+			DxObjects->Residency.MakeResidents = 0;
+			DxObjects->Residency.OvercommittedFrames = 0;
+			DxObjects->Residency.QueueWaits = 0;
+			MemoryTakeSnapshot(&MemoryBefore);
+			SyncObjects->RetireQueue.Released = 0;
+			SyncObjects->RetireQueue.OverflowWaits = 0;
+			SyncObjects->RetireQueue.PeakPendingBytes = SyncObjects->RetireQueue.PendingBytes;
+			memset(MemoryLedger.PeakFrameChurn, 0, sizeof(MemoryLedger.PeakFrameChurn));
+			MeasureStart = FrameStart.QuadPart;
+
+			if (Options->Seconds > 0.0)
+				Deadline = MeasureStart + (INT64)(Options->Seconds * Frequency.QuadPart);
+		}
+		else if (Frame > BENCHMARK_WARMUP_FRAMES)
+		{
+			FrameTimes[SampleCount++] = (float)((FrameStart.QuadPart - PreviousFrameStart) * 1000.0 / Frequency.QuadPart);
+		}
+
+		if (SampleCount == Options->FrameCount || FrameStart.QuadPart >= Deadline)
+			break;
+
+		PreviousFrameStart = FrameStart.QuadPart;
+
+		SyncObjects->FrameIndex = Frame % BUFFER_COUNT;
+
+		CPU_ZONE_BEGIN("Fence Wait");
+		WaitForFenceValue(SyncObjects->Fence[SyncObjects->FrameIndex], SyncObjects->FenceValue[SyncObjects->FrameIndex], SyncObjects->FenceEvent);
+		CPU_ZONE_END();
+
+		ResetFrameArena(&DxObjects->FrameArenas[SyncObjects->FrameIndex]);
+		ReleaseRetiredObjects(&SyncObjects->RetireQueue, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+
+		if (GpuProfilerCollect(&DxObjects->Profiler, SyncObjects->FrameIndex, DxObjects->CommandQueue) && DxObjects->Resolution.bEnabled)
+		{
+			const float PreviousScale = DxObjects->Resolution.Scale;
+			UpdateResolutionScale(&DxObjects->Resolution, (float)((DxObjects->Profiler.LastFrameCpuEnd - DxObjects->Profiler.LastFrameCpuBegin) * 1000.0 / Frequency.QuadPart));
+
+			if (DxObjects->Resolution.Scale != PreviousScale)
+				ScaleChanges++;
+		}
+
+		if (Frame >= BENCHMARK_WARMUP_FRAMES)
+		{
+			ScaleSum += DxObjects->Resolution.Scale;
+			ScaleMin = min(ScaleMin, DxObjects->Resolution.Scale);
+		}
+
+		LARGE_INTEGER WorkStart;
+		QueryPerformanceCounter(&WorkStart);
+
+		UpdateScene(&Scene, MovementFactor, DxObjects->ConstantBufferCPUAddress[SyncObjects->FrameIndex]);
+
+		if (DxObjects->Particles.bEnabled)
+		{
+			CPU_ZONE_BEGIN("Particles");
+			EmitParticles(&DxObjects->Particles, 1.0f / PACING_FIXED_RATE_HZ);
+			DxObjects->Particles.InstanceCounts[SyncObjects->FrameIndex] = SimulateParticles(&DxObjects->Particles, 1.0f / PACING_FIXED_RATE_HZ, DxObjects->Particles.InstanceData[SyncObjects->FrameIndex]);
+			CPU_ZONE_END();
+		}
+
+		if (DxObjects->Lighting.bEnabled)
+		{
+			CPU_ZONE_BEGIN("Light Binning");
+			UpdateClusteredLights(&DxObjects->Lighting, &Scene, 1.0f / PACING_FIXED_RATE_HZ, SyncObjects->FrameIndex);
+			CPU_ZONE_END();
+		}
+
+		if (DxObjects->Shadows.bEnabled)
+		{
+			CPU_ZONE_BEGIN("Shadow Cascades");
+			UpdateShadows(&DxObjects->Shadows, &Scene, SyncObjects->FrameIndex);
+			CPU_ZONE_END();
+		}
+
+		CPU_ZONE_BEGIN("Frame Recorder");
+		CollectFrameRecordings(&DxObjects->Recorder, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+		BeginFrameRecording(&DxObjects->Recorder, DxObjects->RenderTargets[SyncObjects->FrameIndex], SyncObjects->SubmitFenceValue + 1);
+		CPU_ZONE_END();
+
+		CPU_ZONE_BEGIN("Command Recording");
+		UINT FrameDraws = RecordFrame(DxObjects, &Scene, SyncObjects->FrameIndex, &Viewport, &ScissorRect, NULL);
+		FlushResidency(&DxObjects->Residency, DxObjects->Adapter, DxObjects->CommandQueue, SyncObjects->SubmitFenceValue + 1, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+		CPU_ZONE_END();
+
+		CPU_ZONE_BEGIN("ExecuteCommandLists");
+		ID3D12CommandQueue_ExecuteCommandLists(DxObjects->CommandQueue, 1, &DxObjects->CommandList);
+		SignalSubmission(DxObjects, SyncObjects);
+		CPU_ZONE_END();
+
+		MemoryEndFrame();
+
+		THROW_ON_FAIL(ID3D12CommandQueue_Signal(DxObjects->CommandQueue, SyncObjects->Fence[SyncObjects->FrameIndex], ++SyncObjects->FenceValue[SyncObjects->FrameIndex]));
+
+		LARGE_INTEGER WorkEnd;
+		QueryPerformanceCounter(&WorkEnd);
+
+		if (Frame >= BENCHMARK_WARMUP_FRAMES)
+		{
+			CpuTimes[SampleCount] = (float)((WorkEnd.QuadPart - WorkStart.QuadPart) * 1000.0 / Frequency.QuadPart);
+			Submissions++;
+			Draws += FrameDraws;
+		}
+	}
+
+	FlushCommandQueue(SyncObjects);
+	FinishFrameRecordings(&DxObjects->Recorder);
+
+	LARGE_INTEGER MeasureEnd;
+	QueryPerformanceCounter(&MeasureEnd);
+
+	for (UINT i = 0; i < BUFFER_COUNT; i++)
+	{
+		GpuProfilerCollect(&DxObjects->Profiler, i, DxObjects->CommandQueue);
+	}
+
+	UINT CullGpuCount = 0;
+	UINT CullCpuCount = 0;
+	const bool bCullMatch = DxObjects->Culling.bEnabled ? ValidateGpuCulling(DxObjects, SyncObjects, &CullGpuCount, &CullCpuCount) : true;
+	const double CullReferenceMicroseconds = BenchmarkCullReference();
+
+	const UINT64 BundleHits = DxObjects->Bundles.Hits;
+	const UINT64 BundleRebuilds = DxObjects->Bundles.Rebuilds;
+	const UINT64 OcclusionTested = DxObjects->Occlusion.Tested;
+	const UINT64 OcclusionCulled = DxObjects->Occlusion.Culled;
+	double DirectRecordMicroseconds;
+	double BundleRecordMicroseconds;
+	BenchmarkBundleRecording(DxObjects, &Scene, &DirectRecordMicroseconds, &BundleRecordMicroseconds);
+
+	struct MemorySnapshot MemoryAfter;
+	struct MemorySnapshot MemoryDiff;
+	MemoryTakeSnapshot(&MemoryAfter);
+	MemoryDiffSnapshots(&MemoryBefore, &MemoryAfter, &MemoryDiff);
+	const double MemoryTrackNanoseconds = BenchmarkMemoryAccounting();
+
+	double TextureDdsParseMicroseconds;
+	double TextureKtx2ParseMicroseconds;
+	double TextureCopyGigabytesPerSecond;
+	const bool bTextureLoaderValid = BenchmarkTextureLoader(&TextureDdsParseMicroseconds, &TextureKtx2ParseMicroseconds, &TextureCopyGigabytesPerSecond);
+
+	D3D12_RESOURCE_DESC TextureDesc;
+	ID3D12Resource_GetDesc(DxObjects->Texture, &TextureDesc);
+
+	UINT64 SimRetired;
+	UINT64 SimRetirePeakBytes;
+	const bool bRetireValid = SimulateRetireQueue(&SimRetired, &SimRetirePeakBytes);
+
+	UINT64 SimEvictions;
+	UINT64 SimMakeResidents;
+	UINT64 SimOvercommitted;
+	const bool bResidencyValid = SimulateResidency(&SimEvictions, &SimMakeResidents, &SimOvercommitted);
+
+	UINT SimSettleFrames[3];
+	float SimScales[3];
+	float SimFrameMs[3];
+	SimulateResolutionController(DxObjects->Resolution.TargetMs, SimSettleFrames, SimScales, SimFrameMs);
+
+	double OcclusionScalarMilliseconds;
+	double OcclusionAvx2Milliseconds;
+	const bool bOcclusionMatch = BenchmarkOcclusionRaster(&OcclusionScalarMilliseconds, &OcclusionAvx2Milliseconds);
+
+	double ParticleSingleMilliseconds;
+	double ParticleParallelMilliseconds;
+	UINT ParticleWorkers;
+	UINT ParticleBenchAlive;
+	const bool bParticleMatch = BenchmarkParticles(&ParticleSingleMilliseconds, &ParticleParallelMilliseconds, &ParticleWorkers, &ParticleBenchAlive);
+
+	double ClusterScalarMilliseconds[ARRAYSIZE(ClusterBenchLightCounts)];
+	double ClusterSimdMilliseconds[ARRAYSIZE(ClusterBenchLightCounts)];
+	UINT ClusterIndexCounts[ARRAYSIZE(ClusterBenchLightCounts)];
+	bool bClusterConservative;
+	const bool bClusterMatch = BenchmarkClusteredLights(ClusterScalarMilliseconds, ClusterSimdMilliseconds, ClusterIndexCounts, &bClusterConservative);
+
+	UINT ShadowValidationRenders;
+	double ShadowFitMicroseconds;
+	const bool bShadowsValid = ValidateShadowCascades(&ShadowValidationRenders, &ShadowFitMicroseconds);
+
+	UINT64 RecorderSimEncoded;
+	UINT64 RecorderSimDropped;
+	const bool bRecorderValid = SimulateFrameRecorder(&RecorderSimEncoded, &RecorderSimDropped);
+
+	double StartupSerialMilliseconds;
+	const double StartupTotalMilliseconds = StartupMilliseconds(&DxObjects->Startup, &StartupSerialMilliseconds);
+
+	double StartupSimMilliseconds;
+	double StartupSimSerialMilliseconds;
+	const bool bStartupValid = ValidateStartupGraph(&StartupSimMilliseconds, &StartupSimSerialMilliseconds);
+
+	UINT64 LatencySimDropped;
+	UINT64 LatencySimRepeated;
+	struct TimeSummary LatencySimInputToPresent;
+	struct TimeSummary LatencySimPresentToDisplay;
+	const bool bLatencyValid = SimulateLatencyTimeline(&LatencySimDropped, &LatencySimRepeated, &LatencySimInputToPresent, &LatencySimPresentToDisplay);
+
+	UINT64 ArenaSimHighWater;
+	const bool bArenaValid = ValidateFrameArena(&ArenaSimHighWater);
+
+	double ArenaMicroseconds;
+	double MallocMicroseconds;
+	BenchmarkFrameArena(&ArenaMicroseconds, &MallocMicroseconds);
+
+	UINT64 ArenaHighWater = 0;
+	UINT64 ArenaOverflows = 0;
+
+	for (UINT i = 0; i < BUFFER_COUNT; i++)
+	{
+		ArenaHighWater = max(ArenaHighWater, DxObjects->FrameArenas[i].HighWater);
+		ArenaOverflows += DxObjects->FrameArenas[i].Overflows;
+	}
+
+	//the capture below records one more frame, so the counters are taken first
+	const struct EncoderStats EncoderStats = DxObjects->EncoderStats;
+
+	struct CommandStream Capture = { 0 };
+	double ReplayNullMicroseconds = 0.0;
+	double ReplayDeviceMicroseconds = 0.0;
+
+	if (Options->CapturePath[0])
+	{
+		Capture.Data = VirtualAlloc(NULL, COMMAND_STREAM_CAPACITY, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		VALIDATE_HANDLE(Capture.Data);
+
+		//the queue is idle, so one more frame can be recorded for the trace and never executed
+		RecordFrame(DxObjects, &Scene, 0, &Viewport, &ScissorRect, &Capture);
+		THROW_ON_FALSE(!Capture.bOverflow);
+		WriteCommandStream(&Capture, Options->CapturePath);
+
+		LARGE_INTEGER Start;
+		LARGE_INTEGER End;
+		QueryPerformanceCounter(&Start);
+
+		for (UINT i = 0; i < REPLAY_ITERATIONS; i++)
+		{
+			ReplayCommandStream(&Capture, NULL, NULL);
+		}
+
+		QueryPerformanceCounter(&End);
+		ReplayNullMicroseconds = (double)(End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / REPLAY_ITERATIONS;
+
+		QueryPerformanceCounter(&Start);
+
+		for (UINT i = 0; i < REPLAY_ITERATIONS; i++)
+		{
+			THROW_ON_FAIL(ID3D12CommandAllocator_Reset(DxObjects->CommandAllocators[0]));
+			THROW_ON_FAIL(ID3D12GraphicsCommandList7_Reset(DxObjects->CommandList, DxObjects->CommandAllocators[0], DxObjects->PipelineStateObject));
+			ReplayCommandStream(&Capture, DxObjects->CommandList, NULL);
+			THROW_ON_FAIL(ID3D12GraphicsCommandList7_Close(DxObjects->CommandList));
+		}
+
+		QueryPerformanceCounter(&End);
+		ReplayDeviceMicroseconds = (double)(End.QuadPart - Start.QuadPart) * 1000000.0 / Frequency.QuadPart / REPLAY_ITERATIONS;
+	}
+
+	struct TimeSummary FrameSummary;
+	struct TimeSummary CpuSummary;
+	SummarizeTimes(FrameTimes, SampleCount, &FrameSummary);
+	SummarizeTimes(CpuTimes, SampleCount, &CpuSummary);
+	const double CpuZoneNanoseconds = BenchmarkCpuZones();
+
+	UINT SortWorkers;
+	bool bSortVerified;
+	const double SortMilliseconds = BenchmarkDrawSort(&SortWorkers, &bSortVerified);
+
+	PROCESS_MEMORY_COUNTERS_EX ProcessMemory = { 0 };
+	ProcessMemory.cb = sizeof(ProcessMemory);
+	THROW_ON_FALSE(GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&ProcessMemory, sizeof(ProcessMemory)));
+
+	DXGI_QUERY_VIDEO_MEMORY_INFO LocalMemory;
+	DXGI_QUERY_VIDEO_MEMORY_INFO NonLocalMemory;
+	THROW_ON_FAIL(IDXGIAdapter3_QueryVideoMemoryInfo(DxObjects->Adapter, 0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &LocalMemory));
+	THROW_ON_FAIL(IDXGIAdapter3_QueryVideoMemoryInfo(DxObjects->Adapter, 0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &NonLocalMemory));
+
+	char AdapterName[128] = { 0 };
+
+	{
+		DXGI_ADAPTER_DESC1 AdapterDesc;
+		THROW_ON_FAIL(IDXGIAdapter3_GetDesc1(DxObjects->Adapter, &AdapterDesc));
+		THROW_ON_FALSE(WideCharToMultiByte(CP_UTF8, 0, AdapterDesc.Description, -1, AdapterName, sizeof(AdapterName), NULL, NULL) != 0);
+
+		for (char* c = AdapterName; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				*c = ' ';
+		}
+	}
+
+	static struct TraceWriter Writer;
+
+	Writer.File = CreateFileW(Options->ReportPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	VALIDATE_HANDLE(Writer.File);
+
+	Writer.Used = 0;
+	TraceWrite(&Writer,
+		"{\n\t\"adapter\": \"%s\",\n\t\"warp\": %s,\n\t\"width\": %u,\n\t\"height\": %u,\n\t\"frames\": %u,\n\t\"seconds\": %.4f,\n",
+		AdapterName, Options->bWarp ? "true" : "false", Options->Width, Options->Height, SampleCount,
+		(double)(MeasureEnd.QuadPart - MeasureStart) / Frequency.QuadPart);
+
+	TraceWriteSummary(&Writer, "frame_ms", &FrameSummary);
+	TraceWriteSummary(&Writer, "cpu_ms", &CpuSummary);
+
+#ifdef CPU_ZONES
+	const char* CpuZonesEnabled = "true";
+#else
+	const char* CpuZonesEnabled = "false";
+#endif
+
+	TraceWrite(&Writer,
+		"\t\"cpu_zones\": { \"enabled\": %s, \"zone_ns\": %.1f },\n", CpuZonesEnabled, CpuZoneNanoseconds);
+
+	TraceWrite(&Writer, "\t\"gpu_ms\": [");
+
+	for (UINT i = 0; i < DxObjects->Profiler.StatsCount; i++)
+	{
+		float Min;
+		float Avg;
+		float P99;
+		ProfilerSummarize(&DxObjects->Profiler.Stats[i], &Min, &Avg, &P99);
+
+		TraceWrite(&Writer,
+			"%s\n\t\t{ \"scope\": \"%s\", \"depth\": %u, \"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f }",
+			i == 0 ? "" : ",", DxObjects->Profiler.Stats[i].Name, DxObjects->Profiler.Stats[i].Depth, Min, Avg, P99);
+	}
+
+	TraceWrite(&Writer, "\n\t],\n");
+
+	if (Capture.Data)
+	{
+		TraceWrite(&Writer,
+			"\t\"replay\": { \"packets\": %u, \"bytes\": %u, \"null_us\": %.3f, \"device_us\": %.3f },\n",
+			Capture.PacketCount, Capture.Used, ReplayNullMicroseconds, ReplayDeviceMicroseconds);
+	}
+
+	TraceWrite(&Writer, "\t\"encoder\": {");
+
+	for (UINT i = 0; i < COMMAND_OP_COUNT; i++)
+	{
+		TraceWrite(&Writer,
+			"%s\n\t\t\"%s\": { \"issued\": %llu, \"elided\": %llu }",
+			i == 0 ? "" : ",", CommandOpNames[i], EncoderStats.Issued[i], EncoderStats.Elided[i]);
+	}
+
+	TraceWrite(&Writer, "\n\t},\n");
+
+	TraceWrite(&Writer,
+		"\t\"culling\": { \"gpu_driven\": %s, \"gpu_count\": %u, \"cpu_count\": %u, \"match\": %s, \"reference_objects\": %u, \"reference_us\": %.3f },\n",
+		DxObjects->Culling.bEnabled ? "true" : "false", CullGpuCount, CullCpuCount, bCullMatch ? "true" : "false", CULL_BENCH_OBJECTS, CullReferenceMicroseconds);
+
+	TraceWrite(&Writer,
+		"\t\"bundles\": { \"enabled\": %s, \"hits\": %llu, \"rebuilds\": %llu, \"direct_record_us\": %.3f, \"bundle_record_us\": %.3f },\n",
+		DxObjects->Bundles.bEnabled ? "true" : "false", BundleHits, BundleRebuilds, DirectRecordMicroseconds, BundleRecordMicroseconds);
+
+	TraceWrite(&Writer,
+		"\t\"occlusion\": { \"enabled\": %s, \"tested\": %llu, \"culled\": %llu, \"avx2\": %s, \"bench_triangles\": %u, \"scalar_ms\": %.3f, \"avx2_ms\": %.3f, \"match\": %s },\n",
+		DxObjects->Occlusion.bEnabled ? "true" : "false", OcclusionTested, OcclusionCulled, DxObjects->Occlusion.bAvx2 ? "true" : "false",
+		OCCLUSION_BENCH_TRIANGLES, OcclusionScalarMilliseconds, OcclusionAvx2Milliseconds, bOcclusionMatch ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"particles\": { \"enabled\": %s, \"alive\": %u, \"spawned\": %llu, \"dropped\": %llu, \"bench_particles\": %u, \"bench_alive\": %u, \"workers\": %u, \"single_ms\": %.3f, \"parallel_ms\": %.3f, \"match\": %s },\n",
+		DxObjects->Particles.bEnabled ? "true" : "false", DxObjects->Particles.Pool.Count, DxObjects->Particles.Spawned, DxObjects->Particles.Dropped,
+		PARTICLE_BENCH_COUNT, ParticleBenchAlive, ParticleWorkers, ParticleSingleMilliseconds, ParticleParallelMilliseconds, bParticleMatch ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"lighting\": { \"enabled\": %s, \"lights\": %u, \"indices\": %u, \"dropped\": %llu, \"match\": %s, \"conservative\": %s, \"bench\": [",
+		DxObjects->Lighting.bEnabled ? "true" : "false", DxObjects->Lighting.LightCount, DxObjects->Lighting.IndexCount, DxObjects->Lighting.Grid.Dropped,
+		bClusterMatch ? "true" : "false", bClusterConservative ? "true" : "false");
+
+	for (UINT i = 0; i < ARRAYSIZE(ClusterBenchLightCounts); i++)
+	{
+		TraceWrite(&Writer,
+			"%s { \"lights\": %u, \"indices\": %u, \"scalar_ms\": %.3f, \"simd_ms\": %.3f }",
+			i == 0 ? "" : ",", ClusterBenchLightCounts[i], ClusterIndexCounts[i], ClusterScalarMilliseconds[i], ClusterSimdMilliseconds[i]);
+	}
+
+	TraceWrite(&Writer, " ] },\n");
+
+	TraceWrite(&Writer,
+		"\t\"shadows\": { \"enabled\": %s, \"cascades\": %u, \"cached_cascades\": %u, \"static_renders\": %llu, \"cache_hits\": %llu, \"caster_draws\": %llu, \"culled_casters\": %llu, \"validation_renders\": %u, \"fit_us\": %.3f, \"valid\": %s },\n",
+		DxObjects->Shadows.bEnabled ? "true" : "false", SHADOW_CASCADES, SHADOW_CASCADES - SHADOW_FIRST_CACHED, DxObjects->Shadows.StaticRenders, DxObjects->Shadows.CacheHits,
+		DxObjects->Shadows.CasterDraws, DxObjects->Shadows.CulledCasters, ShadowValidationRenders, ShadowFitMicroseconds, bShadowsValid ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"recorder\": { \"enabled\": %s, \"slots\": %u, \"captured\": %llu, \"dropped\": %llu, \"encoded\": %lld, \"encoded_mb\": %.1f, \"encode_ms\": %.3f, \"sim_encoded\": %llu, \"sim_dropped\": %llu, \"valid\": %s },\n",
+		DxObjects->Recorder.bEnabled ? "true" : "false", RECORDER_SLOTS, DxObjects->Recorder.Captured, DxObjects->Recorder.Dropped, DxObjects->Recorder.Encoded,
+		DxObjects->Recorder.EncodedBytes / (1024.0 * 1024.0), DxObjects->Recorder.Encoded ? DxObjects->Recorder.EncodeTicks * 1000.0 / Frequency.QuadPart / DxObjects->Recorder.Encoded : 0.0,
+		RecorderSimEncoded, RecorderSimDropped, bRecorderValid ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"startup\": { \"ms\": %.3f, \"serial_ms\": %.3f, \"phases\": [", StartupTotalMilliseconds, StartupSerialMilliseconds);
+
+	for (UINT i = 0; i < DxObjects->Startup.Count; i++)
+	{
+		const struct StartupTask* Task = &DxObjects->Startup.Tasks[i];
+
+		TraceWrite(&Writer,
+			"%s\n\t\t{ \"name\": \"%s\", \"thread\": %lu, \"main\": %s, \"start_ms\": %.3f, \"ms\": %.3f }",
+			i == 0 ? "" : ",", Task->Name, Task->ThreadId, Task->Proc ? "false" : "true",
+			(Task->Begin - DxObjects->Startup.Begin) * 1000.0 / DxObjects->Startup.Frequency,
+			(Task->End - Task->Begin) * 1000.0 / DxObjects->Startup.Frequency);
+	}
+
+	TraceWrite(&Writer,
+		"\n\t\t], \"sim_tasks\": %u, \"sim_ms\": %.3f, \"sim_serial_ms\": %.3f, \"valid\": %s },\n",
+		STARTUP_SIM_TASKS, StartupSimMilliseconds, StartupSimSerialMilliseconds, bStartupValid ? "true" : "false");
+
+	//there is no swap chain or input here, so only the correlation is checked against a synthetic timeline
+	TraceWrite(&Writer,
+		"\t\"latency\": { \"sim_frames\": %u, \"sim_dropped\": %llu, \"sim_repeated\": %llu, \"sim_input_to_present_ms\": { \"p50\": %.3f, \"p99\": %.3f }, \"sim_present_to_display_ms\": { \"p50\": %.3f, \"p99\": %.3f }, \"valid\": %s },\n",
+		LATENCY_SIM_FRAMES, LatencySimDropped, LatencySimRepeated, LatencySimInputToPresent.P50, LatencySimInputToPresent.P99,
+		LatencySimPresentToDisplay.P50, LatencySimPresentToDisplay.P99, bLatencyValid ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"arena\": { \"guard_pages\": %s, \"size_kb\": %u, \"high_water_kb\": %.1f, \"overflows\": %llu, \"sim_workers\": %u, \"sim_high_water_kb\": %.1f, \"bench_allocations\": %u, \"arena_us\": %.3f, \"malloc_us\": %.3f, \"valid\": %s },\n",
+		DxObjects->FrameArenas[0].bGuardPages ? "true" : "false", FRAME_ARENA_SIZE / 1024, ArenaHighWater / 1024.0, ArenaOverflows, FRAME_ARENA_SIM_WORKERS,
+		ArenaSimHighWater / 1024.0, FRAME_ARENA_BENCH_ALLOCATIONS, ArenaMicroseconds, MallocMicroseconds, bArenaValid ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"resolution\": { \"enabled\": %s, \"target_ms\": %.3f, \"final_scale\": %.4f, \"avg_scale\": %.4f, \"min_scale\": %.4f, \"changes\": %u,\n",
+		DxObjects->Resolution.bEnabled ? "true" : "false", DxObjects->Resolution.TargetMs, DxObjects->Resolution.Scale,
+		SampleCount ? ScaleSum / SampleCount : DxObjects->Resolution.Scale, ScaleMin, ScaleChanges);
+
+	TraceWrite(&Writer,
+		"\t\t\"simulation\": [ { \"settle_frames\": %u, \"scale\": %.4f, \"ms\": %.3f }, { \"settle_frames\": %u, \"scale\": %.4f, \"ms\": %.3f }, { \"settle_frames\": %u, \"scale\": %.4f, \"ms\": %.3f } ] },\n",
+		SimSettleFrames[0], SimScales[0], SimFrameMs[0], SimSettleFrames[1], SimScales[1], SimFrameMs[1], SimSettleFrames[2], SimScales[2], SimFrameMs[2]);
+
+	TraceWrite(&Writer,
+		"\t\"memory_ledger\": { \"track_ns\": %.1f, \"frames\": %lld,", MemoryTrackNanoseconds, MemoryDiff.Frames);
+
+	for (UINT i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		TraceWrite(&Writer,
+			"%s\n\t\t\"%s\": { \"live\": %lld, \"peak\": %lld, \"allocated\": %lld, \"freed\": %lld, \"peak_frame_churn\": %llu }",
+			i == 0 ? "" : ",", MemoryCategoryNames[i], MemoryAfter.Live[i], MemoryAfter.Peak[i], MemoryDiff.Allocated[i], MemoryDiff.Freed[i], MemoryLedger.PeakFrameChurn[i]);
+	}
+
+	TraceWrite(&Writer, "\n\t},\n");
+
+	TraceWrite(&Writer,
+		"\t\"retire\": { \"pending\": %u, \"pending_bytes\": %llu, \"peak_pending_bytes\": %llu, \"released\": %llu, \"overflow_waits\": %u,\n",
+		SyncObjects->RetireQueue.Count, SyncObjects->RetireQueue.PendingBytes, SyncObjects->RetireQueue.PeakPendingBytes,
+		SyncObjects->RetireQueue.Released, SyncObjects->RetireQueue.OverflowWaits);
+
+	TraceWrite(&Writer,
+		"\t\t\"simulation\": { \"valid\": %s, \"released\": %llu, \"peak_pending_bytes\": %llu } },\n",
+		bRetireValid ? "true" : "false", SimRetired, SimRetirePeakBytes);
+
+	TraceWrite(&Writer,
+		"\t\"texture\": { \"format\": %u, \"width\": %llu, \"height\": %u, \"mips\": %u, \"array\": %u, \"dds_parse_us\": %.3f, \"ktx2_parse_us\": %.3f, \"copy_gbps\": %.2f, \"valid\": %s },\n",
+		TextureDesc.Format, TextureDesc.Width, TextureDesc.Height, TextureDesc.MipLevels, TextureDesc.DepthOrArraySize,
+		TextureDdsParseMicroseconds, TextureKtx2ParseMicroseconds, TextureCopyGigabytesPerSecond, bTextureLoaderValid ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"residency\": { \"budget_mb\": %.2f, \"resident_mb\": %.2f, \"evictions\": %llu, \"make_resident\": %llu, \"overcommitted_frames\": %llu,\n"
+		"\t\t\"queue_waits\": %llu, \"dropped_tracks\": %llu,\n",
+		DxObjects->Residency.Budget / (1024.0 * 1024.0), DxObjects->Residency.ResidentBytes / (1024.0 * 1024.0),
+		DxObjects->Residency.Evictions, DxObjects->Residency.MakeResidents, DxObjects->Residency.OvercommittedFrames,
+		DxObjects->Residency.QueueWaits, DxObjects->Residency.DroppedTracks);
+
+	TraceWrite(&Writer,
+		"\t\t\"simulation\": { \"valid\": %s, \"evictions\": %llu, \"make_resident\": %llu, \"overcommitted_frames\": %llu } },\n",
+		bResidencyValid ? "true" : "false", SimEvictions, SimMakeResidents, SimOvercommitted);
+
+	TraceWrite(&Writer,
+		"\t\"sort\": { \"packets\": %u, \"workers\": %u, \"ms\": %.4f, \"mkeys_per_s\": %.2f, \"verified\": %s },\n",
+		DRAW_SORT_BENCH_PACKETS, SortWorkers, SortMilliseconds, DRAW_SORT_BENCH_PACKETS / (SortMilliseconds * 1000.0), bSortVerified ? "true" : "false");
+
+	TraceWrite(&Writer,
+		"\t\"submissions\": %llu,\n\t\"draws\": %llu,\n\t\"dropped_draws\": %llu,\n"
+		"\t\"memory\": { \"working_set\": %zu, \"peak_working_set\": %zu, \"private\": %zu, \"video_local\": %llu, \"video_local_budget\": %llu, \"video_non_local\": %llu }\n}\n",
+		Submissions, Draws, DxObjects->DrawQueue.Dropped,
+		ProcessMemory.WorkingSetSize, ProcessMemory.PeakWorkingSetSize, ProcessMemory.PrivateUsage,
+		LocalMemory.CurrentUsage, LocalMemory.Budget, NonLocalMemory.CurrentUsage);
+
+	TraceFlush(&Writer);
+	THROW_ON_FALSE(CloseHandle(Writer.File));
+
+	if (Options->MemoryReportPath[0])
+		ExportMemoryReport(Options->MemoryReportPath);
+
+	char buffer[160];
+	int stringlength = _snprintf_s(buffer, 160, _TRUNCATE, "benchmark: %u frames, avg %.3f ms, p99 %.3f ms, cpu avg %.3f ms\n",
+		SampleCount, FrameSummary.Avg, FrameSummary.P99, CpuSummary.Avg);
+	WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
+
+	if (Capture.Data)
+		THROW_ON_FALSE(VirtualFree(Capture.Data, 0, MEM_RELEASE));
+
+	THROW_ON_FALSE(VirtualFree(FrameTimes, 0, MEM_RELEASE));
+}
+
+void RunWindowed(HWND Window, UINT Width, UINT Height, struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects)
+{
+	struct IdleScheduler IdleScheduler = { 0 };
+
+	{
+		LARGE_INTEGER Frequency;
+		LARGE_INTEGER Now;
+		QueryPerformanceFrequency(&Frequency);
+		QueryPerformanceCounter(&Now);
+
+		IdleScheduler.State = POWER_ACTIVE;
+		IdleScheduler.bFocused = true;
+		IdleScheduler.Frequency = Frequency.QuadPart;
+		IdleScheduler.BackgroundInterval = Frequency.QuadPart / BACKGROUND_FRAME_RATE_HZ;
+		IdleScheduler.OccludedInterval = Frequency.QuadPart / OCCLUDED_PROBE_RATE_HZ;
+		IdleScheduler.StateEntered = Now.QuadPart;
+		IdleScheduler.StateCpuEntered = QueryProcessCpuTicks(Frequency.QuadPart);
+	}
+
+	THROW_ON_FALSE(SetWindowLongPtrW(Window, GWLP_WNDPROC, (LONG_PTR)WndProc) != 0);
+
+	DispatchMessageW(&(MSG) {
+		.hwnd = Window,
+		.message = WM_INIT,
+		.wParam = (WPARAM)&(struct WindowProcPayload)
+		{
+			.DxObjects = DxObjects,
+			.SyncObjects = SyncObjects,
+			.IdleScheduler = &IdleScheduler
+		},
+		.lParam = 0
+	});
+
+	DispatchMessageW(&(MSG) {
+		.hwnd = Window,
+		.message = WM_SIZE,
+		.wParam = SIZE_RESTORED,
+		.lParam = MAKELONG(Width, Height)
+	});
+
+	MSG Message = { 0 };
+
+	while (Message.message != WM_QUIT)
+	{
+		if (PeekMessageW(&Message, NULL, 0, 0, PM_REMOVE))
+		{
+			TranslateMessage(&Message);
+			DispatchMessageW(&Message);
+			continue;
+		}
+
+		LARGE_INTEGER Now;
+		QueryPerformanceCounter(&Now);
+
+		if (IdleFrameDue(&IdleScheduler, Now.QuadPart))
+		{
+			THROW_ON_FALSE(InvalidateRect(Window, NULL, FALSE));
+			continue;
+		}
+
+		//sleep until input, the next throttled frame, or the GPU draining so retired objects can go
+		DWORD WaitResult = MsgWaitForMultipleObjectsEx(1, &SyncObjects->IdleFenceEvent, IdleTimeout(&IdleScheduler, Now.QuadPart), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		THROW_ON_FALSE(WaitResult != WAIT_FAILED);
+
+		if (WaitResult == WAIT_OBJECT_0)
+			ReleaseRetiredObjects(&SyncObjects->RetireQueue, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+	}
+
+	ReportIdleStatistics(&IdleScheduler);
+}
+
+inline void WaitForPreviousFrame(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects)
+{
+	//only waits for the last frame that rendered into this back buffer, the others stay in flight
+	SyncObjects->FrameIndex = IDXGISwapChain3_GetCurrentBackBufferIndex(DxObjects->SwapChain);
+	WaitForFenceValue(SyncObjects->Fence[SyncObjects->FrameIndex], SyncObjects->FenceValue[SyncObjects->FrameIndex], SyncObjects->FenceEvent);
+}
+
+inline void WaitForFenceValue(ID3D12Fence* Fence, UINT64 Value, HANDLE FenceEvent)
+{
+	if (ID3D12Fence_GetCompletedValue(Fence) < Value)
+	{
+		THROW_ON_FAIL(ID3D12Fence_SetEventOnCompletion(Fence, Value, FenceEvent));
+		THROW_ON_FALSE(WaitForSingleObject(FenceEvent, INFINITE) == WAIT_OBJECT_0);
+	}
+}
+
+inline void SignalSubmission(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects)
+{
+	THROW_ON_FAIL(ID3D12CommandQueue_Signal(DxObjects->CommandQueue, SyncObjects->SubmitFence, ++SyncObjects->SubmitFenceValue));
+}
+
+inline void FlushCommandQueue(struct SyncObjects* restrict SyncObjects)
+{
+	WaitForFenceValue(SyncObjects->SubmitFence, SyncObjects->SubmitFenceValue, SyncObjects->FenceEvent);
+}
+
+inline void WaitUntil(HANDLE WaitableTimer, INT64 Target, INT64 Frequency)
+{
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+
+	if (Target <= Now.QuadPart)
+		return;
+
+	//negative due time is relative, in 100ns units
+	LARGE_INTEGER DueTime;
+	DueTime.QuadPart = -((Target - Now.QuadPart) * 10000000 / Frequency);
+
+	THROW_ON_FALSE(SetWaitableTimerEx(WaitableTimer, &DueTime, 0, NULL, NULL, NULL, 0));
+	THROW_ON_FALSE(WaitForSingleObject(WaitableTimer, INFINITE) == WAIT_OBJECT_0);
+}
+
+inline UINT PacingFrameLatency(enum PacingMode Mode)
+{
+	return Mode == PACING_THROUGHPUT ? BUFFER_COUNT - 1 : 1;
+}
+
+inline void PacingSetMode(struct PacingController* restrict Pacing, enum PacingMode Mode)
+{
+	Pacing->Mode = Mode;
+	Pacing->NextDeadline = 0;
+}
+
+inline void PacingRecordSlot(struct PacingController* restrict Pacing, INT64 Now)
+{
+	if (Pacing->LastSlot != 0 && Now > Pacing->LastSlot)
+	{
+		INT64 Interval = Now - Pacing->LastSlot;
+
+		//a missed vblank doubles the interval, so the estimate drops fast and only creeps up
+		if (Pacing->RefreshEstimate == 0)
+			Pacing->RefreshEstimate = Interval;
+		else if (Interval < Pacing->RefreshEstimate)
+			Pacing->RefreshEstimate -= (Pacing->RefreshEstimate - Interval) / 2;
+		else
+			Pacing->RefreshEstimate += (Interval - Pacing->RefreshEstimate) / 16;
+	}
+
+	Pacing->LastSlot = Now;
+}
+
+inline void PacingRecordCpu(struct PacingController* restrict Pacing, INT64 Duration)
+{
+	//durations rise fast so one slow frame doesn't push the next one past its vblank
+	if (Pacing->CpuEstimate == 0 || Duration > Pacing->CpuEstimate)
+		Pacing->CpuEstimate += (Duration - Pacing->CpuEstimate) / 2;
+	else
+		Pacing->CpuEstimate -= (Pacing->CpuEstimate - Duration) / 16;
+}
+
+inline void PacingRecordGpu(struct PacingController* restrict Pacing, INT64 Duration)
+{
+	if (Pacing->GpuEstimate == 0 || Duration > Pacing->GpuEstimate)
+		Pacing->GpuEstimate += (Duration - Pacing->GpuEstimate) / 2;
+	else
+		Pacing->GpuEstimate -= (Pacing->GpuEstimate - Duration) / 16;
+}
+
+inline INT64 PacingFrameStart(const struct PacingController* restrict Pacing, INT64 Now)
+{
+	INT64 Start = Now;
+
+	switch (Pacing->Mode)
+	{
+	case PACING_LOW_LATENCY:
+		//start as late as possible while still finishing before the vblank after this slot
+		if (Pacing->bSynced && Pacing->RefreshEstimate != 0 && Pacing->CpuEstimate != 0 && Pacing->GpuEstimate != 0)
+			Start = Pacing->LastSlot + Pacing->RefreshEstimate - Pacing->CpuEstimate - Pacing->GpuEstimate - Pacing->SafetyMargin;
+		break;
+	case PACING_FIXED_RATE:
+		Start = Pacing->NextDeadline;
+		break;
+	}
+
+	return max(Start, Now);
+}
+
+inline void PacingBeginFrame(struct PacingController* restrict Pacing, INT64 Start)
+{
+	if (Pacing->Mode != PACING_FIXED_RATE)
+		return;
+
+	//falling more than a frame behind restarts the cadence instead of bursting to catch up
+	if (Start - Pacing->NextDeadline > Pacing->FixedInterval)
+		Pacing->NextDeadline = Start + Pacing->FixedInterval;
+	else
+		Pacing->NextDeadline += Pacing->FixedInterval;
+}
+
+inline UINT ProfilerBeginScope(struct GpuProfilerFrame* restrict Frame, const char* Name)
+{
+	//scopes that don't fit are dropped together with their matching end
+	if (Frame->DroppedDepth > 0 || Frame->ScopeCount == PROFILER_MAX_SCOPES || Frame->StackDepth == PROFILER_MAX_DEPTH)
+	{
+		Frame->DroppedDepth++;
+		return UINT_MAX;
+	}
+
+	UINT Scope = Frame->ScopeCount++;
+	Frame->Names[Scope] = Name;
+	Frame->Depths[Scope] = Frame->StackDepth;
+	Frame->Stack[Frame->StackDepth++] = Scope;
+	return Scope * 2;
+}
+
+inline UINT ProfilerEndScope(struct GpuProfilerFrame* restrict Frame)
+{
+	if (Frame->DroppedDepth > 0)
+	{
+		Frame->DroppedDepth--;
+		return UINT_MAX;
+	}
+
+	assert(Frame->StackDepth > 0);
+	return Frame->Stack[--Frame->StackDepth] * 2 + 1;
+}
+
+inline INT64 ProfilerGpuToCpu(const struct GpuProfiler* restrict Profiler, UINT64 Timestamp)
+{
+	INT64 GpuDelta = (INT64)(Timestamp - Profiler->GpuCalibration);
+	return (INT64)Profiler->CpuCalibration + (INT64)((double)GpuDelta * Profiler->CpuFrequency / Profiler->TimestampFrequency);
+}
+
+struct GpuScopeStats* ProfilerFindStats(struct GpuProfiler* restrict Profiler, const char* Name, UINT Depth)
+{
+	for (UINT i = 0; i < Profiler->StatsCount; i++)
+	{
+		if (Profiler->Stats[i].Depth == Depth && strcmp(Profiler->Stats[i].Name, Name) == 0)
+			return &Profiler->Stats[i];
+	}
+
+	if (Profiler->StatsCount == PROFILER_MAX_SCOPES)
+		return NULL;
 
-	const void* VertexShaderBytecode = MapViewOfFile(VertexShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+	struct GpuScopeStats* Stats = &Profiler->Stats[Profiler->StatsCount++];
+	Stats->Name = Name;
+	Stats->Depth = Depth;
+	Stats->SampleCount = 0;
+	Stats->NextSample = 0;
+	return Stats;
+}
 
+void ProfilerCollectFrame(struct GpuProfiler* restrict Profiler, struct GpuProfilerFrame* restrict Frame, const UINT64* restrict Timestamps)
+{
+	for (UINT i = 0; i < Frame->ScopeCount; i++)
+	{
+		const UINT64 Begin = Timestamps[i * 2];
+		const UINT64 End = Timestamps[i * 2 + 1];
 
-	HANDLE PixelShaderFile = CreateFileW(L"PixelShader.cso", GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-	VALIDATE_HANDLE(PixelShaderFile);
+		if (End < Begin)
+			continue;
 
-	LONGLONG PixelShaderSize;
-	THROW_ON_FALSE(GetFileSizeEx(PixelShaderFile, &PixelShaderSize));
+		if (i == 0)
+		{
+			Profiler->LastFrameCpuBegin = ProfilerGpuToCpu(Profiler, Begin);
+			Profiler->LastFrameCpuEnd = ProfilerGpuToCpu(Profiler, End);
+		}
 
-	HANDLE PixelShaderFileMap = CreateFileMappingW(PixelShaderFile, NULL, PAGE_READONLY, 0, 0, NULL);
-	VALIDATE_HANDLE(PixelShaderFileMap);
+		struct GpuScopeStats* Stats = ProfilerFindStats(Profiler, Frame->Names[i], Frame->Depths[i]);
 
-	const void* PixelShaderBytecode = MapViewOfFile(PixelShaderFileMap, FILE_MAP_READ, 0, 0, 0);
+		if (Stats == NULL)
+			continue;
 
-	struct
-	{
-		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypepRootSignature;
-		ID3D12RootSignature* pRootSignature;
+		Stats->Samples[Stats->NextSample] = (float)((double)(End - Begin) * 1000.0 / Profiler->TimestampFrequency);
+		Stats->NextSample = (Stats->NextSample + 1) % PROFILER_HISTORY;
+		Stats->SampleCount = min(Stats->SampleCount + 1, PROFILER_HISTORY);
+	}
 
-		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeInputLayout;
-		D3D12_INPUT_LAYOUT_DESC InputLayout;
+	Frame->ScopeCount = 0;
+	Frame->StackDepth = 0;
+	Frame->DroppedDepth = 0;
+	Frame->bPending = false;
+}
 
-		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeVS;
-		D3D12_SHADER_BYTECODE VS;
+int CompareFloat(const void* a, const void* b)
+{
+	float x = *(const float*)a;
+	float y = *(const float*)b;
+	return (x > y) - (x < y);
+}
 
-		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypePS;
-		D3D12_SHADER_BYTECODE PS;
+void ProfilerSummarize(const struct GpuScopeStats* restrict Stats, float* restrict Min, float* restrict Avg, float* restrict P99)
+{
+	*Min = 0.0f;
+	*Avg = 0.0f;
+	*P99 = 0.0f;
 
-		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDepthStencilState;
-		D3D12_DEPTH_STENCIL_DESC DepthStencilState;
+	if (Stats->SampleCount == 0)
+		return;
 
-		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeDSVFormat;
-		DXGI_FORMAT DSVFormat;
+	float Sorted[PROFILER_HISTORY];
+	double Sum = 0.0;
 
-		alignas(void*) D3D12_PIPELINE_STATE_SUBOBJECT_TYPE ObjectTypeRTVFormats;
-		struct D3D12_RT_FORMAT_ARRAY RTVFormats;
-	} PipelineStateObject = { 0 };
+	for (UINT i = 0; i < Stats->SampleCount; i++)
+	{
+		Sorted[i] = Stats->Samples[i];
+		Sum += Stats->Samples[i];
+	}
 
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC PsoDesc = { 0 };
-	PipelineStateObject.ObjectTypepRootSignature = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE;
-	PipelineStateObject.pRootSignature = DxObjects.RootSignature;
+	qsort(Sorted, Stats->SampleCount, sizeof(float), CompareFloat);
 
-	PipelineStateObject.ObjectTypeVS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_VS;
-	PipelineStateObject.VS.pShaderBytecode = VertexShaderBytecode;
-	PipelineStateObject.VS.BytecodeLength = VertexShaderSize;
+	*Min = Sorted[0];
+	*Avg = (float)(Sum / Stats->SampleCount);
+	*P99 = Sorted[(Stats->SampleCount * 99 + 99) / 100 - 1];
+}
 
-	PipelineStateObject.ObjectTypePS = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS;
-	PipelineStateObject.PS.pShaderBytecode = PixelShaderBytecode;
-	PipelineStateObject.PS.BytecodeLength = PixelShaderSize;
+inline void GpuProfilerBegin(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12GraphicsCommandList7* CommandList, const char* Name)
+{
+	UINT Query = ProfilerBeginScope(&Profiler->Frames[Slot], Name);
 
-	PipelineStateObject.ObjectTypeDepthStencilState = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL;
-	PipelineStateObject.DepthStencilState.DepthEnable = TRUE;
-	PipelineStateObject.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
-	PipelineStateObject.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
-	PipelineStateObject.DepthStencilState.StencilEnable = FALSE;
-	PipelineStateObject.DepthStencilState.StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
-	PipelineStateObject.DepthStencilState.StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
-	PipelineStateObject.DepthStencilState.FrontFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
-	PipelineStateObject.DepthStencilState.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
-	PipelineStateObject.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
-	PipelineStateObject.DepthStencilState.FrontFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
-	PipelineStateObject.DepthStencilState.BackFace.StencilFailOp = D3D12_STENCIL_OP_KEEP;
-	PipelineStateObject.DepthStencilState.BackFace.StencilDepthFailOp = D3D12_STENCIL_OP_KEEP;
-	PipelineStateObject.DepthStencilState.BackFace.StencilPassOp = D3D12_STENCIL_OP_KEEP;
-	PipelineStateObject.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_ALWAYS;
+	if (Query != UINT_MAX)
+		ID3D12GraphicsCommandList7_EndQuery(CommandList, Profiler->QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, Slot * PROFILER_QUERIES_PER_FRAME + Query);
+}
 
-	PipelineStateObject.ObjectTypeInputLayout = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_INPUT_LAYOUT;
-	PipelineStateObject.InputLayout.pInputElementDescs = (D3D12_INPUT_ELEMENT_DESC[]){
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }};
-	PipelineStateObject.InputLayout.NumElements = 2;
+inline void GpuProfilerEnd(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12GraphicsCommandList7* CommandList)
+{
+	UINT Query = ProfilerEndScope(&Profiler->Frames[Slot]);
 
-	PipelineStateObject.ObjectTypeDSVFormat = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT;
-	PipelineStateObject.DSVFormat = DSV_FORMAT;
+	if (Query != UINT_MAX)
+		ID3D12GraphicsCommandList7_EndQuery(CommandList, Profiler->QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, Slot * PROFILER_QUERIES_PER_FRAME + Query);
+}
 
-	PipelineStateObject.ObjectTypeRTVFormats = D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS;
-	PipelineStateObject.RTVFormats.RTFormats[0] = RTV_FORMAT;
-	PipelineStateObject.RTVFormats.NumRenderTargets = 1;
+inline void GpuProfilerResolve(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12GraphicsCommandList7* CommandList)
+{
+	struct GpuProfilerFrame* Frame = &Profiler->Frames[Slot];
 
-	D3D12_PIPELINE_STATE_STREAM_DESC PsoStreamDesc = { 0 };
-	PsoStreamDesc.SizeInBytes = sizeof(PipelineStateObject);
-	PsoStreamDesc.pPipelineStateSubobjectStream = &PipelineStateObject;
+	assert(Frame->StackDepth == 0);
 
-	THROW_ON_FAIL(ID3D12Device10_CreatePipelineState(Device, &PsoStreamDesc, &IID_ID3D12PipelineState, &DxObjects.PipelineStateObject));
+	if (Frame->ScopeCount == 0)
+		return;
 
-	THROW_ON_FALSE(UnmapViewOfFile(VertexShaderBytecode));
-	THROW_ON_FALSE(CloseHandle(VertexShaderFileMap));
-	THROW_ON_FALSE(CloseHandle(VertexShaderFile));
-	
-	THROW_ON_FALSE(UnmapViewOfFile(PixelShaderBytecode));
-	THROW_ON_FALSE(CloseHandle(PixelShaderFileMap));
-	THROW_ON_FALSE(CloseHandle(PixelShaderFile));
+	ID3D12GraphicsCommandList7_ResolveQueryData(CommandList, Profiler->QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, Slot * PROFILER_QUERIES_PER_FRAME, Frame->ScopeCount * 2, Profiler->Readback, Slot * PROFILER_QUERIES_PER_FRAME * sizeof(UINT64));
+	Frame->bPending = true;
+}
 
-	ID3D12Resource* VertexBufferUploadHeap;
+bool GpuProfilerCollect(struct GpuProfiler* restrict Profiler, UINT Slot, ID3D12CommandQueue* CommandQueue)
+{
+	struct GpuProfilerFrame* Frame = &Profiler->Frames[Slot];
 
+	if (!Frame->bPending)
 	{
-		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
-		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		ResourceDesc.Alignment = 0;
-		ResourceDesc.Width = sizeof(VertexList);
-		ResourceDesc.Height = 1;
-		ResourceDesc.DepthOrArraySize = 1;
-		ResourceDesc.MipLevels = 1;
-		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
-		ResourceDesc.SampleDesc.Count = 1;
-		ResourceDesc.SampleDesc.Quality = 0;
-		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		//a frame that never got resolved (resize, occlusion) leaves nothing to read back
+		Frame->ScopeCount = 0;
+		Frame->StackDepth = 0;
+		Frame->DroppedDepth = 0;
+		return false;
+	}
 
-		{
-			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-			HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects.VertexBuffer));
-		}
+	//the two clocks drift apart, so the mapping is refreshed every so often
+	if (++Profiler->FramesSinceCalibration >= PROFILER_CALIBRATION_INTERVAL)
+	{
+		THROW_ON_FAIL(ID3D12CommandQueue_GetClockCalibration(CommandQueue, &Profiler->GpuCalibration, &Profiler->CpuCalibration));
+		Profiler->FramesSinceCalibration = 0;
+	}
 
-#ifdef _DEBUG
-		ID3D12Resource_SetName(DxObjects.VertexBuffer, L"Vertex Buffer Resource");
-#endif
+	ProfilerCollectFrame(Profiler, Frame, Profiler->ReadbackData + Slot * PROFILER_QUERIES_PER_FRAME);
+	return true;
+}
 
-		{
-			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-			HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &VertexBufferUploadHeap));
-		}
+void ReportGpuProfile(const struct GpuProfiler* restrict Profiler)
+{
+	WriteConsoleA(ConsoleHandle, "gpu scope                   min ms   avg ms   p99 ms\n", 53, NULL, NULL);
 
-#ifdef _DEBUG
-		ID3D12Resource_SetName(VertexBufferUploadHeap, L"Vertex Buffer Upload Heap");
-#endif
+	for (UINT i = 0; i < Profiler->StatsCount; i++)
+	{
+		float Min;
+		float Avg;
+		float P99;
+		ProfilerSummarize(&Profiler->Stats[i], &Min, &Avg, &P99);
+
+		char buffer[96];
+		int stringlength = _snprintf_s(buffer, 96, _TRUNCATE, "%*s%-*s %8.3f %8.3f %8.3f\n",
+			(int)Profiler->Stats[i].Depth * 2, "",
+			24 - (int)Profiler->Stats[i].Depth * 2, Profiler->Stats[i].Name,
+			Min, Avg, P99);
+		WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
 	}
-	
+}
+
+inline enum PowerState IdleTargetState(const struct IdleScheduler* restrict Idle)
+{
+	if (Idle->bMinimized)
+		return POWER_MINIMIZED;
+
+	if (Idle->bOccluded)
+		return POWER_OCCLUDED;
+
+	if (!Idle->bFocused)
+		return POWER_BACKGROUND;
+
+	return POWER_ACTIVE;
+}
+
+inline void IdleTransition(struct IdleScheduler* restrict Idle, INT64 Now, INT64 CpuNow)
+{
+	enum PowerState Target = IdleTargetState(Idle);
+
+	if (Target == Idle->State)
+		return;
+
+	Idle->WallTime[Idle->State] += Now - Idle->StateEntered;
+	Idle->CpuTime[Idle->State] += CpuNow - Idle->StateCpuEntered;
+	Idle->StateEntered = Now;
+	Idle->StateCpuEntered = CpuNow;
+
+	//a new state always gets a frame straight away, so restoring never waits out a throttled interval
+	Idle->State = Target;
+	Idle->NextFrame = Now;
+}
+
+inline bool IdleFrameDue(const struct IdleScheduler* restrict Idle, INT64 Now)
+{
+	switch (Idle->State)
 	{
-		void* pData;
-		THROW_ON_FAIL(ID3D12Resource_Map(VertexBufferUploadHeap, 0, NULL, &pData));
-		MEMCPY_VERIFY(memcpy_s(pData, sizeof(VertexList), VertexList, sizeof(VertexList)));
-		ID3D12Resource_Unmap(VertexBufferUploadHeap, 0, NULL);
+	case POWER_ACTIVE:
+		return true;
+	case POWER_MINIMIZED:
+		return false;
+	default:
+		return Now >= Idle->NextFrame;
+	}
+}
 
-		ID3D12GraphicsCommandList7_CopyBufferRegion(DxObjects.CommandList, DxObjects.VertexBuffer, 0, VertexBufferUploadHeap, 0, sizeof(VertexList));
+inline DWORD IdleTimeout(const struct IdleScheduler* restrict Idle, INT64 Now)
+{
+	switch (Idle->State)
+	{
+	case POWER_ACTIVE:
+		return 0;
+	case POWER_MINIMIZED:
+		return INFINITE;
+	default:
+		if (Now >= Idle->NextFrame)
+			return 0;
+		return (DWORD)(((Idle->NextFrame - Now) * 1000 + Idle->Frequency - 1) / Idle->Frequency);
 	}
+}
 
+inline void IdleFrameRendered(struct IdleScheduler* restrict Idle, INT64 Now)
+{
+	switch (Idle->State)
 	{
-		D3D12_BUFFER_BARRIER BufferBarrier = { 0 };
-		BufferBarrier.SyncBefore = D3D12_BARRIER_SYNC_COPY;
-		BufferBarrier.SyncAfter = D3D12_BARRIER_SYNC_DRAW;
-		BufferBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST;
-		BufferBarrier.AccessAfter = D3D12_BARRIER_ACCESS_VERTEX_BUFFER;
-		BufferBarrier.pResource = DxObjects.VertexBuffer;
-		BufferBarrier.Offset = 0;
-		BufferBarrier.Size = sizeof(VertexList);
+	case POWER_BACKGROUND:
+		Idle->NextFrame = Now + Idle->BackgroundInterval;
+		break;
+	case POWER_OCCLUDED:
+		Idle->NextFrame = Now + Idle->OccludedInterval;
+		break;
+	default:
+		Idle->NextFrame = Now;
+		break;
+	}
+}
 
-		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
-		ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
-		ResourceBarrier.NumBarriers = 1;
-		ResourceBarrier.pBufferBarriers = &BufferBarrier;
-		ID3D12GraphicsCommandList7_Barrier(DxObjects.CommandList, 1, &ResourceBarrier);
+inline INT64 QueryProcessCpuTicks(INT64 Frequency)
+{
+	FILETIME CreationTime;
+	FILETIME ExitTime;
+	ULARGE_INTEGER KernelTime;
+	ULARGE_INTEGER UserTime;
+	THROW_ON_FALSE(GetProcessTimes(GetCurrentProcess(), &CreationTime, &ExitTime, (FILETIME*)&KernelTime, (FILETIME*)&UserTime));
+
+	//process times are in 100ns units
+	return (INT64)((double)(KernelTime.QuadPart + UserTime.QuadPart) * Frequency / 10000000.0);
+}
+
+inline void IdleRefresh(struct IdleScheduler* restrict Idle)
+{
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+	IdleTransition(Idle, Now.QuadPart, QueryProcessCpuTicks(Idle->Frequency));
+}
+
+void ReportIdleStatistics(struct IdleScheduler* restrict Idle)
+{
+	static const char* StateNames[POWER_STATE_COUNT] = { "active", "background", "occluded", "minimized" };
+
+	LARGE_INTEGER Now;
+	QueryPerformanceCounter(&Now);
+	INT64 CpuNow = QueryProcessCpuTicks(Idle->Frequency);
+
+	Idle->WallTime[Idle->State] += Now.QuadPart - Idle->StateEntered;
+	Idle->CpuTime[Idle->State] += CpuNow - Idle->StateCpuEntered;
+	Idle->StateEntered = Now.QuadPart;
+	Idle->StateCpuEntered = CpuNow;
+
+	for (int i = 0; i < POWER_STATE_COUNT; i++)
+	{
+		if (Idle->WallTime[i] == 0)
+			continue;
+
+		char buffer[96];
+		int stringlength = _snprintf_s(buffer, 96, _TRUNCATE, "%-10s %9.2fs %7.2f%% cpu\n",
+			StateNames[i],
+			(double)Idle->WallTime[i] / Idle->Frequency,
+			100.0 * Idle->CpuTime[i] / Idle->WallTime[i]);
+		WriteConsoleA(ConsoleHandle, buffer, stringlength, NULL, NULL);
 	}
+}
 
-	ID3D12Resource* IndexBufferUploadHeap;
+inline void PostResize(struct ResizeRequest* restrict Request, UINT Width, UINT Height)
+{
+	Request->Width = Width;
+	Request->Height = Height;
+	Request->bPending = true;
+}
+
+inline bool TakeResize(struct ResizeRequest* restrict Request, UINT CurrentWidth, UINT CurrentHeight, UINT* restrict Width, UINT* restrict Height)
+{
+	if (!Request->bPending)
+		return false;
+
+	Request->bPending = false;
+
+	if (Request->Width == 0 || Request->Height == 0)
+		return false;
+
+	if (Request->Width == CurrentWidth && Request->Height == CurrentHeight)
+		return false;
+
+	*Width = Request->Width;
+	*Height = Request->Height;
+	return true;
+}
+
+//FenceValue is the value the last work referencing the object signals, Bytes is only reported
+inline bool RetireObject(struct RetireQueue* restrict Queue, IUnknown* Object, UINT64 FenceValue, UINT64 Bytes)
+{
+	if (Queue->Count == RETIRE_QUEUE_CAPACITY)
+		return false;
+
+	UINT Slot = (Queue->Head + Queue->Count) % RETIRE_QUEUE_CAPACITY;
+	Queue->Objects[Slot] = Object;
+	Queue->FenceValues[Slot] = FenceValue;
+	Queue->Bytes[Slot] = Bytes;
+	Queue->Count++;
+
+	Queue->PendingBytes += Bytes;
+	Queue->PeakPendingBytes = max(Queue->PeakPendingBytes, Queue->PendingBytes);
+	return true;
+}
+
+inline UINT ReleaseRetiredObjects(struct RetireQueue* restrict Queue, UINT64 CompletedValue)
+{
+	UINT Released = 0;
 
+	//fence values are pushed in submission order, so the queue drains from the head
+	while (Queue->Count > 0 && Queue->FenceValues[Queue->Head] <= CompletedValue)
 	{
-		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
-		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		ResourceDesc.Alignment = 0;
-		ResourceDesc.Width = sizeof(IndexList);
-		ResourceDesc.Height = 1;
-		ResourceDesc.DepthOrArraySize = 1;
-		ResourceDesc.MipLevels = 1;
-		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
-		ResourceDesc.SampleDesc.Count = 1;
-		ResourceDesc.SampleDesc.Quality = 0;
-		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		MemoryUntrack(Queue->Objects[Queue->Head]);
+		IUnknown_Release(Queue->Objects[Queue->Head]);
+		Queue->Objects[Queue->Head] = NULL;
+		Queue->PendingBytes -= Queue->Bytes[Queue->Head];
+		Queue->Head = (Queue->Head + 1) % RETIRE_QUEUE_CAPACITY;
+		Queue->Count--;
+		Released++;
+	}
 
-		{
-			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-			HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects.IndexBuffer));
-		}
+	Queue->Released += Released;
+	return Released;
+}
 
-#ifdef _DEBUG
-		ID3D12Resource_SetName(DxObjects.IndexBuffer, L"Index Buffer Resource");
-#endif
+void RetireResource(struct SyncObjects* restrict SyncObjects, ID3D12Resource* Resource)
+{
+	const UINT64 Bytes = MemoryTrackedSize(Resource);
+
+	//everything that could reference the resource has been submitted before the last signal
+	if (RetireObject(&SyncObjects->RetireQueue, (IUnknown*)Resource, SyncObjects->SubmitFenceValue, Bytes))
+		return;
+
+	//full, wait for the oldest entry only rather than the whole queue
+	SyncObjects->RetireQueue.OverflowWaits++;
+	WaitForFenceValue(SyncObjects->SubmitFence, SyncObjects->RetireQueue.FenceValues[SyncObjects->RetireQueue.Head], SyncObjects->FenceEvent);
+	ReleaseRetiredObjects(&SyncObjects->RetireQueue, ID3D12Fence_GetCompletedValue(SyncObjects->SubmitFence));
+	THROW_ON_FALSE(RetireObject(&SyncObjects->RetireQueue, (IUnknown*)Resource, SyncObjects->SubmitFenceValue, Bytes));
+}
+
+struct SimRetiredObject
+{
+	const IUnknownVtbl* lpVtbl;
+	UINT64 FenceValue;
+	UINT64 ReleasedAt;
+	UINT ReleaseCount;
+};
+
+static UINT64 SimCompletedValue;
 
+ULONG STDMETHODCALLTYPE SimRetiredRelease(IUnknown* This)
+{
+	struct SimRetiredObject* Object = (struct SimRetiredObject*)This;
+	Object->ReleasedAt = SimCompletedValue;
+	Object->ReleaseCount++;
+	return 0;
+}
+
+//drives a queue with stand-in objects against a fence that completes one to three submissions behind, checking that
+//each object is released exactly once, never before its fence and no later than the first sweep after it
+bool SimulateRetireQueue(UINT64* restrict Released, UINT64* restrict PeakPendingBytes)
+{
+	static const IUnknownVtbl SimVtbl = { .Release = SimRetiredRelease };
+	static struct SimRetiredObject Objects[RETIRE_SIM_FRAMES * 3];
+	static struct RetireQueue Queue;
+
+	Queue = (struct RetireQueue){ 0 };
+	SimCompletedValue = 0;
+
+	UINT ObjectCount = 0;
+	UINT64 Seed = 0x9E3779B97F4A7C15;
+	bool bValid = true;
+
+	for (UINT Frame = 0; Frame < RETIRE_SIM_FRAMES; Frame++)
+	{
+		Seed = Seed * 6364136223846793005 + 1442695040888963407;
+
+		//the frame's submission signals Frame + 1
+		const UINT Retired = (UINT)(Seed >> 62);
+
+		for (UINT i = 0; i < Retired; i++)
 		{
-			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-			HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &IndexBufferUploadHeap));
+			struct SimRetiredObject* Object = &Objects[ObjectCount++];
+			*Object = (struct SimRetiredObject){ .lpVtbl = &SimVtbl, .FenceValue = Frame + 1 };
+
+			if (!RetireObject(&Queue, (IUnknown*)Object, Object->FenceValue, 65536))
+				bValid = false;
 		}
 
-#ifdef _DEBUG
-		ID3D12Resource_SetName(IndexBufferUploadHeap, L"Index Buffer Upload Heap");
-#endif
-	}
+		const UINT64 Lag = 1 + (Seed >> 32) % 3;
+		SimCompletedValue = max(SimCompletedValue, Frame + 1 >= Lag ? Frame + 1 - Lag : 0);
+		ReleaseRetiredObjects(&Queue, SimCompletedValue);
 
-	{
-		void* pData;
-		THROW_ON_FAIL(ID3D12Resource_Map(IndexBufferUploadHeap, 0, NULL, &pData));
-		MEMCPY_VERIFY(memcpy_s(pData, sizeof(IndexList), IndexList, sizeof(IndexList)));
-		ID3D12Resource_Unmap(IndexBufferUploadHeap, 0, NULL);
+		if (Queue.PendingBytes != (UINT64)Queue.Count * 65536)
+			bValid = false;
 
-		ID3D12GraphicsCommandList7_CopyBufferRegion(DxObjects.CommandList, DxObjects.IndexBuffer, 0, IndexBufferUploadHeap, 0, sizeof(IndexList));
+		for (UINT i = 0; i < ObjectCount; i++)
+		{
+			if (Objects[i].ReleaseCount == 0 && Objects[i].FenceValue <= SimCompletedValue)
+				bValid = false;
+		}
 	}
 
+	SimCompletedValue = UINT64_MAX;
+	ReleaseRetiredObjects(&Queue, UINT64_MAX);
+
+	for (UINT i = 0; i < ObjectCount; i++)
 	{
-		D3D12_BUFFER_BARRIER BufferBarrier = { 0 };
-		BufferBarrier.SyncBefore = D3D12_BARRIER_SYNC_COPY;
-		BufferBarrier.SyncAfter = D3D12_BARRIER_SYNC_DRAW;
-		BufferBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST;
-		BufferBarrier.AccessAfter = D3D12_BARRIER_ACCESS_INDEX_BUFFER;
-		BufferBarrier.pResource = DxObjects.IndexBuffer;
-		BufferBarrier.Offset = 0;
-		BufferBarrier.Size = sizeof(IndexList);
+		if (Objects[i].ReleaseCount != 1 || Objects[i].ReleasedAt < Objects[i].FenceValue)
+			bValid = false;
+	}
 
-		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
-		ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
-		ResourceBarrier.NumBarriers = 1;
-		ResourceBarrier.pBufferBarriers = &BufferBarrier;
-		ID3D12GraphicsCommandList7_Barrier(DxObjects.CommandList, 1, &ResourceBarrier);
+	*Released = Queue.Released;
+	*PeakPendingBytes = Queue.PeakPendingBytes;
+	return bValid && Queue.PendingBytes == 0 && Queue.Released == ObjectCount;
+}
+
+inline UINT DepthBucketSize(UINT Size)
+{
+	UINT Bucket = (Size + DEPTH_BUCKET_GRANULARITY - 1) & ~(DEPTH_BUCKET_GRANULARITY - 1);
+	return min(Bucket, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION);
+}
+
+inline int FindPooledDepthBuffer(const struct DepthBufferPool* restrict Pool, UINT Width, UINT Height)
+{
+	for (UINT i = 0; i < Pool->Count; i++)
+	{
+		if (Pool->Widths[i] == Width && Pool->Heights[i] == Height)
+			return i;
 	}
 
-	ID3D12DescriptorHeap* DepthStencilDescriptorHeap;
+	return -1;
+}
+
+inline int OldestPooledDepthBuffer(const struct DepthBufferPool* restrict Pool)
+{
+	int Oldest = -1;
 
+	for (UINT i = 0; i < Pool->Count; i++)
 	{
-		D3D12_DESCRIPTOR_HEAP_DESC DsvHeapDesc = { 0 };
-		DsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-		DsvHeapDesc.NumDescriptors = 1;
-		DsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-		THROW_ON_FAIL(ID3D12Device10_CreateDescriptorHeap(Device, &DsvHeapDesc, &IID_ID3D12DescriptorHeap, &DepthStencilDescriptorHeap));
+		if (Oldest == -1 || Pool->LastUsed[i] < Pool->LastUsed[Oldest])
+			Oldest = i;
 	}
 
-#ifdef _DEBUG
-	ID3D12DescriptorHeap_SetName(DepthStencilDescriptorHeap, L"Depth/Stencil Resource Heap");
-#endif
+	return Oldest;
+}
 
-	ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(DepthStencilDescriptorHeap, &DxObjects.DsvHeapHandle);
+void AcquireDepthBuffer(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height)
+{
+	struct DepthBufferPool* Pool = &DxObjects->DepthBufferPool;
 
-	ID3D12Resource* ConstantBufferHeaps[BUFFER_COUNT];
+	const UINT BucketWidth = DepthBucketSize(Width);
+	const UINT BucketHeight = DepthBucketSize(Height);
 
-	for (int i = 0; i < BUFFER_COUNT; i++)
+	if (DxObjects->DepthStencilBuffer && DxObjects->DepthStencilWidth == BucketWidth && DxObjects->DepthStencilHeight == BucketHeight)
+		return;
+
+	if (DxObjects->DepthStencilBuffer)
+	{
+		if (Pool->Count == DEPTH_POOL_CAPACITY)
+		{
+			int Victim = OldestPooledDepthBuffer(Pool);
+			ResidencyUntrack(&DxObjects->Residency, Pool->Buffers[Victim]);
+			RetireResource(SyncObjects, Pool->Buffers[Victim]);
+
+			Pool->Count--;
+			Pool->Buffers[Victim] = Pool->Buffers[Pool->Count];
+			Pool->Widths[Victim] = Pool->Widths[Pool->Count];
+			Pool->Heights[Victim] = Pool->Heights[Pool->Count];
+			Pool->LastUsed[Victim] = Pool->LastUsed[Pool->Count];
+		}
+
+		//the queue executes in order, so a pooled buffer can be reused without waiting on its last frame
+		Pool->Buffers[Pool->Count] = DxObjects->DepthStencilBuffer;
+		Pool->Widths[Pool->Count] = DxObjects->DepthStencilWidth;
+		Pool->Heights[Pool->Count] = DxObjects->DepthStencilHeight;
+		Pool->LastUsed[Pool->Count] = SyncObjects->SubmitFenceValue;
+		Pool->Count++;
+
+		DxObjects->DepthStencilBuffer = NULL;
+	}
+
+	int Pooled = FindPooledDepthBuffer(Pool, BucketWidth, BucketHeight);
+
+	if (Pooled != -1)
+	{
+		DxObjects->DepthStencilBuffer = Pool->Buffers[Pooled];
+
+		Pool->Count--;
+		Pool->Buffers[Pooled] = Pool->Buffers[Pool->Count];
+		Pool->Widths[Pooled] = Pool->Widths[Pool->Count];
+		Pool->Heights[Pooled] = Pool->Heights[Pool->Count];
+		Pool->LastUsed[Pooled] = Pool->LastUsed[Pool->Count];
+	}
+	else
 	{
 		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-		HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+		HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
 		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
 		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
 
 		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
-		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 		ResourceDesc.Alignment = 0;
-		ResourceDesc.Width = ConstantBufferPerObjectAlignedSize * 2;
-		ResourceDesc.Height = 1;
+		ResourceDesc.Width = BucketWidth;
+		ResourceDesc.Height = BucketHeight;
 		ResourceDesc.DepthOrArraySize = 1;
 		ResourceDesc.MipLevels = 1;
-		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ResourceDesc.Format = DSV_FORMAT;
 		ResourceDesc.SampleDesc.Count = 1;
 		ResourceDesc.SampleDesc.Quality = 0;
-		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &ConstantBufferHeaps[i]));
+		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+
+		D3D12_CLEAR_VALUE ScreenClearValue = { 0 };
+		ScreenClearValue.Format = DSV_FORMAT;
+		ScreenClearValue.DepthStencil.Depth = 1.0f;
+		ScreenClearValue.DepthStencil.Stencil = 0;
+
+		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE, &ScreenClearValue, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects->DepthStencilBuffer));
+		MemoryTrackResource(DxObjects->DepthStencilBuffer, MEMORY_DEPTH, &ResourceDesc, "Depth/Stencil Buffer");
 
 #ifdef _DEBUG
-		ID3D12Resource_SetName(ConstantBufferHeaps[i], L"Constant Buffer Upload Resource Heap");
+		THROW_ON_FAIL(ID3D12Resource_SetName(DxObjects->DepthStencilBuffer, L"Depth/Stencil Buffer"));
 #endif
 
-		THROW_ON_FAIL(ID3D12Resource_Map(ConstantBufferHeaps[i], 0, NULL, &DxObjects.ConstantBufferCPUAddress[i]));
-
-		DxObjects.ContantBufferGPUAddress[i] = ID3D12Resource_GetGPUVirtualAddress(ConstantBufferHeaps[i]);
+		ResidencyTrack(&DxObjects->Residency, DxObjects->DepthStencilBuffer, &ResourceDesc);
 	}
 
+	DxObjects->DepthStencilWidth = BucketWidth;
+	DxObjects->DepthStencilHeight = BucketHeight;
+
 	{
-		D3D12_DESCRIPTOR_HEAP_DESC HeapDesc = { 0 };
-		HeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		HeapDesc.NumDescriptors = 1;
-		HeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		THROW_ON_FAIL(ID3D12Device10_CreateDescriptorHeap(Device, &HeapDesc, &IID_ID3D12DescriptorHeap, &DxObjects.SRVDescriptorHeap));
+		D3D12_DEPTH_STENCIL_VIEW_DESC DepthStencilViewDesc = { 0 };
+		DepthStencilViewDesc.Format = DSV_FORMAT;
+		DepthStencilViewDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+		DepthStencilViewDesc.Flags = D3D12_DSV_FLAG_NONE;
+		ID3D12Device10_CreateDepthStencilView(Device, DxObjects->DepthStencilBuffer, &DepthStencilViewDesc, DxObjects->DsvHeapHandle);
 	}
+}
 
-	ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(DxObjects.SRVDescriptorHeap, &DxObjects.SrvGpuHandle);
-	
-	ID3D12Resource* TextureBuffer;
+void ResizeSwapChain(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects, UINT Width, UINT Height)
+{
+	//ResizeBuffers needs every back buffer reference gone and the GPU done with all of them
+	FlushCommandQueue(SyncObjects);
 
+	if (DxObjects->RenderTargets[0])
 	{
-		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-		HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-
-		D3D12_RESOURCE_DESC1 TextureResourceDesc = { 0 };
-		TextureResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		TextureResourceDesc.Alignment = 0;
-		TextureResourceDesc.Width = TEXTURE_WIDTH;
-		TextureResourceDesc.Height = TEXTURE_HEIGHT;
-		TextureResourceDesc.DepthOrArraySize = 1;
-		TextureResourceDesc.MipLevels = 0;
-		TextureResourceDesc.Format = TEXTURE_FORMAT;
-		TextureResourceDesc.SampleDesc.Count = 1;
-		TextureResourceDesc.SampleDesc.Quality = 0;
-		TextureResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		TextureResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &TextureResourceDesc, D3D12_BARRIER_LAYOUT_COMMON, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &TextureBuffer));
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			THROW_ON_FAIL(ID3D12Resource_Release(DxObjects->RenderTargets[i]));
+		}
 	}
 
-#ifdef _DEBUG
-	ID3D12Resource_SetName(TextureBuffer, L"Texture Buffer Resource Heap");
-#endif
+	THROW_ON_FAIL(IDXGISwapChain3_ResizeBuffers(DxObjects->SwapChain, BUFFER_COUNT, Width, Height, RTV_FORMAT, SWAP_CHAIN_FLAGS));
 
-	ID3D12Resource* TextureBufferUploadHeap;
+	SyncObjects->FrameIndex = IDXGISwapChain3_GetCurrentBackBufferIndex(DxObjects->SwapChain);
 
 	{
-		D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-		HeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-		HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		D3D12_CPU_DESCRIPTOR_HANDLE RtvHandle = DxObjects->RtvHeapHandle;
 
-		D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
-		ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		ResourceDesc.Alignment = 0;
-		ResourceDesc.Width = TEXTURE_WIDTH * TEXTURE_HEIGHT * BYTES_PER_TEXEL;
-		ResourceDesc.Height = 1;
-		ResourceDesc.DepthOrArraySize = 1;
-		ResourceDesc.MipLevels = 1;
-		ResourceDesc.Format = DXGI_FORMAT_UNKNOWN;
-		ResourceDesc.SampleDesc.Count = 1;
-		ResourceDesc.SampleDesc.Quality = 0;
-		ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_UNDEFINED, NULL, NULL, 0, NULL, &IID_ID3D12Resource, &TextureBufferUploadHeap));
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			THROW_ON_FAIL(IDXGISwapChain3_GetBuffer(DxObjects->SwapChain, i, &IID_ID3D12Resource, &DxObjects->RenderTargets[i]));
+			ID3D12Device10_CreateRenderTargetView(Device, DxObjects->RenderTargets[i], NULL, RtvHandle);
+			RtvHandle.ptr += DxObjects->RtvDescriptorSize;
+		}
 	}
-	
-#ifdef _DEBUG
-	THROW_ON_FAIL(ID3D12Resource_SetName(TextureBufferUploadHeap, L"Texture Buffer Upload Resource Heap"));
-#endif
 
-	{
-		WORD* pData;
-		THROW_ON_FAIL(ID3D12Resource_Map(TextureBufferUploadHeap, 0, NULL, &pData));
+	AcquireDepthBuffer(DxObjects, SyncObjects, Width, Height);
+	CreateSceneColor(DxObjects, SyncObjects, Width, Height);
+}
 
-		for (UINT y = 0; y < TEXTURE_HEIGHT; y++)
-		{
-			for (UINT x = 0; x < TEXTURE_WIDTH; x++)
-			{
-				pData[(y * TEXTURE_WIDTH + x) * (BYTES_PER_TEXEL / sizeof(WORD))] = x == 0 || x == (TEXTURE_WIDTH - 1) || y == 0 || y == (TEXTURE_HEIGHT - 1) ? 0b1111100000000000 : rand() * (UINT16_MAX / RAND_MAX);
-			}
-		}
-		
-		ID3D12Resource_Unmap(TextureBufferUploadHeap, 0, NULL);
+//counts the call either way, returns true when it should be dropped
+inline bool EncoderFilter(struct CommandEncoder* restrict Encoder, enum CommandOp Op, bool bRedundant)
+{
+	if (bRedundant)
+		Encoder->Stats->Elided[Op]++;
+	else
+		Encoder->Stats->Issued[Op]++;
 
-		D3D12_TEXTURE_COPY_LOCATION TextureCopyDest = { 0 };
-		TextureCopyDest.pResource = TextureBuffer;
-		TextureCopyDest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-		TextureCopyDest.SubresourceIndex = 0;
+	return bRedundant;
+}
 
-		D3D12_TEXTURE_COPY_LOCATION TextureCopySrc = { 0 };
-		TextureCopySrc.pResource = TextureBufferUploadHeap;
-		TextureCopySrc.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-		TextureCopySrc.PlacedFootprint.Offset = 0;
-		TextureCopySrc.PlacedFootprint.Footprint.Format = TEXTURE_FORMAT;
-		TextureCopySrc.PlacedFootprint.Footprint.Width = TEXTURE_WIDTH;
-		TextureCopySrc.PlacedFootprint.Footprint.Height = TEXTURE_HEIGHT;
-		TextureCopySrc.PlacedFootprint.Footprint.Depth = 1;
-		TextureCopySrc.PlacedFootprint.Footprint.RowPitch = TEXTURE_WIDTH * BYTES_PER_TEXEL;
-		ID3D12GraphicsCommandList7_CopyTextureRegion(DxObjects.CommandList, &TextureCopyDest, 0, 0, 0, &TextureCopySrc, NULL);
-	}
+inline void CaptureCommand(struct CommandStream* restrict Stream, enum CommandOp Op, const void* Payload, UINT Size)
+{
+	const UINT PacketSize = (sizeof(struct CommandPacketHeader) + Size + 7) & ~7;
 
+	if (Stream->Used + PacketSize > COMMAND_STREAM_CAPACITY)
 	{
-		D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
-		TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_COPY;
-		TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_ALL;
-		TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST;
-		TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_COMMON;
-		TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_COMMON;
-		TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
-		TextureBarrier.pResource = TextureBuffer;
-		TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+		Stream->bOverflow = true;
+		return;
+	}
+
+	struct CommandPacketHeader* Header = (struct CommandPacketHeader*)(Stream->Data + Stream->Used);
+	Header->Op = (UINT16)Op;
+	Header->Size = (UINT16)PacketSize;
+	Header->Padding = 0;
+	memcpy(Header + 1, Payload, Size);
+
+	Stream->Used += PacketSize;
+	Stream->PacketCount++;
+}
+
+inline void EncodeTextureBarrier(struct CommandEncoder* restrict Encoder, const D3D12_TEXTURE_BARRIER* Barrier)
+{
+	EncoderFilter(Encoder, COMMAND_TEXTURE_BARRIER, false);
 
+	if (Encoder->CommandList)
+	{
 		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
 		ResourceBarrier.Type = D3D12_BARRIER_TYPE_TEXTURE;
 		ResourceBarrier.NumBarriers = 1;
-		ResourceBarrier.pTextureBarriers = &TextureBarrier;
-		ID3D12GraphicsCommandList7_Barrier(DxObjects.CommandList, 1, &ResourceBarrier);
+		ResourceBarrier.pTextureBarriers = Barrier;
+		ID3D12GraphicsCommandList7_Barrier(Encoder->CommandList, 1, &ResourceBarrier);
 	}
 
-	{
-		D3D12_SHADER_RESOURCE_VIEW_DESC ResourceViewDesc = { 0 };
-		ResourceViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		ResourceViewDesc.Format = TEXTURE_FORMAT;
-		ResourceViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-		ResourceViewDesc.Texture2D.MipLevels = 1;
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_TEXTURE_BARRIER, Barrier, sizeof(*Barrier));
+}
 
-		D3D12_CPU_DESCRIPTOR_HANDLE srvHandle;
-		ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(DxObjects.SRVDescriptorHeap, &srvHandle);
-		ID3D12Device10_CreateShaderResourceView(Device, TextureBuffer, &ResourceViewDesc, srvHandle);
-	}
+inline void EncodeSetRenderTarget(struct CommandEncoder* restrict Encoder, D3D12_CPU_DESCRIPTOR_HANDLE Rtv, D3D12_CPU_DESCRIPTOR_HANDLE Dsv)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_RENDER_TARGET, Encoder->Shadow.RenderTarget.Rtv.ptr == Rtv.ptr && Encoder->Shadow.RenderTarget.Dsv.ptr == Dsv.ptr))
+		return;
 
-	ID3D12GraphicsCommandList7_Close(DxObjects.CommandList);
+	Encoder->Shadow.RenderTarget.Rtv = Rtv;
+	Encoder->Shadow.RenderTarget.Dsv = Dsv;
 
-	ID3D12CommandQueue_ExecuteCommandLists(DxObjects.CommandQueue, 1, &DxObjects.CommandList);
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_OMSetRenderTargets(Encoder->CommandList, Rtv.ptr ? 1 : 0, Rtv.ptr ? &Rtv : NULL, FALSE, Dsv.ptr ? &Dsv : NULL);
 
-	SyncObjects.FenceValue[SyncObjects.FrameIndex]++;
-	THROW_ON_FAIL(ID3D12CommandQueue_Signal(DxObjects.CommandQueue, SyncObjects.Fence[SyncObjects.FrameIndex], SyncObjects.FenceValue[SyncObjects.FrameIndex]));
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_RENDER_TARGET, &(struct CommandRenderTarget) { .Rtv = Rtv, .Dsv = Dsv }, sizeof(struct CommandRenderTarget));
+}
 
-	DxObjects.VertexBufferView.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(DxObjects.VertexBuffer);
-	DxObjects.VertexBufferView.SizeInBytes = sizeof(VertexList);
-	DxObjects.VertexBufferView.StrideInBytes = sizeof(struct Vertex);
+inline void EncodeClearRenderTarget(struct CommandEncoder* restrict Encoder, D3D12_CPU_DESCRIPTOR_HANDLE Rtv, const float Color[4])
+{
+	EncoderFilter(Encoder, COMMAND_CLEAR_RENDER_TARGET, false);
 
-	DxObjects.IndexBufferView.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(DxObjects.IndexBuffer);
-	DxObjects.IndexBufferView.SizeInBytes = sizeof(IndexList);
-	DxObjects.IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_ClearRenderTargetView(Encoder->CommandList, Rtv, Color, 0, NULL);
 
-	WaitForPreviousFrame(&DxObjects, &SyncObjects);
-	THROW_ON_FAIL(ID3D12Resource_Release(VertexBufferUploadHeap));
-	THROW_ON_FAIL(ID3D12Resource_Release(IndexBufferUploadHeap));
-	THROW_ON_FAIL(ID3D12Resource_Release(TextureBufferUploadHeap));
-	THROW_ON_FALSE(SetWindowLongPtrW(Window, GWLP_WNDPROC, (LONG_PTR)WndProc) != 0);
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_CLEAR_RENDER_TARGET, &(struct CommandClear) { .View = Rtv, .Values = { Color[0], Color[1], Color[2], Color[3] } }, sizeof(struct CommandClear));
+}
 
-	DispatchMessageW(&(MSG) {
-		.hwnd = Window,
-		.message = WM_INIT,
-		.wParam = (WPARAM)&(struct WindowProcPayload)
-		{
-			.DxObjects = &DxObjects,
-			.SyncObjects = &SyncObjects
-		},
-		.lParam = 0
-	});
+inline void EncodeClearDepth(struct CommandEncoder* restrict Encoder, D3D12_CPU_DESCRIPTOR_HANDLE Dsv, float Depth)
+{
+	EncoderFilter(Encoder, COMMAND_CLEAR_DEPTH, false);
 
-	DispatchMessageW(&(MSG) {
-		.hwnd = Window,
-		.message = WM_SIZE,
-		.wParam = SIZE_RESTORED,
-		.lParam = MAKELONG(WindowRect.right - WindowRect.left, WindowRect.bottom - WindowRect.top)
-	});
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_ClearDepthStencilView(Encoder->CommandList, Dsv, D3D12_CLEAR_FLAG_DEPTH, Depth, 0, 0, NULL);
 
-	MSG Message = { 0 };
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_CLEAR_DEPTH, &(struct CommandClear) { .View = Dsv, .Values = { Depth } }, sizeof(struct CommandClear));
+}
 
-	while (Message.message != WM_QUIT)
-	{
-		if (PeekMessageW(&Message, NULL, 0, 0, PM_REMOVE))
-		{
-			TranslateMessage(&Message);
-			DispatchMessageW(&Message);
-		}
-	}
+inline void EncodeSetPipelineState(struct CommandEncoder* restrict Encoder, ID3D12PipelineState* PipelineState)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_PIPELINE_STATE, Encoder->Shadow.PipelineState == PipelineState))
+		return;
 
-	WaitForPreviousFrame(&DxObjects, &SyncObjects);
+	Encoder->Shadow.PipelineState = PipelineState;
 
-	for (int i = 0; i < BUFFER_COUNT; i++)
-	{
-		ID3D12Resource_Unmap(ConstantBufferHeaps[i], 0, NULL);
-		THROW_ON_FAIL(ID3D12Resource_Release(ConstantBufferHeaps[i]));
-	}
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetPipelineState(Encoder->CommandList, PipelineState);
 
-	THROW_ON_FAIL(ID3D12PipelineState_Release(DxObjects.PipelineStateObject));
-	
-	THROW_ON_FAIL(ID3D12RootSignature_Release(DxObjects.RootSignature));
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_PIPELINE_STATE, &PipelineState, sizeof(PipelineState));
+}
 
-	for (int i = 0; i < BUFFER_COUNT; i++)
-	{
-		THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.RenderTargets[i]));
-	}
+inline void EncodeSetRootSignature(struct CommandEncoder* restrict Encoder, ID3D12RootSignature* RootSignature)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_ROOT_SIGNATURE, Encoder->Shadow.RootSignature == RootSignature))
+		return;
 
-	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.DepthStencilBuffer));
+	//a new root signature invalidates every root argument
+	Encoder->Shadow.RootSignature = RootSignature;
+	memset(Encoder->Shadow.RootArguments, 0, sizeof(Encoder->Shadow.RootArguments));
 
-	THROW_ON_FAIL(IDXGISwapChain3_Release(DxObjects.SwapChain));
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetGraphicsRootSignature(Encoder->CommandList, RootSignature);
 
-	THROW_ON_FALSE(CloseHandle(SyncObjects.FenceEvent));
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_ROOT_SIGNATURE, &RootSignature, sizeof(RootSignature));
+}
 
-	for (int i = 0; i < BUFFER_COUNT; i++)
-	{
-		THROW_ON_FAIL(ID3D12Fence_Release(SyncObjects.Fence[i]));
-	}
+inline void EncodeSetDescriptorHeap(struct CommandEncoder* restrict Encoder, ID3D12DescriptorHeap* Heap)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_DESCRIPTOR_HEAP, Encoder->Shadow.DescriptorHeap == Heap))
+		return;
 
-	THROW_ON_FAIL(ID3D12GraphicsCommandList7_Release(DxObjects.CommandList));
+	//tables bound against the old heap may not survive the switch
+	Encoder->Shadow.DescriptorHeap = Heap;
+	memset(Encoder->Shadow.RootArguments, 0, sizeof(Encoder->Shadow.RootArguments));
 
-	THROW_ON_FAIL(ID3D12CommandAllocator_Release(DxObjects.CommandAllocator));
-	
-	THROW_ON_FAIL(ID3D12CommandQueue_Release(DxObjects.CommandQueue));
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetDescriptorHeaps(Encoder->CommandList, 1, &Heap);
 
-	THROW_ON_FAIL(ID3D12DescriptorHeap_Release(RtvDescriptorHeap));
-	THROW_ON_FAIL(ID3D12DescriptorHeap_Release(DepthStencilDescriptorHeap)); 
-	THROW_ON_FAIL(ID3D12DescriptorHeap_Release(DxObjects.SRVDescriptorHeap));
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_DESCRIPTOR_HEAP, &Heap, sizeof(Heap));
+}
 
-	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.VertexBuffer));
-	THROW_ON_FAIL(ID3D12Resource_Release(DxObjects.IndexBuffer));
-	THROW_ON_FAIL(ID3D12Resource_Release(TextureBuffer));
+inline void EncodeSetRootTable(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_DESCRIPTOR_HANDLE Handle)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_ROOT_TABLE, Index < ENCODER_ROOT_PARAMETERS && Encoder->Shadow.RootArguments[Index] == Handle.ptr))
+		return;
 
-#ifdef _DEBUG
-	THROW_ON_FAIL(ID3D12InfoQueue_Release(InfoQueue));
-#endif
+	if (Index < ENCODER_ROOT_PARAMETERS)
+		Encoder->Shadow.RootArguments[Index] = Handle.ptr;
 
-	THROW_ON_FAIL(ID3D12Device10_Release(Device));
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetGraphicsRootDescriptorTable(Encoder->CommandList, Index, Handle);
 
-#ifdef _DEBUG
-	THROW_ON_FAIL(ID3D12Debug6_Release(DebugController));
-#endif
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_ROOT_TABLE, &(struct CommandRootArgument) { .Index = Index, .Value = Handle.ptr }, sizeof(struct CommandRootArgument));
+}
 
-	THROW_ON_FALSE(UnregisterClassW(WindowClassName, Instance));
+inline void EncodeSetViewport(struct CommandEncoder* restrict Encoder, const D3D12_VIEWPORT* Viewport)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_VIEWPORT, Encoder->Shadow.bViewport && memcmp(&Encoder->Shadow.Viewport, Viewport, sizeof(*Viewport)) == 0))
+		return;
 
-	THROW_ON_FALSE(DestroyCursor(Cursor));
-	THROW_ON_FALSE(DestroyIcon(Icon));
+	Encoder->Shadow.Viewport = *Viewport;
+	Encoder->Shadow.bViewport = true;
 
-#ifdef _DEBUG
-	{
-		IDXGIDebug1* dxgiDebug;
-		THROW_ON_FAIL(DXGIGetDebugInterface1(0, &IID_IDXGIDebug1, &dxgiDebug));
-		THROW_ON_FAIL(IDXGIDebug1_ReportLiveObjects(dxgiDebug, DXGI_DEBUG_ALL, DXGI_DEBUG_RLO_SUMMARY | DXGI_DEBUG_RLO_IGNORE_INTERNAL));
-	}
-#endif
-	return 0;
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_RSSetViewports(Encoder->CommandList, 1, Viewport);
+
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_VIEWPORT, Viewport, sizeof(*Viewport));
+}
+
+inline void EncodeSetScissor(struct CommandEncoder* restrict Encoder, const D3D12_RECT* ScissorRect)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_SCISSOR, Encoder->Shadow.bScissor && memcmp(&Encoder->Shadow.ScissorRect, ScissorRect, sizeof(*ScissorRect)) == 0))
+		return;
+
+	Encoder->Shadow.ScissorRect = *ScissorRect;
+	Encoder->Shadow.bScissor = true;
+
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_RSSetScissorRects(Encoder->CommandList, 1, ScissorRect);
+
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_SCISSOR, ScissorRect, sizeof(*ScissorRect));
+}
+
+inline void EncodeSetTopology(struct CommandEncoder* restrict Encoder, D3D12_PRIMITIVE_TOPOLOGY Topology)
+{
+	if (EncoderFilter(Encoder, COMMAND_SET_TOPOLOGY, Encoder->Shadow.Topology == Topology))
+		return;
+
+	Encoder->Shadow.Topology = Topology;
+
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_IASetPrimitiveTopology(Encoder->CommandList, Topology);
+
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_TOPOLOGY, &Topology, sizeof(Topology));
 }
 
-LRESULT CALLBACK PreInitProc(HWND Window, UINT message, WPARAM wParam, LPARAM lParam)
+inline void EncodeSetVertexBuffer(struct CommandEncoder* restrict Encoder, const D3D12_VERTEX_BUFFER_VIEW* View)
 {
-	switch (message)
-	{
-	case WM_DESTROY:
-		PostQuitMessage(0);
-		break;
-	default:
-		return DefWindowProcW(Window, message, wParam, lParam);
-	}
-	return 0;
+	if (EncoderFilter(Encoder, COMMAND_SET_VERTEX_BUFFER, memcmp(&Encoder->Shadow.VertexBuffer, View, sizeof(*View)) == 0))
+		return;
+
+	Encoder->Shadow.VertexBuffer = *View;
+
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_IASetVertexBuffers(Encoder->CommandList, 0, 1, View);
+
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_VERTEX_BUFFER, View, sizeof(*View));
 }
 
-LRESULT CALLBACK IdleProc(HWND Window, UINT message, WPARAM wParam, LPARAM lParam)
+inline void EncodeSetIndexBuffer(struct CommandEncoder* restrict Encoder, const D3D12_INDEX_BUFFER_VIEW* View)
 {
-	switch (message)
-	{
-	case WM_PAINT:
-		Sleep(25);
-		break;
-	case WM_SIZE:
-		if (wParam == SIZE_RESTORED)
-			THROW_ON_FALSE(SetWindowLongPtrW(Window, GWLP_WNDPROC, (LONG_PTR)WndProc) != 0);
-		break;
-	case WM_DESTROY:
-		PostQuitMessage(0);
-		break;
-	default:
-		return DefWindowProcW(Window, message, wParam, lParam);
-	}
-	return 0;
+	if (EncoderFilter(Encoder, COMMAND_SET_INDEX_BUFFER, memcmp(&Encoder->Shadow.IndexBuffer, View, sizeof(*View)) == 0))
+		return;
+
+	Encoder->Shadow.IndexBuffer = *View;
+
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_IASetIndexBuffer(Encoder->CommandList, View);
+
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_INDEX_BUFFER, View, sizeof(*View));
 }
 
-LRESULT CALLBACK WndProc(HWND Window, UINT message, WPARAM wParam, LPARAM lParam)
+inline void EncodeSetRootCbv(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_VIRTUAL_ADDRESS Address)
 {
-	static struct
-	{
-		UINT WindowWidth;
-		UINT WindowHeight;
+	if (EncoderFilter(Encoder, COMMAND_SET_ROOT_CBV, Index < ENCODER_ROOT_PARAMETERS && Encoder->Shadow.RootArguments[Index] == Address))
+		return;
 
-		bool bFullScreen;
-		bool bVsync;
+	if (Index < ENCODER_ROOT_PARAMETERS)
+		Encoder->Shadow.RootArguments[Index] = Address;
 
-		D3D12_VIEWPORT Viewport;
-		D3D12_RECT ScissorRect;
-	} WindowDetails = { 0 };
-	
-	static struct
-	{
-		mat4 cube1RotMat;
-		vec3 cube1Position;
-		mat4 cube1WorldMat;
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetGraphicsRootConstantBufferView(Encoder->CommandList, Index, Address);
 
-		mat4 cube2RotMat;
-		vec3 cube2PositionOffset;
-		mat4 cube2WorldMat;
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_ROOT_CBV, &(struct CommandRootArgument) { .Index = Index, .Value = Address }, sizeof(struct CommandRootArgument));
+}
 
-		mat4 cameraViewMat;
-		mat4 cameraProjMat;
-	}
-	Camera = 
-	{
-		.cube1Position = { 0.0f, 0.0f, 0.0f },
-		.cube2PositionOffset = { 1.5f, 0.0f, 0.0f }
-	};
-	
-	static struct
-	{
-		LARGE_INTEGER ProcessorFrequency;
-		LARGE_INTEGER tickCount;
-	} Timer = { 0 };
+inline void EncodeDrawIndexed(struct CommandEncoder* restrict Encoder, UINT IndexCount, UINT InstanceCount, UINT StartIndex, INT BaseVertex, UINT StartInstance)
+{
+	EncoderFilter(Encoder, COMMAND_DRAW_INDEXED, false);
 
-	static struct DxObjects* DxObjects = NULL;
-	static struct SyncObjects* SyncObjects = NULL;
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_DrawIndexedInstanced(Encoder->CommandList, IndexCount, InstanceCount, StartIndex, BaseVertex, StartInstance);
 
-	switch (message)
+	if (Encoder->Capture)
 	{
-	case WM_INIT:
-		WindowDetails.Viewport.TopLeftX = 0;
-		WindowDetails.Viewport.TopLeftY = 0;
-		WindowDetails.Viewport.MinDepth = 0.0f;
-		WindowDetails.Viewport.MaxDepth = 1.0f;
-
-		WindowDetails.ScissorRect.left = 0;
-		WindowDetails.ScissorRect.top = 0;
-
-		QueryPerformanceFrequency(&Timer.ProcessorFrequency);
+		const struct CommandDraw Draw = {
+			.IndexCount = IndexCount,
+			.InstanceCount = InstanceCount,
+			.StartIndex = StartIndex,
+			.BaseVertex = BaseVertex,
+			.StartInstance = StartInstance
+		};
+		CaptureCommand(Encoder->Capture, COMMAND_DRAW_INDEXED, &Draw, sizeof(Draw));
+	}
+}
 
-		DxObjects = ((struct WindowProcPayload*)wParam)->DxObjects;
-		SyncObjects = ((struct WindowProcPayload*)wParam)->SyncObjects;
-		break;
-	case WM_KEYDOWN:
-		switch (wParam)
-		{
-		case VK_ESCAPE:
-			THROW_ON_FALSE(DestroyWindow(Window));
-			break;
-		case 'V':
-			if (!(lParam & 1 << 30))
-				WindowDetails.bVsync = !WindowDetails.bVsync;
-			break;
-		}
-		break;
-	case WM_SYSKEYDOWN:
-		if (wParam == VK_RETURN && (lParam & 0x60000000) == 0x20000000)
-		{
-			WindowDetails.bFullScreen = !WindowDetails.bFullScreen;
+inline void EncodeBufferBarrier(struct CommandEncoder* restrict Encoder, const D3D12_BUFFER_BARRIER* Barrier)
+{
+	EncoderFilter(Encoder, COMMAND_BUFFER_BARRIER, false);
 
-			if (WindowDetails.bFullScreen)
-			{
-				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_EXSTYLE, WS_EX_TOPMOST) != 0);
-				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_STYLE, 0) != 0);
+	if (Encoder->CommandList)
+	{
+		D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
+		ResourceBarrier.Type = D3D12_BARRIER_TYPE_BUFFER;
+		ResourceBarrier.NumBarriers = 1;
+		ResourceBarrier.pBufferBarriers = Barrier;
+		ID3D12GraphicsCommandList7_Barrier(Encoder->CommandList, 1, &ResourceBarrier);
+	}
 
-				THROW_ON_FALSE(ShowWindow(Window, SW_SHOWMAXIMIZED));
-			}
-			else
-			{
-				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_STYLE, WS_OVERLAPPEDWINDOW) != 0);
-				THROW_ON_FALSE(SetWindowLongPtrW(Window, GWL_EXSTYLE, 0) != 0);
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_BUFFER_BARRIER, Barrier, sizeof(*Barrier));
+}
 
-				THROW_ON_FALSE(ShowWindow(Window, SW_SHOWMAXIMIZED));
-			}
-		}
-		break;
-	case WM_SIZE:
-		if (wParam == SIZE_MINIMIZED)
-		{
-			THROW_ON_FALSE(SetWindowLongPtrW(Window, GWLP_WNDPROC, (LONG_PTR)IdleProc) != 0);
-			break;
-		}
+//compute bindings are not shadowed, the culling pass binds them once per frame
+inline void EncodeSetComputeRootSignature(struct CommandEncoder* restrict Encoder, ID3D12RootSignature* RootSignature)
+{
+	EncoderFilter(Encoder, COMMAND_SET_COMPUTE_ROOT_SIGNATURE, false);
 
-		if (WindowDetails.WindowWidth == LOWORD(lParam) && WindowDetails.WindowHeight == HIWORD(lParam))
-			break;
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetComputeRootSignature(Encoder->CommandList, RootSignature);
 
-		WindowDetails.WindowWidth = LOWORD(lParam);
-		WindowDetails.WindowHeight = HIWORD(lParam);
-		
-		WindowDetails.Viewport.Width = WindowDetails.WindowWidth;
-		WindowDetails.Viewport.Height = WindowDetails.WindowHeight;
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_COMPUTE_ROOT_SIGNATURE, &RootSignature, sizeof(RootSignature));
+}
 
-		WindowDetails.ScissorRect.right = WindowDetails.WindowWidth;
-		WindowDetails.ScissorRect.bottom = WindowDetails.WindowHeight;
-		
-		WaitForPreviousFrame(DxObjects, SyncObjects);
-	
-	{
-		mat4 tmpMat;
-		glm_perspective_lh_zo(45.0f * (3.14f / 180.0f), (float)WindowDetails.WindowWidth / (float)WindowDetails.WindowHeight, 0.1f, 1000.0f, tmpMat);
+inline void EncodeSetComputeRootConstants(struct CommandEncoder* restrict Encoder, UINT Index, UINT Count, const void* Values)
+{
+	assert(Count <= CULL_ROOT_CONSTANTS);
 
-		glm_mat4_copy(tmpMat, Camera.cameraProjMat);
+	EncoderFilter(Encoder, COMMAND_SET_COMPUTE_ROOT_CONSTANTS, false);
 
-		vec3 cameraPosition = { 0.0f, 2.0f, -4.0f };
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetComputeRoot32BitConstants(Encoder->CommandList, Index, Count, Values, 0);
 
-		vec3 cameraTarget = { 0.0f , 0.0f , 0.0f };
+	if (Encoder->Capture)
+	{
+		struct CommandRootConstants RootConstants = { .Index = Index, .Count = Count };
+		memcpy(RootConstants.Values, Values, Count * sizeof(UINT));
+		CaptureCommand(Encoder->Capture, COMMAND_SET_COMPUTE_ROOT_CONSTANTS, &RootConstants, (UINT)offsetof(struct CommandRootConstants, Values) + Count * sizeof(UINT));
+	}
+}
 
-		vec3 cameraUp = { 0.0f , 1.0f, 0.0f };
+inline void EncodeSetComputeRootSrv(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_VIRTUAL_ADDRESS Address)
+{
+	EncoderFilter(Encoder, COMMAND_SET_COMPUTE_ROOT_SRV, false);
 
-		vec3 cPos;
-		glm_vec3_copy(cameraPosition, cPos);
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetComputeRootShaderResourceView(Encoder->CommandList, Index, Address);
 
-		vec3 cTarg;
-		glm_vec3_copy(cameraTarget, cTarg);
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_COMPUTE_ROOT_SRV, &(struct CommandRootArgument) { .Index = Index, .Value = Address }, sizeof(struct CommandRootArgument));
+}
 
-		vec3 cUp;
-		glm_vec3_copy(cameraUp, cUp);
+inline void EncodeSetComputeRootUav(struct CommandEncoder* restrict Encoder, UINT Index, D3D12_GPU_VIRTUAL_ADDRESS Address)
+{
+	EncoderFilter(Encoder, COMMAND_SET_COMPUTE_ROOT_UAV, false);
 
-		glm_lookat_lh(cPos, cTarg, cUp, tmpMat);
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetComputeRootUnorderedAccessView(Encoder->CommandList, Index, Address);
 
-		glm_mat4_copy(tmpMat, Camera.cameraViewMat);
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_SET_COMPUTE_ROOT_UAV, &(struct CommandRootArgument) { .Index = Index, .Value = Address }, sizeof(struct CommandRootArgument));
+}
 
-		vec3 posVec;
-		glm_vec3_copy(Camera.cube1Position, posVec);
+inline void EncodeDispatch(struct CommandEncoder* restrict Encoder, UINT X, UINT Y, UINT Z)
+{
+	EncoderFilter(Encoder, COMMAND_DISPATCH, false);
 
-		glm_translate_make(tmpMat, posVec);
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_Dispatch(Encoder->CommandList, X, Y, Z);
 
-		glm_mat4_identity(Camera.cube1RotMat);
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_DISPATCH, (const UINT[]) { X, Y, Z }, sizeof(UINT) * 3);
+}
 
-		glm_mat4_copy(tmpMat, Camera.cube1WorldMat);
+inline void EncodeExecuteIndirect(struct CommandEncoder* restrict Encoder, ID3D12CommandSignature* Signature, UINT MaxCommandCount, ID3D12Resource* ArgumentBuffer, ID3D12Resource* CountBuffer)
+{
+	EncoderFilter(Encoder, COMMAND_EXECUTE_INDIRECT, false);
 
-		glm_vec3_add(Camera.cube2PositionOffset, Camera.cube1Position, posVec);
+	//the commands overwrite root arguments, so nothing bound before can be assumed afterwards
+	memset(Encoder->Shadow.RootArguments, 0, sizeof(Encoder->Shadow.RootArguments));
 
-		glm_translate_make(tmpMat, posVec);
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_ExecuteIndirect(Encoder->CommandList, Signature, MaxCommandCount, ArgumentBuffer, 0, CountBuffer, 0);
 
-		glm_mat4_identity(Camera.cube2RotMat);
+	if (Encoder->Capture)
+	{
+		const struct CommandExecuteIndirect Indirect = {
+			.Signature = Signature,
+			.ArgumentBuffer = ArgumentBuffer,
+			.CountBuffer = CountBuffer,
+			.MaxCommandCount = MaxCommandCount
+		};
+		CaptureCommand(Encoder->Capture, COMMAND_EXECUTE_INDIRECT, &Indirect, sizeof(Indirect));
+	}
+}
 
-		glm_mat4_copy(tmpMat, Camera.cube2WorldMat);
+inline void EncodeExecuteBundle(struct CommandEncoder* restrict Encoder, ID3D12GraphicsCommandList7* Bundle)
+{
+	EncoderFilter(Encoder, COMMAND_EXECUTE_BUNDLE, false);
 
-		if (DxObjects->RenderTargets[0])
-		{
-			for (int i = 0; i < BUFFER_COUNT; i++)
-			{
-				THROW_ON_FAIL(ID3D12Resource_Release(DxObjects->RenderTargets[i]));
-				SyncObjects->FenceValue[i] = SyncObjects->FenceValue[SyncObjects->FrameIndex] + 1;
-			}
-		}
+	//whatever the bundle binds stays bound on the calling list, only the heap and output state are known to survive
+	Encoder->Shadow.PipelineState = NULL;
+	Encoder->Shadow.RootSignature = NULL;
+	memset(Encoder->Shadow.RootArguments, 0, sizeof(Encoder->Shadow.RootArguments));
+	Encoder->Shadow.Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	Encoder->Shadow.VertexBuffer = (D3D12_VERTEX_BUFFER_VIEW){ 0 };
+	Encoder->Shadow.IndexBuffer = (D3D12_INDEX_BUFFER_VIEW){ 0 };
 
-		THROW_ON_FAIL(IDXGISwapChain3_ResizeBuffers(DxObjects->SwapChain, BUFFER_COUNT, WindowDetails.WindowWidth, WindowDetails.WindowHeight, RTV_FORMAT, DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING));
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_ExecuteBundle(Encoder->CommandList, (ID3D12GraphicsCommandList*)Bundle);
 
-		SyncObjects->FrameIndex = IDXGISwapChain3_GetCurrentBackBufferIndex(DxObjects->SwapChain);
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_EXECUTE_BUNDLE, &Bundle, sizeof(Bundle));
+}
 
-		{
-			D3D12_CPU_DESCRIPTOR_HANDLE RtvHandle = DxObjects->RtvHeapHandle;
+inline void EncodeSetRootConstants(struct CommandEncoder* restrict Encoder, UINT Index, UINT Count, const void* Values)
+{
+	assert(Count <= CULL_ROOT_CONSTANTS);
 
-			for (int i = 0; i < BUFFER_COUNT; i++)
-			{
-				THROW_ON_FAIL(IDXGISwapChain3_GetBuffer(DxObjects->SwapChain, i, &IID_ID3D12Resource, &DxObjects->RenderTargets[i]));
-				ID3D12Device10_CreateRenderTargetView(Device, DxObjects->RenderTargets[i], NULL, RtvHandle);
-				RtvHandle.ptr += DxObjects->RtvDescriptorSize;
-			}
-		}
+	EncoderFilter(Encoder, COMMAND_SET_ROOT_CONSTANTS, false);
 
-		if(DxObjects->DepthStencilBuffer)
-		{
-			THROW_ON_FAIL(ID3D12Resource_Release(DxObjects->DepthStencilBuffer));
-		}
+	//the slot no longer holds whatever descriptor the shadow remembers for it
+	if (Index < ENCODER_ROOT_PARAMETERS)
+		Encoder->Shadow.RootArguments[Index] = 0;
 
-		{
-			D3D12_HEAP_PROPERTIES HeapProperties = { 0 };
-			HeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
-			HeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-			HeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_SetGraphicsRoot32BitConstants(Encoder->CommandList, Index, Count, Values, 0);
 
-			D3D12_RESOURCE_DESC1 ResourceDesc = { 0 };
-			ResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-			ResourceDesc.Alignment = 0;
-			ResourceDesc.Width = WindowDetails.WindowWidth;
-			ResourceDesc.Height = WindowDetails.WindowHeight;
-			ResourceDesc.DepthOrArraySize = 1;
-			ResourceDesc.MipLevels = 1;
-			ResourceDesc.Format = DSV_FORMAT;
-			ResourceDesc.SampleDesc.Count = 1;
-			ResourceDesc.SampleDesc.Quality = 0;
-			ResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-			ResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+	if (Encoder->Capture)
+	{
+		struct CommandRootConstants RootConstants = { .Index = Index, .Count = Count };
+		memcpy(RootConstants.Values, Values, Count * sizeof(UINT));
+		CaptureCommand(Encoder->Capture, COMMAND_SET_ROOT_CONSTANTS, &RootConstants, (UINT)offsetof(struct CommandRootConstants, Values) + Count * sizeof(UINT));
+	}
+}
 
-			D3D12_CLEAR_VALUE ScreenClearValue = { 0 };
-			ScreenClearValue.Format = DSV_FORMAT;
-			ScreenClearValue.DepthStencil.Depth = 1.0f;
-			ScreenClearValue.DepthStencil.Stencil = 0;
+inline void EncodeDraw(struct CommandEncoder* restrict Encoder, UINT VertexCount, UINT InstanceCount, UINT StartVertex, UINT StartInstance)
+{
+	EncoderFilter(Encoder, COMMAND_DRAW, false);
 
-			THROW_ON_FAIL(ID3D12Device10_CreateCommittedResource3(Device, &HeapProperties, D3D12_HEAP_FLAG_NONE, &ResourceDesc, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE, &ScreenClearValue, NULL, 0, NULL, &IID_ID3D12Resource, &DxObjects->DepthStencilBuffer));
-		}
+	if (Encoder->CommandList)
+		ID3D12GraphicsCommandList7_DrawInstanced(Encoder->CommandList, VertexCount, InstanceCount, StartVertex, StartInstance);
 
-#ifdef _DEBUG
-		THROW_ON_FAIL(ID3D12Resource_SetName(DxObjects->DepthStencilBuffer, L"Depth/Stencil Buffer"));
-#endif
+	if (Encoder->Capture)
+		CaptureCommand(Encoder->Capture, COMMAND_DRAW, (const UINT[]) { VertexCount, InstanceCount, StartVertex, StartInstance }, sizeof(UINT) * 4);
+}
 
+inline void ResidencyUse(struct ResidencyManager* restrict Manager, ID3D12Resource* Resource)
+{
+	for (UINT i = 0; i < RESIDENCY_MAX_OBJECTS; i++)
+	{
+		if (Manager->bTracked[i] && Manager->Objects[i] == (ID3D12Pageable*)Resource)
 		{
-			D3D12_DEPTH_STENCIL_VIEW_DESC DepthStencilViewDesc = { 0 };
-			DepthStencilViewDesc.Format = DSV_FORMAT;
-			DepthStencilViewDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-			DepthStencilViewDesc.Flags = D3D12_DSV_FLAG_NONE;
-			ID3D12Device10_CreateDepthStencilView(Device, DxObjects->DepthStencilBuffer, &DepthStencilViewDesc, DxObjects->DsvHeapHandle);
+			Manager->bUsed[i] = true;
+			return;
 		}
-		break;
 	}
-	case WM_PAINT:
-	{
-		WaitForPreviousFrame(DxObjects, SyncObjects);
+}
 
-		LARGE_INTEGER tickCountNow;
-		QueryPerformanceCounter(&tickCountNow);
-		ULONGLONG tickCountDelta = tickCountNow.QuadPart - Timer.tickCount.QuadPart;
-		Timer.tickCount.QuadPart = tickCountNow.QuadPart;
+inline UINT64 ResourceAllocationSize(const D3D12_RESOURCE_DESC1* Desc)
+{
+	D3D12_RESOURCE_ALLOCATION_INFO AllocationInfo;
+	ID3D12Device10_GetResourceAllocationInfo2(Device, &AllocationInfo, 0, 1, Desc, NULL);
+	return AllocationInfo.SizeInBytes;
+}
 
-		float MovementFactor = (tickCountDelta / ((float)Timer.ProcessorFrequency.QuadPart)) * 75.f;
+//layer:4 pipeline:10 root signature:6 descriptor table:12 mesh:12 depth:20, most significant first
+inline UINT64 MakeDrawKey(UINT Layer, UINT Pipeline, UINT RootSignature, UINT DescriptorTable, UINT Mesh, float Depth)
+{
+	const float Normalized = min(max(Depth / DRAW_KEY_MAX_DEPTH, 0.0f), 1.0f);
+	const UINT64 QuantizedDepth = (UINT64)(Normalized * ((1 << 20) - 1));
+
+	return ((UINT64)(Layer & 0xF) << 60) |
+		((UINT64)(Pipeline & 0x3FF) << 50) |
+		((UINT64)(RootSignature & 0x3F) << 44) |
+		((UINT64)(DescriptorTable & 0xFFF) << 32) |
+		((UINT64)(Mesh & 0xFFF) << 20) |
+		QuantizedDepth;
+}
 
-		mat4 rotXMat;
-		glm_mat4_identity(rotXMat);
-		glm_rotate_x(rotXMat, 0.01f * MovementFactor, rotXMat);
+inline void PushDrawPacket(struct DrawQueue* restrict Queue, UINT64 Key, const struct DrawPacket* restrict Packet)
+{
+	//a full queue loses the draw for this frame rather than writing past the end
+	if (Queue->Count == Queue->Capacity)
+	{
+		Queue->Dropped++;
+		return;
+	}
 
-		mat4 rotYMat;
-		glm_mat4_identity(rotYMat);
-		glm_rotate_y(rotYMat, 0.02f * MovementFactor, rotYMat);
+	Queue->Packets[Queue->Count] = *Packet;
+	Queue->Entries[Queue->Count].Key = Key;
+	Queue->Entries[Queue->Count].Index = Queue->Count;
+	Queue->Count++;
+}
 
-		mat4 rotZMat;
-		glm_mat4_identity(rotZMat);
-		glm_rotate_z(rotZMat, 0.03f * MovementFactor, rotZMat);
+inline void RunRadixPhase(struct DrawQueue* restrict Queue)
+{
+	Queue->Job.NextChunk = 0;
 
-		mat4 rotMat;
-		glm_mat4_mul(Camera.cube1RotMat, rotXMat, rotMat);
-		glm_mat4_mul(rotMat, rotYMat, rotMat);
-		glm_mat4_mul(rotMat, rotZMat, rotMat);
-		glm_mat4_copy(rotMat, Camera.cube1RotMat);
+	if (Queue->Job.ChunkCount == 1)
+	{
+		RadixSortWork(NULL, &Queue->Job, NULL);
+		return;
+	}
 
-		mat4 translationMat;
-		glm_translate_make(translationMat, Camera.cube1Position);
+	for (UINT i = 0; i < Queue->Job.ChunkCount; i++)
+	{
+		SubmitThreadpoolWork(Queue->SortWork);
+	}
 
-		mat4 worldMat;
-		glm_mat4_mul(rotMat, translationMat, worldMat);
-		glm_mat4_copy(worldMat, Camera.cube1WorldMat);
+	WaitForThreadpoolWorkCallbacks(Queue->SortWork, FALSE);
+}
 
-		mat4 viewMat;
-		glm_mat4_copy(Camera.cameraViewMat, viewMat);
+inline void SetGpuObject(struct GpuObject* restrict Object, const mat4 WorldMat, float Radius, D3D12_GPU_VIRTUAL_ADDRESS Constants)
+{
+	Object->Sphere[0] = WorldMat[3][0];
+	Object->Sphere[1] = WorldMat[3][1];
+	Object->Sphere[2] = WorldMat[3][2];
+	Object->Sphere[3] = Radius;
+	Object->ConstantsLow = (UINT)Constants;
+	Object->ConstantsHigh = (UINT)(Constants >> 32);
+	Object->IndexCount = NUM_CUBE_INDICES;
+	Object->StartIndex = 0;
+}
 
-		mat4 projMat;
-		glm_mat4_copy(Camera.cameraProjMat, projMat);
+inline bool BundleCacheLookup(struct BundleCache* restrict Cache, UINT Slot, UINT64 Key)
+{
+	if (Cache->Keys[Slot] == Key)
+	{
+		Cache->Hits++;
+		return true;
+	}
 
-		mat4 wvpMat;
-		glm_mat4_mul(projMat, viewMat, wvpMat);
-		glm_mat4_mul(wvpMat, Camera.cube1WorldMat, wvpMat);
+	Cache->Keys[Slot] = Key;
+	Cache->Rebuilds++;
+	return false;
+}
 
-		mat4 ConstantBufferPerObject = { 0 };
-		mat4 transposed;
-		glm_mat4_transpose_to(wvpMat, transposed);
-		glm_mat4_copy(transposed, ConstantBufferPerObject);
+//eight pixels of one row per step, the span starts on a multiple of 8 so it never leaves the row
+inline void RasterizeOcclusionSpanAvx2(float* restrict Depth, int MinX, int MaxX, float Py, const float* restrict EdgeA, const float* restrict EdgeB, const float* restrict EdgeC, const float* restrict Plane)
+{
+	const __m256 PixelOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 Zero = _mm256_setzero_ps();
 
-		memcpy(DxObjects->ConstantBufferCPUAddress[SyncObjects->FrameIndex], &ConstantBufferPerObject, sizeof(ConstantBufferPerObject));
+	const __m256 A0 = _mm256_set1_ps(EdgeA[0]);
+	const __m256 A1 = _mm256_set1_ps(EdgeA[1]);
+	const __m256 A2 = _mm256_set1_ps(EdgeA[2]);
+	const __m256 AZ = _mm256_set1_ps(Plane[0]);
 
-		glm_mat4_identity(rotXMat);
-		glm_rotate_x(rotXMat, 0.03f * MovementFactor, rotXMat);
+	const __m256 Row0 = _mm256_set1_ps(EdgeB[0] * Py + EdgeC[0]);
+	const __m256 Row1 = _mm256_set1_ps(EdgeB[1] * Py + EdgeC[1]);
+	const __m256 Row2 = _mm256_set1_ps(EdgeB[2] * Py + EdgeC[2]);
+	const __m256 RowZ = _mm256_set1_ps(Plane[1] * Py + Plane[2]);
 
-		glm_mat4_identity(rotYMat);
-		glm_rotate_y(rotYMat, 0.02f * MovementFactor, rotYMat);
+	for (int x = MinX & ~7; x <= MaxX; x += 8)
+	{
+		const __m256 Px = _mm256_add_ps(_mm256_set1_ps((float)x), PixelOffsets);
 
-		glm_mat4_identity(rotZMat);
-		glm_rotate_z(rotZMat, 0.01f * MovementFactor, rotZMat);
+		__m256 Mask = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(A0, Px), Row0), Zero, _CMP_GE_OQ);
+		Mask = _mm256_and_ps(Mask, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(A1, Px), Row1), Zero, _CMP_GE_OQ));
+		Mask = _mm256_and_ps(Mask, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(A2, Px), Row2), Zero, _CMP_GE_OQ));
 
-		glm_mat4_mul(rotZMat, rotYMat, rotMat);
-		glm_mat4_mul(rotMat, rotXMat, rotMat);
-		glm_mat4_mul(rotMat, Camera.cube2RotMat, rotMat);
+		if (_mm256_movemask_ps(Mask) == 0)
+			continue;
 
-		glm_mat4_copy(rotMat, Camera.cube2RotMat);
+		const __m256 Z = _mm256_add_ps(_mm256_mul_ps(AZ, Px), RowZ);
+		const __m256 Old = _mm256_loadu_ps(Depth + x);
+		_mm256_storeu_ps(Depth + x, _mm256_blendv_ps(Old, _mm256_min_ps(Old, Z), Mask));
+	}
+}
 
-		mat4 translationOffsetMat;
-		glm_translate_make(translationOffsetMat, Camera.cube2PositionOffset);
+//returns the block edge in texels, 4 for bc formats and 1 otherwise, or 0 for formats the loader does not know
+inline UINT TextureSurfaceInfo(DXGI_FORMAT Format, UINT Width, UINT Height, UINT64* restrict RowBytes, UINT* restrict RowCount)
+{
+	UINT BlockSize = 1;
+	UINT BlockBytes;
 
-		mat4 scaleMat;
-		const vec3 scaleVec = { 0.5f, 0.5f, 0.5f };
-		glm_scale_make(scaleMat, scaleVec);
+	switch (Format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		BlockSize = 4;
+		BlockBytes = 8;
+		break;
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		BlockSize = 4;
+		BlockBytes = 16;
+		break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		BlockBytes = 16;
+		break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		BlockBytes = 8;
+		break;
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		BlockBytes = 4;
+		break;
+	case DXGI_FORMAT_B5G6R5_UNORM:
+		BlockBytes = 2;
+		break;
+	case DXGI_FORMAT_R8_UNORM:
+		BlockBytes = 1;
+		break;
+	default:
+		return 0;
+	}
 
-		glm_mat4_mul(translationMat, rotMat, worldMat);
-		glm_mat4_mul(worldMat, translationOffsetMat, worldMat);
-		glm_mat4_mul(worldMat, scaleMat, worldMat);
+	*RowBytes = (UINT64)((Width + BlockSize - 1) / BlockSize) * BlockBytes;
+	*RowCount = (Height + BlockSize - 1) / BlockSize;
+	return BlockSize;
+}
 
-		glm_mat4_mul(projMat, viewMat, wvpMat);
-		glm_mat4_mul(wvpMat, Camera.cube2WorldMat, wvpMat);
+inline void RunParticlePhase(struct ParticleSystem* restrict System)
+{
+	System->Job.NextChunk = 0;
 
-		glm_mat4_transpose_to(wvpMat, transposed);
-		glm_mat4_copy(transposed, ConstantBufferPerObject);
+	if (System->Job.ChunkCount == 1)
+	{
+		ParticleWork(NULL, &System->Job, NULL);
+		return;
+	}
 
-		memcpy(DxObjects->ConstantBufferCPUAddress[SyncObjects->FrameIndex] + ConstantBufferPerObjectAlignedSize, &ConstantBufferPerObject, sizeof(ConstantBufferPerObject));
+	for (UINT i = 0; i < System->Job.ChunkCount; i++)
+	{
+		SubmitThreadpoolWork(System->Work);
+	}
 
-		glm_mat4_copy(worldMat, Camera.cube2WorldMat);
+	WaitForThreadpoolWorkCallbacks(System->Work, FALSE);
+}
 
-		THROW_ON_FAIL(ID3D12CommandAllocator_Reset(DxObjects->CommandAllocator));
-		THROW_ON_FAIL(ID3D12GraphicsCommandList7_Reset(DxObjects->CommandList, DxObjects->CommandAllocator, DxObjects->PipelineStateObject));
+//the tile an ndc coordinate falls in, anything off the edge goes to the edge tile
+inline UINT ClusterTile(float Ndc, UINT TileCount)
+{
+	return (UINT)min(max((Ndc + 1.0f) * 0.5f * TileCount, 0.0f), TileCount - 1.0f);
+}
 
-		{
-			D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
-			TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_ALL;
-			TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_RENDER_TARGET;
-			TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_COMMON;
-			TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_RENDER_TARGET;
-			TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_PRESENT;
-			TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
-			TextureBarrier.pResource = DxObjects->RenderTargets[SyncObjects->FrameIndex];
-			TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+//the slice holding Depth, clamped to the grid
+inline UINT ClusterSlice(const struct ClusterGrid* restrict Grid, float Depth)
+{
+	UINT Slice = 0;
 
-			D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
-			ResourceBarrier.Type = D3D12_BARRIER_TYPE_TEXTURE;
-			ResourceBarrier.NumBarriers = 1;
-			ResourceBarrier.pTextureBarriers = &TextureBarrier;
-			ID3D12GraphicsCommandList7_Barrier(DxObjects->CommandList, 1, &ResourceBarrier);
-		}
+	while (Slice + 1 < CLUSTER_SLICES && Grid->SliceDepths[Slice + 1] <= Depth)
+		Slice++;
 
-		const D3D12_CPU_DESCRIPTOR_HANDLE RtvHandle = { .ptr = DxObjects->RtvHeapHandle.ptr + (SyncObjects->FrameIndex * DxObjects->RtvDescriptorSize) };
+	return Slice;
+}
 
-		ID3D12GraphicsCommandList7_OMSetRenderTargets(DxObjects->CommandList, 1, &RtvHandle, FALSE, &DxObjects->DsvHeapHandle);
-		ID3D12GraphicsCommandList7_ClearRenderTargetView(DxObjects->CommandList, RtvHandle, ((const float[]) { 0.0f, 0.2f, 0.4f, 1.0f }), 0, NULL);
-		ID3D12GraphicsCommandList7_ClearDepthStencilView(DxObjects->CommandList, DxObjects->DsvHeapHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, NULL);
-		
-		ID3D12GraphicsCommandList7_SetGraphicsRootSignature(DxObjects->CommandList, DxObjects->RootSignature);
-
-		ID3D12GraphicsCommandList7_SetDescriptorHeaps(DxObjects->CommandList, 1, &DxObjects->SRVDescriptorHeap);
-
-		ID3D12GraphicsCommandList7_SetGraphicsRootDescriptorTable(DxObjects->CommandList, 1, DxObjects->SrvGpuHandle);
-		ID3D12GraphicsCommandList7_RSSetViewports(DxObjects->CommandList, 1, &WindowDetails.Viewport);
-		ID3D12GraphicsCommandList7_RSSetScissorRects(DxObjects->CommandList, 1, &WindowDetails.ScissorRect);
-		ID3D12GraphicsCommandList7_IASetPrimitiveTopology(DxObjects->CommandList, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		ID3D12GraphicsCommandList7_IASetVertexBuffers(DxObjects->CommandList, 0, 1, &DxObjects->VertexBufferView);
-		ID3D12GraphicsCommandList7_IASetIndexBuffer(DxObjects->CommandList, &DxObjects->IndexBufferView);
-		ID3D12GraphicsCommandList7_SetGraphicsRootConstantBufferView(DxObjects->CommandList, 0, DxObjects->ContantBufferGPUAddress[SyncObjects->FrameIndex]);
-		ID3D12GraphicsCommandList7_DrawIndexedInstanced(DxObjects->CommandList, NUM_CUBE_INDICES, 1, 0, 0, 0);
-		ID3D12GraphicsCommandList7_SetGraphicsRootConstantBufferView(DxObjects->CommandList, 0, DxObjects->ContantBufferGPUAddress[SyncObjects->FrameIndex] + ConstantBufferPerObjectAlignedSize);
-		ID3D12GraphicsCommandList7_DrawIndexedInstanced(DxObjects->CommandList, NUM_CUBE_INDICES, 1, 0, 0, 0);
-
-		{
-			D3D12_TEXTURE_BARRIER TextureBarrier = { 0 };
-			TextureBarrier.SyncBefore = D3D12_BARRIER_SYNC_RENDER_TARGET;
-			TextureBarrier.SyncAfter = D3D12_BARRIER_SYNC_ALL;
-			TextureBarrier.AccessBefore = D3D12_BARRIER_ACCESS_RENDER_TARGET;
-			TextureBarrier.AccessAfter = D3D12_BARRIER_ACCESS_COMMON;
-			TextureBarrier.LayoutBefore = D3D12_BARRIER_LAYOUT_RENDER_TARGET;
-			TextureBarrier.LayoutAfter = D3D12_BARRIER_LAYOUT_PRESENT;
-			TextureBarrier.pResource = DxObjects->RenderTargets[SyncObjects->FrameIndex];
-			TextureBarrier.Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE;
+//inclusive x, y and slice ranges of the clusters the light could touch, false when it is outside the frustum
+inline bool ClusterLightBounds(const struct ClusterGrid* restrict Grid, const struct GpuLight* restrict Light, UINT* restrict Bounds)
+{
+	const float NearZ = max(Light->Position[2] - Light->Radius, Grid->Near);
+	const float FarZ = min(Light->Position[2] + Light->Radius, Grid->Far);
+
+	if (NearZ > FarZ)
+		return false;
+
+	//x / z over the box around the sphere is extreme at one of its corners
+	const float Left = min((Light->Position[0] - Light->Radius) / NearZ, (Light->Position[0] - Light->Radius) / FarZ) * Grid->Projection[0];
+	const float Right = max((Light->Position[0] + Light->Radius) / NearZ, (Light->Position[0] + Light->Radius) / FarZ) * Grid->Projection[0];
+	const float Bottom = min((Light->Position[1] - Light->Radius) / NearZ, (Light->Position[1] - Light->Radius) / FarZ) * Grid->Projection[1];
+	const float Top = max((Light->Position[1] + Light->Radius) / NearZ, (Light->Position[1] + Light->Radius) / FarZ) * Grid->Projection[1];
+
+	if (Right < -1.0f || Left > 1.0f || Top < -1.0f || Bottom > 1.0f)
+		return false;
+
+	//tile rows count down from the top of the screen
+	Bounds[0] = ClusterTile(Left, CLUSTER_TILES_X);
+	Bounds[1] = ClusterTile(Right, CLUSTER_TILES_X);
+	Bounds[2] = ClusterTile(-Top, CLUSTER_TILES_Y);
+	Bounds[3] = ClusterTile(-Bottom, CLUSTER_TILES_Y);
+	Bounds[4] = ClusterSlice(Grid, NearZ);
+	Bounds[5] = ClusterSlice(Grid, FarZ);
+
+	return true;
+}
 
-			D3D12_BARRIER_GROUP ResourceBarrier = { 0 };
-			ResourceBarrier.Type = D3D12_BARRIER_TYPE_TEXTURE;
-			ResourceBarrier.NumBarriers = 1;
-			ResourceBarrier.pTextureBarriers = &TextureBarrier;
-			ID3D12GraphicsCommandList7_Barrier(DxObjects->CommandList, 1, &ResourceBarrier);
-		}
+//the cube's corner distance along the longest axis of WorldMat
+inline float ShadowCasterRadius(const mat4 WorldMat)
+{
+	return CUBE_BOUNDING_RADIUS * sqrtf(max(max(glm_vec3_norm2(WorldMat[0]), glm_vec3_norm2(WorldMat[1])), glm_vec3_norm2(WorldMat[2])));
+}
 
-		THROW_ON_FAIL(ID3D12GraphicsCommandList7_Close(DxObjects->CommandList));
+//the caster's sphere against the cascade's light space box, which reaches SHADOW_CASTER_RANGE back towards the sun
+inline bool ShadowCascadeTest(const struct ShadowCascade* restrict Cascade, const mat4 LightView, const struct ShadowCaster* restrict Caster)
+{
+	vec3 Center;
+	glm_mat4_mulv3(LightView, Caster->WorldMat[3], 1.0f, Center);
 
-		ID3D12CommandQueue_ExecuteCommandLists(DxObjects->CommandQueue, 1, &DxObjects->CommandList);
+	const float Min[3] = { Cascade->Center[0] - Cascade->Radius, Cascade->Center[1] - Cascade->Radius, Cascade->Center[2] - Cascade->Radius - SHADOW_CASTER_RANGE };
+	const float Max[3] = { Cascade->Center[0] + Cascade->Radius, Cascade->Center[1] + Cascade->Radius, Cascade->Center[2] + Cascade->Radius };
 
-		THROW_ON_FAIL(ID3D12CommandQueue_Signal(DxObjects->CommandQueue, SyncObjects->Fence[SyncObjects->FrameIndex], SyncObjects->FenceValue[SyncObjects->FrameIndex]));
+	float Distance2 = 0.0f;
 
-		THROW_ON_FAIL(IDXGISwapChain3_Present(DxObjects->SwapChain, WindowDetails.bVsync ? 1 : 0, WindowDetails.bVsync ? 0 : DXGI_PRESENT_ALLOW_TEARING));
-		break;
-	}
-	case WM_DESTROY:
-		PostQuitMessage(0);
-		break;
-	default:
-		return DefWindowProcW(Window, message, wParam, lParam);
+	for (UINT i = 0; i < 3; i++)
+	{
+		const float Outside = max(Min[i] - Center[i], 0.0f) + max(Center[i] - Max[i], 0.0f);
+		Distance2 += Outside * Outside;
 	}
-	return 0;
+
+	return Distance2 <= Caster->Radius * Caster->Radius;
 }
 
-inline void WaitForPreviousFrame(struct DxObjects* restrict DxObjects, struct SyncObjects* restrict SyncObjects)
+//FNV-1a a word at a time, cheap enough to run over every recorded frame
+inline UINT64 BitmapChecksum(const UINT8* Data, UINT Size)
 {
-	SyncObjects->FrameIndex = IDXGISwapChain3_GetCurrentBackBufferIndex(DxObjects->SwapChain);
-	THROW_ON_FAIL(ID3D12CommandQueue_Signal(DxObjects->CommandQueue, SyncObjects->Fence[SyncObjects->FrameIndex], ++SyncObjects->FenceValue[SyncObjects->FrameIndex]));
+	UINT64 Hash = 0xCBF29CE484222325;
 
-	if (ID3D12Fence_GetCompletedValue(SyncObjects->Fence[SyncObjects->FrameIndex]) < SyncObjects->FenceValue[SyncObjects->FrameIndex])
+	for (UINT i = 0; i < Size; i += 8)
 	{
-		THROW_ON_FAIL(ID3D12Fence_SetEventOnCompletion(SyncObjects->Fence[SyncObjects->FrameIndex], SyncObjects->FenceValue[SyncObjects->FrameIndex], SyncObjects->FenceEvent));
-		THROW_ON_FALSE(WaitForSingleObject(SyncObjects->FenceEvent, INFINITE) == WAIT_OBJECT_0);
+		UINT64 Word = 0;
+		memcpy(&Word, Data + i, min(Size - i, 8));
+		Hash = (Hash ^ Word) * 0x100000001B3;
 	}
+
+	return Hash;
 }
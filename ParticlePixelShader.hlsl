@@ -0,0 +1,13 @@
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float2 offset : TEXCOORD;
+    float4 color : COLOR;
+};
+
+//a soft round spot, fading to nothing at the edge of the quad
+float4 main(VS_OUTPUT input) : SV_TARGET
+{
+    float falloff = saturate(1.0f - dot(input.offset, input.offset));
+    return float4(input.color.rgb, input.color.a * falloff);
+}
@@ -0,0 +1,41 @@
+struct VS_INPUT
+{
+    float3 center : POSITION;
+    float size : SIZE;
+    float4 color : COLOR;
+};
+
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float2 offset : TEXCOORD;
+    float4 color : COLOR;
+};
+
+struct ParticleConstants
+{
+    float4x4 viewProj;
+    float3 right;
+    float3 up;
+};
+
+ConstantBuffer<ParticleConstants> particles : register(b0);
+
+static const float2 corners[6] =
+{
+    float2(-1.0f, -1.0f), float2(-1.0f, 1.0f), float2(1.0f, -1.0f),
+    float2(1.0f, -1.0f), float2(-1.0f, 1.0f), float2(1.0f, 1.0f)
+};
+
+//one camera facing quad per instance, the corner comes from SV_VertexID
+VS_OUTPUT main(VS_INPUT input, uint id : SV_VertexID)
+{
+    float2 corner = corners[id];
+    float3 position = input.center + (particles.right * corner.x + particles.up * corner.y) * input.size;
+
+    VS_OUTPUT output;
+    output.pos = mul(float4(position, 1.0f), particles.viewProj);
+    output.offset = corner;
+    output.color = input.color;
+    return output;
+}
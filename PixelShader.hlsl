@@ -1,5 +1,44 @@
+struct Light
+{
+    float3 position;
+    float radius;
+    float3 color;
+    float padding;
+};
+
+struct ClusterConstants
+{
+    float4 viewport;
+    float4 projection;
+    float sliceScale;
+    float sliceBias;
+    float ambient;
+    uint enabled;
+    uint4 grid;
+};
+
+struct ShadowConstants
+{
+    float4x4 viewToShadow[4];
+    float4 splits;
+    float3 sunDirection;
+    float padding0;
+    float3 sunColor;
+    float padding1;
+    uint enabled;
+    uint firstCached;
+};
+
 Texture2D t1 : register(t0);
+StructuredBuffer<Light> lights : register(t1);
+StructuredBuffer<uint2> clusterRanges : register(t2);
+StructuredBuffer<uint> lightIndices : register(t3);
+Texture2DArray<float> shadowMaps : register(t4);
+Texture2DArray<float> staticShadowMaps : register(t5);
+ConstantBuffer<ClusterConstants> clusters : register(b1);
+ConstantBuffer<ShadowConstants> shadows : register(b2);
 SamplerState s1 : register(s0);
+SamplerComparisonState shadowSampler : register(s1);
 
 struct VS_OUTPUT
 {
@@ -7,7 +46,64 @@ struct VS_OUTPUT
     float2 texCoord : TEXCOORD;
 };
 
+//the cascades past firstCached keep their static casters in a map of their own, a texel is lit only if both maps say so
+float ShadowVisibility(float3 position, float depth)
+{
+    if (depth > shadows.splits.w)
+        return 1;
+
+    uint cascade = 0;
+
+    [unroll]
+    for (uint i = 0; i < 3; i++)
+        cascade += depth > shadows.splits[i] ? 1 : 0;
+
+    float4 shadowPosition = mul(float4(position, 1), shadows.viewToShadow[cascade]);
+    float3 uv = float3(shadowPosition.xy * float2(0.5, -0.5) + 0.5, cascade);
+
+    float visibility = shadowMaps.SampleCmpLevelZero(shadowSampler, uv, shadowPosition.z);
+
+    if (cascade >= shadows.firstCached)
+        visibility *= staticShadowMaps.SampleCmpLevelZero(shadowSampler, uv, shadowPosition.z);
+
+    return visibility;
+}
+
 float4 main(VS_OUTPUT input) : SV_TARGET
 {
-    return t1.Sample(s1, input.texCoord);
+    float4 albedo = t1.Sample(s1, input.texCoord);
+
+    if (!clusters.enabled && !shadows.enabled)
+        return albedo;
+
+    //view space position rebuilt from the pixel, projection holds 1 / p00, 1 / p11, p22 and p32
+    float2 uv = (input.pos.xy - clusters.viewport.xy) * clusters.viewport.zw;
+    float depth = clusters.projection.w / (input.pos.z - clusters.projection.z);
+    float3 position = float3((uv.x * 2 - 1) * clusters.projection.x, (1 - uv.y * 2) * clusters.projection.y, 1) * depth;
+    float3 normal = normalize(cross(ddx(position), ddy(position)));
+
+    float3 lighting = clusters.ambient;
+
+    if (shadows.enabled)
+        lighting += shadows.sunColor * (saturate(dot(normal, shadows.sunDirection)) * ShadowVisibility(position, depth));
+
+    if (clusters.enabled)
+    {
+        uint2 tile = (uint2)clamp(uv * (float2)clusters.grid.xy, 0, (float2)clusters.grid.xy - 1);
+        uint slice = (uint)clamp(log2(depth) * clusters.sliceScale + clusters.sliceBias, 0, (float)clusters.grid.z - 1);
+        uint2 range = clusterRanges[(slice * clusters.grid.y + tile.y) * clusters.grid.x + tile.x];
+
+        for (uint i = 0; i < range.y; i++)
+        {
+            Light light = lights[lightIndices[range.x + i]];
+
+            float3 toLight = light.position - position;
+            float distanceSquared = dot(toLight, toLight);
+            float falloff = saturate(1 - distanceSquared / (light.radius * light.radius));
+
+            lighting += light.color * (falloff * falloff * saturate(dot(normal, toLight) * rsqrt(max(distanceSquared, 1e-6))));
+        }
+    }
+
+    return float4(albedo.rgb * lighting, albedo.a);
 }
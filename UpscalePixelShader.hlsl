@@ -0,0 +1,22 @@
+Texture2D t1 : register(t0);
+SamplerState s1 : register(s0);
+
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float2 texCoord : TEXCOORD;
+};
+
+struct UpscaleConstants
+{
+    float2 uvScale;
+    float2 uvMax;
+};
+
+ConstantBuffer<UpscaleConstants> upscale : register(b0);
+
+float4 main(VS_OUTPUT input) : SV_TARGET
+{
+    //the scene only fills the top left of the texture, keep the filter from reaching past it
+    return t1.Sample(s1, min(input.texCoord, upscale.uvMax));
+}
@@ -0,0 +1,24 @@
+struct VS_OUTPUT
+{
+    float4 pos : SV_POSITION;
+    float2 texCoord : TEXCOORD;
+};
+
+struct UpscaleConstants
+{
+    float2 uvScale;
+    float2 uvMax;
+};
+
+ConstantBuffer<UpscaleConstants> upscale : register(b0);
+
+//one triangle covering the target, no vertex buffer
+VS_OUTPUT main(uint id : SV_VertexID)
+{
+    float2 uv = float2((id << 1) & 2, id & 2);
+
+    VS_OUTPUT output;
+    output.pos = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    output.texCoord = uv * upscale.uvScale;
+    return output;
+}